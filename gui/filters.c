@@ -1212,7 +1212,7 @@ static int save_filtered_var (filter_info *finfo, double *x, int i,
     if (v == dataset->v) {
 	err = dataset_add_allocated_series(dataset, x);
     } else {
-	free(dataset->Z[v]);
+	series_data_free(dataset->Z[v]);
 	dataset->Z[v] = x;
 	series_set_discrete(dataset, v, 0);
     }
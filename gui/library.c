@@ -5301,6 +5301,7 @@ int do_rename_variable (int v, const char *newname,
 
     if (!err) {
 	strcpy(dataset->varname[v], newname);
+	series_index_invalidate();
 	mark_dataset_as_modified();
 	lib_command_sprintf("rename %d %s", v, newname);
 	record_command_verbatim();
@@ -63,6 +63,7 @@ struct ExecState_ {
     char *submask;        /* record of incoming sub-sample for functions */
     int padded;           /* record of incoming panel padding, if any */
     int in_comment;
+    GENERATOR **pgenr;    /* location for compiled "genr", if wanted */
     EXEC_CALLBACK callback;
 };
 
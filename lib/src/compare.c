@@ -708,8 +708,21 @@ static MODEL replicate_estimator (const MODEL *orig, int *list,
 
     cv = gretl_model_get_cluster_var(orig);
     if (cv > 0 && cv < dset->v) {
+	const int *clist = gretl_model_get_list(orig, "cluster_list");
+	char *cstr = NULL;
+	int cerr = 0;
+
 	myopt |= OPT_C;
-	set_optval_string(orig->ci, OPT_C, dset->varname[cv]);
+	if (clist != NULL) {
+	    /* multi-way clustering */
+	    cstr = gretl_list_get_names(clist, dset, &cerr);
+	}
+	if (cstr != NULL) {
+	    set_optval_string(orig->ci, OPT_C, cstr);
+	    free(cstr);
+	} else {
+	    set_optval_string(orig->ci, OPT_C, dset->varname[cv]);
+	}
     }
 
     if (orig->ci == AR1) {
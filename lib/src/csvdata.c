@@ -33,7 +33,12 @@
 # include "gretl_win32.h"
 #endif
 
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+
 #include <errno.h>
+#include <limits.h>
 
 #define CDEBUG 0    /* CSV reading in general */
 #define AGGDEBUG 0  /* aggregation in "join" */
@@ -121,6 +126,7 @@ struct csvdata_ {
     int masklen;
     joinspec *jspec; /* info used for "join" command */
     csvprobe *probe; /* used in connection with "join" */
+    GMappedFile *map; /* memory-mapped input, if applicable */
 };
 
 #define csv_has_trailing_comma(c) (c->flags & CSV_TRAIL)
@@ -303,6 +309,10 @@ static void csvdata_free (csvdata *c)
 	free(c->width_list);
     }
 
+    if (c->map != NULL) {
+	g_mapped_file_unref(c->map);
+    }
+
     destroy_dataset(c->dset);
 
     free(c);
@@ -345,6 +355,7 @@ static csvdata *csvdata_new (DATASET *dset)
 
     c->jspec = NULL;
     c->probe = NULL;
+    c->map = NULL;
 
     c->dset = datainfo_new();
 
@@ -530,7 +541,7 @@ static int add_single_obs (DATASET *dset)
     int i, err = 0;
 
     for (i=0; i<dset->v && !err; i++) {
-	x = realloc(dset->Z[i], (dset->n + 1) * sizeof *x);
+	x = series_data_realloc(dset->Z[i], dset->n + 1);
 	if (x != NULL) {
 	    dset->Z[i] = x;
 	} else {
@@ -1894,10 +1905,10 @@ static void purge_unquoted_spaces (char *s)
     }
 }
 
-static void compress_csv_line (csvdata *c, int nospace)
+static void compress_csv_line (csvdata *c, char *line, int nospace)
 {
-    int n = strlen(c->line);
-    char *p = c->line + n - 1;
+    int n = strlen(line);
+    char *p = line + n - 1;
 
     if (*p == 0x0a) {
 	*p = '\0';
@@ -1909,26 +1920,26 @@ static void compress_csv_line (csvdata *c, int nospace)
     }
 
     if (!csv_keep_quotes(c) && c->delim == ',') {
-	purge_quoted_commas(c->line);
+	purge_quoted_commas(line);
     }
 
     if (c->delim != ' ') {
 	if (nospace) {
-	    purge_unquoted_spaces(c->line);
+	    purge_unquoted_spaces(line);
 	}
     } else {
-	compress_spaces(c->line);
+	compress_spaces(line);
     }
 
     if (!csv_keep_quotes(c)) {
-        gretl_delchar('"', c->line);
+        gretl_delchar('"', line);
     }
 
     if (csv_has_trailing_comma(c)) {
 	/* chop trailing comma */
-	n = strlen(c->line);
+	n = strlen(line);
 	if (n > 0) {
-	    c->line[n-1] = '\0';
+	    line[n-1] = '\0';
 	}
     }
 }
@@ -2491,13 +2502,21 @@ static char *csv_unquote (char *s)
     return s;
 }
 
-static double csv_atof (csvdata *c, int i)
+/* Try converting @s to a double, allowing for thousands
+   separators and decimal comma as determined so far: on
+   success set @ok to 1 and return the value. This function
+   does not modify @c and so can be called from multiple
+   threads.
+*/
+
+static double csv_strtod (const csvdata *c, const char *s, int *ok)
 {
     char tmp[CSVSTRLEN], clean[CSVSTRLEN];
     double x = NON_NUMERIC;
-    const char *s = c->str;
     char *test;
 
+    *ok = 1;
+
     if (csv_scrub_thousep(c) && strchr(s, c->thousep) &&
 	all_digits_and_seps(s)) {
 	/* second pass through the data: pre-process fields
@@ -2539,9 +2558,25 @@ static double csv_atof (csvdata *c, int i)
 	}
     }
 
-    /* fallback */
-    /* revised 2020-02-13 to use csv_unquote */
-    return eval_non_numeric(c, i, csv_unquote(c->str));
+    *ok = 0;
+
+    return NON_NUMERIC;
+}
+
+static double csv_atof (csvdata *c, int i)
+{
+    double x;
+    int ok;
+
+    x = csv_strtod(c, c->str, &ok);
+
+    if (ok) {
+	return x;
+    } else {
+	/* fallback */
+	/* revised 2020-02-13 to use csv_unquote */
+	return eval_non_numeric(c, i, csv_unquote(c->str));
+    }
 }
 
 static int process_csv_obs (csvdata *c, int i, int t, int *miss_shown,
@@ -2716,7 +2751,7 @@ static int csv_fields_check (gzFile fp, csvdata *c, PRN *prn)
 	    }
 	}
 
-	compress_csv_line(c, 1);
+	compress_csv_line(c, c->line, 1);
 
 	if (!gotdata) {
 	    /* scrutinize the first "real" line */
@@ -3018,7 +3053,7 @@ static int csv_varname_scan (csvdata *c, gzFile fp, PRN *prn, PRN *mprn)
 
     c->datapos = gztell(fp);
 
-    compress_csv_line(c, 1);
+    compress_csv_line(c, c->line, 1);
 
     p = c->line;
     if (c->delim == ' ' && *p == ' ') p++;
@@ -3249,9 +3284,8 @@ static int maybe_fix_csv_string (gchar *s)
     return err;
 }
 
-static void transcribe_obs_label (csvdata *c, int t)
+static void transcribe_obs_label (csvdata *c, char *s, int t)
 {
-    char *s = c->str;
     char c0 = *s;
     int n = strlen(s);
 
@@ -3281,14 +3315,97 @@ static void transcribe_obs_label (csvdata *c, int t)
     gretl_utf8_strncat(c->dset->S[t], s, n);
 }
 
-static int real_read_labels_and_data (csvdata *c, gzFile fp, PRN *prn)
+/* Parse the data line @line into observation @t, using @str as
+   workspace for the content of each field. If @defer is non-NULL
+   we're being called from a worker thread: in that case we don't
+   touch any state in @c other than row @t of the data, and on
+   encountering a field that calls for more than a plain numeric
+   conversion we set @defer and return; the row must then be
+   redone serially with @defer = NULL.
+*/
+
+static int csv_read_row (csvdata *c, char *line, char *str, int t,
+			 int *missp, int *truncated, int *defer,
+			 PRN *prn)
 {
     char *p;
+    int inquote = 0;
+    int i, j, k, ok;
+    int err = 0;
+
+    compress_csv_line(c, line, 0);
+    p = line;
+
+    if (c->delim == ' ') {
+	if (*p == ' ') p++;
+    } else {
+	p += strspn(p, " ");
+    }
+
+    j = 1;
+    for (k=0; k<c->ncols && !err; k++) {
+	i = 0;
+	while (*p) {
+	    if (csv_keep_quotes(c) && *p == c->qchar) {
+		inquote = !inquote;
+	    } else if (!inquote && *p == c->delim) {
+		break;
+	    }
+	    if (i < CSVSTRLEN - 1) {
+		str[i++] = *p;
+	    } else {
+		*truncated += 1;
+	    }
+	    p++;
+	}
+	str[i] = '\0';
+	if (defer != NULL) {
+	    if (!g_utf8_validate(str, -1, NULL)) {
+		*defer = 1;
+		return 0;
+	    }
+	} else {
+	    err = maybe_fix_csv_string(str);
+	}
+	if (!err) {
+	    if (k == 0 && csv_skip_col_1(c) && c->dset->S != NULL) {
+		transcribe_obs_label(c, str, t);
+	    } else if (cols_subset(c) && skip_data_column(c, k)) {
+		; /* no-op */
+	    } else if (defer == NULL) {
+		err = process_csv_obs(c, j++, t, missp, prn);
+	    } else if (csv_missval(str, j, t+1, NULL, NULL)) {
+		c->dset->Z[j++][t] = NADBL;
+	    } else {
+		gretl_strstrip(str);
+		c->dset->Z[j][t] = csv_strtod(c, str, &ok);
+		if (!ok) {
+		    *defer = 1;
+		    return 0;
+		}
+		j++;
+	    }
+	}
+	if (!err) {
+	    /* prep for next column */
+	    if (*p == c->delim) {
+		p++;
+	    }
+	    if (c->delim != ' ') {
+		p += strspn(p, " ");
+	    }
+	}
+    }
+
+    return err;
+}
+
+static int real_read_labels_and_data (csvdata *c, gzFile fp, PRN *prn)
+{
     int miss_shown = 0;
     int *missp = NULL;
     int truncated = 0;
     int t = 0, s = 0;
-    int i, j, k;
     int err = 0;
 
     if (csv_is_verbose(c)) {
@@ -3298,8 +3415,6 @@ static int real_read_labels_and_data (csvdata *c, gzFile fp, PRN *prn)
     c->real_n = c->dset->n;
 
     while (csv_fgets(c, fp) && !err) {
-	int inquote = 0;
-
 	if (*c->line == '#' || string_is_blank(c->line)) {
 	    continue;
 	} else if (*c->skipstr != '\0' && strstr(c->line, c->skipstr)) {
@@ -3310,56 +3425,311 @@ static int real_read_labels_and_data (csvdata *c, gzFile fp, PRN *prn)
 	    continue;
 	}
 
-	compress_csv_line(c, 0);
-	p = c->line;
+	err = csv_read_row(c, c->line, c->str, t, missp, &truncated,
+			   NULL, prn);
 
-	if (c->delim == ' ') {
-	    if (*p == ' ') p++;
-	} else {
-	    p += strspn(p, " ");
+	s++;
+	if (++t == c->dset->n) {
+	    break;
 	}
+    }
 
-	j = 1;
-	for (k=0; k<c->ncols && !err; k++) {
-	    i = 0;
-	    while (*p) {
-		if (csv_keep_quotes(c) && *p == c->qchar) {
-		    inquote = !inquote;
-		} else if (!inquote && *p == c->delim) {
-		    break;
-		}
-		if (i < CSVSTRLEN - 1) {
-		    c->str[i++] = *p;
-		} else {
-		    truncated++;
-		}
-		p++;
+    if (truncated) {
+	pprintf(prn, A_("warning: %d labels were truncated.\n"), truncated);
+    }
+
+    if (!err && c->real_n < c->dset->n) {
+	int drop = c->dset->n - c->real_n;
+
+	err = dataset_drop_observations(c->dset, drop);
+    }
+
+    return err;
+}
+
+/* Support for reading the data from a memory-mapped CSV file,
+   using multiple threads if OpenMP is available. We first find
+   the starting point of each line (this is done in parallel,
+   chunk by chunk), then select the lines that hold wanted rows
+   of data, replicating the logic of real_read_labels_and_data().
+   The parsing and numeric conversion of the selected rows is
+   then farmed out to threads. Rows containing anything other
+   than numbers and NAs are flagged and re-read serially, in
+   order, since the handling of non-numeric values may update
+   the state of @c.
+*/
+
+#define CSV_MMAP_MIN (1 << 20)
+#define CSV_CHUNK_MIN (1 << 16)
+
+static int csv_is_line_start (const char *buf, const char *p)
+{
+    return p == buf || p[-1] == '\n' || (p[-1] == '\r' && *p != '\n');
+}
+
+/* Return the position of the end of the line starting at @s,
+   where @stop marks the end of the buffer: a line is terminated
+   by LF, CR or CR+LF.
+*/
+
+static const char *csv_line_end (const char *s, const char *stop)
+{
+    while (s < stop && *s != '\n' && *s != '\r') {
+	s++;
+    }
+
+    return s;
+}
+
+static int mapped_line_is_blank (const char *s, const char *e)
+{
+    while (s < e && *s) {
+	if (!isspace((unsigned char) *s) && *s != CTRLZ) {
+	    return 0;
+	}
+	s++;
+    }
+
+    return 1;
+}
+
+/* Find the offsets of all the lines in the @len bytes at @buf,
+   returning an array of length *@nlines, or NULL on failure.
+*/
+
+static gint64 *mapped_line_starts (const char *buf, gint64 len,
+				   int *nlines)
+{
+    gint64 *starts = NULL;
+    gint64 *counts = NULL;
+    int nchunks = 1;
+    int c, n = 0;
+
+#if defined(_OPENMP)
+    if (len >= 2 * CSV_CHUNK_MIN) {
+	nchunks = omp_get_max_threads();
+	while (nchunks > 1 && len / nchunks < CSV_CHUNK_MIN) {
+	    nchunks--;
+	}
+    }
+#endif
+
+    counts = calloc(nchunks + 1, sizeof *counts);
+    if (counts == NULL) {
+	return NULL;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (nchunks > 1)
+#endif
+    for (c=0; c<nchunks; c++) {
+	const char *p = buf + c * (len / nchunks);
+	const char *stop = (c == nchunks - 1) ? buf + len :
+	    buf + (c + 1) * (len / nchunks);
+	gint64 m = 0;
+
+	for ( ; p < stop; p++) {
+	    if (csv_is_line_start(buf, p)) {
+		m++;
 	    }
-	    c->str[i] = '\0';
-	    err = maybe_fix_csv_string(c->str);
-	    if (!err) {
-		if (k == 0 && csv_skip_col_1(c) && c->dset->S != NULL) {
-		    transcribe_obs_label(c, t);
-		} else if (cols_subset(c) && skip_data_column(c, k)) {
-		    ; /* no-op */
-		} else {
-		    err = process_csv_obs(c, j++, t, missp, prn);
+	}
+	counts[c+1] = m;
+    }
+
+    for (c=0; c<nchunks; c++) {
+	counts[c+1] += counts[c];
+    }
+
+    if (counts[nchunks] > INT_MAX) {
+	free(counts);
+	return NULL;
+    }
+
+    n = (int) counts[nchunks];
+    starts = malloc((n + 1) * sizeof *starts);
+
+    if (starts != NULL) {
+#if defined(_OPENMP)
+#pragma omp parallel for if (nchunks > 1)
+#endif
+	for (c=0; c<nchunks; c++) {
+	    const char *p = buf + c * (len / nchunks);
+	    const char *stop = (c == nchunks - 1) ? buf + len :
+		buf + (c + 1) * (len / nchunks);
+	    gint64 m = counts[c];
+
+	    for ( ; p < stop; p++) {
+		if (csv_is_line_start(buf, p)) {
+		    starts[m++] = p - buf;
 		}
 	    }
-	    if (!err) {
-		/* prep for next column */
-		if (*p == c->delim) {
-		    p++;
-		}
-		if (c->delim != ' ') {
-		    p += strspn(p, " ");
+	}
+	*nlines = n;
+    }
+
+    free(counts);
+
+    return starts;
+}
+
+/* Copy the content of the line at @s into @line, with a
+   terminating LF, as csv_fgets() would do.
+*/
+
+static void mapped_line_copy (char *line, const char *s,
+			      const char *e)
+{
+    size_t n = e - s;
+
+    memcpy(line, s, n);
+    line[n] = '\n';
+    line[n+1] = '\0';
+}
+
+/* If the CSV file @fname is big enough to make it worthwhile,
+   try mapping it into memory, for use by
+   mapped_read_labels_and_data(). Failure is not an error: we
+   just carry on with the regular reader.
+*/
+
+static void csv_map_file (csvdata *c, const char *fname)
+{
+    GMappedFile *map;
+
+    map = g_mapped_file_new(fname, FALSE, NULL);
+
+    if (map != NULL) {
+	if (g_mapped_file_get_length(map) >= CSV_MMAP_MIN &&
+	    g_mapped_file_get_contents(map) != NULL) {
+	    c->map = map;
+	} else {
+	    g_mapped_file_unref(map);
+	}
+    }
+}
+
+/* Returns 0 on success, -1 if the mapped read is not possible
+   (in which case the caller should fall back on the regular
+   reader), or a positive error code.
+*/
+
+static int mapped_read_labels_and_data (csvdata *c, PRN *prn)
+{
+    const char *buf = g_mapped_file_get_contents(c->map);
+    const char *stop = buf + g_mapped_file_get_length(c->map);
+    const char *data = buf + c->datapos;
+    gint64 *starts = NULL;
+    int *rows = NULL;
+    char *defer = NULL;
+    int nlines = 0;
+    int truncated = 0;
+    int nrows = 0;
+    int maxlen = c->maxlinelen - 2;
+    int t, i, s = 0;
+    int err = 0;
+
+    if (c->datapos < 0 || data >= stop) {
+	return -1;
+    }
+
+    starts = mapped_line_starts(data, stop - data, &nlines);
+    if (starts == NULL) {
+	return -1;
+    }
+
+    rows = malloc(c->dset->n * sizeof *rows);
+    defer = calloc(c->dset->n, 1);
+    if (rows == NULL || defer == NULL) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
+    c->real_n = c->dset->n;
+
+    /* select the lines holding wanted rows of data */
+    for (i=0; i<nlines && nrows < c->dset->n; i++) {
+	const char *p = data + starts[i];
+	const char *e = csv_line_end(p, stop);
+
+	if (e - p > maxlen) {
+	    /* shouldn't happen, but let csv_fgets() handle it */
+	    err = -1;
+	    goto bailout;
+	} else if (*p == '#' || mapped_line_is_blank(p, e)) {
+	    continue;
+	} else if (*c->skipstr != '\0' &&
+		   g_strstr_len(p, e - p, c->skipstr) != NULL) {
+	    c->real_n -= 1;
+	    continue;
+	} else if (row_not_wanted(c, s)) {
+	    s++;
+	    continue;
+	}
+	rows[nrows++] = i;
+	s++;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel if (libset_use_openmp((guint64) nrows * c->ncols)) \
+    reduction(+:truncated)
+#endif
+    {
+	char *line = malloc(c->maxlinelen + 1);
+	char *str = malloc(CSVSTRLEN);
+	int tt, myerr = 0;
+
+	if (line == NULL || str == NULL) {
+	    myerr = E_ALLOC;
+	}
+
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+	for (tt=0; tt<nrows; tt++) {
+	    const char *p = data + starts[rows[tt]];
+	    int dt = 0, tr = 0;
+
+	    if (myerr) {
+		continue;
+	    }
+	    mapped_line_copy(line, p, csv_line_end(p, stop));
+	    myerr = csv_read_row(c, line, str, tt, NULL, &tr,
+				 &dt, NULL);
+	    if (dt) {
+		/* truncation will be counted on the re-read */
+		defer[tt] = 1;
+	    } else {
+		truncated += tr;
+	    }
+	}
+
+	if (myerr) {
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+	    {
+		if (!err) {
+		    err = myerr;
 		}
 	    }
 	}
 
-	s++;
-	if (++t == c->dset->n) {
-	    break;
+	free(line);
+	free(str);
+    }
+
+    if (err) {
+	goto bailout;
+    }
+
+    /* redo the flagged rows serially, in order */
+    for (t=0; t<nrows && !err; t++) {
+	if (defer[t]) {
+	    const char *p = data + starts[rows[t]];
+
+	    mapped_line_copy(c->line, p, csv_line_end(p, stop));
+	    err = csv_read_row(c, c->line, c->str, t, NULL, &truncated,
+			       NULL, prn);
 	}
     }
 
@@ -3373,6 +3743,12 @@ static int real_read_labels_and_data (csvdata *c, gzFile fp, PRN *prn)
 	err = dataset_drop_observations(c->dset, drop);
     }
 
+ bailout:
+
+    free(starts);
+    free(rows);
+    free(defer);
+
     return err;
 }
 
@@ -3412,9 +3788,16 @@ static int csv_read_data (csvdata *c, gzFile fp, PRN *prn, PRN *mprn)
 	}
     }
 
-    gzseek(fp, c->datapos, SEEK_SET);
+    if (c->map != NULL && c->st == NULL && !csv_is_verbose(c)) {
+	err = mapped_read_labels_and_data(c, prn);
+    } else {
+	err = -1;
+    }
 
-    err = real_read_labels_and_data(c, fp, prn);
+    if (err < 0) {
+	gzseek(fp, c->datapos, SEEK_SET);
+	err = real_read_labels_and_data(c, fp, prn);
+    }
 
     if (!err && csv_skip_col_1(c) && !rows_subset(c) && !csv_skip_dates(c)) {
 	c->markerpd = test_markers_for_dates(c->dset, &reversed,
@@ -3757,6 +4140,11 @@ static int real_import_csv (const char *fname,
 	goto csv_bailout;
     }
 
+    if (gzdirect(fp)) {
+	/* uncompressed input: try memory-mapping a big file */
+	csv_map_file(c, altname != NULL ? altname : fname);
+    }
+
     if (c->decpoint == '.' && get_local_decpoint() == ',') {
 	/* we're in a locale that uses decimal comma:
 	   switch to the C locale */
@@ -3806,6 +4194,11 @@ static int real_import_csv (const char *fname,
 	gretl_pop_c_numeric_locale();
     }
 
+    if (c->map != NULL) {
+	g_mapped_file_unref(c->map);
+	c->map = NULL;
+    }
+
     if (err) {
 	goto csv_bailout;
     }
@@ -4140,9 +4533,11 @@ struct joiner_ {
     int n_keys;     /* number of keys used (0, 1 or 2) */
     int n_unique;   /* number of unique primary key values on right */
     jr_row *rows;   /* array of table rows */
-    keynum *keys;   /* array of unique (primary) key values as 64-bit ints */
+    keynum *keys;   /* array of unique (primary) key values */
     int *key_freq;  /* counts of occurrences of (primary) key values */
     int *key_row;   /* record of starting row in joiner table for primary keys */
+    int *htab;      /* hash table: positions in @keys, or -1 for empty */
+    guint32 hmask;  /* size of @htab, minus 1 */
     int *str_keys;  /* flags for string comparison of key(s) */
     const int *l_keyno; /* list of key columns in left-hand dataset */
     const int *r_keyno; /* list of key columns in right-hand dataset */
@@ -4151,6 +4546,7 @@ struct joiner_ {
     int auxcol;         /* auxiliary data column for aggregation */
     int midas_m;        /* midas frequency ratio */
     int midas_pd;       /* frequency of outer dataset */
+    int dupkey;         /* got 1:n match without aggregation method */
     obskey *auto_keys;  /* struct to hold info on obs-based key(s) */
     DATASET *l_dset;    /* the left-hand or inner dataset */
     DATASET *r_dset;    /* the right-hand or outer temporary dataset */
@@ -4187,6 +4583,7 @@ static void joiner_destroy (joiner *jr)
 	free(jr->keys);
 	free(jr->key_freq);
 	free(jr->key_row);
+	free(jr->htab);
 	free(jr);
     }
 }
@@ -4209,6 +4606,9 @@ static joiner *joiner_new (int nrows)
 	jr->keys = NULL;
 	jr->key_freq = NULL;
 	jr->key_row = NULL;
+	jr->htab = NULL;
+	jr->hmask = 0;
+	jr->dupkey = 0;
 	jr->l_keyno = NULL;
 	jr->r_keyno = NULL;
     }
@@ -4628,52 +5028,81 @@ static joiner *build_joiner (joinspec *jspec,
     return jr;
 }
 
-/* qsort callback for sorting rows of the joiner struct */
+/* Hash function for (primary) key values: keys are matched for
+   exact equality, so we just scramble the bits of the double,
+   taking care that 0 and -0 hash alike.
+*/
 
-static int compare_jr_rows (const void *a, const void *b)
+static guint32 keynum_hash (keynum k)
 {
-    const jr_row *ra = a;
-    const jr_row *rb = b;
-    int ret;
+    guint64 u;
+
+    if (k == 0) {
+	k = 0;
+    }
 
-    ret = (ra->keyval > rb->keyval) - (ra->keyval < rb->keyval);
+    memcpy(&u, &k, sizeof u);
+    u ^= u >> 33;
+    u *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    u ^= u >> 33;
+    u *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    u ^= u >> 33;
 
-    if (ret == 0 && ra->n_keys > 1) {
-	ret = (ra->keyval2 > rb->keyval2) - (ra->keyval2 < rb->keyval2);
+    return (guint32) u;
+}
+
+/* Look up the (primary) key value @k in the hash table of the
+   joiner: return its position in the array of unique outer key
+   values, or -1 for no match.
+*/
+
+static int joiner_lookup (const joiner *jr, keynum k)
+{
+    guint32 h;
+    int pos;
+
+    if (jr->htab == NULL) {
+	return -1;
     }
 
-    if (ret == 0) {
-	/* ensure stable sort */
-	ret = a - b > 0 ? 1 : -1;
+    h = keynum_hash(k) & jr->hmask;
+
+    while ((pos = jr->htab[h]) >= 0) {
+	if (jr->keys[pos] == k) {
+	    return pos;
+	}
+	h = (h + 1) & jr->hmask;
     }
 
-    return ret;
+    return -1;
 }
 
-/* Sort the rows of the joiner struct, by either one or two keys, then
-   figure out how many unique (primary) key values we have and
-   construct (a) an array of frequency of occurrence of these values
-   and (b) an array which records the first row of the joiner on
-   which each of these values is found.
+/* Map from the string indices of key(s) on the right to those for
+   the same strings on the left, and drop any rows whose key string
+   has no match on the left, preserving the order of the rows.
 */
 
-static int joiner_sort (joiner *jr)
+static int joiner_map_string_keys (joiner *jr)
 {
-    int matches = jr->n_rows;
-    int i, err = 0;
+    char *drop;
+    int i, j, err = 0;
 
-    /* If there are string keys, we begin by mapping from the string
-       indices on the right -- held in the keyval and/or keyval2
-       members of the each joiner row -- to the indices for the same
-       strings on the left. This enables us to avoid doing string
-       comparisons when running aggr_value() later; we can just
-       compare the indices of the strings. In addition, if on any
-       given row we get no match for the right-hand key string on the
-       left (signalled by a strmap value of -1) we can exploit this
-       information by shuffling such rows to the end of the joiner
-       rectangle and ignoring them when aggregating.
+    /* If there are string keys, we map from the string indices on
+       the right -- held in the keyval and/or keyval2 members of the
+       each joiner row -- to the indices for the same strings on the
+       left. This enables us to avoid doing string comparisons when
+       running aggr_value() later; we can just compare the indices of
+       the strings. In addition, if on any given row we get no match
+       for the right-hand key string on the left (signalled by a
+       strmap value of -1) we can drop the row, since it can play no
+       part in aggregation.
     */
 
+    drop = calloc(jr->n_rows, 1);
+    if (drop == NULL) {
+	return E_ALLOC;
+    }
+
     if (jr->str_keys[0] || jr->str_keys[1]) {
 	series_table *stl, *str;
 	int *strmap;
@@ -4693,10 +5122,10 @@ static int joiner_sort (joiner *jr)
 	    }
 
 	    for (i=0; i<jr->n_rows; i++) {
-		if (k == 1) {
-		    rkeyval = jr->rows[i].keyval;
-		} else if (jr->rows[i].keyval == INT_MAX) {
+		if (drop[i]) {
 		    continue;
+		} else if (k == 1) {
+		    rkeyval = jr->rows[i].keyval;
 		} else {
 		    rkeyval = jr->rows[i].keyval2;
 		}
@@ -4711,9 +5140,7 @@ static int joiner_sort (joiner *jr)
 			jr->rows[i].keyval2 = lkeyval;
 		    }
 		} else {
-		    /* arrange for qsort to move row to end */
-		    jr->rows[i].keyval = G_MAXDOUBLE;
-		    matches--;
+		    drop[i] = 1;
 		}
 	    }
 
@@ -4721,60 +5148,111 @@ static int joiner_sort (joiner *jr)
 	}
     }
 
-    if (err) {
-	return err;
+    if (!err) {
+	for (i=0, j=0; i<jr->n_rows; i++) {
+	    if (!drop[i]) {
+		if (j < i) {
+		    jr->rows[j] = jr->rows[i];
+		}
+		j++;
+	    }
+	}
+	jr->n_rows = j;
     }
 
-    qsort(jr->rows, jr->n_rows, sizeof *jr->rows, compare_jr_rows);
+    free(drop);
+
+    return err;
+}
+
+/* Build the hash table for the joiner: we find the unique (primary)
+   key values on the right and construct (a) an array of frequency
+   of occurrence of these values and (b) an array which records the
+   first row of the joiner on which each of these values is found.
+   The rows are then regrouped by primary key (a counting sort),
+   preserving their original order within each group.
+*/
+
+static int joiner_hash (joiner *jr)
+{
+    jr_row *rows = NULL;
+    int *rowkey = NULL;
+    int *next = NULL;
+    guint32 h, nh = 16;
+    int i, pos, n;
+    int err;
 
-    if (matches < jr->n_rows) {
-	jr->n_rows = matches;
+    err = joiner_map_string_keys(jr);
+    if (err || jr->n_rows == 0) {
+	return err;
     }
 
-    jr->n_unique = 1;
-    for (i=1; i<jr->n_rows; i++) {
-	if (jr->rows[i].keyval != jr->rows[i-1].keyval) {
-	    jr->n_unique += 1;
-	}
+    n = jr->n_rows;
+    while (nh < 2 * (guint32) n) {
+	nh *= 2;
     }
 
-    jr->keys = malloc(jr->n_unique * sizeof *jr->keys);
-    jr->key_freq = malloc(jr->n_unique * sizeof *jr->key_freq);
-    jr->key_row = malloc(jr->n_unique * sizeof *jr->key_row);
+    jr->htab = malloc(nh * sizeof *jr->htab);
+    jr->keys = malloc(n * sizeof *jr->keys);
+    jr->key_freq = calloc(n, sizeof *jr->key_freq);
+    jr->key_row = malloc(n * sizeof *jr->key_row);
+    rowkey = malloc(n * sizeof *rowkey);
+    rows = malloc(n * sizeof *rows);
 
-    if (jr->keys == NULL || jr->key_freq == NULL || jr->key_row == NULL) {
+    if (jr->htab == NULL || jr->keys == NULL || jr->key_freq == NULL ||
+	jr->key_row == NULL || rowkey == NULL || rows == NULL) {
 	err = E_ALLOC;
-    } else {
-	int j = 0, nj = 1;
+	goto bailout;
+    }
 
-	for (i=0; i<jr->n_unique; i++) {
-	    jr->key_freq[i] = 0;
-	}
+    jr->hmask = nh - 1;
+    for (h=0; h<nh; h++) {
+	jr->htab[h] = -1;
+    }
 
-	jr->keys[0] = jr->rows[0].keyval;
-	jr->key_row[0] = 0;
+    /* build: find or insert each primary key value */
+    for (i=0; i<n; i++) {
+	keynum k = jr->rows[i].keyval;
 
-	for (i=1; i<jr->n_rows; i++) {
-	    if (jr->rows[i].keyval != jr->rows[i-1].keyval) {
-		/* finalize info for key j */
-		jr->keys[j] = jr->rows[i-1].keyval;
-		jr->key_freq[j] = nj;
-		/* and initialize for next key */
-		nj = 1;
-		if (j < jr->n_unique - 1) {
-		    jr->key_row[j+1] = i;
-		}
-		j++;
-	    } else {
-		nj++;
-	    }
+	h = keynum_hash(k) & jr->hmask;
+	while ((pos = jr->htab[h]) >= 0 && jr->keys[pos] != k) {
+	    h = (h + 1) & jr->hmask;
 	}
+	if (pos < 0) {
+	    pos = jr->n_unique;
+	    jr->keys[pos] = k;
+	    jr->htab[h] = pos;
+	    jr->n_unique += 1;
+	}
+	jr->key_freq[pos] += 1;
+	rowkey[i] = pos;
+    }
 
-	/* make sure the last row is right */
-	jr->keys[j] = jr->rows[i-1].keyval;
-	jr->key_freq[j] = nj;
+    next = malloc(jr->n_unique * sizeof *next);
+    if (next == NULL) {
+	err = E_ALLOC;
+	goto bailout;
     }
 
+    jr->key_row[0] = next[0] = 0;
+    for (i=1; i<jr->n_unique; i++) {
+	jr->key_row[i] = next[i] = jr->key_row[i-1] + jr->key_freq[i-1];
+    }
+
+    for (i=0; i<n; i++) {
+	rows[next[rowkey[i]]++] = jr->rows[i];
+    }
+
+    free(jr->rows);
+    jr->rows = rows;
+    rows = NULL;
+
+ bailout:
+
+    free(rowkey);
+    free(rows);
+    free(next);
+
     return err;
 }
 
@@ -4840,30 +5318,12 @@ static int seqval_out_of_bounds (joiner *jr, int seqmax)
     }
 }
 
-/* Do a binary search for the left-hand key value @targ in the sorted
-   array of unique right-hand key values, @vals; return the position
-   among @vals at which @targ matches, or -1 for no match.
-*/
-
-static int binsearch (keynum targ, const keynum *vals, int n, int offset)
-{
-    int m = n/2;
-
-    if (fabs((targ) - (vals[m])) < 1.0e-7) {
-	return m + offset;
-    } else if (targ < vals[0] || targ > vals[n-1]) {
-	return -1;
-    } else if (targ < vals[m]) {
-	return binsearch(targ, vals, m, offset);
-    } else {
-	return binsearch(targ, vals + m, n - m, offset + m);
-    }
-}
-
 /* In some cases we can figure out what aggr_value() should return
    just based on the number of matches, @n, and the characteristics
    of the joiner. If so, write the value into @x and return 1; if
-   not, return 0.
+   not, return 0. Note that this may be called from multiple threads,
+   so in case of error we leave it to aggregate_data() to set the
+   error message.
 */
 
 static int aggr_val_determined (joiner *jr, int n, double *x, int *err)
@@ -4882,8 +5342,11 @@ static int aggr_val_determined (joiner *jr, int n, double *x, int *err)
 	fprintf(stderr, "aggr_val_determined(): got n=%d\n", n);
 #endif
 	*err = E_DATA;
-	gretl_errmsg_set(_("You need to specify an aggregation "
-			   "method for a 1:n join"));
+	/* may be running threaded: see aggregate_series_mt() */
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+	jr->dupkey = 1;
 	*x = NADBL;
 	return 1;
     } else {
@@ -4937,7 +5400,7 @@ static double aggr_value (joiner *jr,
 
     /* find the position of the inner (primary) key in the
        array of unique outer key values */
-    pos = binsearch(key1, jr->keys, jr->n_unique, 0);
+    pos = joiner_lookup(jr, key1);
 
 #if AGGDEBUG
     if (pos < 0) {
@@ -5211,6 +5674,123 @@ static int outer_series_index (joinspec *jspec, int i)
     }
 }
 
+/* Work out the value to be imported for observation @t of series
+   @lv in the left-hand dataset, from series @rv on the right. The
+   arrays @xmatch and @auxmatch are workspace for aggr_value();
+   @rst and @lst are non-NULL only if both series are string-valued.
+*/
+
+static int aggregate_obs (joiner *jr, int t, const int *ikeyvars,
+			  int lv, int rv, int revseq, int orig_v,
+			  series_table *rst, series_table *lst,
+			  double *xmatch, double *auxmatch,
+			  int *modified)
+{
+    DATASET *dset = jr->l_dset;
+    keynum key, key2 = 0;
+    int missing = 0;
+    int nomatch = 0;
+    double z;
+    int err;
+
+    err = get_inner_key_values(jr, t, ikeyvars, &key, &key2, &missing);
+
+    if (err) {
+	return err;
+    } else if (missing) {
+	dset->Z[lv][t] = NADBL;
+	return 0;
+    }
+
+    z = aggr_value(jr, key, key2, rv, revseq, xmatch, auxmatch,
+		   &nomatch, &err);
+#if AGGDEBUG
+    if (na(z)) {
+	fprintf(stderr, " aggr_value: got NA (keys=%g,%g, err=%d)\n",
+		key, key2, err);
+    } else {
+	fprintf(stderr, " aggr_value: got %.12g (keys=%g,%g, err=%d)\n",
+		z, key, key2, err);
+    }
+#endif
+    if (!err && rst != NULL && lst != NULL && !na(z)) {
+	z = maybe_adjust_string_code(rst, lst, z, &err);
+    }
+    if (!err) {
+	if (lv >= orig_v) {
+	    /* @lv is a newly added series */
+	    dset->Z[lv][t] = z;
+	} else if (z != dset->Z[lv][t]) {
+	    if (nomatch && !na(dset->Z[lv][t])) {
+		; /* leave existing data alone (?) */
+	    } else {
+		dset->Z[lv][t] = z;
+		*modified += 1;
+	    }
+	}
+    }
+
+    return err;
+}
+
+/* Multi-threaded variant of the loop over observations in
+   aggregate_data(), for use when neither MIDAS nor string
+   recoding is involved: each thread gets its own workspace
+   for aggr_value().
+*/
+
+static int aggregate_series_mt (joiner *jr, const int *ikeyvars,
+				int lv, int rv, int orig_v, int nmax,
+				int *modified)
+{
+    DATASET *dset = jr->l_dset;
+    int nmod = 0;
+    int err = 0;
+
+#if defined(_OPENMP)
+#pragma omp parallel reduction(+:nmod)
+#endif
+    {
+	int nx = (jr->auxcol > 0)? 2 * nmax : nmax;
+	double *xmatch = malloc(nx * sizeof *xmatch);
+	double *auxmatch = NULL;
+	int t, myerr = 0;
+
+	if (xmatch == NULL) {
+	    myerr = E_ALLOC;
+	} else if (jr->auxcol) {
+	    auxmatch = xmatch + nmax;
+	}
+
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+	for (t=dset->t1; t<=dset->t2; t++) {
+	    if (!myerr) {
+		myerr = aggregate_obs(jr, t, ikeyvars, lv, rv, 0, orig_v,
+				      NULL, NULL, xmatch, auxmatch, &nmod);
+	    }
+	}
+
+	if (myerr) {
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+	    {
+		if (!err) {
+		    err = myerr;
+		}
+	    }
+	}
+
+	free(xmatch);
+    }
+
+    *modified += nmod;
+
+    return err;
+}
+
 static int aggregate_data (joiner *jr, const int *ikeyvars,
 			   const int *targvars, joinspec *jspec,
 			   int orig_v, int *modified)
@@ -5220,7 +5800,7 @@ static int aggregate_data (joiner *jr, const int *ikeyvars,
     DATASET *dset = jr->l_dset;
     double *xmatch = NULL;
     double *auxmatch = NULL;
-    keynum key, key2 = 0;
+    int nobs = dset->t2 - dset->t1 + 1;
     int revseq = 0;
     int i, t, nmax;
     int err = 0;
@@ -5270,6 +5850,7 @@ static int aggregate_data (joiner *jr, const int *ikeyvars,
 	    jr->midas_pd = 0;
 	}
 
+	rst = lst = NULL;
 	if (rv > 0) {
 	    /* check for the case where both the target variable on the
 	       left and the series to be imported are string-valued
@@ -5285,46 +5866,14 @@ static int aggregate_data (joiner *jr, const int *ikeyvars,
 	   imported from the right
 	*/
 
-	for (t=dset->t1; t<=dset->t2 && !err; t++) {
-	    int missing = 0;
-	    int nomatch = 0;
-	    double z;
-
-	    err = get_inner_key_values(jr, t, ikeyvars, &key, &key2, &missing);
-
-	    if (err) {
-		break;
-	    } else if (missing) {
-		dset->Z[lv][t] = NADBL;
-		continue;
-	    }
-
-	    z = aggr_value(jr, key, key2, rv, revseq, xmatch, auxmatch,
-			   &nomatch, &err);
-#if AGGDEBUG
-	    if (na(z)) {
-		fprintf(stderr, " aggr_value: got NA (keys=%g,%g, err=%d)\n",
-			key, key2, err);
-	    } else {
-		fprintf(stderr, " aggr_value: got %.12g (keys=%g,%g, err=%d)\n",
-			z, key, key2, err);
-	    }
-#endif
-	    if (!err && strcheck && !na(z)) {
-		z = maybe_adjust_string_code(rst, lst, z, &err);
-	    }
-	    if (!err) {
-		if (lv >= orig_v) {
-		    /* @lv is a newly added series */
-		    dset->Z[lv][t] = z;
-		} else if (z != dset->Z[lv][t]) {
-		    if (nomatch && !na(dset->Z[lv][t])) {
-			; /* leave existing data alone (?) */
-		    } else {
-			dset->Z[lv][t] = z;
-			*modified += 1;
-		    }
-		}
+	if (!strcheck && jr->aggr != AGGR_MIDAS && nmax > 0 &&
+	    libset_use_openmp((guint64) nobs * nmax)) {
+	    err = aggregate_series_mt(jr, ikeyvars, lv, rv, orig_v,
+				      nmax, modified);
+	} else {
+	    for (t=dset->t1; t<=dset->t2 && !err; t++) {
+		err = aggregate_obs(jr, t, ikeyvars, lv, rv, revseq, orig_v,
+				    rst, lst, xmatch, auxmatch, modified);
 	    }
 	}
 
@@ -5345,6 +5894,12 @@ static int aggregate_data (joiner *jr, const int *ikeyvars,
 	revseq--;
     }
 
+    if (err == E_DATA && jr->dupkey) {
+	/* see aggr_val_determined() */
+	gretl_errmsg_set(_("You need to specify an aggregation "
+			   "method for a 1:n join"));
+    }
+
     free(xmatch);
 
     return err;
@@ -7052,7 +7607,7 @@ int gretl_join_data (const char *fname,
 	pprintf(prn, "Filter: %d rows were selected\n", jr->n_rows);
     }
 
-    /* Step 7: transcribe more info and sort the "joiner" struct */
+    /* Step 7: transcribe more info and hash the "joiner" struct */
 
     if (!err) {
 	jr->n_keys = n_keys;
@@ -7060,7 +7615,7 @@ int gretl_join_data (const char *fname,
 	jr->l_keyno = ikeyvars;
 	jr->r_keyno = okeyvars;
 	if (jr->n_keys > 0) {
-	    err = joiner_sort(jr);
+	    err = joiner_hash(jr);
 	}
 #if CDEBUG > 1
 	if (!err) joiner_print(jr);
@@ -35,6 +35,10 @@
 
 #include <glib.h>
 
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+
 #define MERGE_DEBUG 0
 
 /**
@@ -836,7 +840,7 @@ format_from_opt_or_name (gretlopt opt, const char *fname,
     GretlDataFormat fmt = GRETL_FMT_GDT;
 
     if (has_suffix(fname, ".gdt")) {
-	if (non_native(opt)) {
+	if (non_native(opt) || (opt & OPT_K)) {
 	    *err = E_BADOPT;
 	}
 	return GRETL_FMT_GDT;
@@ -845,6 +849,10 @@ format_from_opt_or_name (gretlopt opt, const char *fname,
 	    *err = E_BADOPT;
 	}
 	return GRETL_FMT_BINARY;
+    } else if (opt & OPT_K) {
+	/* --chunked is specific to .gdtb */
+	*err = E_BADOPT;
+	return fmt;
     }
 
     if (opt & OPT_M) {
@@ -923,89 +931,301 @@ void date_maj_min (int t, const DATASET *dset, int *maj, int *min)
 
 #define TMPLEN 64
 
-static void csv_data_out (const DATASET *dset, const int *list,
-			  int print_obs, int digits, char decpoint,
-			  char delim, FILE *fp, gzFile fz)
+/* size of the buffer in which CSV output is assembled */
+#define CSV_OUTBUF (1 << 20)
+
+static const double pow10_tab[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Print @x into @s (which must be at least TMPLEN bytes, enough
+   for the sprintf fallback at the maximum csv_digits of 25) just as
+   sprintf(s, "%.*g", digits, x) would in the C locale, and return
+   the number of bytes written. For a value which can be written
+   exactly in at most @digits <= 15 significant figures -- the
+   normal case for imported data -- we get the digits by scaling
+   by a power of 10 and check that the result reads back as @x;
+   then no correct-rounding issues arise and we can lay out the
+   string ourselves. Anything else goes via sprintf.
+*/
+
+static int fast_print_g (char *s, double x, int digits)
 {
-    const char *NA = get_csv_na_write_string();
+    char dig[16];
+    double ax = fabs(x);
+    gint64 m = 0;
+    int e, p = 0, i, L, n = 0;
+    int ok = 0;
+
+    if (x == 0) {
+	return sprintf(s, signbit(x) ? "-0" : "0");
+    } else if (digits > 15 || !isfinite(x)) {
+	return sprintf(s, "%.*g", digits, x);
+    }
+
+    e = (int) floor(log10(ax));
+
+    for (i=0; i<2 && !ok; i++) {
+	p = digits - 1 - e;
+	if (p > 22 || p < -22) {
+	    break;
+	}
+	m = (gint64) ((p >= 0 ? ax * pow10_tab[p] : ax / pow10_tab[-p]) + 0.5);
+	if (m >= (gint64) pow10_tab[digits]) {
+	    e++;
+	} else if (m < (gint64) pow10_tab[digits-1]) {
+	    e--;
+	} else {
+	    ok = 1;
+	}
+    }
+
+    if (ok) {
+	/* does the decimal value read back as @x? */
+	double z = p >= 0 ? m / pow10_tab[p] : m * pow10_tab[-p];
+
+	ok = (z == ax);
+    }
+
+    if (!ok) {
+	return sprintf(s, "%.*g", digits, x);
+    }
+
+    /* the significant digits, less trailing zeros */
+    for (L=digits; m % 10 == 0; L--) {
+	m /= 10;
+    }
+    for (i=L-1; i>=0; i--) {
+	dig[i] = '0' + m % 10;
+	m /= 10;
+    }
+
+    if (x < 0) {
+	s[n++] = '-';
+    }
+
+    if (e < -4 || e >= digits) {
+	/* exponential format */
+	s[n++] = dig[0];
+	if (L > 1) {
+	    s[n++] = '.';
+	    for (i=1; i<L; i++) {
+		s[n++] = dig[i];
+	    }
+	}
+	n += sprintf(s + n, "e%c%02d", e < 0 ? '-' : '+', abs(e));
+    } else if (e >= 0) {
+	for (i=0; i<=e; i++) {
+	    s[n++] = i < L ? dig[i] : '0';
+	}
+	if (L > e + 1) {
+	    s[n++] = '.';
+	    for (i=e+1; i<L; i++) {
+		s[n++] = dig[i];
+	    }
+	}
+    } else {
+	s[n++] = '0';
+	s[n++] = '.';
+	for (i=e+1; i<0; i++) {
+	    s[n++] = '0';
+	}
+	for (i=0; i<L; i++) {
+	    s[n++] = dig[i];
+	}
+    }
+
+    s[n] = '\0';
+
+    return n;
+}
+
+/* settings for the formatting of CSV data rows */
+
+typedef struct csv_outspec_ csv_outspec;
+
+struct csv_outspec_ {
+    const DATASET *dset;
+    const int *list;  /* series to write */
+    const char *NA;   /* string representing missing values */
+    int print_obs;    /* print observation strings? */
+    int digits;       /* precision for "%g" */
+    char decpoint;    /* decimal character */
+    char delim;       /* delimiter */
+};
+
+/* Write row @t of the CSV data into @s, which must have room for
+   csv_row_max() bytes, and return the number of bytes written.
+   Numerical values are formatted in the C locale, with @decpoint
+   substituted for the dot if need be.
+*/
+
+static int csv_format_row (char *s, const csv_outspec *cs, int t)
+{
+    const DATASET *dset = cs->dset;
+    const int *list = cs->list;
     char tmp[TMPLEN];
     double xt;
-    int popit = 0, dotsub = 0;
-    int t, i, vi;
+    int i, k, vi, n = 0;
 
-    if (decpoint == '.' && get_local_decpoint() == ',') {
-	gretl_push_c_numeric_locale();
-	popit = 1;
-    } else if (decpoint == ',' && get_local_decpoint() == '.') {
-	dotsub = 1;
+    if (cs->print_obs) {
+	if (dset->S != NULL) {
+	    n += sprintf(s, "\"%s\"%c", dset->S[t], cs->delim);
+	} else {
+	    ntolabel(tmp, t, dset);
+	    if (quarterly_or_monthly(dset)) {
+		modify_date_for_csv(tmp, dset->pd);
+	    }
+	    n += sprintf(s, "%s%c", tmp, cs->delim);
+	}
     }
 
-    for (t=dset->t1; t<=dset->t2; t++) {
-	if (print_obs) {
-	    if (dset->S != NULL) {
-		if (fz != NULL) {
-		    gzprintf(fz, "\"%s\"%c", dset->S[t], delim);
-		} else {
-		    fprintf(fp, "\"%s\"%c", dset->S[t], delim);
-		}
+    for (i=1; i<=list[0]; i++) {
+	vi = list[i];
+	xt = dset->Z[vi][t];
+	if (na(xt)) {
+	    n += sprintf(s + n, "%s", cs->NA);
+	} else if (is_string_valued(dset, vi)) {
+	    const char *st;
+
+	    st = series_get_string_for_obs(dset, vi, t);
+	    if (st != NULL) {
+		*tmp = '\0';
+		strcat(tmp, "\"");
+		strncat(tmp, st, TMPLEN - 3);
+		strcat(tmp, "\"");
 	    } else {
-		ntolabel(tmp, t, dset);
-		if (quarterly_or_monthly(dset)) {
-		    modify_date_for_csv(tmp, dset->pd);
-		}
-		if (fz != NULL) {
-		    gzprintf(fz, "%s%c", tmp, delim);
-		} else {
-		    fprintf(fp, "%s%c", tmp, delim);
-		}
+		fprintf(stderr, "missing string at t=%d, vi=%d, xt=%g\n",
+			t, vi, xt);
+		strcpy(tmp, "\"NA\"");
+	    }
+	    n += sprintf(s + n, "%s", tmp);
+	} else if (series_is_coded(dset, vi)) {
+	    n += sprintf(s + n, "\"%d\"", (int) xt);
+	} else {
+	    k = fast_print_g(s + n, xt, cs->digits);
+	    if (cs->decpoint != '.') {
+		gretl_charsub(s + n, '.', cs->decpoint);
 	    }
+	    n += k;
 	}
+	s[n++] = i < list[0] ? cs->delim : '\n';
+    }
 
-	for (i=1; i<=list[0]; i++) {
-	    vi = list[i];
-	    xt = dset->Z[vi][t];
-	    if (na(xt)) {
-		fputs(NA, fp);
-	    } else {
-		if (is_string_valued(dset, vi)) {
-		    const char *st;
-
-		    st = series_get_string_for_obs(dset, vi, t);
-		    if (st != NULL) {
-			*tmp = '\0';
-			strcat(tmp, "\"");
-			strncat(tmp, st, TMPLEN - 3);
-			strcat(tmp, "\"");
-		    } else {
-			fprintf(stderr, "missing string at t=%d, vi=%d, xt=%g\n",
-				t, vi, xt);
-			strcpy(tmp, "\"NA\"");
-		    }
-		} else if (series_is_coded(dset, vi)) {
-		    sprintf(tmp, "\"%d\"", (int) xt);
-		} else {
-		    sprintf(tmp, "%.*g", digits, xt);
-		}
-		if (dotsub) {
-		    gretl_charsub(tmp, '.', ',');
-		}
-		if (fz != NULL) {
-		    gzputs(fz, tmp);
-		} else {
-		    fputs(tmp, fp);
-		}
-	    }
-	    if (fz != NULL) {
-		gzputc(fz, i < list[0] ? delim : '\n');
-	    } else {
-		fputc(i < list[0] ? delim : '\n', fp);
+    s[n] = '\0';
+
+    return n;
+}
+
+/* the maximum length of a row of CSV data, including the
+   terminating nul byte */
+
+static size_t csv_row_max (const csv_outspec *cs)
+{
+    return OBSLEN + 4 + cs->list[0] * (TMPLEN + strlen(cs->NA) + 2);
+}
+
+static int csv_output (FILE *fp, gzFile fz, const char *s, size_t n)
+{
+    if (n == 0) {
+	return 0;
+    } else if (fz != NULL) {
+	return gzwrite(fz, s, n) != (int) n ? E_DATA : 0;
+    } else {
+	return fwrite(s, 1, n, fp) != n ? E_DATA : 0;
+    }
+}
+
+/* Write the data rows of a CSV file. The rows are formatted into
+   a large buffer which is then written in one go; and when the
+   job is big enough and OpenMP is available, blocks of rows are
+   formatted in parallel, each thread having its own buffer, with
+   the buffers written out in order.
+*/
+
+static int csv_data_out (const DATASET *dset, const int *list,
+			 int print_obs, int digits, char decpoint,
+			 char delim, FILE *fp, gzFile fz)
+{
+    csv_outspec cs;
+    size_t rowmax;
+    int T = dset->t2 - dset->t1 + 1;
+    int nt = 1, blk, t0;
+    char **bufs;
+    size_t *lens;
+    int j, err = 0;
+
+    cs.dset = dset;
+    cs.list = list;
+    cs.NA = get_csv_na_write_string();
+    cs.print_obs = print_obs;
+    cs.digits = digits;
+    cs.decpoint = decpoint;
+    cs.delim = delim;
+
+    rowmax = csv_row_max(&cs);
+
+    /* rows per thread per block: aim at filling CSV_OUTBUF */
+    blk = CSV_OUTBUF / rowmax;
+    if (blk < 16) {
+	blk = 16;
+    }
+
+#if defined(_OPENMP)
+    if (T > 256 && libset_use_openmp((guint64) T * list[0])) {
+	nt = omp_get_max_threads();
+    }
+#endif
+
+    if (T < nt * blk) {
+	/* don't allocate more than we need */
+	blk = (T + nt - 1) / nt;
+    }
+
+    bufs = calloc(nt, sizeof *bufs);
+    lens = calloc(nt, sizeof *lens);
+    if (bufs == NULL || lens == NULL) {
+	err = E_ALLOC;
+    }
+    for (j=0; j<nt && !err; j++) {
+	bufs[j] = malloc(blk * rowmax);
+	if (bufs[j] == NULL) {
+	    err = E_ALLOC;
+	}
+    }
+
+    /* ensure that numerical values are written with dot decimal */
+    gretl_push_c_numeric_locale();
+
+    for (t0=dset->t1; t0<=dset->t2 && !err; t0+=nt*blk) {
+#if defined(_OPENMP)
+#pragma omp parallel for if (nt > 1) num_threads(nt)
+#endif
+	for (j=0; j<nt; j++) {
+	    int t = t0 + j * blk;
+	    int tmax = MIN(t + blk - 1, dset->t2);
+
+	    lens[j] = 0;
+	    for (; t<=tmax; t++) {
+		lens[j] += csv_format_row(bufs[j] + lens[j], &cs, t);
 	    }
 	}
+	for (j=0; j<nt && !err; j++) {
+	    err = csv_output(fp, fz, bufs[j], lens[j]);
+	}
     }
 
-    if (popit) {
-	gretl_pop_c_numeric_locale();
+    gretl_pop_c_numeric_locale();
+
+    for (j=0; j<nt && bufs != NULL; j++) {
+	free(bufs[j]);
     }
+    free(bufs);
+    free(lens);
+
+    return err;
 }
 
 static int markers_are_unique (const DATASET *dset)
@@ -1027,6 +1247,7 @@ static void R_data_out (const DATASET *dset, const int *list,
 			int digits, FILE *fp)
 {
     int print_markers = 0;
+    char numstr[TMPLEN];
     double xt;
     int t, i, vi;
 
@@ -1048,7 +1269,8 @@ static void R_data_out (const DATASET *dset, const int *list,
 	    } else if (series_is_coded(dset, vi)) {
 		fprintf(fp, "\"%d\"", (int) xt);
 	    } else {
-		fprintf(fp, "%.*g", digits, xt);
+		fast_print_g(numstr, xt, digits);
+		fputs(numstr, fp);
 	    }
 	    fputc(i < list[0] ? ' ' : '\n', fp);
 	}
@@ -1082,6 +1304,7 @@ static int real_write_data (const char *fname, int *list,
     int i, t, v, l0;
     GretlDataFormat fmt;
     char datfile[MAXLEN];
+    char numstr[TMPLEN];
     int n = dset->n;
     int pop_locale = 0;
     char delim = 0;
@@ -1212,8 +1435,8 @@ static int real_write_data (const char *fname, int *list,
 	    }
 	}
 
-	csv_data_out(dset, list, print_obs, csv_digits,
-		     decpoint, delim, fp, fz);
+	err = csv_data_out(dset, list, print_obs, csv_digits,
+			   decpoint, delim, fp, fz);
     } else if (fmt == GRETL_FMT_R) {
 	/* friendly to GNU R */
 	if (dataset_is_time_series(dset)) {
@@ -1243,7 +1466,9 @@ static int real_write_data (const char *fname, int *list,
 		if (na(xx)) {
 		    fputs("NaN ", fp);
 		} else {
-		    fprintf(fp, "%.*g\n", csv_digits, xx);
+		    fast_print_g(numstr, xx, csv_digits);
+		    fputs(numstr, fp);
+		    fputc('\n', fp);
 		}
 	    }
 	}
@@ -1273,7 +1498,8 @@ static int real_write_data (const char *fname, int *list,
 		if (na(xx)) {
 		    fprintf(fp, "-9999.99");
 		} else {
-		    fprintf(fp, "%.*g", csv_digits, xx);
+		    fast_print_g(numstr, xx, csv_digits);
+		    fputs(numstr, fp);
 		}
 		fputc('\n', fp);
 	    }
@@ -1311,7 +1537,9 @@ static int real_write_data (const char *fname, int *list,
 		if (na(dset->Z[v][t])) {
 		    fputs("NaN ", fp);
 		} else {
-		    fprintf(fp, "%.*g ", csv_digits, dset->Z[v][t]);
+		    fast_print_g(numstr, dset->Z[v][t], csv_digits);
+		    fputs(numstr, fp);
+		    fputc(' ', fp);
 		}
 	    }
 	    fputc('\n', fp);
@@ -2007,7 +2235,7 @@ static int merge_lengthen_series (DATASET *dset,
     for (i=0; i<dset->v && !err; i++) {
 	double *x;
 
-	x = realloc(dset->Z[i], new_n * sizeof *x);
+	x = series_data_realloc(dset->Z[i], new_n);
 	if (x == NULL) {
 	    err = E_ALLOC;
 	    break;
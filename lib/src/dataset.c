@@ -91,6 +91,143 @@ static void dataset_set_nobs (DATASET *dset, int n)
     }
 }
 
+/* Support for series whose values live in a memory-mapped binary
+   data file. When a big .gdtb file is opened, read_binary_data()
+   in gretl_xml.c may point columns of Z directly into a private,
+   writable mapping of the binary data rather than copying the
+   values into malloc'd arrays. The OS then reads pages of the file
+   only when they're first accessed, and copies a page into private
+   memory only on the first write to it, so the file itself is
+   never modified.
+
+   Such series must not be passed to free() or realloc(): code that
+   disposes of or resizes series should use series_data_free() and
+   series_data_realloc(), which handle both cases. A mapping is
+   released when the last series pointing into it is freed.
+*/
+
+typedef struct series_map_ series_map;
+
+struct series_map_ {
+    GMappedFile *mf;  /* the mapped file */
+    const char *buf;  /* its contents */
+    gsize len;        /* length of @buf in bytes */
+    int n;            /* length of each mapped series */
+    int refcount;     /* number of series pointing into @buf */
+};
+
+static series_map *series_maps;
+static int n_series_maps;
+
+static int series_map_lookup (const double *x)
+{
+    const char *p = (const char *) x;
+    int i;
+
+    for (i=0; i<n_series_maps; i++) {
+	if (p >= series_maps[i].buf &&
+	    p < series_maps[i].buf + series_maps[i].len) {
+	    return i;
+	}
+    }
+
+    return -1;
+}
+
+/**
+ * series_data_map_register:
+ * @mf: mapped file.
+ * @nseries: the number of series pointing into @mf.
+ * @n: the length of each such series.
+ *
+ * Records the fact that @nseries series of length @n have their
+ * data inside the (private, writable) mapping @mf. The caller's
+ * reference to @mf is taken over, and will be dropped once all
+ * of these series have been freed via series_data_free().
+ *
+ * Returns: 0 on success, non-zero on failure.
+ */
+
+int series_data_map_register (GMappedFile *mf, int nseries, int n)
+{
+    series_map *maps;
+    series_map *sm;
+
+    maps = realloc(series_maps, (n_series_maps + 1) * sizeof *maps);
+    if (maps == NULL) {
+	return E_ALLOC;
+    }
+
+    series_maps = maps;
+    sm = &series_maps[n_series_maps];
+    sm->mf = mf;
+    sm->buf = g_mapped_file_get_contents(mf);
+    sm->len = g_mapped_file_get_length(mf);
+    sm->n = n;
+    sm->refcount = nseries;
+    n_series_maps++;
+
+    return 0;
+}
+
+/**
+ * series_data_free:
+ * @x: series data array.
+ *
+ * Frees @x, allowing for the possibility that it points into a
+ * memory-mapped data file.
+ */
+
+void series_data_free (double *x)
+{
+    int i;
+
+    if (x == NULL) {
+	return;
+    } else if (n_series_maps == 0 || (i = series_map_lookup(x)) < 0) {
+	free(x);
+    } else if (--series_maps[i].refcount == 0) {
+	g_mapped_file_unref(series_maps[i].mf);
+	series_maps[i] = series_maps[--n_series_maps];
+	if (n_series_maps == 0) {
+	    free(series_maps);
+	    series_maps = NULL;
+	}
+    }
+}
+
+/**
+ * series_data_realloc:
+ * @x: series data array.
+ * @n: new length.
+ *
+ * Counterpart to realloc() for series data, allowing for the
+ * possibility that @x points into a memory-mapped data file: in
+ * that case the values are copied into newly allocated storage.
+ *
+ * Returns: the resized array, or NULL on failure (in which case
+ * @x is unchanged).
+ */
+
+double *series_data_realloc (double *x, int n)
+{
+    double *y;
+    int i;
+
+    if (x == NULL || n_series_maps == 0 || (i = series_map_lookup(x)) < 0) {
+	return realloc(x, n * sizeof *x);
+    }
+
+    y = malloc(n * sizeof *y);
+
+    if (y != NULL) {
+	memcpy(y, x, MIN(n, series_maps[i].n) * sizeof *y);
+	series_data_free(x);
+    }
+
+    return y;
+}
+
 /**
  * free_Z:
  * @dset: dataset information.
@@ -107,7 +244,7 @@ void free_Z (DATASET *dset)
 	fprintf(stderr, "Freeing Z (%p): %d vars\n", (void *) dset->Z, v);
 #endif
 	for (i=0; i<v; i++) {
-	    free(dset->Z[i]);
+	    series_data_free(dset->Z[i]);
 	}
 	free(dset->Z);
 	dset->Z = NULL;
@@ -184,6 +321,7 @@ void clear_datainfo (DATASET *dset, int code)
     /* if this is not a sub-sample datainfo, free varnames, labels, etc. */
 
     if (code == CLEAR_FULL) {
+	series_index_invalidate();
 	if (dset->varname != NULL) {
 	    for (i=0; i<dset->v; i++) {
 		free(dset->varname[i]);
@@ -422,6 +560,8 @@ int dataset_allocate_varnames (DATASET *dset)
     int i, j, v = dset->v;
     int err = 0;
 
+    series_index_invalidate();
+
     dset->varname = strings_array_new_with_length(v, VNAMELEN);
     if (dset->varname == NULL) {
 	return E_ALLOC;
@@ -963,7 +1103,7 @@ static int real_dataset_add_observations (DATASET *dset, int n,
     bign = oldn + n;
 
     for (i=0; i<dset->v; i++) {
-	x = realloc(dset->Z[i], bign * sizeof *x);
+	x = series_data_realloc(dset->Z[i], bign);
 	if (x == NULL) {
 	    return E_ALLOC;
 	}
@@ -1099,7 +1239,7 @@ static int panel_dataset_extend_time (DATASET *dset, int n)
 	    }
 	    memcpy(vtmp + j*newT, utmp, usz);
 	}
-	free(dset->Z[i]);
+	series_data_free(dset->Z[i]);
 	dset->Z[i] = vtmp;
     }
 
@@ -1177,7 +1317,7 @@ static int real_insert_observation (int pos, DATASET *dset)
     int err = 0;
 
     for (i=0; i<dset->v; i++) {
-	x = realloc(dset->Z[i], n * sizeof *x);
+	x = series_data_realloc(dset->Z[i], n);
 	if (x == NULL) {
 	    return E_ALLOC;
 	}
@@ -1246,7 +1386,7 @@ int dataset_drop_observations (DATASET *dset, int n)
     }
 
     for (i=0; i<dset->v; i++) {
-	x = realloc(dset->Z[i], newn * sizeof *x);
+	x = series_data_realloc(dset->Z[i], newn);
 	if (x == NULL) {
 	    return E_ALLOC;
 	}
@@ -1335,6 +1475,7 @@ dataset_expand_varinfo (int v0, int newvars, DATASET *dset)
     char **varname = NULL;
     VARINFO **varinfo = NULL;
     int bigv = v0 + newvars;
+    int indexed = series_index_is_current(dset);
     int i, v, err = 0;
 
     varname = realloc(dset->varname, bigv * sizeof *varname);
@@ -1342,6 +1483,10 @@ dataset_expand_varinfo (int v0, int newvars, DATASET *dset)
 	err = E_ALLOC;
     } else {
 	dset->varname = varname;
+	if (indexed) {
+	    /* the names of existing series are unchanged */
+	    series_index_relocate(dset);
+	}
     }
 
     for (i=0; i<newvars && !err; i++) {
@@ -1669,6 +1814,7 @@ static int shrink_dataset_to_size (DATASET *dset, int nv, int drop)
 
     dset->Z = newZ;
     dset->v = nv;
+    series_index_invalidate();
 
     return 0;
 }
@@ -1765,6 +1911,7 @@ int dataset_rename_series (DATASET *dset, int v, const char *name)
     if (!err && strcmp(dset->varname[v], name)) {
 	dset->varname[v][0] = '\0';
 	strncat(dset->varname[v], name, VNAMELEN-1);
+	series_index_invalidate();
 	set_dataset_is_changed(dset, 1);
     }
 
@@ -1804,7 +1951,7 @@ int dataset_replace_series (DATASET *dset, int v,
     series_set_label(dset, v, descrip);
 
     if (flag == DS_GRAB_VALUES) {
-	free(dset->Z[v]);
+	series_data_free(dset->Z[v]);
 	dset->Z[v] = x;
     } else {
 	int t;
@@ -1935,7 +2082,7 @@ static int real_drop_listed_vars (int *list, DATASET *dset,
     for (i=1; i<=list[0]; i++) {
 	v = list[i];
 	if (v > 0 && v < oldv) {
-	    free(dset->Z[v]);
+	    series_data_free(dset->Z[v]);
 	    dset->Z[v] = NULL;
 	    if (drop == DROP_NORMAL) {
 		free(dset->varname[v]);
@@ -2201,6 +2348,7 @@ int dataset_renumber_variable (int v_old, int v_new,
     strcpy(dset->varname[v_new], vname);
     dset->varinfo[v_new] = vinfo;
 
+    series_index_invalidate();
     set_dataset_is_changed(dset, 1);
 
     return 0;
@@ -2723,7 +2871,7 @@ int dataset_drop_last_variables (DATASET *dset, int delvars)
     for (i=newv; i<dset->v; i++) {
 	free(dset->varname[i]);
 	free_varinfo(dset, i);
-	free(dset->Z[i]);
+	series_data_free(dset->Z[i]);
 	dset->Z[i] = NULL;
     }
 
@@ -2762,7 +2910,7 @@ int dataset_drop_last_variables (DATASET *dset, int delvars)
 		    fset->v, newv);
 #endif
 	    for (i=newv; i<fset->v; i++) {
-		free(fset->Z[i]);
+		series_data_free(fset->Z[i]);
 		fset->Z[i] = NULL;
 	    }
 	    err = shrink_dataset_to_size(fset, newv, DROP_SPECIAL);
@@ -3603,7 +3751,7 @@ int dataset_purge_missing_rows (DATASET *dset)
     new_n = dset->n - totmiss;
 
     for (i=1; i<dset->v; i++) {
-	Zi = realloc(dset->Z[i], new_n * sizeof *Zi);
+	Zi = series_data_realloc(dset->Z[i], new_n);
 	if (Zi == NULL) {
 	    err = E_ALLOC;
 	} else {
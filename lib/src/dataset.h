@@ -320,6 +320,12 @@ typedef struct _series_table series_table;
 
 void free_Z (DATASET *dset);
 
+int series_data_map_register (GMappedFile *mf, int nseries, int n);
+
+void series_data_free (double *x);
+
+double *series_data_realloc (double *x, int n);
+
 DATASET *datainfo_new (void);
 
 void datainfo_init (DATASET *dset);
@@ -35,6 +35,8 @@
 #include <glib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #if G_BYTE_ORDER == G_BIG_ENDIAN
 # include <netinet/in.h>
@@ -131,11 +133,8 @@ static int lib_add_db_data (double **dbZ, SERIESINFO *sinfo,
 
 static int do_compact_spread (DATASET *dset, int newpd);
 
-static FILE *open_binfile (const char *dbbase, int code, int offset, int *err)
+static void binfile_name (char *dbbin, const char *dbbase, int code)
 {
-    char dbbin[MAXLEN];
-    FILE *fp = NULL;
-
     strcpy(dbbin, dbbase);
     if (code == GRETL_NATIVE_DB) {
 	if (strstr(dbbin, ".bin") == NULL) {
@@ -146,7 +145,14 @@ static FILE *open_binfile (const char *dbbase, int code, int offset, int *err)
 	    strcat(dbbin, ".bn7");
 	}
     }
+}
 
+static FILE *open_binfile (const char *dbbase, int code, int offset, int *err)
+{
+    char dbbin[MAXLEN];
+    FILE *fp = NULL;
+
+    binfile_name(dbbin, dbbase, code);
     fp = gretl_fopen(dbbin, "rb");
 
     if (fp == NULL) {
@@ -160,6 +166,19 @@ static FILE *open_binfile (const char *dbbase, int code, int offset, int *err)
     return fp;
 }
 
+static double dbnumber_to_double (dbnumber x)
+{
+    char numstr[32];
+    double d;
+
+    sprintf(numstr, "%.7g", (double) x); /* N.B. converting a float */
+    d = atof(numstr);
+
+    return (d == DBNA)? NADBL : d;
+}
+
+static const char *native_db_map_bin (const char *dbbin, gsize *len);
+
 /**
  * get_native_db_data:
  * @dbbase:
@@ -172,28 +191,45 @@ static FILE *open_binfile (const char *dbbase, int code, int offset, int *err)
 int get_native_db_data (const char *dbbase, SERIESINFO *sinfo,
 			double **Z)
 {
-    char numstr[32];
+    char dbbin[MAXLEN];
+    const char *buf;
     FILE *fp;
     dbnumber x;
+    gsize len = 0;
     int v = sinfo->v;
     int t, t2, err = 0;
 
+    t2 = (sinfo->t2 > 0)? sinfo->t2 : sinfo->nobs - 1;
+
+    binfile_name(dbbin, dbbase, GRETL_NATIVE_DB);
+    buf = native_db_map_bin(dbbin, &len);
+
+    if (buf != NULL) {
+	/* the data file is memory-mapped */
+	gsize need = (t2 - sinfo->t1 + 1) * sizeof x;
+
+	if (sinfo->offset < 0 || sinfo->offset + need > len) {
+	    return DB_PARSE_ERROR;
+	}
+	buf += sinfo->offset;
+	for (t=sinfo->t1; t<=t2; t++) {
+	    memcpy(&x, buf, sizeof x);
+	    Z[v][t] = dbnumber_to_double(x);
+	    buf += sizeof x;
+	}
+	return 0;
+    }
+
     fp = open_binfile(dbbase, GRETL_NATIVE_DB, sinfo->offset, &err);
     if (err) {
 	return err;
     }
 
-    t2 = (sinfo->t2 > 0)? sinfo->t2 : sinfo->nobs - 1;
-
     for (t=sinfo->t1; t<=t2 && !err; t++) {
 	if (fread(&x, sizeof x, 1, fp) != 1) {
 	    err = DB_PARSE_ERROR;
 	} else {
-	    sprintf(numstr, "%.7g", (double) x); /* N.B. converting a float */
-	    Z[v][t] = atof(numstr);
-	    if (Z[v][t] == DBNA) {
-		Z[v][t] = NADBL;
-	    }
+	    Z[v][t] = dbnumber_to_double(x);
 	}
     }
 
@@ -459,33 +495,236 @@ static char *native_db_index_name (void)
     return fname;
 }
 
-static int db_match_glob (FILE *fp,
-			  char *line, int linelen,
-			  GPatternSpec *pspec,
-			  char **S, int *err)
+/* Apparatus for speeding up retrieval from native databases,
+   which may hold hundreds of thousands of series. Rather than
+   scanning the .idx file for each series requested, on first use
+   we map the file into memory and build a hash table from series
+   names to their index entries; and we map the .bin file so that
+   data can be retrieved without opening and seeking in the file
+   each time. The mappings and the hash table are cached until
+   another database is opened, or until the modification time or
+   size of the file in question changes.
+*/
+
+typedef struct db_mapped_file_ db_mapped_file;
+
+struct db_mapped_file_ {
+    char *fname;     /* name of the file */
+    gint64 mtime;    /* its modification time when mapped */
+    gint64 size;     /* its size when mapped */
+    GMappedFile *mf; /* the mapping */
+};
+
+typedef struct db_index_entry_ db_index_entry;
+
+struct db_index_entry_ {
+    char *name;    /* name of the series */
+    gsize line;    /* offset of its first line in the .idx file */
+    gint64 offset; /* offset of its data in the .bin file */
+};
+
+static db_mapped_file db_idx_map;
+static db_mapped_file db_bin_map;
+static db_index_entry *db_entries;
+static int db_n_entries;
+static GHashTable *db_index_ht;
+static int db_index_err;
+
+static void db_mapped_file_clear (db_mapped_file *dmf)
 {
-    char vname[VNAMELEN], l2[72];
+    if (dmf->mf != NULL) {
+	g_mapped_file_unref(dmf->mf);
+	dmf->mf = NULL;
+    }
+    g_free(dmf->fname);
+    dmf->fname = NULL;
+}
+
+/* Ensure that @dmf holds a current mapping of @fname: returns 1 if
+   a new mapping was made, 0 if the existing one is still good, or
+   -1 on failure.
+*/
+
+static int db_mapped_file_update (db_mapped_file *dmf,
+				  const char *fname)
+{
+    struct stat buf;
+
+    if (gretl_stat(fname, &buf) != 0) {
+	db_mapped_file_clear(dmf);
+	return -1;
+    }
+
+    if (dmf->mf != NULL && !strcmp(dmf->fname, fname) &&
+	dmf->mtime == buf.st_mtime && dmf->size == buf.st_size) {
+	return 0;
+    }
+
+    db_mapped_file_clear(dmf);
+
+    dmf->mf = g_mapped_file_new(fname, FALSE, NULL);
+    if (dmf->mf == NULL) {
+	return -1;
+    }
+
+    dmf->fname = g_strdup(fname);
+    dmf->mtime = buf.st_mtime;
+    dmf->size = buf.st_size;
+
+    return 1;
+}
+
+static const char *native_db_map_bin (const char *dbbin, gsize *len)
+{
+    if (db_mapped_file_update(&db_bin_map, dbbin) < 0) {
+	return NULL;
+    }
+
+    *len = g_mapped_file_get_length(db_bin_map.mf);
+
+    return g_mapped_file_get_contents(db_bin_map.mf);
+}
+
+/* counterpart to fgets() for the mapped .idx file: copy into @s
+   the line starting at offset *@pos and advance *@pos to the start
+   of the next line
+*/
+
+static char *db_idx_gets (char *s, int size, gsize *pos)
+{
+    const char *buf = g_mapped_file_get_contents(db_idx_map.mf);
+    gsize len = g_mapped_file_get_length(db_idx_map.mf);
+    gsize i = *pos;
     int n = 0;
 
-    while (fgets(line, linelen, fp) && !*err) {
-	if (*line == '#') {
+    if (buf == NULL || i >= len) {
+	return NULL;
+    }
+
+    while (i < len && n < size - 1) {
+	s[n++] = buf[i];
+	if (buf[i++] == '\n') {
+	    break;
+	}
+    }
+    s[n] = '\0';
+    *pos = i;
+
+    return s;
+}
+
+static void db_index_destroy (void)
+{
+    int i;
+
+    if (db_index_ht != NULL) {
+	g_hash_table_destroy(db_index_ht);
+	db_index_ht = NULL;
+    }
+    for (i=0; i<db_n_entries; i++) {
+	free(db_entries[i].name);
+    }
+    free(db_entries);
+    db_entries = NULL;
+    db_n_entries = 0;
+    db_index_err = 0;
+}
+
+/* Scan the mapped .idx file and record the position of each series
+   in both the .idx and .bin files. If we hit a malformed entry we
+   stop there, but keep what we have so far; the error is then
+   reported only for series that were not found.
+*/
+
+static int db_index_build (void)
+{
+    char s1[1024], s2[72];
+    char sername[VNAMELEN];
+    db_index_entry *e;
+    gint64 offset = 0;
+    gsize pos = 0, line;
+    int nalloc = 0;
+    int n;
+
+    db_index_ht = g_hash_table_new(g_str_hash, g_str_equal);
+
+    while (1) {
+	line = pos;
+	if (db_idx_gets(s1, sizeof s1, &pos) == NULL) {
+	    break;
+	}
+	if (*s1 == '#') {
 	    continue;
 	}
-	if (gretl_scan_varname(line, vname) != 1) {
+	if (gretl_scan_varname(s1, sername) != 1) {
 	    break;
 	}
-	if (g_pattern_match_string(pspec, vname)) {
-	    if (S != NULL) {
-		S[n] = gretl_strdup(vname);
+	if (db_idx_gets(s2, sizeof s2, &pos) == NULL ||
+	    sscanf(s2, "%*c %*s %*s %*s %*s %*s %d", &n) != 1) {
+	    db_index_err = DB_PARSE_ERROR;
+	    break;
+	}
+	if (db_n_entries == nalloc) {
+	    int newalloc = nalloc == 0 ? 1024 : 2 * nalloc;
+
+	    e = realloc(db_entries, newalloc * sizeof *e);
+	    if (e == NULL) {
+		db_index_destroy();
+		return E_ALLOC;
 	    }
-	    n++;
+	    db_entries = e;
+	    nalloc = newalloc;
 	}
-	if (fgets(l2, sizeof l2, fp) == NULL) {
-	    *err = DB_PARSE_ERROR;
+	e = &db_entries[db_n_entries];
+	e->name = gretl_strdup(sername);
+	if (e->name == NULL) {
+	    db_index_destroy();
+	    return E_ALLOC;
 	}
+	e->line = line;
+	e->offset = offset;
+	db_n_entries++;
+	offset += n * sizeof(dbnumber);
     }
 
-    return n;
+    /* don't let a duplicate name shadow the first occurrence */
+    for (n=db_n_entries-1; n>=0; n--) {
+	e = &db_entries[n];
+	g_hash_table_insert(db_index_ht, e->name, e);
+    }
+
+    return 0;
+}
+
+/* make sure the cached index is up to date for @idxname */
+
+static int native_db_index_update (const char *idxname)
+{
+    int ret = db_mapped_file_update(&db_idx_map, idxname);
+
+    if (ret < 0) {
+	db_index_destroy();
+	return E_FOPEN;
+    } else if (ret > 0 || db_index_ht == NULL) {
+	db_index_destroy();
+	return db_index_build();
+    }
+
+    return 0;
+}
+
+/**
+ * db_index_cleanup:
+ *
+ * Frees the cached index of the current native database, and
+ * releases the memory mappings of its files, if any.
+ */
+
+void db_index_cleanup (void)
+{
+    db_index_destroy();
+    db_mapped_file_clear(&db_idx_map);
+    db_mapped_file_clear(&db_bin_map);
 }
 
 static char **native_db_match_series (const char *glob, int *nmatch,
@@ -493,33 +732,45 @@ static char **native_db_match_series (const char *glob, int *nmatch,
 {
     GPatternSpec *pspec;
     char **S = NULL;
-    FILE *fp = NULL;
-    char line[256];
+    int i, n = 0;
 
-    fp = gretl_fopen(idxname, "rb");
-    if (fp == NULL) {
-	*err = E_FOPEN;
-	*nmatch = 0;
+    *nmatch = 0;
+    *err = native_db_index_update(idxname);
+    if (*err) {
 	return NULL;
     }
 
     pspec = g_pattern_spec_new(glob);
 
-    *nmatch = db_match_glob(fp, line, sizeof line, pspec, NULL, err);
+    for (i=0; i<db_n_entries; i++) {
+	if (g_pattern_match_string(pspec, db_entries[i].name)) {
+	    n++;
+	}
+    }
 
-    if (!*err && *nmatch > 0) {
-	S = strings_array_new(*nmatch);
+    if (n > 0) {
+	S = strings_array_new(n);
 	if (S == NULL) {
-	    *nmatch = 0;
 	    *err = E_ALLOC;
 	} else {
-	    rewind(fp);
-	    db_match_glob(fp, line, sizeof line, pspec, S, err);
+	    for (i=0, n=0; i<db_n_entries && !*err; i++) {
+		if (g_pattern_match_string(pspec, db_entries[i].name)) {
+		    S[n] = gretl_strdup(db_entries[i].name);
+		    if (S[n++] == NULL) {
+			*err = E_ALLOC;
+		    }
+		}
+	    }
+	    if (*err) {
+		strings_array_free(S, n);
+		S = NULL;
+		n = 0;
+	    }
 	}
     }
 
     g_pattern_spec_free(pspec);
-    fclose(fp);
+    *nmatch = n;
 
     return S;
 }
@@ -528,63 +779,46 @@ static int get_native_series_info (const char *series,
 				   SERIESINFO *sinfo,
 				   const char *idxname)
 {
-    FILE *fp = NULL;
-    char sername[VNAMELEN];
+    db_index_entry *e;
     /* 2019-01-08: enlarge @s1 from 256 to 1024 */
     char s1[1024], s2[72];
     char stobs[OBSLEN], endobs[OBSLEN];
     char pdc;
-    int offset = 0;
-    int gotit = 0, err = 0;
-    int n;
+    gsize pos;
+    int err;
 
-    fp = gretl_fopen(idxname, "rb");
-    if (fp == NULL) {
-	return E_FOPEN;
+    err = native_db_index_update(idxname);
+    if (err) {
+	return err;
     }
 
-    while (fgets(s1, sizeof s1, fp) && !gotit) {
-	if (*s1 == '#') {
-	    continue;
-	}
-	if (gretl_scan_varname(s1, sername) != 1) {
-	    break;
-	}
-	if (!strcmp(series, sername)) {
-	    gotit = 1;
-	    strcpy(sinfo->varname, sername);
-	}
-	if (fgets(s2, sizeof s2, fp) == NULL) {
-	    err = DB_PARSE_ERROR;
-	    break;
-	}
-	if (gotit) {
-	    get_native_series_comment(sinfo, s1);
-	    if (sscanf(s2, "%c %10s %*s %10s %*s %*s %d",
-		       &pdc, stobs, endobs, &sinfo->nobs) != 4) {
-		gretl_errmsg_set(_("Failed to parse series information"));
-		err = DB_PARSE_ERROR;
-	    } else {
-		get_native_series_pd(sinfo, pdc);
-		get_native_series_obs(sinfo, stobs, endobs);
-		sinfo->offset = offset;
-		sinfo->t2 = sinfo->nobs - 1;
-	    }
-	} else {
-	    if (sscanf(s2, "%*c %*s %*s %*s %*s %*s %d", &n) != 1) {
-		gretl_errmsg_set(_("Failed to parse series information"));
-		err = DB_PARSE_ERROR;
-	    } else {
-		offset += n * sizeof(dbnumber);
-	    }
+    e = g_hash_table_lookup(db_index_ht, series);
+
+    if (e == NULL) {
+	if (db_index_err) {
+	    gretl_errmsg_set(_("Failed to parse series information"));
+	    return db_index_err;
 	}
+	gretl_errmsg_sprintf(_("Series not found, '%s'"), series);
+	return DB_NO_SUCH_SERIES;
     }
 
-    fclose(fp);
+    pos = e->line;
+    db_idx_gets(s1, sizeof s1, &pos);
+    db_idx_gets(s2, sizeof s2, &pos);
 
-    if (!err && !gotit) {
-	gretl_errmsg_sprintf(_("Series not found, '%s'"), series);
-	err = DB_NO_SUCH_SERIES;
+    strcpy(sinfo->varname, e->name);
+    get_native_series_comment(sinfo, s1);
+
+    if (sscanf(s2, "%c %10s %*s %10s %*s %*s %d",
+	       &pdc, stobs, endobs, &sinfo->nobs) != 4) {
+	gretl_errmsg_set(_("Failed to parse series information"));
+	err = DB_PARSE_ERROR;
+    } else {
+	get_native_series_pd(sinfo, pdc);
+	get_native_series_obs(sinfo, stobs, endobs);
+	sinfo->offset = e->offset;
+	sinfo->t2 = sinfo->nobs - 1;
     }
 
     return err;
@@ -1717,6 +1951,8 @@ int set_db_name (const char *fname, int filetype, PRN *prn)
     FILE *fp;
     int err = 0;
 
+    db_index_cleanup();
+
     *saved_db_name = '\0';
     if (fname != NULL) {
 	strncat(saved_db_name, fname, MAXLEN - 1);
@@ -2821,6 +3057,7 @@ int db_get_series (const char *line, DATASET *dset,
     if (idxname != NULL) {
 	if (saved_db_type == GRETL_NATIVE_DB_WWW) {
 	    /* this file is a temporary download */
+	    db_index_cleanup();
 	    gretl_remove(idxname);
 	}
 	free(idxname);
@@ -2868,6 +3105,9 @@ static int db_delete_series (const char *line, const int *list,
     int ndel = 0;
     int err = 0;
 
+    /* we're going to rewrite the database files */
+    db_index_cleanup();
+
     if (fname == NULL) {
 	if (*saved_db_name == '\0') {
 	    gretl_errmsg_set(_("No database has been opened"));
@@ -4602,7 +4842,7 @@ static int daily_dataset_to_weekly (DATASET *dset, int repday)
 		x[s++] = dset->Z[i][t];
 	    }
 	}
-	tmp = realloc(dset->Z[i], n * sizeof *tmp);
+	tmp = series_data_realloc(dset->Z[i], n);
 	if (tmp == NULL) {
 	    err = E_ALLOC;
 	} else {
@@ -4662,7 +4902,7 @@ static int daily_dataset_to_monthly (DATASET *dset,
 	if (x == NULL) {
 	    err = E_ALLOC;
 	} else {
-	    free(dset->Z[i]);
+	    series_data_free(dset->Z[i]);
 	    dset->Z[i] = x;
 	}
     }
@@ -4994,7 +5234,7 @@ int compact_data_set (DATASET *dset, int newpd,
 	if (x == NULL) {
 	    err = E_ALLOC;
 	} else {
-	    free(dset->Z[i]);
+	    series_data_free(dset->Z[i]);
 	    dset->Z[i] = x;
 	}
     }
@@ -19,6 +19,7 @@
 
 #include "libgretl.h"
 #include "dbwrite.h"
+#include "dbread.h"
 
 /**
  * SECTION:dbwrite
@@ -620,6 +621,9 @@ int write_db_data (const char *fname, const int *list, gretlopt opt,
 	return E_PDWRONG;
     }
 
+    /* drop any cached mappings of the database files */
+    db_index_cleanup();
+
     if (open_db_files(fname, idxname, binname, 
 		      &fidx, &fbin, &append)) {
 	return 1;
@@ -3412,6 +3412,115 @@ static double gretl_acf (int k, int t1, int t2, const double *y,
     return num / den;
 }
 
+/* When the product of the number of lags and the number of
+   observations exceeds ACF_FFT_MIN we compute the autocovariances
+   (or cross-covariances) at all lags at once, by FFT, in
+   O(T log T) time rather than O(T * order).
+*/
+
+#define ACF_FFT_MIN 100000
+
+static int use_fft_acf (int m, int T)
+{
+    return (double) m * T > ACF_FFT_MIN;
+}
+
+/* length of zero-padded array for FFT: a power of 2 that
+   is at least @T + @m, which ensures that the circular
+   (co-)variances at lags up to @m are not contaminated
+*/
+
+static int acf_fft_length (int T, int m)
+{
+    int N = 2;
+
+    while (N < T + m) {
+	N *= 2;
+    }
+
+    return N;
+}
+
+/* Autocorrelations of the T-vector @y (which must not contain
+   any missing values) at lags 1 to @m, written into @acf, via
+   the squared modulus of the Fourier transform. The result at
+   lag 0 gives the denominator.
+*/
+
+static int fft_acf (const double *y, int T, double ybar,
+		    double *acf, int m)
+{
+    gretl_matrix *z, *f, *r = NULL;
+    double re, im, den;
+    int N = acf_fft_length(T, m);
+    int k, t, err = 0;
+
+    z = gretl_zero_matrix_new(N, 1);
+    if (z == NULL) {
+	return E_ALLOC;
+    }
+
+    for (t=0; t<T; t++) {
+	z->val[t] = y[t] - ybar;
+    }
+
+    f = gretl_matrix_fft(z, 0, &err);
+
+    if (!err) {
+	for (t=0; t<N; t++) {
+	    re = gretl_matrix_get(f, t, 0);
+	    im = gretl_matrix_get(f, t, 1);
+	    gretl_matrix_set(f, t, 0, re*re + im*im);
+	    gretl_matrix_set(f, t, 1, 0.0);
+	}
+	r = gretl_matrix_ffti(f, &err);
+    }
+
+    if (!err) {
+	den = r->val[0];
+	for (k=1; k<=m; k++) {
+	    acf[k-1] = k < T ? r->val[k] / den : NADBL;
+	}
+    }
+
+    gretl_matrix_free(z);
+    gretl_matrix_free(f);
+    gretl_matrix_free(r);
+
+    return err;
+}
+
+/* Fill @acf with the autocorrelations of @y at lags 1 to @m,
+   for the range @t1 to @t2, by FFT or directly depending on
+   the size of the problem. As with gretl_acf(), missing values
+   in the range produce #NADBL throughout.
+*/
+
+static void gretl_acf_vec (int m, int t1, int t2, const double *y,
+			   double ybar, double *acf)
+{
+    int T = t2 - t1 + 1;
+    int k, t;
+
+    if (use_fft_acf(m, T)) {
+	for (t=t1; t<=t2; t++) {
+	    if (na(y[t])) {
+		for (k=0; k<m; k++) {
+		    acf[k] = NADBL;
+		}
+		return;
+	    }
+	}
+	if (fft_acf(y + t1, T, ybar, acf, m) == 0) {
+	    return;
+	}
+    }
+
+    for (k=1; k<=m; k++) {
+	acf[k-1] = gretl_acf(k, t1, t2, y, ybar);
+    }
+}
+
 /**
  * ljung_box:
  * @m: maximum lag.
@@ -3427,7 +3536,7 @@ static double gretl_acf (int k, int t1, int t2, const double *y,
 
 double ljung_box (int m, int t1, int t2, const double *y, int *err)
 {
-    double acf, ybar = 0.0, LB = 0.0;
+    double *acf, ybar = 0.0, LB = 0.0;
     int k, n = t2 - t1 + 1;
 
     *err = 0;
@@ -3448,16 +3557,24 @@ double ljung_box (int m, int t1, int t2, const double *y, int *err)
 	return NADBL;
     }
 
+    acf = malloc(m * sizeof *acf);
+    if (acf == NULL) {
+	*err = E_ALLOC;
+	return NADBL;
+    }
+
     /* calculate acf up to lag m, cumulating LB */
+    gretl_acf_vec(m, t1, t2, y, ybar, acf);
     for (k=1; k<=m; k++) {
-	acf = gretl_acf(k, t1, t2, y, ybar);
-	if (na(acf)) {
+	if (na(acf[k-1])) {
 	    *err = E_MISSDATA;
 	    break;
 	}
-	LB += acf * acf / (n - k);
+	LB += acf[k-1] * acf[k-1] / (n - k);
     }
 
+    free(acf);
+
     if (*err) {
 	LB = NADBL;
     } else {
@@ -3675,9 +3792,7 @@ int corrgram (int varno, int order, int nparam, DATASET *dset,
     pacf = acf + m;
 
     /* calculate acf up to order acf_m */
-    for (k=1; k<=m; k++) {
-	acf[k-1] = gretl_acf(k, t1, t2, dset->Z[varno], ybar);
-    }
+    gretl_acf_vec(m, t1, t2, dset->Z[varno], ybar, acf);
 
     /* graphing? */
     handle_corrgm_plot_options(CORRGM, opt, &ascii_plot, &use_gnuplot);
@@ -3892,8 +4007,8 @@ gretl_matrix *acf_matrix (const double *x, int order,
     }
 
     /* calculate ACF up to order m */
+    gretl_acf_vec(m, t1, t2, x, xbar, A->val);
     for (k=0; k<m && !*err; k++) {
-	A->val[k] = gretl_acf(k+1, t1, t2, x, xbar);
 	if (na(A->val[k])) {
 	    *err = E_DATA;
 	}
@@ -3985,6 +4100,73 @@ static int xcorrgm_ascii_plot (double *xcf, int xcf_m, PRN *prn)
     return 0;
 }
 
+/* Cross-correlations of the T-vectors @x and @y at lags -@p to
+   @p, via the inverse transform of the product of the Fourier
+   transform of @x and the conjugate of that of @y. Lag k is
+   found at position k of the result, or N + k for k < 0.
+*/
+
+static int fft_xcf (const double *x, const double *y, int T,
+		    double xbar, double ybar, double *xcf, int p)
+{
+    gretl_matrix *z, *f, *g = NULL, *r = NULL;
+    double xr, xi, yr, yi;
+    double zx, zy, sxx = 0, syy = 0;
+    int N = acf_fft_length(T, p);
+    int k, t, err = 0;
+
+    z = gretl_zero_matrix_new(N, 2);
+    if (z == NULL) {
+	return E_ALLOC;
+    }
+
+    for (t=0; t<T; t++) {
+	zx = x[t] - xbar;
+	zy = y[t] - ybar;
+	gretl_matrix_set(z, t, 0, zx);
+	gretl_matrix_set(z, t, 1, zy);
+	sxx += zx * zx;
+	syy += zy * zy;
+    }
+
+    f = gretl_matrix_fft(z, 0, &err);
+
+    if (!err) {
+	g = gretl_matrix_alloc(N, 2);
+	if (g == NULL) {
+	    err = E_ALLOC;
+	}
+    }
+
+    if (!err) {
+	for (t=0; t<N; t++) {
+	    xr = gretl_matrix_get(f, t, 0);
+	    xi = gretl_matrix_get(f, t, 1);
+	    yr = gretl_matrix_get(f, t, 2);
+	    yi = gretl_matrix_get(f, t, 3);
+	    gretl_matrix_set(g, t, 0, xr*yr + xi*yi);
+	    gretl_matrix_set(g, t, 1, xi*yr - xr*yi);
+	}
+	r = gretl_matrix_ffti(g, &err);
+    }
+
+    if (!err) {
+	/* gretl_matrix_ffti() has already divided by N */
+	double den = sqrt(sxx * syy) / N;
+
+	for (k=-p; k<=p; k++) {
+	    xcf[k+p] = r->val[k < 0 ? N + k : k] / den;
+	}
+    }
+
+    gretl_matrix_free(z);
+    gretl_matrix_free(f);
+    gretl_matrix_free(g);
+    gretl_matrix_free(r);
+
+    return err;
+}
+
 /* We assume here that all data issues have already been
    assessed (lag length, missing values etc.) and we just
    get on with the job.
@@ -4015,6 +4197,11 @@ static gretl_matrix *real_xcf_vec (const double *x, const double *y,
 	return NULL;
     }
 
+    if (use_fft_acf(2 * p + 1, T) &&
+	fft_xcf(x, y, T, xbar, ybar, xcf->val, p) == 0) {
+	return xcf;
+    }
+
     for (i=-p; i<=p; i++) {
 	xcf->val[i+p] = gretl_xcf(i, 0, T - 1, x, y, xbar, ybar);
     }
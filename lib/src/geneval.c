@@ -57,6 +57,20 @@
 
 #include <errno.h>
 
+/* AVX code for series arithmetic: selected at run time if the
+   compiler supports per-function targets (see also matrix_simd.c),
+   otherwise compiled in only if gretl is built with AVX */
+#if defined(HAVE_IMMINTRIN_H) && (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+# include <immintrin.h>
+# define SERIES_AVX 1
+# define AVX_TARGET __attribute__((target("avx")))
+#elif defined(USE_AVX) && defined(HAVE_IMMINTRIN_H)
+# include <immintrin.h>
+# define SERIES_AVX 1
+# define AVX_TARGET
+#endif
+
 #if GENDEBUG
 # define EDEBUG GENDEBUG
 # define LHDEBUG GENDEBUG
@@ -89,6 +103,10 @@ static void real_rndebug (const char *format, ...)
 
 #define ONE_BY_ONE_CAST 1
 
+/* flatten compiled trees into an instruction stream where
+   possible: see genprog.c */
+#define USE_GENPROG 1
+
 enum {
     FR_TREE = 1,
     FR_RET,
@@ -100,6 +118,7 @@ enum {
 #define is_aux_node(n) (n != NULL && (n->flags & AUX_NODE))
 #define is_tmp_node(n) (n != NULL && (n->flags & TMP_NODE))
 #define is_proxy_node(n) (n != NULL && (n->flags & PRX_NODE))
+#define is_view_node(n) (n != NULL && (n->flags & MVW_NODE))
 
 #define emptymat_ok(f) (f == F_GINV || f == F_DIAG || f == F_TRANSP || \
 			f == F_VEC || f == F_VECH || f == F_UNVECH ||	\
@@ -335,7 +354,10 @@ static void free_node (NODE *t, parser *p)
 	return;
     }
 
-    if (is_tmp_node(t)) {
+    if (is_view_node(t)) {
+	/* free the view but not the data it points to */
+	gretl_matrix_view_free(t->v.m);
+    } else if (is_tmp_node(t)) {
 #if EDEBUG
 	fprintf(stderr, " tmp node: freeing attached data\n");
 #endif
@@ -403,6 +425,14 @@ static void free_node (NODE *t, parser *p)
    is that they cut down on wasteful deep-copying of objects
    that may be used in calculation, without being modified,
    on the fly.
+
+   A special case of a fragile node is one that holds a matrix
+   "view" (flagged by MVW_NODE): this is what we get when a
+   contiguous chunk of an existing matrix is selected, as in
+   X[,1:5]. The matrix struct on such a node is allocated
+   but its data array belongs to the source matrix, so the
+   node must be handled as fragile except that on freeing it
+   we call gretl_matrix_view_free().
 */
 
 static void free_tree (NODE *t, parser *p, int code)
@@ -786,6 +816,18 @@ static void maybe_switch_node_type (NODE *n, int type,
     }
 }
 
+/* Revert an aux node that held a matrix view on a previous
+   round of evaluation to a plain "tmp" matrix node.
+*/
+
+static void drop_matrix_view (NODE *n)
+{
+    gretl_matrix_view_free(n->v.m);
+    n->v.m = NULL;
+    n->flags &= ~MVW_NODE;
+    n->flags |= TMP_NODE;
+}
+
 /* get an auxiliary node: if starting from scratch we allocate
    a new node, otherwise we look up an existing one */
 
@@ -807,6 +849,9 @@ static NODE *get_aux_node (parser *p, int t, int n, int flags)
     if (ret != NULL) {
 	/* got a pre-existing aux node */
 	if (starting(p)) {
+	    if (is_view_node(ret)) {
+		drop_matrix_view(ret);
+	    }
 	    if (ret->t != t) {
 		maybe_switch_node_type(ret, t, flags, p);
 	    } else if (is_tmp_node(ret) && !(p->flags & P_MSAVE)) {
@@ -1312,6 +1357,169 @@ static int rmatrix_xy_calc (gretl_matrix *targ,
     return p->err;
 }
 
+/* Specialized loops for the commonest binary operators applied to
+   series, or to a series and a scalar. These give exactly the same
+   results as calling xy_calc() per observation -- NA propagation
+   (with "NA" including non-finite values), the rule that zero times
+   anything is zero for non-matrix targets, and the P_NATEST override
+   of that rule -- but the operator dispatch is hoisted out of the
+   loop and NAs are handled via a single finiteness mask, which lets
+   the compiler (or AVX, when available) process several observations
+   at once.
+
+   The operands are read via an "increment" so that a scalar can be
+   passed as a pointer with an increment of zero.
+*/
+
+#define xy_kernel_op(o) (o == B_ADD || o == B_SUB || o == B_MUL ||	\
+			 o == B_DIV || o == B_EQ || o == B_NEQ ||	\
+			 o == B_GT || o == B_LT || o == B_GTE || o == B_LTE)
+
+/* both operands finite, in the sense of !na(), tested without
+   branching: x * 0 is 0 for finite x and NaN otherwise
+*/
+#define xy_both_ok(a,b) ((a) * 0.0 + (b) * 0.0 == 0.0)
+
+#define XY_KERNEL_LOOP(expr)				\
+    for (; i<n; i++) {					\
+	double a = x[i*xinc], b = y[i*yinc];		\
+	z[i] = xy_both_ok(a,b) ? (expr) : NADBL;	\
+    }
+
+#ifdef SERIES_AVX
+
+static inline AVX_TARGET __m256d xy_avx_load (const double *v, int inc, int i,
+				   __m256d vs)
+{
+    return inc ? _mm256_loadu_pd(v + i) : vs;
+}
+
+/* AVX variant: processes blocks of 4 observations and returns
+   the index of the first observation not yet handled
+*/
+
+static AVX_TARGET int series_xy_avx (double *z, const double *x, int xinc,
+			  const double *y, int yinc, int n,
+			  int op, int natest)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d nan = _mm256_set1_pd(NADBL);
+    const __m256d xs = _mm256_broadcast_sd(x);
+    const __m256d ys = _mm256_broadcast_sd(y);
+    __m256d A, B, C, ok;
+    int i, imax = n - n % 4;
+
+    for (i=0; i<imax; i+=4) {
+	A = xy_avx_load(x, xinc, i, xs);
+	B = xy_avx_load(y, yinc, i, ys);
+	switch (op) {
+	case B_ADD: C = _mm256_add_pd(A, B); break;
+	case B_SUB: C = _mm256_sub_pd(A, B); break;
+	case B_MUL: C = _mm256_mul_pd(A, B); break;
+	case B_DIV: C = _mm256_div_pd(A, B); break;
+	case B_EQ:  C = _mm256_cmp_pd(A, B, _CMP_EQ_OQ); break;
+	case B_NEQ: C = _mm256_cmp_pd(A, B, _CMP_NEQ_UQ); break;
+	case B_GT:  C = _mm256_cmp_pd(A, B, _CMP_GT_OQ); break;
+	case B_LT:  C = _mm256_cmp_pd(A, B, _CMP_LT_OQ); break;
+	case B_GTE: C = _mm256_cmp_pd(A, B, _CMP_GE_OQ); break;
+	default:    C = _mm256_cmp_pd(A, B, _CMP_LE_OQ); break;
+	}
+	if (op != B_ADD && op != B_SUB && op != B_MUL && op != B_DIV) {
+	    /* convert comparison mask to 0/1 */
+	    C = _mm256_and_pd(C, one);
+	}
+	/* the NA mask */
+	ok = _mm256_add_pd(_mm256_mul_pd(A, zero), _mm256_mul_pd(B, zero));
+	ok = _mm256_cmp_pd(ok, zero, _CMP_EQ_OQ);
+	if (op == B_MUL) {
+	    /* zero times anything is (positive) zero, and unless
+	       we're testing for NAs this trumps the NA mask
+	    */
+	    __m256d zm = _mm256_or_pd(_mm256_cmp_pd(A, zero, _CMP_EQ_OQ),
+				      _mm256_cmp_pd(B, zero, _CMP_EQ_OQ));
+
+	    if (natest) {
+		C = _mm256_blendv_pd(C, zero, zm);
+		C = _mm256_blendv_pd(nan, C, ok);
+	    } else {
+		C = _mm256_blendv_pd(nan, C, ok);
+		C = _mm256_blendv_pd(C, zero, zm);
+	    }
+	} else {
+	    C = _mm256_blendv_pd(nan, C, ok);
+	}
+	_mm256_storeu_pd(z + i, C);
+    }
+
+    return i;
+}
+
+#endif /* SERIES_AVX */
+
+/* Compute z[i] = x[i*xinc] op y[i*yinc] for i = 0 to n-1, where
+   op satisfies xy_kernel_op(). Note that @z may coincide with @x
+   or @y.
+*/
+
+static void series_xy_kernel (double *z, const double *x, int xinc,
+			      const double *y, int yinc, int n,
+			      int op, parser *p)
+{
+    int natest = (p->flags & P_NATEST) ? 1 : 0;
+    int i = 0;
+
+#ifdef SERIES_AVX
+    if (n >= 4 && gretl_simd_level() >= GRETL_SIMD_AVX) {
+	i = series_xy_avx(z, x, xinc, y, yinc, n, op, natest);
+    }
+#endif
+
+    switch (op) {
+    case B_ADD:
+	XY_KERNEL_LOOP(a + b);
+	break;
+    case B_SUB:
+	XY_KERNEL_LOOP(a - b);
+	break;
+    case B_MUL:
+	if (natest) {
+	    XY_KERNEL_LOOP(a == 0 || b == 0 ? 0 : a * b);
+	} else {
+	    for (; i<n; i++) {
+		double a = x[i*xinc], b = y[i*yinc];
+
+		z[i] = (a == 0 || b == 0) ? 0 :
+		    xy_both_ok(a,b) ? a * b : NADBL;
+	    }
+	}
+	break;
+    case B_DIV:
+	XY_KERNEL_LOOP(a / b);
+	break;
+    case B_EQ:
+	XY_KERNEL_LOOP(a == b);
+	break;
+    case B_NEQ:
+	XY_KERNEL_LOOP(a != b);
+	break;
+    case B_GT:
+	XY_KERNEL_LOOP(a > b);
+	break;
+    case B_LT:
+	XY_KERNEL_LOOP(a < b);
+	break;
+    case B_GTE:
+	XY_KERNEL_LOOP(a >= b);
+	break;
+    case B_LTE:
+	XY_KERNEL_LOOP(a <= b);
+	break;
+    default:
+	break;
+    }
+}
+
 static int operator_real_only (int op)
 {
     gretl_errmsg_sprintf("'%s': %s", getsymb(op),
@@ -2448,6 +2656,14 @@ static NODE *series_calc (NODE *l, NODE *r, int f, parser *p)
 	int t2 = autoreg(p) ? p->obs : tmax;
 	int t;
 
+	if (xy_kernel_op(f) && t2 > t1) {
+	    series_xy_kernel(ret->v.xvec + t1,
+			     x != NULL ? x + t1 : &xt, x != NULL,
+			     y != NULL ? y + t1 : &yt, y != NULL,
+			     t2 - t1 + 1, f, p);
+	    return ret;
+	}
+
 	for (t=t1; t<=t2; t++) {
 	    if (x != NULL) {
 		xt = x[t];
@@ -3879,6 +4095,27 @@ static NODE *matrix_to_alt_node (NODE *n, int f, parser *p)
     return ret;
 }
 
+/* Built-in functions that modify their first argument in place
+   (cnameset, rnameset, setnote, brename) must not be applied to
+   an object that is const within a user function, since it may
+   be shared with the caller. Here @n is the syntax node for that
+   argument, which we trace back to the named variable of which
+   it forms part, if any.
+*/
+
+static int inplace_const_check (NODE *n)
+{
+    while (n != NULL && (n->t == BMEMB || n->t == OSL || n->t == MSL)) {
+	n = n->L;
+    }
+
+    if (n != NULL && n->vname != NULL && object_is_const(n->vname, -1)) {
+	return overwrite_err(n->vname);
+    }
+
+    return 0;
+}
+
 static NODE *matrix_add_names (NODE *l, NODE *r, int f, parser *p)
 {
     NODE *ret = aux_scalar_node(p);
@@ -4801,7 +5038,17 @@ static NODE *submatrix_node (NODE *l, NODE *r, parser *p)
 	p->err = check_matrix_subspec(spec, m);
 
 	if (!p->err) {
-	    if (spec->ltype == SEL_CONTIG) {
+	    if (spec->ltype == SEL_CONTIG && l->t == MAT) {
+		/* we can avoid copying the data */
+		ret = aux_matrix_node(p);
+		if (!p->err) {
+		    ret->v.m = matrix_get_chunk_view(m, spec, &p->err);
+		}
+		if (!p->err) {
+		    ret->flags &= ~TMP_NODE;
+		    ret->flags |= MVW_NODE;
+		}
+	    } else if (spec->ltype == SEL_CONTIG) {
 		ret = aux_matrix_node(p);
 		if (!p->err) {
 		    ret->v.m = matrix_get_chunk(m, spec, &p->err);
@@ -11098,6 +11345,16 @@ static int set_matrix_value (NODE *lhs, NODE *rhs, parser *p)
 	if (m2->is_complex && !m1->is_complex) {
 	    gretl_errmsg_set("Cannot assign complex values to a real matrix");
 	    p->err = E_TYPES;
+	} else if (is_view_node(rhs) && !inflected) {
+	    /* the RHS may be a view onto @m1 itself, as in
+	       X[,2:3] = X[,1:2], so take a copy before writing
+	    */
+	    m2 = gretl_matrix_copy(m2);
+	    if (m2 == NULL) {
+		p->err = E_ALLOC;
+	    } else {
+		free_m2 = 1;
+	    }
 	}
     } else if (rhs->t == SERIES) {
 	/* legacy: this has long been accepted */
@@ -16858,7 +17115,10 @@ static NODE *eval (NODE *t, parser *p)
     case F_RNAMESET:
 	/* matrix, with (list, string or strings array) as second arg */
 	if (l->t == MAT && (ok_list_node(r, p) || r->t == STR || r->t == ARRAY)) {
-	    ret = matrix_add_names(l, r, t->t, p);
+	    p->err = inplace_const_check(t->L);
+	    if (!p->err) {
+		ret = matrix_add_names(l, r, t->t, p);
+	    }
 	} else {
 	    p->err = E_TYPES;
 	}
@@ -16925,7 +17185,13 @@ static NODE *eval (NODE *t, parser *p)
     case HF_REGLS:
     case F_GEOPLOT:
 	/* built-in functions taking three args */
-	if (t->t == F_REPLACE) {
+	if (t->t == F_SETNOTE || t->t == F_BRENAME) {
+	    /* these modify their first argument in place */
+	    p->err = inplace_const_check(t->L);
+	}
+	if (p->err) {
+	    ; /* const violation */
+	} else if (t->t == F_REPLACE) {
 	    ret = replace_value(l, m, r, p);
 	} else if (t->t == F_STRSUB || t->t == F_REGSUB) {
 	    ret = string_replace(l, m, r, t->t, p);
@@ -17311,9 +17577,14 @@ static NODE *eval (NODE *t, parser *p)
 	}
 	break;
     case F_MPI_RECV:
+    case F_MPI_IRECV:
+    case F_MPI_WAIT:
+    case F_MPI_TEST:
+    case F_ALLGATHER:
 	ret = mpi_transfer_node(l, NULL, NULL, t->t, p);
 	break;
     case F_MPI_SEND:
+    case F_MPI_ISEND:
     case F_BCAST:
     case F_ALLREDUCE:
 	if (t->t == F_ALLREDUCE && r->t != STR) {
@@ -19415,14 +19686,24 @@ static int save_generated_var (parser *p, PRN *prn)
 
 		    memcpy(Z[v] + p->dset->t1, x + p->dset->t1, sz);
 		}
+	    } else if (xy_kernel_op(p->op)) {
+		t = p->dset->t1;
+		series_xy_kernel(Z[v] + t, Z[v] + t, 1, x + t, 1,
+				 sample_size(p->dset), p->op, p);
 	    } else {
 		for (t=p->dset->t1; t<=p->dset->t2; t++) {
 		    Z[v][t] = xy_calc(Z[v][t], x[t], p->op, SERIES, p);
 		}
 	    }
 	} else if (r->t == NUM) {
-	    for (t=p->dset->t1; t<=p->dset->t2; t++) {
-		Z[v][t] = xy_calc(Z[v][t], r->v.xval, p->op, SERIES, p);
+	    if (xy_kernel_op(p->op)) {
+		t = p->dset->t1;
+		series_xy_kernel(Z[v] + t, Z[v] + t, 1, &r->v.xval, 0,
+				 sample_size(p->dset), p->op, p);
+	    } else {
+		for (t=p->dset->t1; t<=p->dset->t2; t++) {
+		    Z[v][t] = xy_calc(Z[v][t], r->v.xval, p->op, SERIES, p);
+		}
 	    }
 	} else if (r->t == MAT) {
 	    const gretl_matrix *m = r->v.m;
@@ -19631,6 +19912,8 @@ static void maybe_update_lhs_uvar (parser *p, GretlType *type)
     }
 }
 
+#include "genprog.c"
+
 static void parser_reinit (parser *p, DATASET *dset, PRN *prn)
 {
     /* flags that should be reinstated if they were
@@ -19698,6 +19981,8 @@ static void parser_init (parser *p, const char *str,
 			 int flags, int targtype)
 {
     p->point = p->rhs = p->input = str;
+    p->inplen = -1;
+    p->rhsoff = 0;
     p->dset = dset;
     p->dset_n = dset != NULL ? dset->n : 0;
     p->prn = prn;
@@ -19710,6 +19995,7 @@ static void parser_init (parser *p, const char *str,
     p->lhres = NULL;
     p->tree = NULL;
     p->ret = NULL;
+    p->prog = NULL;
 
     /* left-hand side info */
     p->lh.t = 0;
@@ -19847,6 +20133,11 @@ void gen_cleanup (parser *p)
 	rndebug(("freeing p->ret %p\n", (void *) p->ret));
 	free_tree(p->ret, p, FR_RET);
 
+	if (p->prog != NULL) {
+	    genprog_destroy(p->prog);
+	    p->prog = NULL;
+	}
+
 	free(p->lh.expr);
     }
 
@@ -19883,6 +20174,97 @@ void genr_reset_uvars (parser *p)
     real_reset_uvars(p);
 }
 
+/* Check, without evaluating anything, whether a variable node
+   in a compiled tree still matches the object of that name: this
+   mirrors the checks in node_reattach_data().
+*/
+
+static int uvnode_is_stale (NODE *n, parser *p)
+{
+    user_var *uv;
+
+    if (n->t == SERIES) {
+	return current_series_index(p->dset, n->vname) < 0;
+    }
+
+    uv = get_user_var_by_name(n->vname);
+
+    if (uv == NULL || uv->ptr == NULL) {
+	return 1;
+    } else if (uscalar_node(n)) {
+	return !(uv->type == GRETL_TYPE_DOUBLE ||
+		 (ONE_BY_ONE_CAST && uv->type == GRETL_TYPE_MATRIX));
+    } else if (n->t == MAT) {
+	return uv->type != GRETL_TYPE_MATRIX;
+    } else if (n->t == LIST) {
+	return uv->type != GRETL_TYPE_LIST;
+    } else if (n->t == BUNDLE) {
+	return uv->type != GRETL_TYPE_BUNDLE;
+    } else if (n->t == STR) {
+	return uv->type != GRETL_TYPE_STRING;
+    } else if (n->t == ARRAY) {
+	return uv->type != GRETL_TYPE_ARRAY;
+    }
+
+    return 0;
+}
+
+static int tree_is_stale (NODE *t, parser *p)
+{
+    int i, ret = 0;
+
+    if (t == NULL || t->t == F_EXISTS || t->t == F_TYPEOF) {
+	/* object queries are OK with missing objects */
+	return 0;
+    }
+
+    if (bnsym(t->t)) {
+	for (i=0; i<t->v.bn.n_nodes && !ret; i++) {
+	    ret = tree_is_stale(t->v.bn.n[i], p);
+	}
+    } else {
+	ret = tree_is_stale(t->L, p) || tree_is_stale(t->M, p) ||
+	    tree_is_stale(t->R, p);
+    }
+
+    if (!ret && t->vname != NULL &&
+	((t->t >= NUM && t->t <= STR) || postfix_node(t))) {
+	ret = uvnode_is_stale(t, p);
+    }
+
+    return ret;
+}
+
+/**
+ * genr_is_stale:
+ * @p: pointer to compiled generator.
+ * @dset: pointer to dataset.
+ *
+ * Checks, before execution, whether any of the named objects
+ * referenced by @p has been deleted or has changed type since
+ * @p was compiled, in which case @p should be discarded and the
+ * statement recompiled from source.
+ *
+ * Returns: 1 if @p is stale, otherwise 0.
+ */
+
+int genr_is_stale (parser *p, DATASET *dset)
+{
+    int ret;
+
+    if (p->err) {
+	return 0;
+    }
+
+    p->dset = dset;
+    ret = tree_is_stale(p->tree, p);
+    if (!ret && p->lhtree != NULL) {
+	ret = tree_is_stale(p->lhtree, p);
+    }
+
+    return ret;
+}
+
 static void maybe_set_return_flags (parser *p)
 {
     NODE *t = p->tree;
@@ -20095,6 +20477,12 @@ int realgen (const char *s, parser *p, DATASET *dset, PRN *prn,
 		p->flags &= ~P_START;
 	    }
 	}
+    } else if (p->prog != NULL && p->prog->n > 0) {
+	/* execute the flattened form of the tree */
+	p->ret = genprog_exec(p);
+	if (p->ret == NULL && !p->err) {
+	    p->ret = eval(p->tree, p);
+	}
     } else {
 	/* standard non-dynamic evaluation */
 	p->ret = eval(p->tree, p);
@@ -20104,6 +20492,12 @@ int realgen (const char *s, parser *p, DATASET *dset, PRN *prn,
 	p->callcount += 1;
     }
 
+#if USE_GENPROG
+    if (reusable(p) && p->prog == NULL && !p->err) {
+	genprog_build(p);
+    }
+#endif
+
  gen_finish:
 
     if (p->errprn != NULL) {
@@ -6758,30 +6758,111 @@ double series_sum_all (int t1, int t2, const double *x)
     return xsum;
 }
 
-static gretl_matrix *delete_null_cases (gretl_matrix *m,
-					int keeprows,
-					int *err)
+/* Support for aggregate_by(): rather than scanning the sample
+   once for each combination of values of the "by" variable(s), we
+   sort the observations once, by the combination of y-values they
+   exhibit, so that each non-empty group occupies a contiguous
+   segment of the sorted array.
+*/
+
+typedef struct {
+    guint64 code; /* index of the combination of y-values */
+    int t;        /* observation, relative to dset->t1 */
+} aggr_obs;
+
+static int compare_aggr_obs (const void *a, const void *b)
 {
-    gretl_matrix *ret;
+    const aggr_obs *pa = a;
+    const aggr_obs *pb = b;
 
-    ret = gretl_matrix_alloc(keeprows, m->cols);
-    if (ret == NULL) {
-	*err = E_ALLOC;
+    if (pa->code != pb->code) {
+	return pa->code < pb->code ? -1 : 1;
     } else {
-	double x;
-	int i, j;
+	/* preserve the original order within groups */
+	return pa->t - pb->t;
+    }
+}
+
+/* find @x among the sorted distinct values in @v, or return -1 */
+
+static int aggr_value_index (const gretl_matrix *v, double x)
+{
+    int lo = 0, hi = v->rows - 1;
+    int mid;
+
+    if (na(x)) {
+	return -1;
+    }
+
+    while (lo <= hi) {
+	mid = (lo + hi) / 2;
+	if (v->val[mid] == x) {
+	    return mid;
+	} else if (v->val[mid] < x) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid - 1;
+	}
+    }
+
+    return -1;
+}
 
-	for (i=0; i<keeprows; i++) {
-	    for (j=0; j<m->cols; j++) {
-		x = gretl_matrix_get(m, i, j);
-		gretl_matrix_set(ret, i, j, x);
+/* Construct an array holding the observations at which all the
+   y variables have valid values, sorted by the mixed-radix index
+   of the combination of y-values. The number of such observations
+   is written to @pnv.
+*/
+
+static aggr_obs *aggr_sort_obs (const double **yvec,
+				gretl_matrix **listvals,
+				int ny, int n, int *pnv,
+				int *err)
+{
+    aggr_obs *ao;
+    guint64 code;
+    int j, k, t, nv = 0;
+
+    ao = malloc(n * sizeof *ao);
+    if (ao == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    for (t=0; t<n; t++) {
+	code = 0;
+	for (j=0; j<ny; j++) {
+	    k = aggr_value_index(listvals[j], yvec[j][t]);
+	    if (k < 0) {
+		break;
 	    }
+	    code = code * listvals[j]->rows + k;
+	}
+	if (j == ny) {
+	    ao[nv].code = code;
+	    ao[nv].t = t;
+	    nv++;
 	}
     }
 
-    gretl_matrix_free(m);
+    qsort(ao, nv, sizeof *ao, compare_aggr_obs);
+    *pnv = nv;
 
-    return ret;
+    return ao;
+}
+
+/* write into row @i of @m the y-values corresponding to @code */
+
+static void aggr_set_yvals (gretl_matrix *m, int i, guint64 code,
+			    gretl_matrix **listvals, int ny)
+{
+    int j, L;
+
+    for (j=ny-1; j>=0; j--) {
+	L = listvals[j]->rows;
+	gretl_matrix_set(m, i, j, listvals[j]->val[code % L]);
+	code /= L;
+    }
 }
 
 static gretl_matrix *real_aggregate_by (const double *x,
@@ -6798,16 +6879,19 @@ static gretl_matrix *real_aggregate_by (const double *x,
 {
     gretl_matrix *m = NULL;
     gretl_matrix **listvals;
-    gretl_matrix *yvals;
+    const double **yvec;
+    aggr_obs *ao = NULL;
+    double *xs = NULL;
+    int *gstart = NULL;
+    int *rowg = NULL;
     int n = sample_size(dset);
-    int match, skipnull = 0;
+    int skipnull = 0;
     int countcol = 1;
-    int maxcases;
-    int ny, nx, mcols;
-    int *idx;
-    double *valvec;
+    double maxcases = 1;
+    int ny, nx, nv = 0;
+    int ng, nrows, mcols;
     double fx;
-    int i, j, k, t, ni, ii;
+    int i, j, k, g, s, ni;
 
     /* note:
        - to skip null cases in the output matrix, set skipnull = 1
@@ -6816,37 +6900,30 @@ static gretl_matrix *real_aggregate_by (const double *x,
 
     ny = ylist == NULL ? 1 : ylist[0];
 
-    valvec = malloc(ny * sizeof *valvec);
-    idx = malloc(ny * sizeof *idx);
-    listvals = malloc(ny * sizeof *listvals);
+    yvec = malloc(ny * sizeof *yvec);
+    listvals = calloc(ny, sizeof *listvals);
 
-    if (valvec == NULL || idx == NULL || listvals == NULL) {
+    if (yvec == NULL || listvals == NULL) {
 	*err = E_ALLOC;
 	goto bailout;
     }
 
-    for (j=0; j<ny; j++) {
-	listvals[j] = NULL;
-    }
-
     /* For @y (or each member of @ylist), create a vector holding
-       its distinct values. As we go, count the combinations of
-       y-values and initialize the valvec and idx arrays.
+       its distinct values, and count the combinations of y-values.
     */
 
-    maxcases = 1;
     for (j=0; j<ny && !*err; j++) {
-	if (ylist != NULL) {
-	    y = dset->Z[ylist[j+1]] + dset->t1;
-	}
-	listvals[j] = gretl_matrix_values(y, n, OPT_S, err);
+	yvec[j] = ylist == NULL ? y : dset->Z[ylist[j+1]] + dset->t1;
+	listvals[j] = gretl_matrix_values(yvec[j], n, OPT_S, err);
 	if (!*err) {
 	    maxcases *= listvals[j]->rows;
-	    valvec[j] = listvals[j]->val[0];
-	    idx[j] = 0;
 	}
     }
 
+    if (!*err && maxcases > (skipnull ? 1.0e18 : INT_MAX)) {
+	*err = E_ALLOC;
+    }
+
     if (just_count) {
 	x = NULL;
 	xlist = NULL;
@@ -6857,112 +6934,112 @@ static gretl_matrix *real_aggregate_by (const double *x,
 	nx = xlist == NULL ? 1 : xlist[0];
     }
 
-    mcols = ny + nx + countcol;
+    if (!*err) {
+	ao = aggr_sort_obs(yvec, listvals, ny, n, &nv, err);
+    }
+
+    if (*err) {
+	goto bailout;
+    }
+
+    /* record the starting points of the non-empty groups */
+    gstart = malloc((nv + 1) * sizeof *gstart);
+    if (gstart == NULL) {
+	*err = E_ALLOC;
+	goto bailout;
+    }
+    ng = 0;
+    for (s=0; s<nv; s++) {
+	if (s == 0 || ao[s].code != ao[s-1].code) {
+	    gstart[ng++] = s;
+	}
+    }
+    gstart[ng] = nv;
 
     /* Allocate a matrix with enough rows to hold all the y-value
-       combinations (maxcases) and enough columns to hold a
-       record of the y values, a count of matching cases, and the
-       value(s) of f(x).
+       combinations (or just the non-empty ones, if skipnull) and
+       enough columns to hold a record of the y values, a count
+       of matching cases, and the value(s) of f(x).
     */
 
-    if (!*err) {
-	m = gretl_zero_matrix_new(maxcases, mcols);
-	if (m == NULL) {
-	    *err = E_ALLOC;
-	}
+    nrows = skipnull ? ng : (int) maxcases;
+    mcols = ny + nx + countcol;
+
+    m = gretl_zero_matrix_new(nrows, mcols);
+    rowg = malloc((nrows > 0 ? nrows : 1) * sizeof *rowg);
+    if (!just_count) {
+	xs = malloc(n * sizeof *xs);
     }
 
-    if (*err) {
+    if (m == NULL || rowg == NULL || (!just_count && xs == NULL)) {
+	*err = E_ALLOC;
 	goto bailout;
     }
 
-    ii = 0;
+    /* the y-values and counts, and the group (if any) for each row */
+    for (i=0, g=0; i<nrows; i++) {
+	guint64 code = skipnull ? ao[gstart[i]].code : (guint64) i;
 
-    for (i=0; i<maxcases; i++) {
-	ni = 0;
-	for (k=0; k<nx && !*err; k++) {
-	    /* fill tmp with x for {y} == {yi} */
-	    if (xlist != NULL) {
-		x = dset->Z[xlist[k+1]] + dset->t1;
-	    }
+	if (g < ng && ao[gstart[g]].code == code) {
+	    rowg[i] = g;
+	    ni = gstart[g+1] - gstart[g];
+	    g++;
+	} else {
+	    rowg[i] = -1;
 	    ni = 0;
-	    for (t=0; t<n; t++) {
-		match = 1;
-		for (j=0; j<ny; j++) {
-		    if (ylist != NULL) {
-			y = dset->Z[ylist[j+1]] + dset->t1;
-		    }
-		    if (y[t] != valvec[j]) {
-			match = 0;
-			break;
-		    }
-		}
-		if (match) {
-		    if (x != NULL) {
-			tmp[ni] = x[t];
-		    }
-		    ni++;
-		}
-	    }
-	    if (just_count) {
-		gretl_matrix_set(m, ii, ny, ni);
-		break;
-	    } else if (ni == 0 && skipnull) {
-		/* exclude cases where the obs count is 0 */
-		break;
-	    } else {
-		/* aggregate x at current y values */
-		if (builtin != NULL) {
-		    fx = (*builtin)(0, ni-1, tmp);
-		} else {
-		    tmpset->t2 = ni-1;
-		    fx = generate_scalar(usercall, tmpset, err);
-		}
-		gretl_matrix_set(m, ii, ny+k+countcol, fx);
-	    }
 	}
+	aggr_set_yvals(m, i, code, listvals, ny);
+	gretl_matrix_set(m, i, ny, ni);
+    }
 
-	if (ni > 0 || !skipnull) {
-	    for (j=0; j<ny; j++) {
-		gretl_matrix_set(m, ii, j, valvec[j]);
-	    }
-	    if (countcol) {
-		gretl_matrix_set(m, ii, ny, ni);
-	    }
-	    ii++;
-	}
+    for (k=0; k<nx && !just_count && !*err; k++) {
+	int col = ny + k + countcol;
 
-	if (*err) {
-	    break;
+	/* arrange x in group order */
+	if (xlist != NULL) {
+	    x = dset->Z[xlist[k+1]] + dset->t1;
+	}
+	for (s=0; s<nv; s++) {
+	    xs[s] = x[ao[s].t];
 	}
 
-	/* set up the next y-values array */
-	for (j=ny-1; j>=0; j--) {
-	    yvals = listvals[j];
-	    if (idx[j] == yvals->rows - 1) {
-		/* restart the index at this level and pass
-		   the buck */
-		idx[j] = 0;
-		valvec[j] = yvals->val[0];
-	    } else {
-		/* increment the index at this level and
-		   we're done */
-		idx[j] += 1;
-		valvec[j] = yvals->val[idx[j]];
-		break;
+	if (builtin != NULL) {
+	    /* aggregate x for each combination of y values; the
+	       builtin functions can safely run in parallel */
+#if defined(_OPENMP)
+#pragma omp parallel for private(i, g) if (libset_use_openmp(nv))
+#endif
+	    for (i=0; i<nrows; i++) {
+		g = rowg[i];
+		if (g < 0) {
+		    gretl_matrix_set(m, i, col, (*builtin)(0, -1, xs));
+		} else {
+		    gretl_matrix_set(m, i, col, (*builtin)(gstart[g],
+							   gstart[g+1]-1,
+							   xs));
+		}
+	    }
+	} else {
+	    for (i=0; i<nrows && !*err; i++) {
+		g = rowg[i];
+		ni = g < 0 ? 0 : gstart[g+1] - gstart[g];
+		if (ni > 0) {
+		    memcpy(tmp, xs + gstart[g], ni * sizeof *tmp);
+		}
+		tmpset->t2 = ni-1;
+		fx = generate_scalar(usercall, tmpset, err);
+		gretl_matrix_set(m, i, col, fx);
 	    }
 	}
     }
 
-    if (skipnull && ii < maxcases) {
-	/* the matrix contains some null cases: shrink it */
-	m = delete_null_cases(m, ii, err);
-    }
-
  bailout:
 
-    free(valvec);
-    free(idx);
+    free(yvec);
+    free(ao);
+    free(xs);
+    free(gstart);
+    free(rowg);
 
     if (listvals != NULL) {
 	for (j=0; j<ny; j++) {
@@ -7129,14 +7206,8 @@ gretl_matrix *aggregate_by (const double *x,
 
     n = sample_size(dset);
 
-    if (just_count) {
+    if (just_count || builtin != NULL) {
 	; /* nothing to do here */
-    } else if (builtin != NULL) {
-	/* nice and simple */
-	tmp = malloc(n * sizeof *tmp);
-	if (tmp == NULL) {
-	    *err = E_ALLOC;
-	}
     } else {
 	/* try treating as user-defined call */
 	tmpset = create_auxiliary_dataset(2, n, OPT_NONE);
@@ -7169,8 +7240,6 @@ gretl_matrix *aggregate_by (const double *x,
     if (tmpset != NULL) {
 	g_free(usercall);
 	destroy_dataset(tmpset);
-    } else {
-	free(tmp);
     }
 
     return m;
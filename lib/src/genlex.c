@@ -508,6 +508,11 @@ struct str_table funcs[] = {
     { F_ALLREDUCE, "mpiallred" },
     { F_SCATTER,   "mpiscatter" },
     { F_BARRIER,   "mpibarrier" },
+    { F_ALLGATHER, "mpiallgather" },
+    { F_MPI_ISEND, "mpiisend" },
+    { F_MPI_IRECV, "mpiirecv" },
+    { F_MPI_WAIT,  "mpiwait" },
+    { F_MPI_TEST,  "mpitest" },
     { F_EASTER,    "easterday" },
     { F_GENSERIES, "genseries" },
     { F_CURL,      "curl" },
@@ -595,6 +600,7 @@ struct str_table func_alias[] = {
     { F_CNAMEGET, "colname" },
     { F_RNAMEGET, "rowname" },
     { F_EXISTS,   "isnull" }, /* deprecated */
+    { F_ALLREDUCE, "mpiallreduce" },
     { 0,          NULL }
 };
 
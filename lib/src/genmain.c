@@ -27,6 +27,10 @@
 
 #include <errno.h>
 
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+
 #if GENDEBUG
 # define GDEBUG 1
 #else
@@ -379,6 +383,226 @@ static int try_for_listvar (const DATASET *dset, const char *s)
 
 #define GEN_LEVEL_DEBUG 0
 
+/* Hash index for looking up series by name, used once the dataset
+   is big enough that a linear search by strcmp() gets costly. The
+   index belongs to a single dataset at any given time: it is built
+   on demand, and extended incrementally as series are appended
+   (when the varname array is moved by realloc() on appending
+   series, dataset.c lets us know via series_index_relocate()).
+   Any other change to the series names (deletion, renaming,
+   renumbering, replacement of the dataset) calls for a rebuild,
+   which should be signalled via series_index_invalidate(). A hit
+   is checked against dset->varname, and if the check fails we
+   rebuild and try again; a miss is passed back to the caller,
+   which falls back on a linear search, so a name change that is
+   not signalled cannot make a series disappear.
+
+   The index is shared state, so it is not used from within an
+   OpenMP parallel region.
+
+   Several series may share a name, at different levels of function
+   execution, so the table maps a name to the lowest ID bearing that
+   name and @sx_next chains the IDs together in ascending order.
+*/
+
+#define SX_MINV 64
+
+#if defined(_OPENMP)
+# define sx_usable(d) ((d)->v >= SX_MINV && !omp_in_parallel())
+#else
+# define sx_usable(d) ((d)->v >= SX_MINV)
+#endif
+
+static GHashTable *sx_hash;      /* name -> lowest ID with that name */
+static int *sx_next;             /* next ID with the same name, or 0 */
+static int sx_alloc;             /* allocated size of @sx_next */
+static int sx_n;                 /* IDs below this are indexed */
+static const DATASET *sx_dset;   /* the dataset indexed */
+static char **sx_names;          /* its varname array, when indexed */
+
+/**
+ * series_index_invalidate:
+ *
+ * To be called when series are deleted, renamed or renumbered, or
+ * when a dataset is replaced: forces a rebuild of the index that
+ * supports series_index() on the next look-up.
+ */
+
+void series_index_invalidate (void)
+{
+    sx_dset = NULL;
+    sx_names = NULL;
+}
+
+/**
+ * series_index_is_current:
+ * @dset: data information struct.
+ *
+ * Returns: 1 if the index that supports series_index() is
+ * currently in use for @dset, otherwise 0.
+ */
+
+int series_index_is_current (const DATASET *dset)
+{
+    return sx_dset == dset && sx_names == dset->varname;
+}
+
+/**
+ * series_index_relocate:
+ * @dset: data information struct.
+ *
+ * To be called when the varname array of @dset has been moved
+ * in the course of appending series, if series_index_is_current()
+ * returned 1 prior to the move. The names of the existing
+ * series must be unchanged; the index then remains in use.
+ */
+
+void series_index_relocate (const DATASET *dset)
+{
+    sx_dset = dset;
+    sx_names = dset->varname;
+}
+
+void series_index_cleanup (void)
+{
+    if (sx_hash != NULL) {
+	g_hash_table_destroy(sx_hash);
+	sx_hash = NULL;
+    }
+    free(sx_next);
+    sx_next = NULL;
+    sx_alloc = 0;
+    series_index_invalidate();
+}
+
+static void sx_insert (const DATASET *dset, int i)
+{
+    gpointer p = g_hash_table_lookup(sx_hash, dset->varname[i]);
+
+    sx_next[i] = 0;
+
+    if (p == NULL) {
+	g_hash_table_insert(sx_hash, g_strdup(dset->varname[i]),
+			    GINT_TO_POINTER(i));
+    } else {
+	int j = GPOINTER_TO_INT(p);
+
+	while (sx_next[j] > 0) {
+	    j = sx_next[j];
+	}
+	sx_next[j] = i;
+    }
+}
+
+/* Bring the index into line with @dset. Series that have been
+   added but not yet named are left for a subsequent call; the
+   IDs from @sx_n upward must therefore be checked directly.
+*/
+
+static int sx_update (const DATASET *dset, int rebuild)
+{
+    int i;
+
+    if (rebuild || dset != sx_dset || dset->varname != sx_names ||
+	dset->v < sx_n) {
+	if (sx_hash == NULL) {
+	    sx_hash = g_hash_table_new_full(g_str_hash, g_str_equal,
+					    g_free, NULL);
+	} else {
+	    g_hash_table_remove_all(sx_hash);
+	}
+	sx_dset = dset;
+	sx_names = dset->varname;
+	sx_n = 1;
+    }
+
+    if (dset->v > sx_alloc) {
+	int n = dset->v + dset->v / 4;
+	int *tmp = realloc(sx_next, n * sizeof *tmp);
+
+	if (tmp == NULL) {
+	    series_index_invalidate();
+	    return E_ALLOC;
+	}
+	sx_next = tmp;
+	sx_alloc = n;
+    }
+
+    for (i=sx_n; i<dset->v && dset->varname[i][0] != '\0'; i++) {
+	sx_insert(dset, i);
+    }
+    sx_n = i;
+
+    return 0;
+}
+
+#define sx_visible(d,i,fd) (fd == 0 || (fd == series_get_stack_level(d,i) \
+					&& !series_is_listarg(d,i)))
+
+/* Hash-based counterpart to the loops in series_index() and
+   series_greatest_index(): returns 1 with the matching ID
+   written to @pv if a match is found, otherwise 0 (no match, or
+   the index is unavailable), in which case the caller should
+   search linearly.
+*/
+
+static int sx_lookup (const DATASET *dset, const char *s, int fd,
+		      int greatest, int *pv)
+{
+    int i, v = 0;
+    int tried = 0;
+
+ retry:
+
+    if (sx_update(dset, tried)) {
+	return 0;
+    }
+
+    if (greatest) {
+	for (i=dset->v-1; i>=sx_n && v == 0; i--) {
+	    if (sx_visible(dset, i, fd) && !strcmp(dset->varname[i], s)) {
+		v = i;
+	    }
+	}
+    }
+
+    if (v == 0) {
+	gpointer p = g_hash_table_lookup(sx_hash, s);
+
+	for (i=GPOINTER_TO_INT(p); i>0; i=sx_next[i]) {
+	    if (strcmp(dset->varname[i], s)) {
+		/* the index is out of date */
+		if (!tried) {
+		    tried = 1;
+		    goto retry;
+		}
+		series_index_invalidate();
+		return 0;
+	    } else if (sx_visible(dset, i, fd)) {
+		v = i;
+		if (!greatest) {
+		    break;
+		}
+	    }
+	}
+    }
+
+    if (!greatest) {
+	for (i=sx_n; i<dset->v && v == 0; i++) {
+	    if (sx_visible(dset, i, fd) && !strcmp(dset->varname[i], s)) {
+		v = i;
+	    }
+	}
+    }
+
+    if (v > 0) {
+	*pv = v;
+	return 1;
+    }
+
+    return 0;
+}
+
 /**
  * series_index:
  * @dset: data information struct.
@@ -415,7 +639,9 @@ int series_index (const DATASET *dset, const char *varname)
 
 	fd = gretl_function_depth();
 
-	if (fd == 0) {
+	if (sx_usable(dset) && sx_lookup(dset, s, fd, 0, &ret)) {
+	    ; /* found via hash look-up */
+	} else if (fd == 0) {
 	    /* not inside a user function: easy */
 	    for (i=1; i<dset->v; i++) {
 		if (strcmp(dset->varname[i], s) == 0) {
@@ -488,7 +714,9 @@ int series_greatest_index (const DATASET *dset, const char *varname)
 
 	fd = gretl_function_depth();
 
-	if (fd == 0) {
+	if (sx_usable(dset) && sx_lookup(dset, s, fd, 1, &ret)) {
+	    ; /* found via hash look-up */
+	} else if (fd == 0) {
 	    /* not inside a user function: easy */
 	    for (i=dset->v-1; i>0; i--) {
 		if (strcmp(dset->varname[i], s) == 0) {
@@ -756,6 +984,30 @@ static int maybe_unassigned_fncall (const char *s)
 
 #define gen_silent(f) (f & (P_DISCARD | P_PRIV | P_DECL))
 
+/* Post-processing after a successful "genr": record a label
+   and lag info for a generated series, print a message if
+   wanted, and note the type of the output. Here @oldv is the
+   number of series in the dataset prior to generation.
+*/
+
+static void gen_finish (parser *p, int oldv, gretlopt opt,
+			PRN *prn)
+{
+    if (!p->err && p->targ != EMPTY && !gen_silent(p->flags)) {
+	if (p->input != NULL) {
+	    gen_write_label(p, oldv);
+	}
+	if (gretl_messages_on() && prn != NULL && !(opt & OPT_Q)) {
+	    gen_write_message(p, oldv, prn);
+	}
+    }
+
+    genr_last_type = genr_get_output_type(p);
+    if (genr_last_type == GRETL_TYPE_SERIES) {
+	set_dataset_is_changed(p->dset, 1);
+    }
+}
+
 int generate (const char *line, DATASET *dset,
 	      GretlType gtype, gretlopt opt,
 	      PRN *prn)
@@ -830,18 +1082,9 @@ int generate (const char *line, DATASET *dset,
 
     if (!p.err && targtype != EMPTY) {
 	gen_save_or_print(&p, prn);
-	if (!p.err && !gen_silent(p.flags)) {
-	    gen_write_label(&p, oldv);
-	    if (gretl_messages_on() && prn != NULL && !(opt & OPT_Q)) {
-		gen_write_message(&p, oldv, prn);
-	    }
-	}
     }
 
-    genr_last_type = genr_get_output_type(&p);
-    if (genr_last_type == GRETL_TYPE_SERIES) {
-	set_dataset_is_changed(dset, 1);
-    }
+    gen_finish(&p, oldv, opt, prn);
 
     if (p.err == 1) {
 	/* a fairly good guess? */
@@ -1147,6 +1390,12 @@ parser *genr_compile (const char *s, DATASET *dset,
 
     *err = realgen(s, p, dset, prn, flags, targtype);
 
+    if (*err == 0 && p->rhs != NULL && !(p->flags & P_ALTINP)) {
+	/* record the position of the RHS in @s */
+	p->inplen = strlen(s);
+	p->rhsoff = p->rhs - s;
+    }
+
     if (*err == 0 && p != NULL &&
 	!(opt & OPT_N) && p->targ != EMPTY) {
 	gen_save_or_print(p, prn);
@@ -1194,6 +1443,67 @@ int execute_genr (parser *p, DATASET *dset, PRN *prn)
     return p->err;
 }
 
+/**
+ * genr_finish_command:
+ * @p: compiled generator.
+ * @src: the "genr" command line, with spaces normalized and
+ * comments stripped, if @p is a saved generator being re-run,
+ * otherwise NULL.
+ * @oldv: number of series in the dataset before @p was run.
+ * @opt: option flags from the "genr" command.
+ * @prn: printing struct.
+ *
+ * To be called after a compiled generator has been run in
+ * place of a "genr" command, to carry out the same
+ * post-processing as generate(). On re-running a saved
+ * generator, the text of the command (which supplies the
+ * label for a generated series) is taken from @src.
+ */
+
+void genr_finish_command (parser *p, const char *src, int oldv,
+			  gretlopt opt, PRN *prn)
+{
+    const char *input = p->input;
+    const char *rhs = p->rhs;
+
+    if (src != NULL) {
+	int n = strlen(src);
+
+	if (p->inplen >= 0 && p->inplen <= n) {
+	    p->input = src + n - p->inplen;
+	    p->rhs = p->input + p->rhsoff;
+	} else {
+	    p->input = p->rhs = NULL;
+	}
+    }
+
+    gen_finish(p, oldv, opt, prn);
+
+    p->input = input;
+    p->rhs = rhs;
+}
+
+/**
+ * genr_command_cacheable:
+ * @p: compiled generator.
+ *
+ * Returns: non-zero if @p, having been run in place of a
+ * "genr" command, can be saved and re-run on the next
+ * execution of the command; 0 if the command must be run
+ * in the regular way. The latter applies when messages
+ * are on, and when a series is generated from input that
+ * can't be located in the command line for labelling.
+ */
+
+int genr_command_cacheable (const parser *p)
+{
+    if (p->targ == SERIES && p->inplen < 0) {
+	return 0;
+    } else {
+	return !gretl_messages_on();
+    }
+}
+
 double evaluate_scalar_genr (parser *p, DATASET *dset,
 			     PRN *prn, int *err)
 {
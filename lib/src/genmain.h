@@ -158,6 +158,11 @@ int execute_genr (GENERATOR *genr, DATASET *dset, PRN *prn);
 
 void destroy_genr (GENERATOR *genr);
 
+void genr_finish_command (GENERATOR *genr, const char *src,
+			  int oldv, gretlopt opt, PRN *prn);
+
+int genr_command_cacheable (const GENERATOR *genr);
+
 int genr_get_output_type (const GENERATOR *genr);
 
 int genr_get_output_varnum (const GENERATOR *genr);
@@ -170,6 +175,14 @@ gretl_matrix *genr_get_output_matrix (GENERATOR *genr);
 
 int series_index (const DATASET *dset, const char *varname);
 
+void series_index_invalidate (void);
+
+int series_index_is_current (const DATASET *dset);
+
+void series_index_relocate (const DATASET *dset);
+
+void series_index_cleanup (void);
+
 int series_greatest_index (const DATASET *dset, const char *varname);
 
 int current_series_index (const DATASET *dset, const char *vname);
@@ -222,6 +235,8 @@ void genr_unset_na_check (GENERATOR *genr);
 
 void genr_reset_uvars (GENERATOR *genr);
 
+int genr_is_stale (GENERATOR *genr, DATASET *dset);
+
 int function_from_string (const char *s);
 
 int function_lookup (const char *s);
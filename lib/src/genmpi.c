@@ -112,6 +112,52 @@ static gretl_matrix *get_transfer_matrix (NODE *t, int f, parser *p)
     return m;
 }
 
+/* package an object received via MPI as a node */
+
+static NODE *mpi_object_node (void *ptr, GretlType type, parser *p)
+{
+    NODE *ret = NULL;
+
+    if (type == GRETL_TYPE_MATRIX) {
+	ret = aux_matrix_node(p);
+	if (!p->err) {
+	    ret->v.m = ptr;
+	}
+    } else if (type == GRETL_TYPE_BUNDLE) {
+	ret = aux_bundle_node(p);
+	if (!p->err) {
+	    ret->v.b = ptr;
+	}
+    } else if (type == GRETL_TYPE_ARRAY) {
+	ret = aux_array_node(p);
+	if (!p->err) {
+	    ret->v.a = ptr;
+	}
+    } else if (type == GRETL_TYPE_DOUBLE) {
+	ret = aux_scalar_node(p);
+	if (!p->err) {
+	    ret->v.xval = *(double *) ptr;
+	}
+    } else if (type == GRETL_TYPE_STRING) {
+	ret = aux_string_node(p);
+	if (!p->err) {
+	    ret->v.str = ptr;
+	}
+    } else if (type == GRETL_TYPE_LIST) {
+	ret = aux_list_node(p);
+	if (!p->err) {
+	    ret->v.ivec = ptr;
+	}
+    } else if (type == GRETL_TYPE_INT) {
+	ret = aux_scalar_node(p);
+	if (!p->err) {
+	    ret->v.xval = *(int *) ptr;
+	}
+    }
+
+    return ret;
+}
+
 static NODE *mpi_transfer_node (NODE *l, NODE *r, NODE *r2,
 				int f, parser *p)
 {
@@ -126,7 +172,7 @@ static NODE *mpi_transfer_node (NODE *l, NODE *r, NODE *r2,
 	return NULL;
     }
 
-    if (f == F_MPI_SEND) {
+    if (f == F_MPI_SEND || f == F_MPI_ISEND) {
 	/* we need a destination id as second argument */
 	if (l->t == MAT) {
 	    type = GRETL_TYPE_MATRIX;
@@ -147,9 +193,23 @@ static NODE *mpi_transfer_node (NODE *l, NODE *r, NODE *r2,
 	    /* destination id */
 	    id = node_get_int(r, p);
 	}
-    } else if (f == F_MPI_RECV) {
+    } else if (f == F_MPI_RECV || f == F_MPI_IRECV) {
 	/* the single argument is the source id */
 	id = node_get_int(l, p);
+    } else if (f == F_MPI_WAIT || f == F_MPI_TEST) {
+	/* the single argument is a request handle */
+	id = node_get_int(l, p);
+    } else if (f == F_ALLGATHER) {
+	/* we need a scalar, matrix or array value */
+	if (l->t == NUM) {
+	    type = GRETL_TYPE_DOUBLE;
+	} else if (l->t == MAT) {
+	    type = GRETL_TYPE_MATRIX;
+	} else if (l->t == ARRAY) {
+	    type = GRETL_TYPE_ARRAY;
+	} else {
+	    p->err = E_TYPES;
+	}
     } else if (f == F_BCAST || f == F_REDUCE ||
 	       f == F_ALLREDUCE || f == F_SCATTER) {
 	/* we need the address of a variable on the left */
@@ -164,8 +224,8 @@ static NODE *mpi_transfer_node (NODE *l, NODE *r, NODE *r2,
 	    } else if (ubundle_node(l) && f == F_BCAST) {
 		/* bundle: only broadcast OK */
 		type = GRETL_TYPE_BUNDLE;
-	    } else if (uarray_node(l) && (f == F_REDUCE || f == F_BCAST)) {
-		/* array: reduce and broadcast OK */
+	    } else if (uarray_node(l) && f != F_SCATTER) {
+		/* array: all ops OK apart from scatter */
 		type = GRETL_TYPE_ARRAY;
 	    } else if (ustring_node(l) && f == F_BCAST) {
 		/* string: only broadcast OK */
@@ -196,7 +256,7 @@ static NODE *mpi_transfer_node (NODE *l, NODE *r, NODE *r2,
 
     if (p->err) {
 	return NULL;
-    } else if (f == F_MPI_SEND) {
+    } else if (f == F_MPI_SEND || f == F_MPI_ISEND) {
 	void *sendp = NULL;
 
 	if (type == GRETL_TYPE_MATRIX) {
@@ -217,7 +277,10 @@ static NODE *mpi_transfer_node (NODE *l, NODE *r, NODE *r2,
 	if (!p->err) {
 	    ret = aux_scalar_node(p);
 	}
-	if (!p->err) {
+	if (!p->err && f == F_MPI_ISEND) {
+	    /* return the request handle */
+	    ret->v.xval = gretl_mpi_isend(sendp, type, id, &p->err);
+	} else if (!p->err) {
 	    p->err = ret->v.xval = gretl_mpi_send(sendp, type, id);
 	}
     } else if (f == F_MPI_RECV) {
@@ -226,41 +289,55 @@ static NODE *mpi_transfer_node (NODE *l, NODE *r, NODE *r2,
 	recvp = gretl_mpi_receive(id, &type, &p->err);
 
 	if (!p->err) {
-	    if (type == GRETL_TYPE_MATRIX) {
-		ret = aux_matrix_node(p);
-		if (!p->err) {
-		    ret->v.m = recvp;
-		}
-	    } else if (type == GRETL_TYPE_BUNDLE) {
-		ret = aux_bundle_node(p);
-		if (!p->err) {
-		    ret->v.b = recvp;
-		}
-	    } else if (type == GRETL_TYPE_ARRAY) {
-		ret = aux_array_node(p);
-		if (!p->err) {
-		    ret->v.a = recvp;
-		}
-	    } else if (type == GRETL_TYPE_DOUBLE) {
+	    ret = mpi_object_node(recvp, type, p);
+	}
+    } else if (f == F_MPI_IRECV) {
+	ret = aux_scalar_node(p);
+	if (!p->err) {
+	    ret->v.xval = gretl_mpi_irecv(id, &p->err);
+	}
+    } else if (f == F_MPI_WAIT) {
+	void *recvp;
+
+	recvp = gretl_mpi_wait(id, &type, &p->err);
+
+	if (!p->err) {
+	    if (type == GRETL_TYPE_NONE) {
+		/* completion of a send */
 		ret = aux_scalar_node(p);
 		if (!p->err) {
-		    ret->v.xval = *(double *) recvp;
+		    ret->v.xval = 0;
 		}
-	    } else if (type == GRETL_TYPE_STRING) {
-		ret = aux_string_node(p);
-		if (!p->err) {
-		    ret->v.str = recvp;
-		}
-	    } else if (type == GRETL_TYPE_LIST) {
-		ret = aux_list_node(p);
-		if (!p->err) {
-		    ret->v.ivec = recvp;
+	    } else {
+		ret = mpi_object_node(recvp, type, p);
+		if (type == GRETL_TYPE_DOUBLE || type == GRETL_TYPE_INT) {
+		    free(recvp);
 		}
-	    } else if (type == GRETL_TYPE_INT) {
-		ret = aux_scalar_node(p);
+	    }
+	}
+    } else if (f == F_MPI_TEST) {
+	ret = aux_scalar_node(p);
+	if (!p->err) {
+	    ret->v.xval = gretl_mpi_test(id, &p->err);
+	}
+    } else if (f == F_ALLGATHER) {
+	if (type == GRETL_TYPE_ARRAY) {
+	    ret = aux_array_node(p);
+	    if (!p->err) {
+		p->err = gretl_array_mpi_allgather(l->v.a, &ret->v.a);
+	    }
+	} else {
+	    ret = aux_matrix_node(p);
+	    if (!p->err && type == GRETL_TYPE_MATRIX) {
+		gretl_matrix *lm = get_transfer_matrix(l, f, p);
+
 		if (!p->err) {
-		    ret->v.xval = *(int *) recvp;
+		    p->err = gretl_matrix_mpi_reduce(lm, &ret->v.m,
+						     GRETL_MPI_VCAT, 0,
+						     OPT_A);
 		}
+	    } else if (!p->err) {
+		p->err = gretl_scalar_mpi_allgather(l->v.xval, &ret->v.m);
 	    }
 	}
     } else if (f == F_BCAST) {
@@ -336,7 +413,13 @@ static NODE *mpi_transfer_node (NODE *l, NODE *r, NODE *r2,
 	    gretl_array *a = NULL;
 	    double x = NADBL;
 
-	    if (type == GRETL_TYPE_ARRAY) {
+	    if (type == GRETL_TYPE_ARRAY && f == F_ALLREDUCE) {
+		if (op == GRETL_MPI_ACAT) {
+		    p->err = gretl_array_mpi_allgather(l->v.a, &a);
+		} else {
+		    p->err = E_DATA;
+		}
+	    } else if (type == GRETL_TYPE_ARRAY) {
 		p->err = gretl_array_mpi_reduce(l->v.a, &a, op, root);
 	    } else if (type == GRETL_TYPE_MATRIX) {
 		lm = get_transfer_matrix(l, f, p);
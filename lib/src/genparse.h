@@ -290,6 +290,10 @@ enum {
     F_CTRANS,
     F_MLOG,
     F_BARRIER,
+    F_ALLGATHER,
+    F_MPI_IRECV,
+    F_MPI_WAIT,
+    F_MPI_TEST,
     HF_JBTERMS,
     F1_MAX,	  /* SEPARATOR: end of single-arg functions */
     HF_LISTINFO,
@@ -368,6 +372,7 @@ enum {
     F_MPI_SEND,
     F_BCAST,
     F_ALLREDUCE,
+    F_MPI_ISEND,
     F_GENSERIES,
     F_KPSSCRIT,
     F_STRINGIFY,
@@ -623,12 +628,13 @@ enum node_flags {
     LHT_NODE = 1 << 4, /* node holds terminal of LHS */
     MSL_NODE = 1 << 5, /* (scalar) node is matrix element */
     MUT_NODE = 1 << 6, /* node is inherently mutable in type */
-    ALS_NODE = 1 << 7  /* function subject to "reversing" alias */
+    ALS_NODE = 1 << 7, /* function subject to "reversing" alias */
+    MVW_NODE = 1 << 8  /* matrix node holds a view, not a copy */
 };
 
 struct node {
     gint16 t;        /* type identifier */
-    guint8 flags;    /* AUX_NODE etc., see above */
+    guint16 flags;   /* AUX_NODE etc., see above */
     int vnum;        /* associated series ID number */
     char *vname;     /* associated variable name */
     user_var *uv;    /* associated named variable */
@@ -683,11 +689,15 @@ struct lhinfo {
 };
 
 typedef struct parser_ parser;
+typedef struct genprog_ genprog;
 
 struct parser_ {
     const char *input; /* complete input string */
     const char *point; /* remaining unprocessed input */
     const char *rhs;   /* for use in labelling */
+    int inplen;        /* length of @input, and */
+    int rhsoff;        /* offset of @rhs within it, for relabelling
+			  on re-running a saved generator */
     DATASET *dset;     /* convenience pointer to dataset */
     PRN *prn;          /* for printing messages */
     PRN *errprn;       /* for storing error message in case @prn is NULL */
@@ -699,6 +709,7 @@ struct parser_ {
     NODE *lhres;       /* result of eval() on @lhtree */
     NODE *tree;        /* RHS syntax tree */
     NODE *ret;         /* result of eval() on @tree */
+    genprog *prog;     /* flattened form of @tree, if applicable */
     /* below: parser state variables */
     NODE *aux;         /* convenience pointer to current auxiliary node */
     int callcount;
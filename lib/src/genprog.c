@@ -0,0 +1,349 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Included by geneval.c: "flattening" of the syntax tree of a
+   compiled generator into a linear instruction stream.
+
+   When a compiled parser is executed repeatedly (in loops, or as
+   the "slave" of NLS/MLE/GMM) each call to eval() re-traverses the
+   L/M/R pointers of the tree and goes through the aux-node lookup
+   machinery for each operator. For the common case of a tree that
+   is built purely from scalars, series, the arithmetical and
+   comparison operators and the one-argument math functions we can
+   instead run a post-order list of instructions in a simple loop.
+
+   The "registers" for the instructions are the tree's own terminal
+   nodes plus the aux nodes attached to the operator nodes on the
+   first evaluation: these are preallocated result slots (scalars,
+   or series of full dataset length) that persist across calls. The
+   results are therefore identical to those from eval(), and the
+   root's aux node can be handed back as p->ret in the usual way.
+
+   If anything about the tree turns out not to be as expected at
+   execution time (say, a named scalar has mutated into a 1 x 1
+   matrix, or the length of the dataset has changed) we discard the
+   program and fall back on eval(); the program is then rebuilt on
+   the basis of the new state of the tree.
+*/
+
+enum {
+    GP_LOAD = 1, /* refresh a named scalar or series */
+    GP_BINOP,    /* binary arithmetical or comparison operator */
+    GP_FUNC      /* function of one scalar or series argument */
+};
+
+typedef struct gp_insn_ gp_insn;
+
+struct gp_insn_ {
+    short code;  /* GP_LOAD, GP_BINOP or GP_FUNC */
+    short t;     /* type of result, NUM or SERIES */
+    NODE *n;     /* source node in the syntax tree */
+    NODE *dst;   /* result register */
+    NODE *a;     /* first (or only) operand register */
+    NODE *b;     /* second operand register, if any */
+};
+
+struct genprog_ {
+    int n;          /* number of instructions (0: tree unsuitable) */
+    int nalloc;     /* allocated size of @insn */
+    int series;     /* does the program reference any series? */
+    gp_insn *insn;  /* the instructions, in order of execution */
+};
+
+#define gp_binop(o) (o == B_ADD || o == B_SUB || o == B_MUL ||	\
+		     o == B_DIV || o == B_MOD || o == B_POW ||	\
+		     o == B_EQ || o == B_NEQ || o == B_GT ||	\
+		     o == B_LT || o == B_GTE || o == B_LTE)
+
+#define gp_func(f) (f == U_NEG || f == U_POS || f == U_NOT ||	\
+		    f == F_ABS || f == F_SGN || f == F_TOINT ||	\
+		    f == F_CEIL || f == F_FLOOR || f == F_ROUND ||	\
+		    f == F_SIN || f == F_COS || f == F_TAN ||		\
+		    f == F_ASIN || f == F_ACOS || f == F_ATAN ||	\
+		    f == F_SINH || f == F_COSH || f == F_TANH ||	\
+		    f == F_ASINH || f == F_ACOSH || f == F_ATANH ||	\
+		    f == F_LOG || f == F_LOG10 || f == F_LOG2 ||	\
+		    f == F_EXP || f == F_SQRT || f == F_CNORM ||	\
+		    f == F_DNORM || f == F_QNORM || f == F_LOGISTIC || \
+		    f == F_GAMMA || f == F_LNGAMMA || f == F_DIGAMMA || \
+		    f == F_INVMILLS)
+
+#define gp_terminal(n) (n->t == NUM || (n->t == SERIES && \
+					!stringvec_node(n)))
+
+static void genprog_destroy (genprog *prog)
+{
+    if (prog != NULL) {
+	free(prog->insn);
+	free(prog);
+    }
+}
+
+static int gp_push (genprog *prog, int code, int t, NODE *n,
+		    NODE *dst, NODE *a, NODE *b)
+{
+    gp_insn *insn;
+
+    if (prog->n == prog->nalloc) {
+	int nalloc = prog->nalloc == 0 ? 8 : 2 * prog->nalloc;
+
+	insn = realloc(prog->insn, nalloc * sizeof *insn);
+	if (insn == NULL) {
+	    return E_ALLOC;
+	}
+	prog->insn = insn;
+	prog->nalloc = nalloc;
+    }
+
+    insn = &prog->insn[prog->n];
+    insn->code = code;
+    insn->t = t;
+    insn->n = n;
+    insn->dst = dst;
+    insn->a = a;
+    insn->b = b;
+    prog->n += 1;
+
+    if (t == SERIES) {
+	prog->series = 1;
+    }
+
+    return 0;
+}
+
+/* the register holding the result of evaluating @t */
+
+static NODE *gp_result (NODE *t)
+{
+    return gp_terminal(t) ? t : t->aux;
+}
+
+/* Post-order traversal of the tree rooted at @t, emitting
+   instructions as we go. Returns the type of the result, or
+   0 if the tree is not suitable for flattening.
+*/
+
+static int gp_flatten (NODE *t, genprog *prog, int *err)
+{
+    int lt, rt = 0, type;
+
+    if (t == NULL || *err) {
+	return 0;
+    }
+
+    if (gp_terminal(t)) {
+	if (uvar_node(t)) {
+	    *err = gp_push(prog, GP_LOAD, t->t, t, t, NULL, NULL);
+	}
+	return *err ? 0 : t->t;
+    }
+
+    if ((!gp_binop(t->t) && !gp_func(t->t)) || t->M != NULL ||
+	t->aux == NULL || is_proxy_node(t->aux)) {
+	return 0;
+    }
+
+    lt = gp_flatten(t->L, prog, err);
+    if (lt == 0) {
+	return 0;
+    }
+
+    if (gp_binop(t->t)) {
+	rt = gp_flatten(t->R, prog, err);
+	if (rt == 0) {
+	    return 0;
+	}
+    } else if (t->R != NULL) {
+	return 0;
+    }
+
+    type = (lt == SERIES || rt == SERIES) ? SERIES : NUM;
+    if (t->aux->t != type) {
+	return 0;
+    }
+
+    if (gp_binop(t->t)) {
+	*err = gp_push(prog, GP_BINOP, type, t, t->aux,
+		       gp_result(t->L), gp_result(t->R));
+    } else {
+	*err = gp_push(prog, GP_FUNC, type, t, t->aux,
+		       gp_result(t->L), NULL);
+    }
+
+    return *err ? 0 : type;
+}
+
+/* Called after successful evaluation of a compiled tree:
+   try to build an instruction stream for @p->tree. If the tree
+   is not suitable we attach a program with zero instructions,
+   so as not to repeat the analysis on every call.
+*/
+
+static void genprog_build (parser *p)
+{
+    genprog *prog;
+    int type = 0;
+    int err = 0;
+
+    prog = calloc(1, sizeof *prog);
+    if (prog == NULL) {
+	return;
+    }
+
+    if (!autoreg(p) && (p->targ == NUM || p->targ == SERIES) &&
+	p->tree != NULL && !gp_terminal(p->tree) &&
+	p->ret == p->tree->aux) {
+	type = gp_flatten(p->tree, prog, &err);
+    }
+
+    if (type == 0 || err) {
+	/* mark as unsuitable */
+	free(prog->insn);
+	prog->insn = NULL;
+	prog->n = prog->nalloc = 0;
+    }
+
+#if EDEBUG
+    fprintf(stderr, "genprog_build: '%s', %d instructions\n",
+	    p->input, prog->n);
+#endif
+
+    p->prog = prog;
+}
+
+static void gp_series_binop (gp_insn *insn, parser *p)
+{
+    const NODE *a = insn->a, *b = insn->b;
+    const double *x = NULL, *y = NULL;
+    double xt = 0, yt = 0;
+    double *z = insn->dst->v.xvec;
+    int op = insn->n->t;
+    int t, t1 = p->dset->t1, t2 = p->dset->t2;
+
+    if (a->t == SERIES) {
+	x = a->v.xvec;
+    } else {
+	xt = a->v.xval;
+    }
+    if (b->t == SERIES) {
+	y = b->v.xvec;
+    } else {
+	yt = b->v.xval;
+    }
+
+    if (xy_kernel_op(op) && t2 > t1) {
+	series_xy_kernel(z + t1, x != NULL ? x + t1 : &xt, x != NULL,
+			 y != NULL ? y + t1 : &yt, y != NULL,
+			 t2 - t1 + 1, op, p);
+    } else {
+	for (t=t1; t<=t2; t++) {
+	    if (x != NULL) {
+		xt = x[t];
+	    }
+	    if (y != NULL) {
+		yt = y[t];
+	    }
+	    z[t] = xy_calc(xt, yt, op, SERIES, p);
+	}
+    }
+}
+
+static void gp_series_func (gp_insn *insn, parser *p)
+{
+    double (*dfunc) (double) = insn->n->v.ptr;
+    const double *x = insn->a->v.xvec;
+    double *z = insn->dst->v.xvec;
+    int f = insn->n->t;
+    int t;
+
+    if (dfunc != NULL) {
+	for (t=p->dset->t1; t<=p->dset->t2; t++) {
+	    z[t] = dfunc(x[t]);
+	}
+    } else {
+	for (t=p->dset->t1; t<=p->dset->t2; t++) {
+	    z[t] = real_apply_func(x[t], f, p);
+	}
+    }
+}
+
+static double gp_scalar_func (gp_insn *insn, parser *p)
+{
+    double (*dfunc) (double) = insn->n->v.ptr;
+    double x = insn->a->v.xval;
+
+    return dfunc != NULL ? dfunc(x) : real_apply_func(x, insn->n->t, p);
+}
+
+/* The dispatch loop: returns the node holding the result, or
+   NULL. In the latter case, if p->err is zero the caller should
+   fall back on eval().
+*/
+
+static NODE *genprog_exec (parser *p)
+{
+    genprog *prog = p->prog;
+    gp_insn *insn;
+    int i;
+
+    if ((p->flags & P_DELTAN) || autoreg(p) ||
+	(prog->series && (p->dset == NULL || p->dset->n == 0))) {
+	goto fallback;
+    }
+
+    for (i=0, insn=prog->insn; i<prog->n; i++, insn++) {
+	if (insn->code == GP_LOAD) {
+	    if (exestart(p)) {
+		node_reattach_data(insn->n, p);
+		if (p->err) {
+		    return NULL;
+		}
+	    }
+	    if (insn->n->t != insn->t) {
+		goto fallback;
+	    }
+	} else if (insn->dst->t != insn->t || is_proxy_node(insn->dst) ||
+		   (insn->t == SERIES && insn->dst->v.xvec == NULL)) {
+	    goto fallback;
+	} else if (insn->t == NUM) {
+	    if (insn->code == GP_BINOP) {
+		insn->dst->v.xval = xy_calc(insn->a->v.xval, insn->b->v.xval,
+					    insn->n->t, NUM, p);
+	    } else {
+		insn->dst->v.xval = gp_scalar_func(insn, p);
+	    }
+	} else if (insn->code == GP_BINOP) {
+	    gp_series_binop(insn, p);
+	} else {
+	    gp_series_func(insn, p);
+	}
+    }
+
+    return p->err ? NULL : prog->insn[prog->n - 1].dst;
+
+ fallback:
+
+#if EDEBUG
+    fprintf(stderr, "genprog_exec: falling back on eval()\n");
+#endif
+    genprog_destroy(prog);
+    p->prog = NULL;
+
+    return NULL;
+}
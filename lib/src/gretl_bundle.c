@@ -31,6 +31,7 @@
 #include "var.h"
 #include "system.h"
 #include "gretl_bundle.h"
+#include "gretl_gbin.h"
 
 #define BDEBUG 0
 
@@ -2397,6 +2398,8 @@ int gretl_bundle_write_to_file (gretl_bundle *b,
 
     if (has_suffix(fname, ".json") || has_suffix(fname, ".geojson")) {
 	return call_bundle_to_json(b, fullname, control);
+    } else if (has_suffix(fname, ".gbin")) {
+	return gretl_gbin_write_file(b, GRETL_TYPE_BUNDLE, fullname);
     }
 
     if (has_suffix(fname, ".gz")) {
@@ -2504,6 +2507,8 @@ gretl_bundle *gretl_bundle_read_from_file (const char *fname,
 	b = read_json_bundle(fullname, err);
     } else if (has_suffix(fname, ".shp")) {
 	b = read_shapefile_bundle(fullname, err);
+    } else if (has_suffix(fname, ".gbin")) {
+	b = gretl_gbin_read_file(fullname, GRETL_TYPE_BUNDLE, err);
     } else {
 	*err = gretl_xml_open_doc_root(fullname, "gretl-bundle", &doc, &cur);
 	if (!*err) {
@@ -2529,6 +2534,10 @@ gretl_bundle *gretl_bundle_read_from_buffer (const char *buf,
     xmlDocPtr doc = NULL;
     gretl_bundle *b = NULL;
 
+    if (len > 0 && gretl_gbin_check_header(buf, len)) {
+	return gretl_gbin_unpack_as(buf, len, GRETL_TYPE_BUNDLE, err);
+    }
+
     xmlKeepBlanksDefault(0);
     doc = xmlParseMemory(buf, len);
 
@@ -2673,6 +2682,7 @@ gretl_bundle *get_sysinfo_bundle (int *err)
 #endif
 	    gretl_bundle_set_string(b, "hostname", g_get_host_name());
 	    gretl_bundle_set_string(b, "blas", blas_variant_string());
+	    gretl_bundle_set_string(b, "simd", gretl_simd_level_string());
 	    if (get_openblas_details(&s1, &s2)) {
 		gretl_bundle_set_string(b, "blascore", s1);
 		gretl_bundle_set_string(b, "blas_parallel", s2);
@@ -2681,6 +2691,16 @@ gretl_bundle *get_sysinfo_bundle (int *err)
 	sysinfo_bundle = b;
     }
 
+    if (sysinfo_bundle != NULL) {
+	/* matrix-pool statistics are not static */
+	double hits, misses, bytes;
+
+	gretl_matrix_pool_stats(&hits, &misses, &bytes);
+	gretl_bundle_set_scalar(sysinfo_bundle, "mpool_hits", hits);
+	gretl_bundle_set_scalar(sysinfo_bundle, "mpool_misses", misses);
+	gretl_bundle_set_scalar(sysinfo_bundle, "mpool_bytes", bytes);
+    }
+
     return sysinfo_bundle;
 }
 
@@ -33,40 +33,286 @@
 
 #define cscalar(m) (m->rows == 1 && m->cols == 1)
 
-/* helper function for fftw-based real FFT functions */
+/* Cache of FFTW plans, keyed by transform length and kind.
+   Creating a plan is expensive relative to executing it,
+   especially if the user has opted for FFTW_MEASURE (via "set
+   fft_measure on"), and scripts commonly perform many transforms
+   of the same length. In the FFTW_MEASURE case we also import
+   "wisdom" from the user's dot directory on first use and export
+   it on exit (see gretl_fft_cleanup()), so that planning is paid
+   for once per machine rather than once per process.
+
+   The FFT functions may be called from within an OpenMP parallel
+   region. Executing a plan is thread-safe, provided each call
+   uses its own arrays (via FFTW's "new-array execute" functions)
+   but creating and destroying plans is not, so all access to
+   the cache goes through the "fft_plans" critical section. A
+   plan is marked as in use while a transform is running on it,
+   and is not evicted from the cache until it is released; if
+   all the slots are busy the plan is made for one-off use.
+*/
+
+enum {
+    FFT_R2C = 1, /* real to complex (forward) */
+    FFT_C2R,     /* complex to real (inverse) */
+    FFT_C2C_F,   /* complex to complex, forward */
+    FFT_C2C_B    /* complex to complex, backward */
+};
+
+#define FFT_CACHE_SIZE 8
+
+/* length of the complex array for a real transform of length
+   @n: note, one extra slot in the case of odd @n */
+#define fft_complex_len(n) ((n)/2 + 1 + (n) % 2)
+#define FFT_WISDOM_FILE "fftw_wisdom.txt"
 
-static int fft_allocate (double **ffx, double complex **ffz,
-			 gretl_matrix **ret, int r, int c,
-			 int inverse, int newstyle)
+typedef struct fft_plan_ fft_plan;
+
+struct fft_plan_ {
+    int kind;           /* one of the enumerated values above */
+    int n;              /* length of transform */
+    fftw_plan p;        /* the plan proper */
+    int users;          /* number of transforms in progress */
+    int oneoff;         /* not in the cache, free on release? */
+    guint64 stamp;      /* time of last use */
+};
+
+static fft_plan fft_cache[FFT_CACHE_SIZE];
+static guint64 fft_clock;
+static int fft_measure;
+static int fft_wisdom_read;
+static int fft_wisdom_new;
+
+static void fft_plan_clear (fft_plan *fp)
 {
-    /* real workspace, per series */
-    *ffx = fftw_malloc(r * sizeof **ffx);
-    if (*ffx == NULL) {
-	return E_ALLOC;
+    if (fp->p != NULL) {
+	fftw_destroy_plan(fp->p);
     }
+    memset(fp, 0, sizeof *fp);
+}
 
-    /* complex workspace, per series */
-    *ffz = fftw_malloc((r/2 + 1 + r % 2) * sizeof **ffz);
-    if (*ffz == NULL) {
-	free(*ffx);
-	return E_ALLOC;
+static void fft_read_wisdom (void)
+{
+    gchar *fname;
+    FILE *fp;
+
+    fname = g_strdup_printf("%s%s", gretl_dotdir(), FFT_WISDOM_FILE);
+    fp = gretl_fopen(fname, "r");
+    if (fp != NULL) {
+	fftw_import_wisdom_from_file(fp);
+	fclose(fp);
     }
+    g_free(fname);
+    fft_wisdom_read = 1;
+}
 
-    /* matrix to hold output */
-    if (newstyle && !inverse) {
-	*ret = gretl_cmatrix_new(r, c);
+/* Create the plan proper for @fp, which has its kind and
+   length set. FFTW_MEASURE overwrites the arrays given to the
+   planner, so we use scratch arrays, of the alignment that
+   fftw_malloc() guarantees; the transforms themselves are run
+   on arrays of the same alignment supplied by the caller.
+*/
+
+static int fft_make_plan (fft_plan *fp)
+{
+    double *x = NULL;
+    double complex *z;
+    unsigned flags;
+    int n = fp->n;
+
+    if (fp->kind == FFT_R2C || fp->kind == FFT_C2R) {
+	x = fftw_malloc(n * sizeof *x);
+	z = fftw_malloc(fft_complex_len(n) * sizeof *z);
     } else {
-	*ret = gretl_matrix_alloc(r, c);
+	z = fftw_malloc(n * sizeof *z);
     }
-    if (*ret == NULL) {
-	free(*ffx);
-	free(*ffz);
+    if (z == NULL || (fp->kind <= FFT_C2R && x == NULL)) {
+	fftw_free(x);
+	fftw_free(z);
 	return E_ALLOC;
     }
 
+    if (fft_measure) {
+	if (!fft_wisdom_read) {
+	    fft_read_wisdom();
+	}
+	flags = FFTW_MEASURE;
+	fft_wisdom_new = 1;
+    } else {
+	flags = FFTW_ESTIMATE;
+    }
+
+    if (fp->kind == FFT_R2C) {
+	fp->p = fftw_plan_dft_r2c_1d(n, x, z, flags);
+    } else if (fp->kind == FFT_C2R) {
+	fp->p = fftw_plan_dft_c2r_1d(n, z, x, flags);
+    } else {
+	int sign = fp->kind == FFT_C2C_F ? FFTW_FORWARD : FFTW_BACKWARD;
+
+	fp->p = fftw_plan_dft_1d(n, z, z, sign, flags);
+    }
+
+    fftw_free(x);
+    fftw_free(z);
+
+    return fp->p == NULL ? E_DATA : 0;
+}
+
+/* Retrieve a plan for a transform of @kind and length @n from
+   the cache, or create one, if need be replacing the plan that
+   has been used least recently. Must be called within the
+   "fft_plans" critical section.
+*/
+
+static fft_plan *fft_plan_acquire (int kind, int n, int *err)
+{
+    fft_plan *fp = NULL;
+    int i;
+
+    for (i=0; i<FFT_CACHE_SIZE; i++) {
+	if (fft_cache[i].kind == kind && fft_cache[i].n == n) {
+	    fp = &fft_cache[i];
+	    fp->stamp = ++fft_clock;
+	    fp->users += 1;
+	    return fp;
+	}
+    }
+
+    /* not found: pick an empty or least recently used slot,
+       among those not in use */
+    for (i=0; i<FFT_CACHE_SIZE; i++) {
+	if (fft_cache[i].p == NULL) {
+	    fp = &fft_cache[i];
+	    break;
+	} else if (fft_cache[i].users == 0 &&
+		   (fp == NULL || fft_cache[i].stamp < fp->stamp)) {
+	    fp = &fft_cache[i];
+	}
+    }
+
+    if (fp != NULL) {
+	fft_plan_clear(fp);
+    } else {
+	fp = calloc(1, sizeof *fp);
+	if (fp == NULL) {
+	    *err = E_ALLOC;
+	    return NULL;
+	}
+	fp->oneoff = 1;
+    }
+
+    fp->kind = kind;
+    fp->n = n;
+    *err = fft_make_plan(fp);
+
+    if (*err) {
+	if (fp->oneoff) {
+	    free(fp);
+	} else {
+	    fft_plan_clear(fp);
+	}
+	return NULL;
+    }
+
+    fp->stamp = ++fft_clock;
+    fp->users = 1;
+
+    return fp;
+}
+
+static fft_plan *get_fft_plan (int kind, int n, int *err)
+{
+    fft_plan *fp;
+
+#if defined(_OPENMP)
+#pragma omp critical (fft_plans)
+#endif
+    {
+	fp = fft_plan_acquire(kind, n, err);
+    }
+
+    return fp;
+}
+
+/* signal that the caller of get_fft_plan() is done with @fp */
+
+static void release_fft_plan (fft_plan *fp)
+{
+#if defined(_OPENMP)
+#pragma omp critical (fft_plans)
+#endif
+    {
+	fp->users -= 1;
+	if (fp->oneoff) {
+	    fft_plan_clear(fp);
+	    free(fp);
+	}
+    }
+}
+
+/**
+ * gretl_fft_set_measure:
+ * @s: non-zero to have FFTW plans created using FFTW_MEASURE,
+ * zero to use FFTW_ESTIMATE (the default).
+ *
+ * Returns: 0.
+ */
+
+int gretl_fft_set_measure (int s)
+{
+    if ((s != 0) != fft_measure) {
+	/* plans made under the other regime are stale */
+	gretl_fft_cleanup(0);
+	fft_measure = (s != 0);
+    }
+
     return 0;
 }
 
+int gretl_fft_get_measure (void)
+{
+    return fft_measure;
+}
+
+/**
+ * gretl_fft_cleanup:
+ * @save_wisdom: if non-zero, and any plans were created using
+ * FFTW_MEASURE, write the accumulated FFTW wisdom to the user's
+ * dot directory.
+ *
+ * Frees all cached FFTW plans and their buffers.
+ */
+
+void gretl_fft_cleanup (int save_wisdom)
+{
+    int i;
+
+#if defined(_OPENMP)
+#pragma omp critical (fft_plans)
+#endif
+    {
+	for (i=0; i<FFT_CACHE_SIZE; i++) {
+	    if (fft_cache[i].users == 0) {
+		fft_plan_clear(&fft_cache[i]);
+	    }
+	}
+    }
+
+    if (save_wisdom && fft_wisdom_new) {
+	gchar *fname;
+	FILE *fp;
+
+	fname = g_strdup_printf("%s%s", gretl_dotdir(), FFT_WISDOM_FILE);
+	fp = gretl_fopen(fname, "w");
+	if (fp != NULL) {
+	    fftw_export_wisdom_to_file(fp);
+	    fclose(fp);
+	}
+	g_free(fname);
+	fft_wisdom_new = 0;
+    }
+}
+
 /* FFT for real input -> complex output and
    FFTI for Hermetian input -> real output.
    Both old and new-style complex formats
@@ -78,9 +324,9 @@ real_matrix_fft (const gretl_matrix *y, int inverse,
 		 int newstyle, int *err)
 {
     gretl_matrix *ret = NULL;
-    fftw_plan p = NULL;
-    double *ffx = NULL;
-    double complex *ffz = NULL;
+    fft_plan *fp;
+    double *ffx;
+    double complex *ffz;
     double xr, xi;
     int r, c, m, odd, cr, ci;
     int incols, outcols;
@@ -105,12 +351,28 @@ real_matrix_fft (const gretl_matrix *y, int inverse,
 	outcols = inverse ? incols / 2 : incols * 2;
     }
 
-    *err = fft_allocate(&ffx, &ffz, &ret, r, outcols,
-			inverse, newstyle);
+    fp = get_fft_plan(inverse ? FFT_C2R : FFT_R2C, r, err);
     if (*err) {
 	return NULL;
     }
 
+    /* matrix to hold output, and our own work arrays */
+    if (newstyle && !inverse) {
+	ret = gretl_cmatrix_new(r, outcols);
+    } else {
+	ret = gretl_matrix_alloc(r, outcols);
+    }
+    ffx = fftw_malloc(r * sizeof *ffx);
+    ffz = fftw_malloc(fft_complex_len(r) * sizeof *ffz);
+    if (ret == NULL || ffx == NULL || ffz == NULL) {
+	gretl_matrix_free(ret);
+	fftw_free(ffx);
+	fftw_free(ffz);
+	release_fft_plan(fp);
+	*err = E_ALLOC;
+	return NULL;
+    }
+
     c = MIN(incols, outcols);
     cr = 0;
     ci = 1;
@@ -134,17 +396,12 @@ real_matrix_fft (const gretl_matrix *y, int inverse,
 	    }
 	}
 
-	if (j == 0) {
-	    /* make the plan just once */
-	    if (inverse) {
-		p = fftw_plan_dft_c2r_1d(r, ffz, ffx, FFTW_ESTIMATE);
-	    } else {
-		p = fftw_plan_dft_r2c_1d(r, ffx, ffz, FFTW_ESTIMATE);
-	    }
-	}
-
 	/* run the transform */
-	fftw_execute(p);
+	if (inverse) {
+	    fftw_execute_dft_c2r(fp->p, ffz, ffx);
+	} else {
+	    fftw_execute_dft_r2c(fp->p, ffx, ffz);
+	}
 
 	/* transcribe the result */
 	if (inverse) {
@@ -172,9 +429,9 @@ real_matrix_fft (const gretl_matrix *y, int inverse,
 	ci += 2;
     }
 
-    fftw_destroy_plan(p);
-    fftw_free(ffz);
     fftw_free(ffx);
+    fftw_free(ffz);
+    release_fft_plan(fp);
 
     return ret;
 }
@@ -1195,9 +1452,8 @@ gretl_matrix *gretl_cmatrix_fft (const gretl_matrix *A,
 				 int inverse, int *err)
 {
     gretl_matrix *B = NULL;
-    double complex *tmp, *ptr;
-    fftw_plan p;
-    int sign;
+    double complex *tmp, *ptr, *ffz;
+    fft_plan *fp;
     int r, c, j;
 
     if (!cmatrix_validate(A, 0)) {
@@ -1214,18 +1470,35 @@ gretl_matrix *gretl_cmatrix_fft (const gretl_matrix *A,
     r = A->rows;
     c = A->cols;
 
+    fp = get_fft_plan(inverse ? FFT_C2C_B : FFT_C2C_F, r, err);
+    if (*err) {
+	gretl_matrix_free(B);
+	return NULL;
+    }
+
+    ffz = fftw_malloc(r * sizeof *ffz);
+    if (ffz == NULL) {
+	release_fft_plan(fp);
+	gretl_matrix_free(B);
+	*err = E_ALLOC;
+	return NULL;
+    }
+
     tmp = (double complex *) B->val;
-    sign = inverse ? FFTW_BACKWARD : FFTW_FORWARD;
 
     ptr = tmp;
     for (j=0; j<c; j++) {
-	p = fftw_plan_dft_1d(r, ptr, ptr, sign, FFTW_ESTIMATE);
-	fftw_execute(p);
-	fftw_destroy_plan(p);
+	/* transform in our own (aligned) buffer */
+	memcpy(ffz, ptr, r * sizeof *ptr);
+	fftw_execute_dft(fp->p, ffz, ffz);
+	memcpy(ptr, ffz, r * sizeof *ptr);
 	/* advance pointer to next column */
 	ptr += r;
     }
 
+    fftw_free(ffz);
+    release_fft_plan(fp);
+
     if (inverse) {
 	/* "FFTW computes an unnormalized transform: computing a
 	    forward followed by a backward transform (or vice versa)
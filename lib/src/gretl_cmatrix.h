@@ -28,6 +28,12 @@ gretl_matrix *gretl_matrix_fft (const gretl_matrix *y, int cmat, int *err);
 
 gretl_matrix *gretl_matrix_ffti (const gretl_matrix *y, int *err);
 
+int gretl_fft_set_measure (int s);
+
+int gretl_fft_get_measure (void);
+
+void gretl_fft_cleanup (int save_wisdom);
+
 gretl_matrix *gretl_cmatrix_multiply (const gretl_matrix *A,
 				      const gretl_matrix *B,
 				      int *err);
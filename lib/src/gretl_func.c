@@ -88,8 +88,10 @@ struct fn_line_ {
     int idx;        /* 1-based line index (allowing for blanks) */
     char *s;        /* text of command line */
     LOOPSET *loop;  /* attached "compiled" loop */
+    GENERATOR *genr; /* attached "compiled" genr */
     int next_idx;   /* line index to skip to after loop */
     int ignore;     /* flag for comment lines */
+    int nocomp;     /* flag for lines that can't be compiled */
 };
 
 #define UNSET_VALUE (-1.0e200)
@@ -141,6 +143,8 @@ struct ufunc_ {
     fn_param *params;      /* parameter info array */
     int rettype;           /* return type (if any) */
     int debug;             /* are we debugging this function? */
+    char *argtypes;        /* argument types on last call */
+    int params_checked;    /* code checked for modification of params? */
 };
 
 /* structure representing a function package */
@@ -212,7 +216,8 @@ struct fnpkg_ {
 enum {
     ARG_OPTIONAL = 1 << 0,
     ARG_CONST    = 1 << 1,
-    ARG_SHIFTED  = 1 << 2
+    ARG_SHIFTED  = 1 << 2,
+    ARG_MODIFIED = 1 << 3
 };
 
 /* structure representing an argument to a user-defined function */
@@ -724,7 +729,6 @@ static void set_executing_off (fncall *call, DATASET *dset, PRN *prn)
     fncall *popcall = NULL;
 
     destroy_option_params_at_level(fn_executing);
-    set_previous_depth(fn_executing);
     fn_executing--;
 
     callstack = g_list_remove(callstack, call);
@@ -758,7 +762,6 @@ static void set_executing_off (fncall *call, DATASET *dset, PRN *prn)
 
     if (popcall == NULL) {
 	/* returning to main */
-	switch_uservar_hash(0);
 	if (dset != NULL) {
 	    series_ensure_level_zero(dset);
 	}
@@ -1468,6 +1471,8 @@ static ufunc *ufunc_new (void)
     fun->rettype = GRETL_TYPE_NONE;
 
     fun->debug = 0;
+    fun->argtypes = NULL;
+    fun->params_checked = 0;
 
     return fun;
 }
@@ -1483,6 +1488,9 @@ static void free_lines_array (fn_line *lines, int n)
 	if (lines[i].loop != NULL) {
 	    gretl_loop_destroy(lines[i].loop);
 	}
+	if (lines[i].genr != NULL) {
+	    destroy_genr(lines[i].genr);
+	}
     }
 
     free(lines);
@@ -1506,13 +1514,16 @@ static void clear_ufunc_data (ufunc *fun)
 {
     free_lines_array(fun->lines, fun->n_lines);
     free_params_array(fun->params, fun->n_params);
+    free(fun->argtypes);
 
     fun->lines = NULL;
     fun->params = NULL;
+    fun->argtypes = NULL;
 
     fun->n_lines = 0;
     fun->line_idx = 1;
     fun->n_params = 0;
+    fun->params_checked = 0;
 
     fun->rettype = GRETL_TYPE_NONE;
 }
@@ -1521,6 +1532,7 @@ static void ufunc_free (ufunc *fun)
 {
     free_lines_array(fun->lines, fun->n_lines);
     free_params_array(fun->params, fun->n_params);
+    free(fun->argtypes);
     free(fun);
 }
 
@@ -1772,8 +1784,10 @@ static int push_function_line (ufunc *fun, char *s, int donate)
 	    }
 	    if (!err) {
 		lines[i].loop = NULL;
+		lines[i].genr = NULL;
 		lines[i].next_idx = -1;
 		lines[i].ignore = 0;
+		lines[i].nocomp = 0;
 		fun->n_lines = n;
 		fun->line_idx += 1;
 	    }
@@ -7272,6 +7286,249 @@ int gretl_function_append_line (ExecState *s)
 
 /* next block: handling function arguments */
 
+/* Non-pointer matrix, bundle and array arguments are copied
+   into a function, so that the function cannot modify the
+   caller's objects. But if the function never modifies the
+   parameter in question there's no need for a copy: the
+   argument can be handled as if the parameter were marked
+   "const", which is much cheaper for big objects. The
+   functions below determine, by a conservative scan of the
+   function code, which parameters might be modified; the
+   result is recorded via the ARG_MODIFIED flag. Should the
+   scan miss a modification, the check in object_is_const()
+   stops an assignment to a shared object, and the built-in
+   functions that modify their first argument in place consult
+   it too (see inplace_const_check() in geneval.c), so the
+   error is caught rather than reaching the caller's object.
+   Commands are not checked at run time, but only those known
+   to be read-only get past the scan.
+*/
+
+#define shareable_type(t) (t == GRETL_TYPE_MATRIX || \
+			   t == GRETL_TYPE_BUNDLE || \
+			   gretl_array_type(t))
+
+#define param_is_shareable(p) (shareable_type(p->type) && \
+			       !(p->flags & ARG_MODIFIED))
+
+#define ident_char(c) (isalnum((unsigned char) c) || c == '_')
+
+/* Is @s the start of a command that leaves all its arguments
+   unchanged? This includes a call to a function whose return
+   value is not assigned, since a user function can modify
+   an object only if it's given in pointer form. Built-in
+   functions that modify their first argument in place are
+   caught separately, by mutator_first_arg() below; nothing
+   else would catch them.
+*/
+
+static int read_only_command (const char *s)
+{
+    const char *ro[] = {
+	"if", "elif", "print", "printf", "return", NULL
+    };
+    int i, n = strcspn(s, " \t(");
+
+    if (s[n + strspn(s + n, " \t")] == '(') {
+	return 1;
+    }
+
+    for (i=0; ro[i] != NULL; i++) {
+	if (strlen(ro[i]) == n && !strncmp(s, ro[i], n)) {
+	    return 1;
+	}
+    }
+
+    return 0;
+}
+
+#define toggles_quote(s, p) (*p == '"' && (p == s || *(p-1) != '\\'))
+
+/* Given that the non-blank character preceding a name is at
+   @q - 1, is the name the first argument to a built-in function
+   that modifies that argument in place? See F_SETNOTE, F_BRENAME,
+   F_CNAMESET and F_RNAMESET in geneval.c.
+*/
+
+static int mutator_first_arg (const char *s, const char *q)
+{
+    const char *mut[] = {
+	"setnote", "brename", "cnameset", "rnameset",
+	"colnames", "rownames", NULL
+    };
+    const char *p;
+    int i, n;
+
+    if (q == s || *(q-1) != '(') {
+	return 0;
+    }
+
+    q--;
+    while (q > s && isspace((unsigned char) *(q-1))) {
+	q--;
+    }
+    for (p=q; p > s && ident_char(*(p-1)); p--) ;
+    n = q - p;
+
+    if (n > 0 && (p == s || strchr(".$", *(p-1)) == NULL)) {
+	for (i=0; mut[i] != NULL; i++) {
+	    if (strlen(mut[i]) == n && !strncmp(p, mut[i], n)) {
+		return 1;
+	    }
+	}
+    }
+
+    return 0;
+}
+
+/* Is the '=' at @s, following on from @s0, part of an
+   option such as --matrix=X?
+*/
+
+static int option_equals (const char *s0, const char *s)
+{
+    while (s > s0 && (ident_char(*(s-1)) || *(s-1) == '-')) {
+	s--;
+	if (s - s0 >= 2 && !strncmp(s - 2, "--", 2)) {
+	    return 1;
+	}
+    }
+
+    return 0;
+}
+
+/* Returns 1 if line @s of a function's code might modify
+   the object named @name, otherwise 0. We look for @name
+   as an identifier (outside of string literals and any
+   trailing comment) and judge it to be safe only if it
+   is not preceded by '&' or an option flag, is not the
+   first argument to a built-in function that modifies
+   that argument, and either follows the assignment
+   operator in an assignment, or occurs in a command that
+   doesn't modify its arguments.
+*/
+
+static int line_may_modify (const char *s, const char *name)
+{
+    const char *s0, *p, *apos = NULL;
+    int n = strlen(name);
+    int quoted = 0;
+    int ro;
+
+    s += strspn(s, " \t");
+    if (!strncmp(s, "catch ", 6)) {
+	s += 6;
+	s += strspn(s, " \t");
+    }
+    s0 = s;
+    ro = read_only_command(s);
+
+    /* locate the assignment operator, if any */
+    for (p=s; *p && !(*p == '#' && !quoted); p++) {
+	if (toggles_quote(s, p)) {
+	    quoted = !quoted;
+	} else if (quoted) {
+	    continue;
+	} else if (*p == ';') {
+	    /* more than one statement? don't take chances */
+	    ro = 0;
+	    apos = NULL;
+	    break;
+	} else if (apos == NULL && *p == '=' && *(p+1) != '=' &&
+		   (p == s || strchr("=<>!", *(p-1)) == NULL) &&
+		   !option_equals(s0, p)) {
+	    apos = p;
+	}
+    }
+
+    quoted = 0;
+    for (p=s; *p && !(*p == '#' && !quoted); p++) {
+	if (toggles_quote(s, p)) {
+	    quoted = !quoted;
+	} else if (!quoted && !strncmp(p, name, n) && !ident_char(p[n]) &&
+		   (p == s || (!ident_char(*(p-1)) && strchr(".$", *(p-1)) == NULL))) {
+	    const char *q = p;
+
+	    while (q > s && isspace((unsigned char) *(q-1))) {
+		q--;
+	    }
+	    if (q > s && *(q-1) == '&' && (q-1 == s || *(q-2) != '&')) {
+		/* address operator, not logical AND */
+		return 1;
+	    } else if (q > s && *(q-1) == '=' && option_equals(s0, q-1)) {
+		return 1;
+	    } else if (mutator_first_arg(s, q)) {
+		return 1;
+	    } else if (!ro && (apos == NULL || p < apos)) {
+		return 1;
+	    }
+	    p += n - 1;
+	}
+    }
+
+    return 0;
+}
+
+/* Set the ARG_MODIFIED flag on those parameters of @fun
+   that might be modified by its code.
+*/
+
+static void check_params_modified (ufunc *fun)
+{
+    int subst = 0;
+    int i, j;
+
+    for (j=0; j<fun->n_lines && !subst; j++) {
+	if (strchr(fun->lines[j].s, '@') != NULL) {
+	    /* string substitution: anything could happen */
+	    subst = 1;
+	}
+    }
+
+    for (i=0; i<fun->n_params; i++) {
+	fn_param *fp = &fun->params[i];
+
+	fp->flags &= ~ARG_MODIFIED;
+	if (!shareable_type(fp->type) || (fp->flags & ARG_CONST)) {
+	    continue;
+	}
+	if (subst) {
+	    fp->flags |= ARG_MODIFIED;
+	    continue;
+	}
+	for (j=0; j<fun->n_lines; j++) {
+	    if (!fun->lines[j].ignore &&
+		line_may_modify(fun->lines[j].s, fp->name)) {
+		fp->flags |= ARG_MODIFIED;
+		break;
+	    }
+	}
+    }
+
+    fun->params_checked = 1;
+}
+
+/* Does @call include a pointer argument via which the
+   function might modify an object that is also supplied
+   as a plain argument? If so, no argument can be shared.
+*/
+
+static int has_object_pointer_arg (fncall *call)
+{
+    ufunc *fun = call->fun;
+    int i, t;
+
+    for (i=0; i<call->argc; i++) {
+	t = fun->params[i].type;
+	if (gretl_ref_type(t) && t != GRETL_TYPE_SCALAR_REF &&
+	    t != GRETL_TYPE_SERIES_REF) {
+	    return 1;
+	}
+    }
+
+    return 0;
+}
+
 static int maybe_set_arg_const (fn_arg *arg, fn_param *fp)
 {
     if (fp->flags & ARG_CONST) {
@@ -7490,6 +7747,7 @@ static int localize_series_ref (fncall *call, fn_arg *arg,
 
     series_increment_stack_level(dset, v);
     strcpy(dset->varname[v], fp->name);
+    series_index_invalidate();
 
     if (!in_gretl_list(call->ptrvars, v)) {
 	gretl_list_append_term(&call->ptrvars, v);
@@ -7646,10 +7904,16 @@ static int allocate_function_args (fncall *call, DATASET *dset)
     ufunc *fun = call->fun;
     fn_arg *arg;
     fn_param *fp;
+    int share_ok;
     int i, err;
 
     err = duplicated_pointer_arg_check(call->args, call->argc);
 
+    if (!fun->params_checked) {
+	check_params_modified(fun);
+    }
+    share_ok = !has_object_pointer_arg(call);
+
     for (i=0; i<call->argc && !err; i++) {
 	arg = &call->args[i];
 	fp = &fun->params[i];
@@ -7690,7 +7954,8 @@ static int allocate_function_args (fncall *call, DATASET *dset)
 		   fp->type == GRETL_TYPE_BUNDLE ||
 		   fp->type == GRETL_TYPE_STRING ||
 		   gretl_array_type(fp->type)) {
-	    if (fp->flags & ARG_CONST) {
+	    if ((fp->flags & ARG_CONST) ||
+		(share_ok && param_is_shareable(fp))) {
 		err = localize_const_object(call, i, fp);
 	    } else {
 		err = copy_as_arg(fp->name, fp->type,
@@ -8169,7 +8434,7 @@ static int is_pointer_arg (fncall *call, int rtype)
 	for (i=0; i<call->argc; i++) {
 	    fp = &u->params[i];
 	    if ((fp->type == gretl_type_get_ref_type(rtype) ||
-		 (fp->flags & ARG_CONST)) &&
+		 (call->args[i].flags & ARG_CONST)) &&
 		strcmp(fp->name, call->retname) == 0) {
 		return 1;
 	    }
@@ -8262,6 +8527,7 @@ function_assign_returns (fncall *call, int rtype,
 
 		series_decrement_stack_level(dset, v);
 		strcpy(dset->varname[v], arg->upname);
+		series_index_invalidate();
 	    } else if (arg->upname != NULL) {
 		user_var_adjust_level(arg->uvar, -1);
 		user_var_set_name(arg->uvar, arg->upname);
@@ -8478,6 +8744,108 @@ static void reset_saved_loops (ufunc *u)
     }
 }
 
+/* Compiled genrs attached to the lines of a function's body are
+   retained across calls, with the same treatment as saved loops:
+   variable addresses are reset on exit. In addition the compiled
+   forms embody assumptions about the types of the arguments, so
+   we discard them if these types change from one call to the next.
+*/
+
+static void reset_saved_genrs (ufunc *u)
+{
+    int i;
+
+    for (i=0; i<u->n_lines; i++) {
+	if (u->lines[i].genr != NULL) {
+	    genr_reset_uvars(u->lines[i].genr);
+	}
+    }
+}
+
+static void check_saved_genrs (fncall *call)
+{
+    ufunc *u = call->fun;
+    int i, changed = 0;
+
+    if (u->n_params == 0) {
+	return;
+    }
+
+    if (u->argtypes == NULL) {
+	u->argtypes = calloc(u->n_params, 1);
+	if (u->argtypes == NULL) {
+	    return;
+	}
+    }
+
+    for (i=0; i<u->n_params; i++) {
+	char t = (i < call->argc)? call->args[i].type : 0;
+
+	if (t != u->argtypes[i]) {
+	    u->argtypes[i] = t;
+	    changed = 1;
+	}
+    }
+
+    if (changed) {
+	for (i=0; i<u->n_lines; i++) {
+	    if (u->lines[i].genr != NULL) {
+		destroy_genr(u->lines[i].genr);
+		u->lines[i].genr = NULL;
+	    }
+	}
+    }
+}
+
+/* Run the compiled version of a "genr" line. The return value
+   is 1 if the line was handled (successfully or not), or 0 if
+   the compiled form turned out to be out of date, in which case
+   it's discarded and the line should be executed afresh.
+*/
+
+static int exec_saved_genr (ExecState *s, fn_line *line,
+			    DATASET *dset, int *err)
+{
+    int oldv = dset != NULL ? dset->v : 0;
+
+    if (gretl_if_state_false()) {
+	s->cmd->ci = CMD_MASKED;
+	return 1;
+    }
+
+    if (!genr_command_cacheable(line->genr) ||
+	genr_is_stale(line->genr, dset)) {
+	/* messages have been turned on since compilation, or
+	   a referenced object has been deleted or has changed
+	   type: fall back to the source line
+	*/
+	destroy_genr(line->genr);
+	line->genr = NULL;
+	return 0;
+    }
+
+    s->cmd->ci = GENR;
+    s->cmd->flags &= ~CMD_CATCH;
+    s->pmod = NULL;
+
+    *err = execute_genr(line->genr, dset, s->prn);
+
+    if (*err) {
+	destroy_genr(line->genr);
+	line->genr = NULL;
+	*err = process_command_error(s, *err);
+    } else {
+	/* s->line holds a copy of the source: put it into the
+	   form seen by the compiler, for labelling purposes */
+	filter_command_line(s->line, s->cmd);
+	genr_finish_command(line->genr, s->line, oldv, OPT_NONE,
+			    s->prn);
+	warnmsg(s->prn);
+    }
+
+    return 1;
+}
+
 static void set_pkgdir (fnpkg *pkg)
 {
     const char *p = strrslash(pkg->fname);
@@ -8504,7 +8872,6 @@ static int start_fncall (fncall *call, DATASET *dset, PRN *prn)
 	tmp = tmp->next;
     }
 
-    set_previous_depth(fn_executing);
     fn_executing++;
 
 #if MINIMAL_SETVARS
@@ -8524,8 +8891,6 @@ static int start_fncall (fncall *call, DATASET *dset, PRN *prn)
 	    call->fun->name, g_list_length(callstack));
 #endif
 
-    switch_uservar_hash(fn_executing);
-
     record_obs_info(&call->obs, dset);
 
     if (gretl_debugging_on() || call->fun->debug) {
@@ -9230,6 +9595,10 @@ int gretl_function_exec (fncall *call, int rtype, DATASET *dset,
 	}
     }
 
+    if (!err && !is_recursing(call)) {
+	check_saved_genrs(call);
+    }
+
 #if EXEC_DEBUG
     fprintf(stderr, "start_fncall: err = %d\n", err);
 #endif
@@ -9279,8 +9648,26 @@ int gretl_function_exec (fncall *call, int rtype, DATASET *dset,
 	    /* skip to the matching 'endloop' */
 	    i = u->lines[i].next_idx;
 	    continue;
+	} else if (u->lines[i].genr != NULL && !is_recursing(call) &&
+		   !debugging && exec_saved_genr(&state, &u->lines[i],
+						 dset, &err)) {
+	    ; /* compiled genr, handled */
 	} else {
+	    int compile = !u->lines[i].nocomp && !is_recursing(call) &&
+		!debugging && !gretl_compiling_loop();
+
+	    if (compile) {
+		state.pgenr = &u->lines[i].genr;
+	    }
 	    err = maybe_exec_line(&state, dset, &loopstart);
+	    if (compile) {
+		if (!err && u->lines[i].genr == NULL &&
+		    state.cmd->ci != CMD_MASKED) {
+		    /* don't try again */
+		    u->lines[i].nocomp = 1;
+		}
+		state.pgenr = NULL;
+	    }
 	    if (loopstart) {
 		u->line_idx = i;
 		loopstart = 0;
@@ -9383,6 +9770,10 @@ int gretl_function_exec (fncall *call, int rtype, DATASET *dset,
 	reset_saved_loops(call->fun);
     }
 
+    if (!is_recursing(call)) {
+	reset_saved_genrs(call->fun);
+    }
+
     gretl_exec_state_clear(&state);
 
     if (started) {
@@ -0,0 +1,1166 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Compact binary serialization ("gbin") of gretl objects: matrices,
+   bundles, arrays and the things they may contain.
+
+   The layout is a 16-byte header -- the magic string "gretlbin",
+   then a 32-bit version number and a reserved word -- followed by a
+   single type-tagged object. All numbers are little-endian. Each
+   object starts with a 32-bit tag (one of the GB_* values below);
+   bundles and arrays are written recursively as a count followed by
+   their members, and the doubles in matrices and series are written
+   raw, aligned on an 8-byte boundary relative to the start of the
+   buffer.
+
+   Strings are written as a 32-bit byte count followed by the bytes,
+   without a terminating nul. Kalman bundles, which have private
+   content, are written as their XML serialization.
+*/
+
+#include "libgretl.h"
+#include "gretl_array.h"
+#include "gretl_bundle.h"
+#include "gretl_typemap.h"
+#include "swap_bytes.h"
+#include "gretl_gbin.h"
+
+#define GBIN_MAGIC "gretlbin"
+#define GBIN_VERSION 1
+#define GBIN_HDRLEN 16
+
+/* limit on the nesting of bundles and arrays, on reading */
+#define GBIN_MAXDEPTH 256
+
+enum {
+    GB_NULL,      /* empty array slot */
+    GB_SCALAR,
+    GB_INT,
+    GB_UNSIGNED,
+    GB_STRING,
+    GB_MATRIX,
+    GB_SERIES,
+    GB_LIST,
+    GB_BUNDLE,
+    GB_ARRAY,
+    GB_XBUNDLE    /* bundle in XML form */
+};
+
+/* flags for matrices */
+#define GB_COMPLEX  (1 << 0)
+#define GB_COLNAMES (1 << 1)
+#define GB_ROWNAMES (1 << 2)
+#define GB_DATED    (1 << 3)
+
+typedef struct gbin_writer_ gbin_writer;
+typedef struct gbin_reader_ gbin_reader;
+
+/* Output goes either to @fp or to @buf; if both are NULL we
+   just count the bytes that would be written, so that a buffer
+   of the right size can be allocated in advance. In that case
+   the XML text of any bundles written in that form is kept in
+   @xml, for use when writing to @buf.
+*/
+
+struct gbin_writer_ {
+    FILE *fp;
+    char *buf;
+    size_t pos;
+    char **xml;
+    int nxml;
+    int ixml;
+    int err;
+};
+
+struct gbin_reader_ {
+    const char *buf;
+    size_t len;
+    size_t pos;
+    int depth;
+};
+
+static int gb_write_object (gbin_writer *w, void *ptr,
+			    GretlType type, int size);
+
+static void *gb_read_object (gbin_reader *r, GretlType *type,
+			     int *size, int *err);
+
+static int gb_tag_from_type (GretlType type)
+{
+    switch (type) {
+    case GRETL_TYPE_DOUBLE:   return GB_SCALAR;
+    case GRETL_TYPE_INT:      return GB_INT;
+    case GRETL_TYPE_UNSIGNED: return GB_UNSIGNED;
+    case GRETL_TYPE_STRING:   return GB_STRING;
+    case GRETL_TYPE_MATRIX:   return GB_MATRIX;
+    case GRETL_TYPE_SERIES:   return GB_SERIES;
+    case GRETL_TYPE_LIST:     return GB_LIST;
+    case GRETL_TYPE_BUNDLE:   return GB_BUNDLE;
+    case GRETL_TYPE_ARRAY:    return GB_ARRAY;
+    default: return -1;
+    }
+}
+
+/* the types that can be written at top level: series can
+   appear only as members of bundles */
+
+int gretl_gbin_type_ok (GretlType type)
+{
+    return type != GRETL_TYPE_SERIES && gb_tag_from_type(type) > 0;
+}
+
+/* writing */
+
+static void gb_write (gbin_writer *w, const void *src, size_t n)
+{
+    if (w->err || n == 0) {
+	return;
+    } else if (w->fp != NULL) {
+	if (fwrite(src, 1, n, w->fp) != n) {
+	    w->err = E_DATA;
+	    return;
+	}
+    } else if (w->buf != NULL) {
+	memcpy(w->buf + w->pos, src, n);
+    }
+
+    w->pos += n;
+}
+
+static void gb_write_u32 (gbin_writer *w, guint32 u)
+{
+    u = GUINT32_TO_LE(u);
+    gb_write(w, &u, sizeof u);
+}
+
+static void gb_write_i32 (gbin_writer *w, int i)
+{
+    gb_write_u32(w, (guint32) i);
+}
+
+static void gb_write_string (gbin_writer *w, const char *s)
+{
+    guint32 len = (s == NULL)? 0 : strlen(s);
+
+    gb_write_u32(w, len);
+    gb_write(w, s, len);
+}
+
+/* pad with zeros to an 8-byte boundary */
+
+static void gb_write_pad (gbin_writer *w)
+{
+    static const char zeros[8];
+    size_t rem = w->pos % 8;
+
+    if (rem > 0) {
+	gb_write(w, zeros, 8 - rem);
+    }
+}
+
+static void gb_write_doubles (gbin_writer *w, const double *x,
+			      size_t n)
+{
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+    double tmp[512];
+    size_t i, k;
+
+    while (n > 0 && !w->err) {
+	k = n < 512 ? n : 512;
+	for (i=0; i<k; i++) {
+	    tmp[i] = x[i];
+	    reverse_double(tmp[i]);
+	}
+	gb_write(w, tmp, k * sizeof *tmp);
+	x += k;
+	n -= k;
+    }
+#else
+    gb_write(w, x, n * sizeof *x);
+#endif
+}
+
+static void gb_write_names (gbin_writer *w, const char **S, int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+	gb_write_string(w, S[i]);
+    }
+}
+
+static void gb_write_matrix (gbin_writer *w, const gretl_matrix *m)
+{
+    const char **cnames = gretl_matrix_get_colnames(m);
+    const char **rnames = gretl_matrix_get_rownames(m);
+    guint32 flags = 0;
+    size_t n;
+
+    if (m->is_complex) {
+	flags |= GB_COMPLEX;
+    }
+    if (cnames != NULL) {
+	flags |= GB_COLNAMES;
+    }
+    if (rnames != NULL) {
+	flags |= GB_ROWNAMES;
+    }
+    if (gretl_matrix_is_dated(m)) {
+	flags |= GB_DATED;
+    }
+
+    gb_write_i32(w, m->rows);
+    gb_write_i32(w, m->cols);
+    gb_write_u32(w, flags);
+
+    if (flags & GB_DATED) {
+	gb_write_i32(w, gretl_matrix_get_t1(m));
+	gb_write_i32(w, gretl_matrix_get_t2(m));
+    }
+    if (cnames != NULL) {
+	gb_write_names(w, cnames, m->cols);
+    }
+    if (rnames != NULL) {
+	gb_write_names(w, rnames, m->rows);
+    }
+
+    n = (size_t) m->rows * m->cols;
+    if (m->is_complex) {
+	/* real and imaginary parts */
+	n *= 2;
+    }
+
+    if (n > 0) {
+	gb_write_pad(w);
+	gb_write_doubles(w, m->val, n);
+    }
+}
+
+static void gb_write_list (gbin_writer *w, const int *list)
+{
+    int i;
+
+    for (i=0; i<=list[0]; i++) {
+	gb_write_i32(w, list[i]);
+    }
+}
+
+static void gb_write_bundle (gbin_writer *w, gretl_bundle *b)
+{
+    GHashTable *ht = gretl_bundle_get_content(b);
+    guint32 nkeys = (ht == NULL)? 0 : g_hash_table_size(ht);
+
+    gb_write_string(w, gretl_bundle_get_creator(b));
+    gb_write_u32(w, nkeys);
+
+    if (nkeys > 0) {
+	GHashTableIter iter;
+	gpointer key, value;
+	GretlType type;
+	void *data;
+	int size;
+
+	g_hash_table_iter_init(&iter, ht);
+	while (g_hash_table_iter_next(&iter, &key, &value) && !w->err) {
+	    data = bundled_item_get_data(value, &type, &size);
+	    if (gb_tag_from_type(type) < 0) {
+		gretl_errmsg_sprintf("bundle -> gbin: can't handle type %s",
+				     gretl_type_get_name(type));
+		w->err = E_TYPES;
+	    } else {
+		gb_write_string(w, key);
+		gb_write_string(w, bundled_item_get_note(value));
+		gb_write_object(w, data, type, size);
+	    }
+	}
+    }
+}
+
+/* write a Kalman bundle, or any other bundle with private
+   content, as XML text */
+
+static void gb_write_xml_bundle (gbin_writer *w, gretl_bundle *b)
+{
+    char *buf;
+    int bytes = 0;
+
+    if (w->buf != NULL && w->ixml < w->nxml) {
+	/* use the text produced when counting */
+	gb_write_string(w, w->xml[w->ixml++]);
+	return;
+    }
+
+    buf = gretl_bundle_write_to_buffer(b, 0, &bytes, &w->err);
+    if (buf == NULL) {
+	return;
+    }
+
+    gb_write_string(w, buf);
+
+    if (w->fp == NULL && w->buf == NULL) {
+	/* counting: keep @buf for the actual write */
+	if (strings_array_donate(&w->xml, &w->nxml, buf)) {
+	    free(buf);
+	    w->err = E_ALLOC;
+	}
+    } else {
+	free(buf);
+    }
+}
+
+static void gb_write_array (gbin_writer *w, gretl_array *A)
+{
+    GretlType type = gretl_array_get_content_type(A);
+    int i, n = gretl_array_get_length(A);
+    int tag = gb_tag_from_type(type);
+    void *ptr;
+
+    if (tag < 0) {
+	w->err = E_TYPES;
+	return;
+    }
+
+    gb_write_u32(w, tag);
+    gb_write_i32(w, n);
+
+    for (i=0; i<n && !w->err; i++) {
+	ptr = gretl_array_get_data(A, i);
+	if (ptr == NULL) {
+	    gb_write_u32(w, GB_NULL);
+	} else {
+	    gb_write_object(w, ptr, type, 0);
+	}
+    }
+}
+
+/* Write the object @ptr of type @type, preceded by its tag;
+   @size is needed only for series.
+*/
+
+static int gb_write_object (gbin_writer *w, void *ptr,
+			    GretlType type, int size)
+{
+    int tag = gb_tag_from_type(type);
+
+    if (tag == GB_BUNDLE &&
+	gretl_bundle_get_type(ptr) != BUNDLE_PLAIN) {
+	tag = GB_XBUNDLE;
+    }
+
+    gb_write_u32(w, tag);
+
+    switch (tag) {
+    case GB_SCALAR:
+	gb_write_doubles(w, ptr, 1);
+	break;
+    case GB_INT:
+	gb_write_i32(w, *(int *) ptr);
+	break;
+    case GB_UNSIGNED:
+	gb_write_u32(w, *(unsigned int *) ptr);
+	break;
+    case GB_STRING:
+	gb_write_string(w, ptr);
+	break;
+    case GB_MATRIX:
+	gb_write_matrix(w, ptr);
+	break;
+    case GB_SERIES:
+	gb_write_i32(w, size);
+	gb_write_pad(w);
+	gb_write_doubles(w, ptr, size);
+	break;
+    case GB_LIST:
+	gb_write_list(w, ptr);
+	break;
+    case GB_BUNDLE:
+	gb_write_bundle(w, ptr);
+	break;
+    case GB_XBUNDLE:
+	gb_write_xml_bundle(w, ptr);
+	break;
+    case GB_ARRAY:
+	gb_write_array(w, ptr);
+	break;
+    default:
+	w->err = E_TYPES;
+	break;
+    }
+
+    return w->err;
+}
+
+static void gb_write_header (gbin_writer *w)
+{
+    gb_write(w, GBIN_MAGIC, 8);
+    gb_write_u32(w, GBIN_VERSION);
+    gb_write_u32(w, 0);
+}
+
+/**
+ * gretl_gbin_write_file:
+ * @ptr: pointer to object.
+ * @type: type of @ptr.
+ * @fname: full path to output file.
+ *
+ * Writes the object @ptr to @fname in gretl's binary format.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int gretl_gbin_write_file (void *ptr, GretlType type,
+			   const char *fname)
+{
+    gbin_writer w = {0};
+
+    if (!gretl_gbin_type_ok(type)) {
+	return E_TYPES;
+    }
+
+    w.fp = gretl_fopen(fname, "wb");
+    if (w.fp == NULL) {
+	return E_FOPEN;
+    }
+
+    gb_write_header(&w);
+    gb_write_object(&w, ptr, type, 0);
+
+    if (fclose(w.fp) != 0 && !w.err) {
+	w.err = E_DATA;
+    }
+
+    return w.err;
+}
+
+/**
+ * gretl_gbin_pack:
+ * @ptr: pointer to object.
+ * @type: type of @ptr.
+ * @size: location to receive the size of the buffer, in bytes.
+ * @err: location to receive error code.
+ *
+ * Serializes the object @ptr into a newly allocated buffer,
+ * in the format written by gretl_gbin_write_file().
+ *
+ * Returns: the buffer, or NULL on failure.
+ */
+
+char *gretl_gbin_pack (void *ptr, GretlType type,
+		       size_t *size, int *err)
+{
+    gbin_writer w = {0};
+
+    if (!gretl_gbin_type_ok(type)) {
+	*err = E_TYPES;
+	return NULL;
+    }
+
+    /* first pass: count the bytes */
+    gb_write_header(&w);
+    gb_write_object(&w, ptr, type, 0);
+
+    if (!w.err) {
+	w.buf = malloc(w.pos);
+	if (w.buf == NULL) {
+	    w.err = E_ALLOC;
+	}
+    }
+
+    if (!w.err) {
+	*size = w.pos;
+	w.pos = 0;
+	gb_write_header(&w);
+	gb_write_object(&w, ptr, type, 0);
+    }
+
+    strings_array_free(w.xml, w.nxml);
+
+    if (w.err) {
+	*err = w.err;
+	free(w.buf);
+	w.buf = NULL;
+    }
+
+    return w.buf;
+}
+
+/* reading */
+
+static void gb_free_object (void *ptr, GretlType type)
+{
+    if (type == GRETL_TYPE_MATRIX) {
+	gretl_matrix_free(ptr);
+    } else if (type == GRETL_TYPE_BUNDLE) {
+	gretl_bundle_destroy(ptr);
+    } else if (type == GRETL_TYPE_ARRAY) {
+	gretl_array_destroy(ptr);
+    } else {
+	free(ptr);
+    }
+}
+
+static int gb_read (gbin_reader *r, void *dest, size_t n)
+{
+    if (n > r->len - r->pos) {
+	return E_DATA;
+    }
+    memcpy(dest, r->buf + r->pos, n);
+    r->pos += n;
+
+    return 0;
+}
+
+static guint32 gb_read_u32 (gbin_reader *r, int *err)
+{
+    guint32 u = 0;
+
+    if (!*err) {
+	*err = gb_read(r, &u, sizeof u);
+    }
+
+    return GUINT32_FROM_LE(u);
+}
+
+static int gb_read_i32 (gbin_reader *r, int *err)
+{
+    return (int) gb_read_u32(r, err);
+}
+
+/* read a count, which must be non-negative and must not imply
+   more content than remains in the buffer, given a minimum of
+   @unit bytes per element */
+
+static int gb_read_count (gbin_reader *r, size_t unit, int *err)
+{
+    int n = gb_read_i32(r, err);
+
+    if (!*err && (n < 0 || (size_t) n > (r->len - r->pos) / unit)) {
+	*err = E_DATA;
+    }
+
+    return *err ? 0 : n;
+}
+
+static char *gb_read_string (gbin_reader *r, int *err)
+{
+    guint32 len = gb_read_u32(r, err);
+    char *s = NULL;
+
+    if (*err) {
+	return NULL;
+    } else if (len > r->len - r->pos) {
+	*err = E_DATA;
+	return NULL;
+    }
+
+    s = malloc(len + 1);
+    if (s == NULL) {
+	*err = E_ALLOC;
+    } else {
+	memcpy(s, r->buf + r->pos, len);
+	s[len] = '\0';
+	r->pos += len;
+    }
+
+    return s;
+}
+
+static void gb_skip_pad (gbin_reader *r, int *err)
+{
+    size_t rem = r->pos % 8;
+
+    if (!*err && rem > 0) {
+	if (8 - rem > r->len - r->pos) {
+	    *err = E_DATA;
+	} else {
+	    r->pos += 8 - rem;
+	}
+    }
+}
+
+static int gb_read_doubles (gbin_reader *r, double *x, size_t n)
+{
+    int err;
+
+    if (n > (r->len - r->pos) / sizeof *x) {
+	return E_DATA;
+    }
+
+    err = gb_read(r, x, n * sizeof *x);
+
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+    if (!err) {
+	size_t i;
+
+	for (i=0; i<n; i++) {
+	    reverse_double(x[i]);
+	}
+    }
+#endif
+
+    return err;
+}
+
+static char **gb_read_names (gbin_reader *r, int n, int *err)
+{
+    char **S = strings_array_new(n);
+    int i;
+
+    if (S == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    for (i=0; i<n && !*err; i++) {
+	S[i] = gb_read_string(r, err);
+    }
+
+    if (*err) {
+	strings_array_free(S, n);
+	S = NULL;
+    }
+
+    return S;
+}
+
+static gretl_matrix *gb_read_matrix (gbin_reader *r, int *err)
+{
+    gretl_matrix *m = NULL;
+    char **cnames = NULL;
+    char **rnames = NULL;
+    int rows, cols, t1 = 0, t2 = 0;
+    guint32 flags;
+    size_t n, avail;
+
+    rows = gb_read_i32(r, err);
+    cols = gb_read_i32(r, err);
+    flags = gb_read_u32(r, err);
+    if (flags & GB_DATED) {
+	t1 = gb_read_i32(r, err);
+	t2 = gb_read_i32(r, err);
+    }
+
+    if (*err) {
+	return NULL;
+    } else if (rows < 0 || cols < 0) {
+	*err = E_DATA;
+	return NULL;
+    }
+
+    n = (size_t) rows * cols;
+    if (flags & GB_COMPLEX) {
+	n *= 2;
+    }
+
+    /* check that the input can hold the names (at least the 4
+       bytes of its length for each) and the data before we
+       allocate anything */
+    avail = r->len - r->pos;
+    if (flags & GB_COLNAMES) {
+	if ((size_t) cols > avail / 4) {
+	    *err = E_DATA;
+	} else {
+	    avail -= (size_t) cols * 4;
+	}
+    }
+    if ((flags & GB_ROWNAMES) && !*err) {
+	if ((size_t) rows > avail / 4) {
+	    *err = E_DATA;
+	} else {
+	    avail -= (size_t) rows * 4;
+	}
+    }
+    if (!*err && n > 0 && n > avail / sizeof(double)) {
+	*err = E_DATA;
+    }
+
+    if (*err) {
+	/* the file can't hold all that */
+	return NULL;
+    }
+
+    if (n == 0) {
+	m = gretl_matrix_alloc(rows, cols);
+    } else if (flags & GB_COMPLEX) {
+	m = gretl_matrix_alloc(2 * rows, cols);
+    } else {
+	m = gretl_matrix_alloc(rows, cols);
+    }
+
+    if (m == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    if (flags & GB_COLNAMES) {
+	cnames = gb_read_names(r, cols, err);
+    }
+    if ((flags & GB_ROWNAMES) && !*err) {
+	rnames = gb_read_names(r, rows, err);
+    }
+
+    if (n > 0 && !*err) {
+	gb_skip_pad(r, err);
+	if (!*err) {
+	    *err = gb_read_doubles(r, m->val, n);
+	}
+    }
+
+    if (!*err && n > 0 && (flags & GB_COMPLEX)) {
+	gretl_matrix_set_complex_full(m, 1);
+    }
+    if (!*err && cnames != NULL) {
+	*err = gretl_matrix_set_colnames(m, cnames);
+	if (!*err) {
+	    cnames = NULL;
+	}
+    }
+    if (!*err && rnames != NULL) {
+	*err = gretl_matrix_set_rownames(m, rnames);
+	if (!*err) {
+	    rnames = NULL;
+	}
+    }
+    if (!*err && (flags & GB_DATED)) {
+	gretl_matrix_set_t1(m, t1);
+	gretl_matrix_set_t2(m, t2);
+    }
+
+    if (*err) {
+	strings_array_free(cnames, cols);
+	strings_array_free(rnames, rows);
+	gretl_matrix_free(m);
+	m = NULL;
+    }
+
+    return m;
+}
+
+static double *gb_read_series (gbin_reader *r, int *size, int *err)
+{
+    double *x = NULL;
+    int n = gb_read_i32(r, err);
+
+    gb_skip_pad(r, err);
+
+    if (*err) {
+	return NULL;
+    } else if (n <= 0 || (size_t) n > (r->len - r->pos) / sizeof *x) {
+	*err = E_DATA;
+	return NULL;
+    }
+
+    x = malloc(n * sizeof *x);
+    if (x == NULL) {
+	*err = E_ALLOC;
+    } else {
+	*err = gb_read_doubles(r, x, n);
+	if (*err) {
+	    free(x);
+	    x = NULL;
+	} else {
+	    *size = n;
+	}
+    }
+
+    return x;
+}
+
+static int *gb_read_list (gbin_reader *r, int *err)
+{
+    int *list = NULL;
+    int i, n = gb_read_count(r, 4, err);
+
+    if (!*err) {
+	list = gretl_list_new(n);
+	if (list == NULL) {
+	    *err = E_ALLOC;
+	}
+    }
+
+    for (i=1; i<=n && !*err; i++) {
+	list[i] = gb_read_i32(r, err);
+    }
+
+    if (*err) {
+	free(list);
+	list = NULL;
+    }
+
+    return list;
+}
+
+static gretl_bundle *gb_read_bundle (gbin_reader *r, int *err)
+{
+    gretl_bundle *b;
+    char *creator, *key, *note;
+    GretlType type;
+    void *ptr;
+    int i, size, nkeys;
+
+    b = gretl_bundle_new();
+    if (b == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    creator = gb_read_string(r, err);
+    if (creator != NULL) {
+	if (*creator != '\0') {
+	    gretl_bundle_set_creator(b, creator);
+	}
+	free(creator);
+    }
+
+    /* each member takes at least 12 bytes */
+    nkeys = gb_read_count(r, 12, err);
+
+    for (i=0; i<nkeys && !*err; i++) {
+	key = gb_read_string(r, err);
+	note = gb_read_string(r, err);
+	size = 0;
+	ptr = NULL;
+	if (!*err) {
+	    ptr = gb_read_object(r, &type, &size, err);
+	    if (!*err && ptr == NULL) {
+		/* empty slots belong only in arrays */
+		*err = E_DATA;
+	    }
+	}
+	if (!*err) {
+	    if (type == GRETL_TYPE_DOUBLE || type == GRETL_TYPE_INT ||
+		type == GRETL_TYPE_UNSIGNED) {
+		*err = gretl_bundle_set_data(b, key, ptr, type, size);
+		free(ptr);
+	    } else {
+		*err = gretl_bundle_donate_data(b, key, ptr, type, size);
+	    }
+	}
+	if (!*err && note != NULL && *note != '\0') {
+	    gretl_bundle_set_note(b, key, note);
+	}
+	free(key);
+	free(note);
+    }
+
+    if (*err) {
+	gretl_bundle_destroy(b);
+	b = NULL;
+    }
+
+    return b;
+}
+
+static gretl_bundle *gb_read_xml_bundle (gbin_reader *r, int *err)
+{
+    gretl_bundle *b = NULL;
+    char *buf = gb_read_string(r, err);
+
+    if (buf != NULL) {
+	b = gretl_bundle_read_from_buffer(buf, strlen(buf), err);
+	free(buf);
+    }
+
+    return b;
+}
+
+static gretl_array *gb_read_array (gbin_reader *r, int *err)
+{
+    gretl_array *A = NULL;
+    GretlType atype = 0;
+    GretlType etype = 0;
+    void *ptr;
+    int i, tag, n;
+
+    tag = gb_read_u32(r, err);
+    /* each element takes at least 4 bytes */
+    n = gb_read_count(r, 4, err);
+
+    if (*err) {
+	return NULL;
+    }
+
+    if (tag == GB_STRING) {
+	atype = GRETL_TYPE_STRINGS;
+    } else if (tag == GB_MATRIX) {
+	atype = GRETL_TYPE_MATRICES;
+    } else if (tag == GB_BUNDLE) {
+	atype = GRETL_TYPE_BUNDLES;
+    } else if (tag == GB_LIST) {
+	atype = GRETL_TYPE_LISTS;
+    } else if (tag == GB_ARRAY) {
+	atype = GRETL_TYPE_ARRAYS;
+    } else {
+	*err = E_DATA;
+	return NULL;
+    }
+
+    A = gretl_array_new(atype, n, err);
+
+    for (i=0; i<n && !*err; i++) {
+	ptr = gb_read_object(r, &etype, NULL, err);
+	if (!*err && ptr != NULL) {
+	    if (etype != gretl_type_get_singular(atype)) {
+		*err = E_DATA;
+	    } else {
+		gretl_array_set_data(A, i, ptr);
+		ptr = NULL;
+	    }
+	}
+	if (ptr != NULL) {
+	    /* not placed in the array */
+	    gb_free_object(ptr, etype);
+	}
+    }
+
+    if (*err && A != NULL) {
+	gretl_array_destroy(A);
+	A = NULL;
+    }
+
+    return A;
+}
+
+/* Read a tagged object, returning a newly allocated pointer
+   (for scalars, ints and unsigned ints, to a single value
+   which the caller should free). An empty array slot gives a
+   NULL return with no error.
+*/
+
+static void *gb_read_object (gbin_reader *r, GretlType *type,
+			     int *size, int *err)
+{
+    void *ret = NULL;
+    int tag;
+
+    tag = gb_read_u32(r, err);
+    if (*err) {
+	return NULL;
+    }
+
+    if (tag == GB_BUNDLE || tag == GB_ARRAY) {
+	if (++r->depth > GBIN_MAXDEPTH) {
+	    *err = E_DATA;
+	    return NULL;
+	}
+    }
+
+    switch (tag) {
+    case GB_NULL:
+	*type = GRETL_TYPE_NONE;
+	break;
+    case GB_SCALAR:
+	*type = GRETL_TYPE_DOUBLE;
+	ret = malloc(sizeof(double));
+	if (ret == NULL) {
+	    *err = E_ALLOC;
+	} else {
+	    *err = gb_read_doubles(r, ret, 1);
+	}
+	break;
+    case GB_INT:
+    case GB_UNSIGNED:
+	*type = (tag == GB_INT)? GRETL_TYPE_INT : GRETL_TYPE_UNSIGNED;
+	ret = malloc(sizeof(guint32));
+	if (ret == NULL) {
+	    *err = E_ALLOC;
+	} else {
+	    *(guint32 *) ret = gb_read_u32(r, err);
+	}
+	break;
+    case GB_STRING:
+	*type = GRETL_TYPE_STRING;
+	ret = gb_read_string(r, err);
+	break;
+    case GB_MATRIX:
+	*type = GRETL_TYPE_MATRIX;
+	ret = gb_read_matrix(r, err);
+	break;
+    case GB_SERIES:
+	*type = GRETL_TYPE_SERIES;
+	if (size == NULL) {
+	    /* series can be found only in bundles */
+	    *err = E_DATA;
+	} else {
+	    ret = gb_read_series(r, size, err);
+	}
+	break;
+    case GB_LIST:
+	*type = GRETL_TYPE_LIST;
+	ret = gb_read_list(r, err);
+	break;
+    case GB_BUNDLE:
+	*type = GRETL_TYPE_BUNDLE;
+	ret = gb_read_bundle(r, err);
+	break;
+    case GB_XBUNDLE:
+	*type = GRETL_TYPE_BUNDLE;
+	ret = gb_read_xml_bundle(r, err);
+	break;
+    case GB_ARRAY:
+	*type = GRETL_TYPE_ARRAY;
+	ret = gb_read_array(r, err);
+	break;
+    default:
+	*err = E_DATA;
+	break;
+    }
+
+    if (tag == GB_BUNDLE || tag == GB_ARRAY) {
+	r->depth -= 1;
+    }
+
+    if (*err && ret != NULL) {
+	gb_free_object(ret, *type);
+	ret = NULL;
+    }
+
+    return ret;
+}
+
+/**
+ * gretl_gbin_check_header:
+ * @buf: buffer.
+ * @size: size of @buf in bytes.
+ *
+ * Returns: 1 if @buf starts with a gbin header of a version
+ * that we can read, otherwise 0.
+ */
+
+int gretl_gbin_check_header (const char *buf, size_t size)
+{
+    guint32 version;
+
+    if (size < GBIN_HDRLEN || memcmp(buf, GBIN_MAGIC, 8)) {
+	return 0;
+    }
+
+    memcpy(&version, buf + 8, sizeof version);
+
+    return GUINT32_FROM_LE(version) <= GBIN_VERSION;
+}
+
+/**
+ * gretl_gbin_unpack:
+ * @buf: buffer.
+ * @size: size of @buf in bytes.
+ * @type: location to receive the type of the object.
+ * @err: location to receive error code.
+ *
+ * Reconstructs an object from a buffer written by
+ * gretl_gbin_pack() or gretl_gbin_write_file(). For
+ * scalars the return value points to a single double,
+ * which the caller should free.
+ *
+ * Returns: the object, or NULL on failure.
+ */
+
+void *gretl_gbin_unpack (const char *buf, size_t size,
+			 GretlType *type, int *err)
+{
+    gbin_reader r = {buf, size, GBIN_HDRLEN, 0};
+    void *ret = NULL;
+    int isize = 0;
+
+    if (!gretl_gbin_check_header(buf, size)) {
+	gretl_errmsg_set(_("Not a gretl binary file"));
+	*err = E_DATA;
+    } else {
+	ret = gb_read_object(&r, type, &isize, err);
+	if (!*err && ret == NULL) {
+	    /* we don't do "empty" at top level */
+	    *err = E_DATA;
+	}
+    }
+
+    return ret;
+}
+
+/**
+ * gretl_gbin_unpack_as:
+ * @buf: buffer.
+ * @size: size of @buf in bytes.
+ * @type: the type of object wanted.
+ * @err: location to receive error code.
+ *
+ * Like gretl_gbin_unpack(), but flags an error if the
+ * buffer does not hold an object of type @type.
+ *
+ * Returns: the object, or NULL on failure.
+ */
+
+void *gretl_gbin_unpack_as (const char *buf, size_t size,
+			    GretlType type, int *err)
+{
+    GretlType gottype = 0;
+    void *ret;
+
+    ret = gretl_gbin_unpack(buf, size, &gottype, err);
+
+    if (!*err && gottype != type) {
+	gretl_errmsg_sprintf(_("Expected %s but found %s"),
+			     gretl_type_get_name(type),
+			     gretl_type_get_name(gottype));
+	*err = E_TYPES;
+	gb_free_object(ret, gottype);
+	ret = NULL;
+    }
+
+    return ret;
+}
+
+/**
+ * gretl_gbin_read_file:
+ * @fname: full path to input file.
+ * @type: the type of object wanted.
+ * @err: location to receive error code.
+ *
+ * Reads an object of type @type from a file written by
+ * gretl_gbin_write_file(). The file is memory-mapped, so the
+ * data in large matrices are copied straight from the mapping
+ * into the matrices' storage.
+ *
+ * Returns: the object, or NULL on failure.
+ */
+
+void *gretl_gbin_read_file (const char *fname, GretlType type,
+			    int *err)
+{
+    GMappedFile *mf;
+    GError *gerr = NULL;
+    void *ret = NULL;
+
+    mf = g_mapped_file_new(fname, FALSE, &gerr);
+
+    if (mf == NULL) {
+	if (gerr != NULL) {
+	    gretl_errmsg_set(gerr->message);
+	    g_error_free(gerr);
+	}
+	*err = E_FOPEN;
+	return NULL;
+    }
+
+    ret = gretl_gbin_unpack_as(g_mapped_file_get_contents(mf),
+			       g_mapped_file_get_length(mf),
+			       type, err);
+    g_mapped_file_unref(mf);
+
+    return ret;
+}
@@ -0,0 +1,42 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GRETL_GBIN_H
+#define GRETL_GBIN_H
+
+int gretl_gbin_type_ok (GretlType type);
+
+int gretl_gbin_write_file (void *ptr, GretlType type,
+			   const char *fname);
+
+void *gretl_gbin_read_file (const char *fname, GretlType type,
+			    int *err);
+
+char *gretl_gbin_pack (void *ptr, GretlType type,
+		       size_t *size, int *err);
+
+void *gretl_gbin_unpack (const char *buf, size_t size,
+			 GretlType *type, int *err);
+
+void *gretl_gbin_unpack_as (const char *buf, size_t size,
+			    GretlType type, int *err);
+
+int gretl_gbin_check_header (const char *buf, size_t size);
+
+#endif /* GRETL_GBIN_H */
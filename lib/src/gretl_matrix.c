@@ -41,6 +41,20 @@
 
 #if defined(USE_AVX)
 # define USE_SIMD 1
+#endif
+
+/* On x86 with GCC or clang we can compile SIMD variants of
+   selected functions for instruction sets beyond those the
+   library as a whole is built for, and choose among them at
+   run time: see matrix_simd.c
+*/
+#if defined(HAVE_IMMINTRIN_H) && (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+# define SIMD_DISPATCH 1
+# include <cpuid.h>
+#endif
+
+#if defined(USE_SIMD) || defined(SIMD_DISPATCH)
 # if defined(HAVE_IMMINTRIN_H)
 #  include <immintrin.h>
 # else
@@ -119,9 +133,7 @@ static inline void *mval_realloc (void *ptr, size_t sz)
 
 #define mval_free(m) free(m)
 
-#ifdef USE_SIMD
-# include "matrix_simd.c"
-#endif
+#include "matrix_simd.c"
 
 /* Below: setting of the maximal value of K = the shared inner
    dimension in matrix multiplication for use of SIMD. Also
@@ -318,6 +330,382 @@ static int matrix_block_error (const char *f)
     return E_DATA;
 }
 
+/* Optional pool for recycling matrices, to cut down on calls to
+   malloc and free when small matrices are created and destroyed at
+   a high rate, as in evaluating hansl expressions within loops.
+   It's switched on via "set matrix_pool on".
+
+   Each thread has its own pool, in which matrices are held, each
+   keeping its data block, in size classes by powers of two. A
+   matrix goes into the largest class whose size its block can
+   accommodate, so any matrix in the right class will do for a new
+   allocation. Since the data of a matrix may have been reallocated
+   or swapped by the time it's freed, we ask the allocator for the
+   capacity of the block where possible, and otherwise trust only
+   the matrix's current size. Everything handed out is plain
+   malloc'd memory, so a matrix taken from the pool can safely be
+   freed or resized in the ordinary way.
+
+   The pools of all threads are also recorded in a global list, so
+   that they can be emptied (on switching the pool off) or freed
+   (on cleanup) from the main thread, outside of any parallel
+   region. On freeing we bump a "generation" count, which tells
+   each thread that its own pointer is no longer valid.
+*/
+
+#define MPOOL_CLASSES 16          /* up to 2^14 elements */
+#define MPOOL_DEPTH 16            /* matrices per size class */
+#define MPOOL_MAX_BYTES (8 << 20) /* high-water mark per thread */
+
+#if defined(HAVE_MALLOC_USABLE_SIZE)
+# include <malloc.h>
+# define mval_usable_size(p) malloc_usable_size(p)
+#elif defined(OS_OSX)
+# include <malloc/malloc.h>
+# define mval_usable_size(p) malloc_size(p)
+#elif defined(WIN32)
+# include <malloc.h>
+# define mval_usable_size(p) _msize(p)
+#endif
+
+typedef struct matrix_pool_ matrix_pool;
+
+struct matrix_pool_ {
+    gretl_matrix *m[MPOOL_CLASSES][MPOOL_DEPTH];
+    int n[MPOOL_CLASSES];
+    size_t bytes;
+    guint64 hits;
+    guint64 misses;
+};
+
+static int mpool_on;
+static int mpool_gen;        /* current generation of pools */
+static matrix_pool **mpools; /* the pools of all threads */
+static int n_mpools;
+static matrix_pool *mpool;   /* the calling thread's pool */
+static int mpool_tgen;       /* the generation of @mpool */
+
+#if defined(_OPENMP) && !defined(OS_OSX)
+#pragma omp threadprivate(mpool, mpool_tgen)
+#endif
+
+/* as with lapack_malloc() above, on OS X we must stay out of
+   the way when running threaded */
+
+#if defined(_OPENMP) && defined(OS_OSX)
+# define mpool_usable() (mpool_on && !omp_in_parallel())
+#else
+# define mpool_usable() (mpool_on)
+#endif
+
+/* number of elements for size class @c > 0 */
+#define mpool_class_size(c) (1 << ((c) - 1))
+
+#define mpool_size(n) (sizeof(gretl_matrix) + (n) * sizeof(double))
+
+/* the smallest class that will hold @n elements, or -1 if
+   @n is too big for the pool */
+
+static int mpool_class (int n)
+{
+    int c = 1;
+
+    if (n == 0) {
+	return 0;
+    }
+
+    while (mpool_class_size(c) < n) {
+	if (++c == MPOOL_CLASSES) {
+	    return -1;
+	}
+    }
+
+    return c;
+}
+
+/* the largest class all of whose members a block of @k
+   elements can stand in for, or -1 if @k is too big */
+
+static int mpool_class_floor (int k)
+{
+    int c = mpool_class(k);
+
+    if (c > 0 && mpool_class_size(c) > k) {
+	c--;
+    }
+
+    return c;
+}
+
+/* the number of elements the data block of @m can hold */
+
+static int mval_capacity (const gretl_matrix *m)
+{
+#if defined(mval_usable_size)
+    return (int) (mval_usable_size(m->val) / sizeof(double));
+#else
+    int n = m->rows * m->cols;
+
+    return m->is_complex ? 2 * n : n;
+#endif
+}
+
+/* the calling thread's pool, or NULL if it has none */
+
+static matrix_pool *mpool_current (void)
+{
+    if (mpool != NULL && mpool_tgen != mpool_gen) {
+	/* freed by gretl_matrix_pool_cleanup() */
+	mpool = NULL;
+    }
+
+    return mpool;
+}
+
+/* create a pool for the calling thread and add it to the
+   global list */
+
+static matrix_pool *mpool_create (void)
+{
+    matrix_pool *pool = calloc(1, sizeof *pool);
+    matrix_pool **pp;
+
+    if (pool == NULL) {
+	return NULL;
+    }
+
+#if defined(_OPENMP)
+#pragma omp critical (mpool_list)
+#endif
+    {
+	pp = realloc(mpools, (n_mpools + 1) * sizeof *pp);
+	if (pp != NULL) {
+	    mpools = pp;
+	    mpools[n_mpools++] = pool;
+	}
+    }
+
+    if (pp == NULL) {
+	free(pool);
+	return NULL;
+    }
+
+    mpool = pool;
+    mpool_tgen = mpool_gen;
+
+    return pool;
+}
+
+/* Returns a cached matrix whose data block holds at least @n
+   elements, or NULL on a miss.
+*/
+
+static gretl_matrix *mpool_get (int n)
+{
+    matrix_pool *pool = mpool_current();
+    gretl_matrix *m;
+    int c;
+
+    if (pool == NULL) {
+	return NULL;
+    }
+
+    c = mpool_class(n);
+
+    if (c < 0 || pool->n[c] == 0) {
+	pool->misses += 1;
+	return NULL;
+    }
+
+    pool->n[c] -= 1;
+    m = pool->m[c][pool->n[c]];
+    pool->bytes -= mpool_size(m->rows);
+    pool->hits += 1;
+
+    return m;
+}
+
+/* Takes charge of @m if there's room for it in the pool, in
+   which case we return 1, otherwise returns 0.
+*/
+
+static int mpool_put (gretl_matrix *m)
+{
+    matrix_pool *pool = mpool_current();
+    int k = 0;
+    int c;
+
+    if (m->val != NULL) {
+	/* note: the data may have been taken over by another
+	   matrix, in which case we just recycle the struct */
+	k = mval_capacity(m);
+    }
+
+    c = mpool_class_floor(k);
+    if (c < 0) {
+	return 0;
+    }
+
+    if (pool == NULL && (pool = mpool_create()) == NULL) {
+	return 0;
+    }
+
+    if (pool->n[c] == MPOOL_DEPTH ||
+	pool->bytes + mpool_size(k) > MPOOL_MAX_BYTES) {
+	return 0;
+    }
+
+    if (m->info != NULL) {
+	gretl_matrix_destroy_info(m);
+    }
+    if (c == 0 && m->val != NULL) {
+	mval_free(m->val);
+	m->val = NULL;
+    }
+
+    /* record the capacity */
+    m->rows = k;
+    m->cols = 1;
+
+    pool->m[c][pool->n[c]] = m;
+    pool->n[c] += 1;
+    pool->bytes += mpool_size(k);
+
+    return 1;
+}
+
+/* Data block for a new matrix of @n elements while the pool is in
+   use: we round up to the size of the class, so the block can be
+   recycled for any matrix of that class, and align at 64 bytes (a
+   cache line, and the width of an AVX-512 register) if that can be
+   done without departing from plain malloc/free semantics, as is
+   the case for posix_memalign(). As in mval_malloc() we pad a
+   block whose size is not a multiple of 16 bytes (in practice,
+   one of a single element), to forestall invalid reads by
+   OpenBLAS.
+*/
+
+static double *mpool_val_alloc (int n)
+{
+    int c = mpool_class(n);
+    size_t sz;
+
+    if (c > 0) {
+	n = mpool_class_size(c);
+    }
+    sz = n * sizeof(double);
+
+#if defined(HAVE_POSIX_MEMALIGN) && !defined(WIN32)
+    {
+	void *mem = NULL;
+
+	if (posix_memalign(&mem, 64, sz % 16 ? sz + 8 : sz) != 0) {
+	    mem = NULL;
+	}
+	return mem;
+    }
+#else
+    return mval_malloc(sz);
+#endif
+}
+
+static void mpool_drain (matrix_pool *pool)
+{
+    int c, i;
+
+    for (c=0; c<MPOOL_CLASSES; c++) {
+	for (i=0; i<pool->n[c]; i++) {
+	    mval_free(pool->m[c][i]->val);
+	    free(pool->m[c][i]);
+	}
+	pool->n[c] = 0;
+    }
+    pool->bytes = 0;
+}
+
+/* empty, and if @destroy is non-zero free, the pools of all
+   threads: not to be called within a parallel region */
+
+static void mpool_drain_all (int destroy)
+{
+    int i;
+
+    for (i=0; i<n_mpools; i++) {
+	mpool_drain(mpools[i]);
+	if (destroy) {
+	    free(mpools[i]);
+	}
+    }
+
+    if (destroy) {
+	free(mpools);
+	mpools = NULL;
+	n_mpools = 0;
+	mpool = NULL;
+	mpool_gen++;
+    }
+}
+
+/**
+ * gretl_matrix_pool_set:
+ * @s: non-zero to switch the matrix pool on, 0 to switch it off.
+ *
+ * Controls the recycling of the storage of freed matrices for
+ * use by newly allocated ones, which is off by default. On
+ * switching off, the pools of all threads are emptied.
+ *
+ * Returns: 0.
+ */
+
+int gretl_matrix_pool_set (int s)
+{
+    mpool_on = (s != 0);
+    if (!mpool_on) {
+	mpool_drain_all(0);
+    }
+
+    return 0;
+}
+
+int gretl_matrix_pool_get (void)
+{
+    return mpool_on;
+}
+
+/**
+ * gretl_matrix_pool_stats:
+ * @hits: location to receive the number of allocations satisfied
+ * from the pool.
+ * @misses: location to receive the number of allocations not so
+ * satisfied.
+ * @bytes: location to receive the number of bytes currently held
+ * in the pool.
+ *
+ * Retrieves statistics on the calling thread's matrix pool.
+ */
+
+void gretl_matrix_pool_stats (double *hits, double *misses,
+			      double *bytes)
+{
+    matrix_pool *pool = mpool_current();
+
+    *hits = pool == NULL ? 0 : (double) pool->hits;
+    *misses = pool == NULL ? 0 : (double) pool->misses;
+    *bytes = pool == NULL ? 0 : (double) pool->bytes;
+}
+
+/**
+ * gretl_matrix_pool_cleanup:
+ *
+ * Cleanup function, called by libgretl_cleanup(). Frees the
+ * matrix pools of all threads.
+ */
+
+void gretl_matrix_pool_cleanup (void)
+{
+    mpool_drain_all(1);
+}
+
 /**
  * gretl_matrix_alloc:
  * @rows: desired number of rows in matrix.
@@ -339,18 +727,27 @@ gretl_matrix *gretl_matrix_alloc (int rows, int cols)
 	return NULL;
     }
 
+    n = rows * cols;
+
+    if (mpool_usable() && (m = mpool_get(n)) != NULL) {
+	/* recycled: the data block is big enough */
+	goto finish;
+    }
+
     m = malloc(sizeof *m);
     if (m == NULL) {
 	set_gretl_matrix_err(E_ALLOC);
 	return NULL;
     }
 
-    n = rows * cols;
-
     if (n == 0) {
 	m->val = NULL;
     } else {
-	m->val = mval_malloc(n * sizeof *m->val);
+	if (mpool_on) {
+	    m->val = mpool_val_alloc(n);
+	} else {
+	    m->val = mval_malloc(n * sizeof *m->val);
+	}
 	if (m->val == NULL) {
 	    set_gretl_matrix_err(E_ALLOC);
 	    free(m);
@@ -358,6 +755,8 @@ gretl_matrix *gretl_matrix_alloc (int rows, int cols)
 	}
     }
 
+ finish:
+
     m->rows = rows;
     m->cols = cols;
     m->is_complex = 0;
@@ -849,6 +1248,80 @@ gretl_matrix *gretl_matrix_init (gretl_matrix *m)
     return m;
 }
 
+/**
+ * gretl_matrix_view_new:
+ * @src: source matrix.
+ * @offset: offset of the first element of the view within
+ * the data array of @src (counting complex elements, if
+ * @src is complex).
+ * @rows: number of rows in the view.
+ * @cols: number of columns in the view.
+ *
+ * Creates a "view" of @rows * @cols elements of @src, starting
+ * at @offset: this is a matrix struct whose data array points
+ * into that of @src rather than holding a copy. Since the data
+ * of gretl matrices are stored in column-major order, any
+ * contiguous range of columns of @src can be viewed in this
+ * way, as can any contiguous range of elements of a vector.
+ *
+ * The view should be treated as read-only, it is valid only
+ * so long as the data array of @src remains in place, and it
+ * must be freed using gretl_matrix_view_free(), never
+ * gretl_matrix_free().
+ *
+ * Returns: the new view, or NULL on failure.
+ */
+
+gretl_matrix *gretl_matrix_view_new (const gretl_matrix *src,
+				     int offset, int rows, int cols)
+{
+    gretl_matrix *m;
+
+    if (src == NULL || src->val == NULL || is_block_matrix(src) ||
+	offset < 0 || rows <= 0 || cols <= 0 ||
+	offset + rows * cols > src->rows * src->cols) {
+	return NULL;
+    }
+
+    m = malloc(sizeof *m);
+
+    if (m != NULL) {
+	m->rows = rows;
+	m->cols = cols;
+	m->info = NULL;
+	if (src->is_complex) {
+	    m->is_complex = 1;
+	    m->z = src->z + offset;
+	    m->val = (double *) m->z;
+	} else {
+	    m->is_complex = 0;
+	    m->z = NULL;
+	    m->val = src->val + offset;
+	}
+    }
+
+    return m;
+}
+
+/**
+ * gretl_matrix_view_free:
+ * @m: matrix view, as obtained via gretl_matrix_view_new().
+ *
+ * Frees @m along with any metadata that may have been
+ * attached to it, but not the data array, which belongs
+ * to the source matrix of the view.
+ */
+
+void gretl_matrix_view_free (gretl_matrix *m)
+{
+    if (m != NULL) {
+	if (m->info != NULL) {
+	    gretl_matrix_destroy_info(m);
+	}
+	free(m);
+    }
+}
+
 /**
  * gretl_matrix_replace:
  * @pa: location of matrix to be replaced.
@@ -1560,6 +2033,10 @@ void gretl_matrix_free (gretl_matrix *m)
 	return;
     }
 
+    if (mpool_usable() && mpool_put(m)) {
+	return;
+    }
+
     if (m->val != NULL) {
 	mval_free(m->val);
     }
@@ -2343,12 +2820,10 @@ void gretl_matrix_multiply_by_scalar (gretl_matrix *m, double x)
 {
     int i, n = m->rows * m->cols;
 
-#if defined(USE_SIMD)
     if (simd_add_sub(n)) {
-	gretl_matrix_simd_scalar_mul(m->val, x, n);
+	gretl_simd_scale(m->val, x, n);
 	return;
     }
-#endif
 
     for (i=0; i<n; i++) {
 	m->val[i] *= x;
@@ -2857,11 +3332,10 @@ gretl_matrix_add_to (gretl_matrix *targ, const gretl_matrix *src)
  st_mode:
 #endif
 
-#if defined(USE_SIMD)
     if (simd_add_sub(n)) {
-	return gretl_matrix_simd_add_to(targ, src, n);
+	gretl_simd_add(targ->val, src->val, targ->val, n);
+	return 0;
     }
-#endif
 
     for (i=0; i<n; i++) {
 	targ->val[i] += src->val[i];
@@ -2900,11 +3374,10 @@ gretl_matrix_add (const gretl_matrix *a, const gretl_matrix *b,
 
     n = rows * cols;
 
-#if defined(USE_SIMD)
     if (simd_add_sub(n)) {
-	return gretl_matrix_simd_add(a->val, b->val, c->val, n);
+	gretl_simd_add(a->val, b->val, c->val, n);
+	return 0;
     }
-#endif
 
     for (i=0; i<n; i++) {
 	c->val[i] = a->val[i] + b->val[i];
@@ -2996,11 +3469,10 @@ gretl_matrix_subtract_from (gretl_matrix *targ, const gretl_matrix *src)
  st_mode:
 #endif
 
-#if defined(USE_SIMD)
     if (simd_add_sub(n)) {
-	return gretl_matrix_simd_subt_from(targ, src, n);
+	gretl_simd_subtract(targ->val, src->val, targ->val, n);
+	return 0;
     }
-#endif
 
     for (i=0; i<n; i++) {
 	targ->val[i] -= src->val[i];
@@ -3040,11 +3512,10 @@ gretl_matrix_subtract (const gretl_matrix *a, const gretl_matrix *b,
 
     n = rows * cols;
 
-#if defined(USE_SIMD)
     if (simd_add_sub(n)) {
-	return gretl_matrix_simd_subtract(a->val, b->val, c->val, n);
+	gretl_simd_subtract(a->val, b->val, c->val, n);
+	return 0;
     }
-#endif
 
     for (i=0; i<n; i++) {
 	c->val[i] = a->val[i] - b->val[i];
@@ -5497,6 +5968,8 @@ static void gretl_blas_dgemm (const gretl_matrix *a, int atr,
 	   c->val, &c->rows);
 }
 
+#include "matrix_gemm.c"
+
 /* below: a native C re-write of netlib BLAS dgemm.f: note that
    for gretl's purposes we do not support values of 'beta'
    other than 0 or 1 */
@@ -5526,6 +5999,11 @@ static void gretl_dgemm (const gretl_matrix *a, int atr,
 	beta = 1;
     }
 
+    if (gemm_use_blocked(m, n, k) &&
+	gretl_dgemm_blocked(a, atr, b, btr, c, cmod, m, n, k, 1) == 0) {
+	return;
+    }
+
 #if defined(_OPENMP)
     fpm = (guint64) m * n * k;
     if (!libset_use_openmp(fpm)) {
@@ -5714,6 +6192,11 @@ static void gretl_dgemm_single (const gretl_matrix *a, int atr,
 	beta = 1;
     }
 
+    if (gemm_use_blocked(m, n, k) &&
+	gretl_dgemm_blocked(a, atr, b, btr, c, cmod, m, n, k, 0) == 0) {
+	return;
+    }
+
 #if defined(USE_SIMD)
     if (k <= simd_k_max && !atr && !btr && !cmod) {
 	gretl_matrix_simd_mul(a, b, c);
@@ -6605,11 +7088,9 @@ double gretl_vector_dot_product (const gretl_vector *a,
 	}
 	dp = NADBL;
     } else {
-#if USE_SIMD
 	if (simd_add_sub(dima)) {
-	    return gretl_vector_simd_dot_product(a, b);
+	    return gretl_simd_dot(a->val, b->val, dima);
 	}
-#endif
 	for (i=0; i<dima; i++) {
 	    dp += a->val[i] * b->val[i];
 	}
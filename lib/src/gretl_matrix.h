@@ -51,6 +51,14 @@ typedef enum {
     GRETL_MATRIX_SCALAR,
 } GretlMatrixStructure;
 
+typedef enum {
+    GRETL_SIMD_NONE = 0,
+    GRETL_SIMD_SSE2,
+    GRETL_SIMD_AVX,
+    GRETL_SIMD_AVX2,   /* AVX2 plus FMA */
+    GRETL_SIMD_AVX512
+} GretlSIMDLevel;
+
 typedef enum {
     V_SUM,
     V_PROD,
@@ -261,6 +269,11 @@ gretl_matrix *gretl_matrix_init_full (gretl_matrix *m,
 				      int rows, int cols,
 				      double *val);
 
+gretl_matrix *gretl_matrix_view_new (const gretl_matrix *src,
+				     int offset, int rows, int cols);
+
+void gretl_matrix_view_free (gretl_matrix *m);
+
 gretl_matrix *gretl_matrix_replace (gretl_matrix **pa,
 				    gretl_matrix *b);
 
@@ -881,6 +894,15 @@ void gretl_matrix_destroy_info (gretl_matrix *m);
 
 void lapack_mem_free (void);
 
+int gretl_matrix_pool_set (int s);
+
+int gretl_matrix_pool_get (void);
+
+void gretl_matrix_pool_stats (double *hits, double *misses,
+			      double *bytes);
+
+void gretl_matrix_pool_cleanup (void);
+
 void set_blas_mnk_min (int mnk);
 
 int get_blas_mnk_min (void);
@@ -893,6 +915,22 @@ void set_simd_mn_min (int mn);
 
 int get_simd_mn_min (void);
 
+void gretl_simd_init (void);
+
+int gretl_simd_level (void);
+
+const char *gretl_simd_level_string (void);
+
+void gretl_simd_add (const double *a, const double *b,
+		     double *c, int n);
+
+void gretl_simd_subtract (const double *a, const double *b,
+			  double *c, int n);
+
+void gretl_simd_scale (double *a, double x, int n);
+
+double gretl_simd_dot (const double *a, const double *b, int n);
+
 #ifdef  __cplusplus
 }
 #endif
@@ -2574,7 +2574,82 @@ int gretl_model_write_vcv (MODEL *pmod, const gretl_matrix *V)
     return err;
 }
 
-static gretl_matrix *make_cluster_vals (MODEL *pmod, int cvar,
+/* Cluster-robust covariance matrices: the following apparatus is
+   shared by the QML variant below and by OLS/IV in qr_estimate.c.
+
+   The option --cluster may name one or more clustering series,
+   separated by spaces or commas. For each (non-empty) subset of
+   these we index the observations used in the model by cluster,
+   in one pass plus a sort, so the scores can be summed by cluster
+   in a single further pass. With more than one clustering series
+   the covariance matrix is formed as in Cameron, Gelbach and
+   Miller (Journal of Business and Economic Statistics, 2011), by
+   inclusion and exclusion of the matrices clustered on the
+   intersections of the subsets.
+*/
+
+#define CLUSTER_MAXVARS 4
+
+/**
+ * gretl_model_get_cluster_list:
+ * @ci: command index.
+ * @dset: pointer to dataset.
+ * @err: location to receive error code.
+ *
+ * Returns: a list of the series named as the argument to the
+ * --cluster option for command @ci, or NULL on error.
+ */
+
+int *gretl_model_get_cluster_list (int ci, const DATASET *dset,
+				   int *err)
+{
+    const char *cname;
+    char **S;
+    int *list = NULL;
+    int i, n = 0;
+
+    cname = get_optval_string(ci, OPT_C);
+    if (cname == NULL) {
+	gretl_errmsg_set("Got --cluster option but couldn't find varname");
+	*err = E_PARSE;
+	return NULL;
+    }
+
+    S = gretl_string_split(cname, &n, " ,");
+    if (S == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    if (n > CLUSTER_MAXVARS) {
+	gretl_errmsg_sprintf(_("--cluster: at most %d series may be given"),
+			     CLUSTER_MAXVARS);
+	*err = E_DATA;
+    } else {
+	list = gretl_list_new(n);
+	if (list == NULL) {
+	    *err = E_ALLOC;
+	}
+    }
+
+    for (i=0; i<n && !*err; i++) {
+	list[i+1] = current_series_index(dset, S[i]);
+	if (list[i+1] < 1 || list[i+1] >= dset->v) {
+	    *err = E_UNKVAR;
+	}
+    }
+
+    strings_array_free(S, n);
+
+    if (*err) {
+	free(list);
+	list = NULL;
+    }
+
+    return list;
+}
+
+static gretl_matrix *make_cluster_vals (const MODEL *pmod, int cvar,
 					const DATASET *dset,
 					int *err)
 {
@@ -2603,6 +2678,7 @@ static gretl_matrix *make_cluster_vals (MODEL *pmod, int cvar,
     if (!*err) {
 	cvals = gretl_matrix_values(cdata, pmod->nobs, OPT_S, err);
 	if (!*err && gretl_vector_get_length(cvals) < 2) {
+	    gretl_errmsg_set("Invalid clustering variable");
 	    gretl_matrix_free(cvals);
 	    cvals = NULL;
 	    *err = E_DATA;
@@ -2614,79 +2690,362 @@ static gretl_matrix *make_cluster_vals (MODEL *pmod, int cvar,
     return cvals;
 }
 
-static int model_make_clustered_GG (MODEL *pmod, int ci,
-				    const gretl_matrix *G,
-				    gretl_matrix *GG,
-				    const DATASET *dset,
-				    int *pcvar,
-				    int *pnc)
+static int sorted_vals_index (const double *v, int n, double x)
 {
-    gretl_matrix *cvals = NULL;
-    gretl_matrix *Gi = NULL;
-    const double *cZ = NULL;
-    const char *cname;
-    int cvar, n_c = 0;
-    int k = G->cols;
-    int i, j, t;
+    int lo = 0, hi = n - 1, mid;
+
+    while (lo <= hi) {
+	mid = (lo + hi) / 2;
+	if (v[mid] == x) {
+	    return mid;
+	} else if (v[mid] < x) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid - 1;
+	}
+    }
+
+    return -1;
+}
+
+static int compare_codes (const void *a, const void *b)
+{
+    const guint64 *ca = a;
+    const guint64 *cb = b;
+
+    return (*ca > *cb) - (*ca < *cb);
+}
+
+/**
+ * gretl_model_cluster_ids:
+ * @pmod: pointer to model.
+ * @clist: list of clustering series.
+ * @mask: bit-mask picking out the members of @clist whose
+ * intersection defines the clusters.
+ * @dset: pointer to dataset.
+ * @n_c: location to receive the number of clusters.
+ * @err: location to receive error code.
+ *
+ * Returns: an array with an element for each observation from
+ * @pmod->t1 to @pmod->t2, holding the 0-based index of the
+ * cluster to which the observation belongs, or -1 if the
+ * observation is not used in @pmod; or NULL on error.
+ */
+
+int *gretl_model_cluster_ids (const MODEL *pmod, const int *clist,
+			      int mask, const DATASET *dset,
+			      int *n_c, int *err)
+{
+    gretl_matrix *cvals;
+    guint64 *code = NULL;
+    guint64 *ucode = NULL;
+    int T = pmod->t2 - pmod->t1 + 1;
+    double radix;
+    int *cid;
+    int i, j, k, s, t, n;
+
+    cid = malloc(T * sizeof *cid);
+    code = calloc(T, sizeof *code);
+    if (cid == NULL || code == NULL) {
+	*err = E_ALLOC;
+	goto bailout;
+    }
+
+    for (s=0; s<T; s++) {
+	cid[s] = model_missing(pmod, pmod->t1 + s) ? -1 : 0;
+    }
+
+    /* mixed-radix code for each observation's combination of
+       values of the selected clustering series */
+    n = 0;
+    radix = 1.0;
+    for (j=1; j<=clist[0] && !*err; j++) {
+	const double *cz = dset->Z[clist[j]];
+
+	if (!(mask & (1 << (j-1)))) {
+	    continue;
+	}
+	cvals = make_cluster_vals(pmod, clist[j], dset, err);
+	if (*err) {
+	    break;
+	}
+	n = cvals->rows;
+	radix *= n;
+	if (radix > 9.0e18) {
+	    gretl_errmsg_set(_("Too many combinations of clustering values"));
+	    gretl_matrix_free(cvals);
+	    *err = E_DATA;
+	    break;
+	}
+	for (s=0, t=pmod->t1; s<T; s++, t++) {
+	    if (cid[s] == 0) {
+		k = sorted_vals_index(cvals->val, n, cz[t]);
+		code[s] = code[s] * n + k;
+	    }
+	}
+	gretl_matrix_free(cvals);
+    }
+
+    if (*err) {
+	goto bailout;
+    }
+
+    if ((mask & (mask - 1)) == 0) {
+	/* a single series: the codes are already cluster indices */
+	for (s=0; s<T; s++) {
+	    if (cid[s] == 0) {
+		cid[s] = (int) code[s];
+	    }
+	}
+	*n_c = n;
+	goto bailout;
+    }
+
+    /* otherwise sort the codes to find the distinct combinations */
+    ucode = malloc(pmod->nobs * sizeof *ucode);
+    if (ucode == NULL) {
+	*err = E_ALLOC;
+	goto bailout;
+    }
+    for (s=0, n=0; s<T; s++) {
+	if (cid[s] == 0) {
+	    ucode[n++] = code[s];
+	}
+    }
+    qsort(ucode, n, sizeof *ucode, compare_codes);
+    for (i=1, k=1; i<n; i++) {
+	if (ucode[i] != ucode[k-1]) {
+	    ucode[k++] = ucode[i];
+	}
+    }
+    for (s=0; s<T; s++) {
+	if (cid[s] == 0) {
+	    guint64 *p = bsearch(&code[s], ucode, k, sizeof *ucode,
+				 compare_codes);
+
+	    cid[s] = p - ucode;
+	}
+    }
+    *n_c = k;
+
+ bailout:
+
+    free(code);
+    free(ucode);
+
+    if (*err) {
+	free(cid);
+	cid = NULL;
+    }
+
+    return cid;
+}
+
+/**
+ * gretl_model_cluster_vcv_fixup:
+ * @V: multi-way clustered covariance matrix.
+ *
+ * The multi-way clustered variance matrix is not guaranteed
+ * to be positive semidefinite: if it is not, replace it by
+ * the matrix with the negative eigenvalues set to zero, as
+ * suggested by Cameron, Gelbach and Miller.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int gretl_model_cluster_vcv_fixup (gretl_matrix *V)
+{
+    gretl_matrix *evals;
+    gretl_matrix *evecs;
+    double lmin;
+    int i, j, k = V->rows;
     int err = 0;
 
-    cname = get_optval_string(ci, OPT_C);
-    if (cname == NULL) {
-	return E_PARSE;
+    evecs = gretl_matrix_copy(V);
+    if (evecs == NULL) {
+	return E_ALLOC;
     }
 
-    cvar = current_series_index(dset, cname);
+    evals = gretl_symmetric_matrix_eigenvals(evecs, 1, &err);
 
-    if (cvar < 1 || cvar >= dset->v) {
-	err = E_UNKVAR;
+    if (!err) {
+	lmin = evals->val[0];
+	for (i=1; i<k; i++) {
+	    if (evals->val[i] < lmin) {
+		lmin = evals->val[i];
+	    }
+	}
+	if (lmin < 0) {
+	    /* V = Q diag(max(lambda, 0)) Q' */
+	    for (i=0; i<k; i++) {
+		if (evals->val[i] < 0) {
+		    evals->val[i] = 0;
+		}
+	    }
+	    for (j=0; j<k; j++) {
+		double sj = sqrt(evals->val[j]);
+
+		for (i=0; i<k; i++) {
+		    gretl_matrix_set(evecs, i, j,
+				     gretl_matrix_get(evecs, i, j) * sj);
+		}
+	    }
+	    gretl_matrix_multiply_mod(evecs, GRETL_MOD_NONE,
+				      evecs, GRETL_MOD_TRANSPOSE,
+				      V, GRETL_MOD_NONE);
+	}
+    }
+
+    gretl_matrix_free(evals);
+    gretl_matrix_free(evecs);
+
+    return err;
+}
+
+/* Record the clustering information on @pmod: in the multi-way
+   case the number of clusters reported is the smallest of the
+   one-way numbers, which also governs the degrees of freedom
+   for the F-test.
+*/
+
+void gretl_model_set_cluster_info (MODEL *pmod, int *clist, int n_c)
+{
+    gretl_model_set_int(pmod, "n_clusters", n_c);
+    gretl_model_set_vcv_info(pmod, VCV_CLUSTER, clist[1]);
+    if (clist[0] > 1) {
+	gretl_model_set_list_as_data(pmod, "cluster_list", clist);
     } else {
-	cvals = make_cluster_vals(pmod, cvar, dset, &err);
+	free(clist);
     }
+}
 
-    if (!err) {
-	Gi = gretl_matrix_alloc(1, k);
-	if (Gi == NULL) {
-	    gretl_matrix_free(cvals);
-	    err = E_ALLOC;
+/* Sum the score rows in @G (one per observation used) by cluster,
+   in a single pass over the data; the columns are independent so
+   they can be handled in parallel.
+*/
+
+static gretl_matrix *cluster_score_sums (const gretl_matrix *G,
+					 const int *cid, int T,
+					 int n_c, int *err)
+{
+    gretl_matrix *S;
+    int k = G->cols;
+    int j, s, t;
+
+    S = gretl_zero_matrix_new(n_c, k);
+    if (S == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(j, s, t) if (libset_use_openmp((guint64) T * k))
+#endif
+    for (j=0; j<k; j++) {
+	double *sj = S->val + j * n_c;
+	const double *gj = G->val + j * G->rows;
+
+	for (s=0, t=0; t<T; t++) {
+	    if (cid[t] >= 0) {
+		sj[cid[t]] += gj[s++];
+	    }
 	}
     }
 
+    return S;
+}
+
+/**
+ * gretl_cluster_mask_size:
+ * @mask: bit-mask as used by gretl_model_cluster_ids().
+ *
+ * Returns: the number of clustering series selected by @mask.
+ */
+
+int gretl_cluster_mask_size (int mask)
+{
+    int n = 0;
+
+    while (mask) {
+	n += mask & 1;
+	mask >>= 1;
+    }
+
+    return n;
+}
+
+static int qml_cluster_vcv (MODEL *pmod, int ci,
+			    const gretl_matrix *H,
+			    const gretl_matrix *G,
+			    const DATASET *dset,
+			    gretl_matrix *V)
+{
+    gretl_matrix *S = NULL;
+    gretl_matrix *GG = NULL;
+    gretl_matrix *Vs = NULL;
+    int T = pmod->t2 - pmod->t1 + 1;
+    int k = H->rows;
+    int *clist, *cid;
+    int mask, nmask, nbits;
+    int n_c, nmin = 0;
+    int err = 0;
+
+    clist = gretl_model_get_cluster_list(ci, dset, &err);
     if (err) {
 	return err;
     }
 
-    n_c = gretl_vector_get_length(cvals);
-    cZ = dset->Z[cvar];
+    GG = gretl_matrix_alloc(k, k);
+    Vs = gretl_matrix_alloc(k, k);
+    if (GG == NULL || Vs == NULL) {
+	err = E_ALLOC;
+    } else {
+	gretl_matrix_zero(V);
+    }
 
-    for (i=0; i<n_c; i++) {
-	double cvi = cvals->val[i];
-	int s = 0;
+    nmask = 1 << clist[0];
 
-	gretl_matrix_zero(Gi);
+    for (mask=1; mask<nmask && !err; mask++) {
+	cid = gretl_model_cluster_ids(pmod, clist, mask, dset, &n_c, &err);
+	if (!err) {
+	    S = cluster_score_sums(G, cid, T, n_c, &err);
+	}
+	if (!err) {
+	    gretl_matrix_multiply_mod(S, GRETL_MOD_TRANSPOSE,
+				      S, GRETL_MOD_NONE,
+				      GG, GRETL_MOD_NONE);
+	    err = gretl_matrix_qform(H, GRETL_MOD_NONE, GG,
+				     Vs, GRETL_MOD_NONE);
+	}
+	if (!err) {
+	    /* stata-style df adjustment, with the sign given by
+	       the number of series in the intersection */
+	    double dfc = n_c / (n_c - 1.0);
 
-	for (t=pmod->t1; t<=pmod->t2; t++) {
-	    if (!model_missing(pmod, t)) {
-		if (cZ[t] == cvi) {
-		    for (j=0; j<k; j++) {
-			Gi->val[j] += gretl_matrix_get(G, s, j);
-		    }
-		}
-		s++;
+	    nbits = gretl_cluster_mask_size(mask);
+	    gretl_matrix_multiply_by_scalar(Vs, nbits % 2 ? dfc : -dfc);
+	    gretl_matrix_add_to(V, Vs);
+	    if (nbits == 1 && (nmin == 0 || n_c < nmin)) {
+		nmin = n_c;
 	    }
 	}
+	gretl_matrix_free(S);
+	S = NULL;
+	free(cid);
+    }
 
-	gretl_matrix_multiply_mod(Gi, GRETL_MOD_TRANSPOSE,
-				  Gi, GRETL_MOD_NONE,
-				  GG, GRETL_MOD_CUMULATE);
+    if (!err && clist[0] > 1) {
+	err = gretl_model_cluster_vcv_fixup(V);
     }
 
     if (!err) {
-	*pcvar = cvar;
-	*pnc = n_c;
+	gretl_model_set_cluster_info(pmod, clist, nmin);
+    } else {
+	free(clist);
     }
 
-    gretl_matrix_free(cvals);
-    gretl_matrix_free(Gi);
+    gretl_matrix_free(GG);
+    gretl_matrix_free(Vs);
 
     return err;
 }
@@ -2720,7 +3079,6 @@ int gretl_model_add_QML_vcv (MODEL *pmod, int ci,
 {
     gretl_matrix *GG = NULL;
     gretl_matrix *V = NULL;
-    int cvar = 0, n_c = 0;
     int k = H->rows;
     int err = 0;
 
@@ -2730,33 +3088,17 @@ int gretl_model_add_QML_vcv (MODEL *pmod, int ci,
 	return E_ALLOC;
     }
 
-    if (!err) {
-	if (opt & OPT_C) {
-	    /* clustered */
-	    GG = gretl_zero_matrix_new(k, k);
-	    if (GG == NULL) {
-		err = E_ALLOC;
-	    } else {
-		err = model_make_clustered_GG(pmod, ci, G, GG,
-					      dset, &cvar, &n_c);
-	    }
+    if (opt & OPT_C) {
+	/* clustered */
+	err = qml_cluster_vcv(pmod, ci, H, G, dset, V);
+    } else {
+	/* regular QML using OPG */
+	GG = gretl_matrix_XTX_new(G);
+	if (GG == NULL) {
+	    err = E_ALLOC;
 	} else {
-	    /* regular QML using OPG */
-	    GG = gretl_matrix_XTX_new(G);
-	    if (GG == NULL) {
-		err = E_ALLOC;
-	    }
-	}
-    }
-
-    if (!err) {
-	err = gretl_matrix_qform(H, GRETL_MOD_NONE, GG,
-				 V, GRETL_MOD_NONE);
-	if (!err && (opt & OPT_C)) {
-	    /* clustering: use stata-style df adjustment */
-	    double dfc = n_c / (n_c - 1.0);
-
-	    gretl_matrix_multiply_by_scalar(V, dfc);
+	    err = gretl_matrix_qform(H, GRETL_MOD_NONE, GG,
+				     V, GRETL_MOD_NONE);
 	}
     }
 
@@ -2766,8 +3108,6 @@ int gretl_model_add_QML_vcv (MODEL *pmod, int ci,
 
     if (!err) {
 	if (opt & OPT_C) {
-	    gretl_model_set_int(pmod, "n_clusters", n_c);
-	    gretl_model_set_vcv_info(pmod, VCV_CLUSTER, cvar);
 	    pmod->opt |= OPT_C;
 	} else {
 	    gretl_model_set_vcv_info(pmod, VCV_ML, ML_QML);
@@ -6279,6 +6619,7 @@ void model_list_to_string (int *list, char *buf)
 int highest_numbered_var_in_model (const MODEL *pmod,
 				   const DATASET *dset)
 {
+    const int *xlist;
     int i, v, vmax = 0;
     int gotsep = 0;
 
@@ -6315,6 +6656,12 @@ int highest_numbered_var_in_model (const MODEL *pmod,
     /* clustered standard errors? */
     v = gretl_model_get_cluster_var(pmod);
     if (v > vmax) vmax = v;
+    xlist = gretl_model_get_list(pmod, "cluster_list");
+    if (xlist != NULL) {
+	for (i=1; i<=xlist[0]; i++) {
+	    if (xlist[i] > vmax) vmax = xlist[i];
+	}
+    }
 
     /* auxiliary variables for some model types */
 
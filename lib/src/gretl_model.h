@@ -297,6 +297,19 @@ int gretl_model_get_hc_version (const MODEL *pmod);
 
 int gretl_model_get_cluster_var (const MODEL *pmod);
 
+int *gretl_model_get_cluster_list (int ci, const DATASET *dset,
+				   int *err);
+
+int *gretl_model_cluster_ids (const MODEL *pmod, const int *clist,
+			      int mask, const DATASET *dset,
+			      int *n_c, int *err);
+
+int gretl_cluster_mask_size (int mask);
+
+int gretl_model_cluster_vcv_fixup (gretl_matrix *V);
+
+void gretl_model_set_cluster_info (MODEL *pmod, int *clist, int n_c);
+
 void *gretl_model_get_data (const MODEL *pmod, const char *key);
 
 void *gretl_model_get_data_full (const MODEL *pmod, const char *key,
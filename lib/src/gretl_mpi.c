@@ -20,6 +20,7 @@
 #include "libgretl.h"
 #include "gretl_mpi.h"
 #include "gretl_typemap.h"
+#include "gretl_gbin.h"
 #include <mpi.h>
 
 #ifdef WIN32
@@ -79,15 +80,16 @@ enum {
     TAG_SCALAR_VAL,
     TAG_INT_VAL,
     TAG_ARRAY_LEN,
-    TAG_SERIES_LEN,
-    TAG_SERIES_VAL,
     TAG_LIST_LEN,
     TAG_LIST_VAL,
     TAG_STR_LEN,
     TAG_STR_VAL,
-    TAG_BMEMB_INFO,
     TAG_ARRAY_INFO,
-    TAG_BUNDLE_SIZE
+    TAG_BUNDLE_SIZE,
+    TAG_PACKED_DATA,
+    TAG_PACKED_STATUS,
+    TAG_NB_HEADER,
+    TAG_NB_DATA  /* must come last: see gretl_mpi_isend() */
 };
 
 #define MI_LEN 5 /* matrix info length */
@@ -107,20 +109,28 @@ static int (*mpi_reduce) (void *, void *, int, MPI_Datatype, MPI_Op,
 			  int, MPI_Comm);
 static int (*mpi_allreduce) (void *, void *, int, MPI_Datatype, MPI_Op,
 			     MPI_Comm);
+static int (*mpi_gatherv) (void *, int, MPI_Datatype, void *, int *,
+			   int *, MPI_Datatype, int, MPI_Comm);
+static int (*mpi_allgather) (void *, int, MPI_Datatype, void *, int,
+			     MPI_Datatype, MPI_Comm);
+static int (*mpi_allgatherv) (void *, int, MPI_Datatype, void *, int *,
+			      int *, MPI_Datatype, MPI_Comm);
 static int (*mpi_bcast) (void *, int, MPI_Datatype, int, MPI_Comm);
 static int (*mpi_send) (void *, int, MPI_Datatype, int, int, MPI_Comm);
 static int (*mpi_recv) (void *, int, MPI_Datatype, int, int, MPI_Comm,
 			MPI_Status *);
+static int (*mpi_isend) (void *, int, MPI_Datatype, int, int, MPI_Comm,
+			 MPI_Request *);
+static int (*mpi_irecv) (void *, int, MPI_Datatype, int, int, MPI_Comm,
+			 MPI_Request *);
+static int (*mpi_waitall) (int, MPI_Request *, MPI_Status *);
+static int (*mpi_testall) (int, MPI_Request *, int *, MPI_Status *);
+static int (*mpi_cancel) (MPI_Request *);
 static int (*mpi_barrier) (MPI_Comm);
 static int (*mpi_probe) (int, int, MPI_Comm, MPI_Status *);
 static double (*mpi_wtime) (void);
 static int (*mpi_initialized) (int *);
 
-static int gretl_matrix_bcast (gretl_matrix **pm, int id, int root);
-static int gretl_array_bcast (gretl_array **pa, int id, int root);
-static int gretl_bundle_send (gretl_bundle *b, int dest);
-static gretl_bundle *gretl_bundle_receive (int source, int *err);
-
 static void *mpi_receive_element (int source, GretlType etype,
 				  int *err);
 
@@ -175,9 +185,17 @@ int gretl_MPI_init (void)
     mpi_error_string = mpiget(MPIhandle, "MPI_Error_string", &err);
     mpi_reduce       = mpiget(MPIhandle, "MPI_Reduce", &err);
     mpi_allreduce    = mpiget(MPIhandle, "MPI_Allreduce", &err);
+    mpi_gatherv      = mpiget(MPIhandle, "MPI_Gatherv", &err);
+    mpi_allgather    = mpiget(MPIhandle, "MPI_Allgather", &err);
+    mpi_allgatherv   = mpiget(MPIhandle, "MPI_Allgatherv", &err);
     mpi_bcast        = mpiget(MPIhandle, "MPI_Bcast", &err);
     mpi_send         = mpiget(MPIhandle, "MPI_Send", &err);
     mpi_recv         = mpiget(MPIhandle, "MPI_Recv", &err);
+    mpi_isend        = mpiget(MPIhandle, "MPI_Isend", &err);
+    mpi_irecv        = mpiget(MPIhandle, "MPI_Irecv", &err);
+    mpi_waitall      = mpiget(MPIhandle, "MPI_Waitall", &err);
+    mpi_testall      = mpiget(MPIhandle, "MPI_Testall", &err);
+    mpi_cancel       = mpiget(MPIhandle, "MPI_Cancel", &err);
     mpi_probe        = mpiget(MPIhandle, "MPI_Probe", &err);
     mpi_barrier      = mpiget(MPIhandle, "MPI_Barrier", &err);
     mpi_wtime        = mpiget(MPIhandle, "MPI_Wtime", &err);
@@ -316,20 +334,16 @@ static void fill_matrix_info (int *rc, const gretl_matrix *m)
 
 static int matrix_reduce_alloc (int *rows, int *cols,
 				int n, Gretl_MPI_Op op,
-				gretl_matrix **pm,
-				double **px)
+				gretl_matrix **pm)
 {
     int rtotal = 0, ctotal = 0;
     int i, err = 0;
 
     /* Note: in the arrays @rows and @cols the elements 0 to
        n-1 are the values for each node, and the elements n
-       are the maxima.
-
-       The tasks here are (a) to allocate a matrix of the right
-       size to hold the result of the "reduce" operation and (b)
-       to allocate workspace big enough to hold the values of
-       the largest individual matrix.
+       are the maxima. The task here is to allocate a matrix
+       of the right size to hold the result of the "reduce"
+       operation.
     */
 
     if (op == GRETL_MPI_SUM || op == GRETL_MPI_PROD) {
@@ -361,21 +375,9 @@ static int matrix_reduce_alloc (int *rows, int *cols,
 
     if (rtotal == 0 || ctotal == 0) {
 	err = E_DATA;
-    } else if (op == GRETL_MPI_PROD) {
-	*pm = gretl_unit_matrix_new(rtotal, ctotal);
-    } else {
-	*pm = gretl_zero_matrix_new(rtotal, ctotal);
-    }
-
-    if (*pm == NULL) {
-	err = E_ALLOC;
     } else {
-	size_t xsize = rows[n] * cols[n];
-
-	*px = malloc(xsize * sizeof **px);
-	if (*px == NULL) {
-	    gretl_matrix_free(*pm);
-	    *pm = NULL;
+	*pm = gretl_matrix_alloc(rtotal, ctotal);
+	if (*pm == NULL) {
 	    err = E_ALLOC;
 	}
     }
@@ -383,44 +385,27 @@ static int matrix_reduce_alloc (int *rows, int *cols,
     return err;
 }
 
-static int matrix_reduce_step (gretl_matrix *mtarg,
-			       double * restrict src,
-			       int n, Gretl_MPI_Op op,
-			       int *offset)
-{
-    double * restrict targ = mtarg->val;
-    int i;
+/* Write the @n values in @src, which represent a matrix
+   having the same number of columns as @mtarg, into @mtarg
+   starting at row *offset, and advance the offset.
+*/
 
-    if (op == GRETL_MPI_SUM) {
-	for (i=0; i<n; i++) {
-	    targ[i] += src[i];
-	}
-    } else if (op == GRETL_MPI_PROD) {
-	for (i=0; i<n; i++) {
-	    targ[i] *= src[i];
-	}
-    } else if (op == GRETL_MPI_HCAT) {
-	int k = *offset;
+static void matrix_vcat_step (gretl_matrix *mtarg,
+			      const double * restrict src,
+			      int n, int *offset)
+{
+    int rmin = *offset;
+    int nrows = n / mtarg->cols;
+    int rmax = rmin + nrows;
+    int i, j, k = 0;
 
-	for (i=0; i<n; i++) {
-	    targ[k++] = src[i];
-	}
-	*offset = k;
-    } else if (op == GRETL_MPI_VCAT) {
-	int rmin = *offset;
-	int nrows = n / mtarg->cols;
-	int rmax = rmin + nrows;
-	int j, k = 0;
-
-	for (j=0; j<mtarg->cols; j++) {
-	    for (i=rmin; i<rmax; i++) {
-		gretl_matrix_set(mtarg, i, j, src[k++]);
-	    }
+    for (j=0; j<mtarg->cols; j++) {
+	for (i=rmin; i<rmax; i++) {
+	    gretl_matrix_set(mtarg, i, j, src[k++]);
 	}
-	*offset += nrows;
     }
 
-    return 0;
+    *offset += nrows;
 }
 
 static int invalid_rank_error (int r)
@@ -448,6 +433,188 @@ static int gretl_comm_check (int root, int *idp, int *npp)
     return 0;
 }
 
+/* To be called by all processes at the same point, ahead of a
+   collective operation which a process can't join if it has
+   hit a local error (typically, failure to allocate a buffer):
+   otherwise the other processes would be left waiting. The
+   processes agree on the outcome via a single reduction: the
+   return value is @err if non-zero, else the largest error
+   code reported by any other process, or 0 if all is well.
+*/
+
+static int mpi_agree_on_error (int err)
+{
+    int myval = -err, minval = 0;
+    int mpierr;
+
+    mpierr = mpi_allreduce(&myval, &minval, 1, mpi_int, mpi_min,
+			   mpi_comm_world);
+    if (mpierr) {
+	gretl_mpi_error(&mpierr);
+	return mpierr;
+    }
+
+    return err ? err : -minval;
+}
+
+/* sum or Hadamard product of conformable matrices: a single
+   MPI reduction, with the result at @root, or at all processes
+   if @all is non-zero. Processes holding null matrices
+   contribute the identity element for @op.
+*/
+
+static int matrix_reduce_elementwise (const gretl_matrix *sm,
+				      gretl_matrix *rm,
+				      int *rows, int *cols, int np,
+				      Gretl_MPI_Op op, int root,
+				      int all)
+{
+    MPI_Op mpi_op = (op == GRETL_MPI_PROD)? mpi_prod : mpi_sum;
+    int n = rows[np] * cols[np];
+    double *sendbuf = NULL, *tmp = NULL;
+    int err = 0;
+
+    if (sm != NULL && sm->rows * sm->cols == n) {
+	sendbuf = sm->val;
+    } else {
+	double x0 = (op == GRETL_MPI_PROD)? 1.0 : 0.0;
+	int i;
+
+	tmp = malloc(n * sizeof *tmp);
+	if (tmp == NULL) {
+	    err = E_ALLOC;
+	} else {
+	    for (i=0; i<n; i++) {
+		tmp[i] = x0;
+	    }
+	    sendbuf = tmp;
+	}
+    }
+
+    err = mpi_agree_on_error(err);
+    if (err) {
+	free(tmp);
+	return err;
+    }
+
+    if (all) {
+	err = mpi_allreduce(sendbuf, rm->val, n, mpi_double, mpi_op,
+			    mpi_comm_world);
+    } else {
+	err = mpi_reduce(sendbuf, rm != NULL ? rm->val : NULL, n,
+			 mpi_double, mpi_op, root, mpi_comm_world);
+    }
+
+    free(tmp);
+
+    if (err) {
+	gretl_mpi_error(&err);
+    }
+
+    return err;
+}
+
+/* horizontal or vertical concatenation: a single gather
+   operation, to @root or to all processes. Given column-major
+   storage the blocks for "hcat" can be gathered straight into
+   the target matrix; for "vcat" they have to be rearranged.
+*/
+
+static int matrix_reduce_concat (const gretl_matrix *sm,
+				 gretl_matrix *rm,
+				 int *rows, int *cols, int np,
+				 Gretl_MPI_Op op, int id,
+				 int root, int all)
+{
+    double *recvbuf = NULL;
+    double *tmp = NULL;
+    double *sendbuf;
+    int *counts, *displs;
+    guint64 total = 0;
+    int i, err = 0;
+
+    counts = malloc(2 * np * sizeof *counts);
+    err = mpi_agree_on_error(counts == NULL ? E_ALLOC : 0);
+    if (err) {
+	free(counts);
+	return err;
+    }
+
+    displs = counts + np;
+
+    for (i=0; i<np; i++) {
+	counts[i] = rows[i] * cols[i];
+	displs[i] = (int) total;
+	total += counts[i];
+    }
+
+    if (total > INT_MAX) {
+	/* too big for MPI's int displacements */
+	err = E_DATA;
+    } else {
+	if (rm != NULL) {
+	    if (op == GRETL_MPI_HCAT) {
+		recvbuf = rm->val;
+	    } else {
+		recvbuf = tmp = malloc(total * sizeof *tmp);
+		if (tmp == NULL) {
+		    err = E_ALLOC;
+		}
+	    }
+	}
+	err = mpi_agree_on_error(err);
+    }
+
+    if (!err) {
+	sendbuf = counts[id] > 0 ? sm->val : NULL;
+	if (all) {
+	    err = mpi_allgatherv(sendbuf, counts[id], mpi_double,
+				 recvbuf, counts, displs, mpi_double,
+				 mpi_comm_world);
+	} else {
+	    err = mpi_gatherv(sendbuf, counts[id], mpi_double,
+			      recvbuf, counts, displs, mpi_double,
+			      root, mpi_comm_world);
+	}
+	if (err) {
+	    gretl_mpi_error(&err);
+	}
+    }
+
+    if (!err && tmp != NULL) {
+	int offset = 0;
+
+	for (i=0; i<np; i++) {
+	    if (counts[i] > 0) {
+		matrix_vcat_step(rm, tmp + displs[i], counts[i],
+				 &offset);
+	    }
+	}
+    }
+
+    free(tmp);
+    free(counts);
+
+    return err;
+}
+
+/**
+ * gretl_matrix_mpi_reduce:
+ * @sm: the matrix contributed by the current process (may be NULL).
+ * @pm: location to receive the result.
+ * @op: the reduction operation: sum, prod, hcat or vcat.
+ * @root: the rank of the root process.
+ * @opt: may include OPT_A ("all") to have the result delivered
+ * to every process rather than just @root.
+ *
+ * Must be called by all processes. The dimensions of the
+ * matrices are exchanged first, so that every process can
+ * check conformability and agree on the outcome; the data
+ * are then combined by a single MPI collective operation.
+ *
+ * Returns: 0 on successful completion, non-zero code otherwise.
+ **/
+
 int gretl_matrix_mpi_reduce (gretl_matrix *sm,
 			     gretl_matrix **pm,
 			     Gretl_MPI_Op op,
@@ -455,11 +622,12 @@ int gretl_matrix_mpi_reduce (gretl_matrix *sm,
 			     gretlopt opt)
 {
     gretl_matrix *rm = NULL;
-    double *val = NULL;
+    int *info = NULL;
     int *rows = NULL;
     int *cols = NULL;
     int rc[MI_LEN] = {0};
-    int id, np;
+    int all = (opt & OPT_A)? 1 : 0;
+    int i, id, np;
     int err = 0;
 
     if (op != GRETL_MPI_SUM &&
@@ -474,106 +642,69 @@ int gretl_matrix_mpi_reduce (gretl_matrix *sm,
 	return err;
     }
 
-    if (id != root) {
-	/* send matrix dimensions to root */
-	fill_matrix_info(rc, sm);
-	err = mpi_send(rc, MI_LEN, mpi_int, root, TAG_MATRIX_INFO,
-		       mpi_comm_world);
-    } else {
-	/* root: gather dimensions from other processes,
-	   check for conformability and allocate storage
-	*/
-	int i;
-
-	rows = malloc((np+1) * sizeof *rows);
-	cols = malloc((np+1) * sizeof *cols);
-	if (rows == NULL || cols == NULL) {
-	    err = E_ALLOC;
-	}
+    info = malloc(np * MI_LEN * sizeof *info);
+    rows = malloc((np+1) * sizeof *rows);
+    cols = malloc((np+1) * sizeof *cols);
+    if (info == NULL || rows == NULL || cols == NULL) {
+	err = E_ALLOC;
+    }
 
-	/* initialize record of row/col maxima */
-	rows[np] = 0;
-	cols[np] = 0;
+    err = mpi_agree_on_error(err);
+    if (err) {
+	goto bailout;
+    }
 
-	for (i=0; i<np && !err; i++) {
-	    if (i == root) {
-		if (sm != NULL) {
-		    rows[i] = sm->rows;
-		    cols[i] = sm->cols;
-		} else {
-		    rows[i] = cols[i] = 0;
-		}
-	    } else {
-		err = mpi_recv(rc, MI_LEN, mpi_int, i, TAG_MATRIX_INFO,
-			       mpi_comm_world, MPI_STATUS_IGNORE);
-		if (!err) {
-		    rows[i] = rc[0];
-		    cols[i] = rc[1];
-		}
-	    }
-	}
+    if (sm != NULL) {
+	fill_matrix_info(rc, sm);
+    }
 
-	if (!err) {
-	    err = matrix_dims_check(rows, cols, np, op);
-	}
+    /* everyone gets the dimensions of all the matrices */
+    err = mpi_allgather(rc, MI_LEN, mpi_int, info, MI_LEN, mpi_int,
+			mpi_comm_world);
+    if (err) {
+	gretl_mpi_error(&err);
+	goto bailout;
+    }
 
-	if (!err) {
-	    err = matrix_reduce_alloc(rows, cols, np, op,
-				      &rm, &val);
-	}
+    for (i=0; i<np; i++) {
+	rows[i] = info[i*MI_LEN];
+	cols[i] = info[i*MI_LEN+1];
     }
 
-    if (!err) {
-	if (id != root) {
-	    /* send data to root */
-	    int sendsize = rc[0] * rc[1];
+    /* initialize record of row/col maxima */
+    rows[np] = 0;
+    cols[np] = 0;
 
-	    if (sendsize > 0) {
-		err = mpi_send(sm->val, sendsize, mpi_double, root,
-			       TAG_MATRIX_VAL, mpi_comm_world);
-	    }
-	} else {
-	    /* root gathers and processes data */
-	    int i, recvsize, offset = 0;
+    err = matrix_dims_check(rows, cols, np, op);
 
-	    for (i=0; i<np && !err; i++) {
-		recvsize = rows[i] * cols[i];
-		if (recvsize == 0) {
-		    continue;
-		}
-		if (i == root) {
-		    if (sm != NULL) {
-			err = matrix_reduce_step(rm, sm->val, recvsize, op,
-						 &offset);
-		    }
-		} else {
-		    err = mpi_recv(val, recvsize, mpi_double, i,
-				   TAG_MATRIX_VAL,  mpi_comm_world,
-				   MPI_STATUS_IGNORE);
-		    if (!err) {
-			err = matrix_reduce_step(rm, val, recvsize, op,
-						 &offset);
-		    }
-		}
-	    }
+    if (!err) {
+	if (all || id == root) {
+	    err = matrix_reduce_alloc(rows, cols, np, op, &rm);
 	}
+	err = mpi_agree_on_error(err);
     }
 
-    if (id == root) {
-	/* clean up */
-	free(val);
-	free(rows);
-	free(cols);
-	/* handle return value */
-	if (!err) {
-	    *pm = rm;
+    if (!err) {
+	if (op == GRETL_MPI_SUM || op == GRETL_MPI_PROD) {
+	    err = matrix_reduce_elementwise(sm, rm, rows, cols, np,
+					    op, root, all);
 	} else {
-	    gretl_matrix_free(rm);
+	    err = matrix_reduce_concat(sm, rm, rows, cols, np,
+				       op, id, root, all);
 	}
     }
 
-    if (!err && (opt & OPT_A)) {
-	err = gretl_matrix_bcast(pm, id, root);
+ bailout:
+
+    free(info);
+    free(rows);
+    free(cols);
+
+    /* handle return value */
+    if (!err && rm != NULL) {
+	*pm = rm;
+    } else {
+	gretl_matrix_free(rm);
     }
 
     return err;
@@ -713,6 +844,163 @@ int gretl_scalar_mpi_reduce (double x,
     return ret;
 }
 
+/**
+ * gretl_scalar_mpi_allgather:
+ * @x: the value contributed by the current process.
+ * @pm: location to receive the result.
+ *
+ * Must be called by all processes. On successful completion
+ * each process gets in @pm a column vector holding the values
+ * of @x in order of rank.
+ *
+ * Returns: 0 on successful completion, non-zero code otherwise.
+ **/
+
+int gretl_scalar_mpi_allgather (double x, gretl_matrix **pm)
+{
+    gretl_matrix *m;
+    int np, err;
+
+    mpi_comm_size(mpi_comm_world, &np);
+
+    m = gretl_matrix_alloc(np, 1);
+    if (m == NULL) {
+	return E_ALLOC;
+    }
+
+    err = mpi_allgather(&x, 1, mpi_double, m->val, 1, mpi_double,
+			mpi_comm_world);
+
+    if (err) {
+	gretl_mpi_error(&err);
+	gretl_matrix_free(m);
+    } else {
+	*pm = m;
+    }
+
+    return err;
+}
+
+/**
+ * gretl_array_mpi_allgather:
+ * @sa: the array contributed by the current process.
+ * @pa: location to receive the result.
+ *
+ * Must be called by all processes. The arrays, which must all
+ * be of the same type, are exchanged in packed form and each
+ * process gets in @pa their concatenation in order of rank.
+ *
+ * Returns: 0 on successful completion, non-zero code otherwise.
+ **/
+
+int gretl_array_mpi_allgather (gretl_array *sa, gretl_array **pa)
+{
+    gretl_array **parts = NULL;
+    gretl_array *a = NULL;
+    char *buf, *recvbuf = NULL;
+    int *counts = NULL;
+    int *displs = NULL;
+    size_t psize = 0;
+    guint64 total = 0;
+    int mysize, ntotal = 0;
+    int i, j, k, np;
+    int err = 0;
+
+    mpi_comm_size(mpi_comm_world, &np);
+
+    buf = gretl_gbin_pack(sa, GRETL_TYPE_ARRAY, &psize, &err);
+    if (!err && psize > INT_MAX) {
+	err = E_DATA;
+    }
+
+    counts = malloc(2 * np * sizeof *counts);
+    if (!err && counts == NULL) {
+	err = E_ALLOC;
+    }
+
+    err = mpi_agree_on_error(err);
+    if (err) {
+	goto bailout;
+    }
+
+    displs = counts + np;
+    mysize = (int) psize;
+
+    err = mpi_allgather(&mysize, 1, mpi_int, counts, 1, mpi_int,
+			mpi_comm_world);
+    if (err) {
+	gretl_mpi_error(&err);
+	goto bailout;
+    }
+
+    for (i=0; i<np; i++) {
+	displs[i] = (int) total;
+	total += counts[i];
+    }
+
+    if (total > INT_MAX) {
+	err = E_DATA;
+    } else {
+	recvbuf = malloc(total);
+	parts = calloc(np, sizeof *parts);
+	if (recvbuf == NULL || parts == NULL) {
+	    err = E_ALLOC;
+	}
+	err = mpi_agree_on_error(err);
+    }
+
+    if (!err) {
+	err = mpi_allgatherv(buf, mysize, mpi_byte, recvbuf, counts,
+			     displs, mpi_byte, mpi_comm_world);
+	if (err) {
+	    gretl_mpi_error(&err);
+	}
+    }
+
+    for (i=0; i<np && !err; i++) {
+	parts[i] = gretl_gbin_unpack_as(recvbuf + displs[i], counts[i],
+					GRETL_TYPE_ARRAY, &err);
+	if (!err && gretl_array_get_type(parts[i]) !=
+	    gretl_array_get_type(parts[0])) {
+	    err = E_TYPES;
+	}
+	if (!err) {
+	    ntotal += gretl_array_get_length(parts[i]);
+	}
+    }
+
+    if (!err) {
+	a = gretl_array_new(gretl_array_get_type(parts[0]), ntotal, &err);
+    }
+
+    if (!err) {
+	/* transfer the elements to the composite array */
+	for (i=0, k=0; i<np; i++) {
+	    for (j=0; j<gretl_array_get_length(parts[i]); j++) {
+		void *data = gretl_array_get_data(parts[i], j);
+
+		gretl_array_set_data(a, k++, data);
+	    }
+	    gretl_array_nullify_elements(parts[i]);
+	}
+	*pa = a;
+    }
+
+ bailout:
+
+    if (parts != NULL) {
+	for (i=0; i<np; i++) {
+	    gretl_array_destroy(parts[i]);
+	}
+	free(parts);
+    }
+    free(recvbuf);
+    free(counts);
+    free(buf);
+
+    return err;
+}
+
 static void maybe_date_matrix (gretl_matrix *m, int *rc)
 {
     if (rc[3] >= 0 && rc[4] >= rc[3]) {
@@ -777,40 +1065,7 @@ static int gretl_matrix_bcast (gretl_matrix **pm, int id, int root)
     return err;
 }
 
-static int gretl_series_bcast (double **px, int len,
-			       int id, int root)
-{
-    double *x = NULL;
-    int err = 0;
-
-    if (id == root) {
-	x = *px;
-	if (x == NULL) {
-	    return E_DATA;
-	}
-    } else {
-	/* everyone else needs to allocate space */
-	x = malloc(len * sizeof *x);
-	if (x == NULL) {
-	    return E_ALLOC;
-	}
-    }
-
-    if (!err) {
-	/* broadcast the series */
-	err = mpi_bcast(x, len, mpi_double, root, mpi_comm_world);
-    }
-
-    if (err) {
-	gretl_mpi_error(&err);
-    } else if (id != root) {
-	*px = x;
-    }
-
-    return err;
-}
-
-static int gretl_list_bcast (int **plist, int id, int root)
+static int gretl_list_bcast (int **plist, int id, int root)
 {
     int *list = NULL;
     int len = 0;
@@ -929,263 +1184,192 @@ static int gretl_unsigned_bcast (unsigned int *pu, int root)
     return err;
 }
 
-/* Compose a message indicating the type (and size, if
-   applicable) of a bundle member to be passed via MPI.
+/* Bundles and arrays are passed via MPI in packed form: the
+   sender serializes the object into a single buffer in gretl's
+   binary format (see gretl_gbin.c); the size of the buffer is
+   passed first, then its content, which the receiver unpacks.
+   So the cost no longer depends on the number of members.
 */
 
-static int compose_msgbuf (char *buf, GretlType type,
-			   const char *key, int *size,
-			   void *data)
-{
-    int n = 0;
+#define PACKED_CHUNK (1 << 30) /* max bytes per message */
 
-    if (type == GRETL_TYPE_DOUBLE) {
-	n = sizeof(double);
-    } else if (type == GRETL_TYPE_INT) {
-	n = sizeof(int);
-    } else if (type == GRETL_TYPE_UNSIGNED) {
-	n = sizeof(unsigned int);
-    } else if (type == GRETL_TYPE_SERIES) {
-	n = *size;
-    } else if (type == GRETL_TYPE_STRING) {
-	char *s = data;
-	n = strlen(s) + 1;
-    } else if (type == GRETL_TYPE_LIST) {
-	int *list = data;
-	n = (list[0] + 1) * sizeof(int);
-    } else if (type == GRETL_TYPE_MATRIX ||
-	       type == GRETL_TYPE_BUNDLE ||
-	       type == GRETL_TYPE_ARRAY) {
-	n = 0;
-    } else {
-	return E_DATA;
-    }
-
-    sprintf(buf, "%d %s %d", type, key, n);
-    *size = n;
+static int gretl_packed_bcast (void **pptr, GretlType type,
+			       int id, int root)
+{
+    char *buf = NULL;
+    guint64 size = 0;
+    int mpierr, err = 0;
 
-    return 0;
-}
+    if (id == root) {
+	size_t psize = 0;
 
-/* Parse the information sent in @buf by root, regarding a
-   bundle member.
-*/
+	buf = gretl_gbin_pack(*pptr, type, &psize, &err);
+	size = psize;
+    }
 
-static int parse_msgbuf (const char *buf, char *key,
-			 GretlType *type, int *size)
-{
-    int t;
+    /* broadcast the size first: zero signals failure on root */
+    mpierr = mpi_bcast(&size, sizeof size, mpi_byte, root,
+		       mpi_comm_world);
 
-    if (sscanf(buf, "%d %s %d", &t, key, size) != 3) {
-	return E_DATA;
+    if (mpierr) {
+	err = mpierr;
+	gretl_mpi_error(&err);
+    } else if (size == 0) {
+	if (!err) {
+	    err = E_DATA;
+	}
     } else {
-	*type = t;
-	return 0;
+	int ok, all_ok = 0;
+
+	if (id != root) {
+	    /* everyone but root needs to allocate space */
+	    buf = malloc(size);
+	}
+	/* all must agree on going ahead, else some would be left
+	   waiting in the broadcast of the content */
+	ok = (buf != NULL);
+	mpierr = mpi_allreduce(&ok, &all_ok, 1, mpi_int, mpi_min,
+			       mpi_comm_world);
+	if (mpierr) {
+	    err = mpierr;
+	    gretl_mpi_error(&err);
+	} else if (!all_ok) {
+	    err = E_ALLOC;
+	}
     }
-}
 
-static int gretl_bundle_bcast (gretl_bundle **pb,
-			       int id, int root)
-{
-    gretl_bundle *b = NULL;
-    gretl_matrix *m = NULL;
-    gretl_array *a = NULL;
-    gretl_bundle *bsub = NULL;
-    gretl_array *keys = NULL;
-    double *x = NULL;
-    GretlType type;
-    char key[32];
-    void *data;
-    char msgbuf[64];
-    int msglen;
-    int size;
-    int i, nk;
-    int err = 0;
+    if (!err) {
+	/* broadcast the packed object */
+	guint64 offset, n;
 
-    if (id == root) {
-	b = *pb;
-	nk = gretl_bundle_get_n_keys(b);
-	keys = gretl_bundle_get_keys(b, &err);
-	if (err) {
-	    return err;
+	for (offset=0; offset<size && !mpierr; offset+=n) {
+	    n = MIN(size - offset, PACKED_CHUNK);
+	    mpierr = mpi_bcast(buf + offset, (int) n, mpi_byte, root,
+			       mpi_comm_world);
+	}
+	if (mpierr) {
+	    err = mpierr;
+	    gretl_mpi_error(&err);
 	}
     }
 
-    /* broadcast the number of keys first */
-    err = mpi_bcast(&nk, 1, mpi_int, root, mpi_comm_world);
-
     if (!err && id != root) {
-	/* everyone but root needs to start a bundle */
-	b = gretl_bundle_new();
-	if (b == NULL) {
-	    return E_ALLOC;
-	}
+	*pptr = gretl_gbin_unpack_as(buf, size, type, &err);
     }
 
-    msglen = sizeof msgbuf;
+    free(buf);
 
-    for (i=0; i<nk && !err; i++) {
-	/* loop across bundle keys */
-	memset(msgbuf, 0, msglen);
-	size = 0;
-	data = NULL;
-	m = NULL;
-	a = NULL;
-	bsub = NULL;
-	x = NULL;
+    return err;
+}
 
-	if (id == root) {
-	    const char *rkey = gretl_array_get_data(keys, i);
+/* Send a bundle or array in packed form: the message carrying
+   the size is tagged by type, so that gretl_mpi_receive() can
+   tell what's coming. A size of zero signals failure to pack
+   the object. Otherwise the receiver tells us whether it was
+   able to allocate space, and the content follows only if so.
+*/
 
-	    data = gretl_bundle_get_data(b, rkey, &type, &size, &err);
-	    if (!err) {
-		compose_msgbuf(msgbuf, type, rkey, &size, data);
-		if (type == GRETL_TYPE_MATRIX) {
-		    m = (gretl_matrix *) data;
-		} else if (type == GRETL_TYPE_ARRAY) {
-		    a = (gretl_array *) data;
-		} else if (type == GRETL_TYPE_BUNDLE) {
-		    bsub = (gretl_bundle *) data;
-		} else if (type == GRETL_TYPE_SERIES) {
-		    x = (double *) data;
-		}
-	    }
-	}
-	if (!err) {
-	    /* broadcast info on the bundle member */
-	    err = mpi_bcast(msgbuf, msglen, mpi_byte, root, mpi_comm_world);
-	}
-	if (!err) {
-	    err = parse_msgbuf(msgbuf, key, &type, &size);
-	}
-	if (err) {
-	    break;
-	}
-	if (type == GRETL_TYPE_MATRIX) {
-	    err = gretl_matrix_bcast(&m, id, root);
-	    if (!err && id != root) {
-		err = gretl_bundle_donate_data(b, key, m, type, 0);
-	    }
-	} else if (type == GRETL_TYPE_ARRAY) {
-	    err = gretl_array_bcast(&a, id, root);
-	    if (!err && id != root) {
-		err = gretl_bundle_donate_data(b, key, a, type, 0);
-	    }
-	} else if (type == GRETL_TYPE_BUNDLE) {
-	    err = gretl_bundle_bcast(&bsub, id, root);
-	    if (!err && id != root) {
-		err = gretl_bundle_donate_data(b, key, bsub, type, 0);
-	    }
-	} else if (type == GRETL_TYPE_SERIES) {
-	    err = gretl_series_bcast(&x, size, id, root);
-	    if (!err && id != root) {
-		err = gretl_bundle_donate_data(b, key, x, type, size);
-	    }
-	} else {
-	    /* scalar, string or list */
-	    if (id != root) {
-		data = calloc(size, 1);
-		if (data == NULL) {
-		    err = E_ALLOC;
-		}
-	    }
-	    err = mpi_bcast(data, size, mpi_byte, root, mpi_comm_world);
-	    if (!err && id != root && data != NULL) {
-		if (gretl_is_scalar_type(type)) {
-		    err = gretl_bundle_set_data(b, key, data, type, 0);
-		    free(data);
-		} else {
-		    err = gretl_bundle_donate_data(b, key, data, type, 0);
-		}
-	    }
-	}
+static int gretl_packed_send (void *ptr, GretlType type, int dest)
+{
+    int tag = (type == GRETL_TYPE_BUNDLE)? TAG_BUNDLE_SIZE :
+	TAG_ARRAY_INFO;
+    guint64 offset, n, size;
+    size_t psize = 0;
+    char *buf;
+    int ok = 0;
+    int err = 0;
+
+    buf = gretl_gbin_pack(ptr, type, &psize, &err);
+    if (err) {
+	/* don't leave the receiver waiting for the size */
+	size = 0;
+	mpi_send(&size, sizeof size, mpi_byte, dest, tag,
+		 mpi_comm_world);
+	return err;
     }
 
-    gretl_array_destroy(keys);
+    size = psize;
+    err = mpi_send(&size, sizeof size, mpi_byte, dest, tag,
+		   mpi_comm_world);
+    if (!err) {
+	err = mpi_recv(&ok, 1, mpi_int, dest, TAG_PACKED_STATUS,
+		       mpi_comm_world, MPI_STATUS_IGNORE);
+    }
 
-    mpi_barrier(mpi_comm_world);
+    for (offset=0; offset<size && ok && !err; offset+=n) {
+	n = MIN(size - offset, PACKED_CHUNK);
+	err = mpi_send(buf + offset, (int) n, mpi_byte, dest,
+		       TAG_PACKED_DATA, mpi_comm_world);
+    }
+
+    free(buf);
 
     if (err) {
 	gretl_mpi_error(&err);
-    } else if (id != root) {
-	*pb = b;
+    } else if (!ok) {
+	gretl_errmsg_sprintf(_("MPI process %d failed to receive data"),
+			     dest);
+	err = E_ALLOC;
     }
 
     return err;
 }
 
-static int gretl_array_bcast (gretl_array **pa, int id, int root)
+static void *gretl_packed_receive (int source, GretlType type,
+				   int *err)
 {
-    gretl_array *a = NULL;
-    GretlType type = 0;
-    int nelem = 0;
-    int st[2];
-    int i, err = 0;
+    int tag = (type == GRETL_TYPE_BUNDLE)? TAG_BUNDLE_SIZE :
+	TAG_ARRAY_INFO;
+    guint64 offset, n, size = 0;
+    void *ret = NULL;
+    char *buf;
+    int ok;
 
-    if (id == root) {
-	a = *pa;
-	st[0] = nelem = gretl_array_get_length(a);
-	st[1] = type = gretl_array_get_type(a);
+    /* get the size of the packed object */
+    *err = mpi_recv(&size, sizeof size, mpi_byte, source, tag,
+		    mpi_comm_world, MPI_STATUS_IGNORE);
+    if (*err) {
+	gretl_mpi_error(err);
+	return NULL;
+    } else if (size == 0) {
+	/* the sender failed to pack the object */
+	gretl_errmsg_sprintf(_("MPI process %d failed to send data"),
+			     source);
+	*err = E_DATA;
+	return NULL;
     }
 
-    /* broadcast the array size and type */
-    err = mpi_bcast(st, 2, mpi_int, root, mpi_comm_world);
-
-    if (!err && id != root) {
-	/* everyone but root needs to allocate an array */
-	nelem = st[0];
-	type = st[1];
-	*pa = a = gretl_array_new(type, nelem, &err);
+    /* tell the sender whether to go ahead: otherwise it would
+       be left blocking on sending the content */
+    buf = malloc(size);
+    ok = (buf != NULL);
+    *err = mpi_send(&ok, 1, mpi_int, source, TAG_PACKED_STATUS,
+		    mpi_comm_world);
+    if (*err) {
+	gretl_mpi_error(err);
+	free(buf);
+	return NULL;
+    } else if (!ok) {
+	*err = E_ALLOC;
+	return NULL;
     }
 
-    for (i=0; i<nelem && !err; i++) {
-	void *ptr, *data = NULL;
-
-	if (id == root) {
-	    data = gretl_array_get_data(a, i);
-	}
-	ptr = &data;
-	if (type == GRETL_TYPE_MATRICES) {
-	    err = gretl_matrix_bcast(ptr, id, root);
-	    if (id != root) {
-		data = *(gretl_matrix **) ptr;
-	    }
-	} else if (type == GRETL_TYPE_STRINGS) {
-	    err = gretl_string_bcast(ptr, id, root);
-	    if (id != root) {
-		data = *(char **) ptr;
-	    }
-	} else if (type == GRETL_TYPE_BUNDLES) {
-	    err = gretl_bundle_bcast(ptr, id, root);
-	    if (id != root) {
-		data = *(gretl_bundle **) ptr;
-	    }
-	} else if (type == GRETL_TYPE_LISTS) {
-	    err = gretl_list_bcast(ptr, id, root);
-	    if (id != root) {
-		data = *(int **) ptr;
-	    }
-	} else if (type == GRETL_TYPE_ARRAYS) {
-	    err = gretl_array_bcast(ptr, id, root);
-	    if (id != root) {
-		data = *(gretl_array **) ptr;
-	    }
-	} else {
-	    /* ?? */
-	    err = E_TYPES;
-	}
-	if (!err && id != root) {
-	    gretl_array_set_data(a, i, data);
-	}
+    for (offset=0; offset<size && !*err; offset+=n) {
+	n = MIN(size - offset, PACKED_CHUNK);
+	*err = mpi_recv(buf + offset, (int) n, mpi_byte, source,
+			TAG_PACKED_DATA, mpi_comm_world,
+			MPI_STATUS_IGNORE);
     }
 
-    mpi_barrier(mpi_comm_world);
-
-    if (err) {
-	gretl_mpi_error(&err);
+    if (*err) {
+	gretl_mpi_error(err);
+    } else {
+	ret = gretl_gbin_unpack_as(buf, size, type, err);
     }
 
-    return err;
+    free(buf);
+
+    return ret;
 }
 
 int gretl_mpi_barrier (void)
@@ -1226,10 +1410,8 @@ int gretl_mpi_bcast (void *p, GretlType type, int root)
 	return gretl_unsigned_bcast((unsigned int *) p, root);
     } else if (type == GRETL_TYPE_MATRIX) {
 	return gretl_matrix_bcast((gretl_matrix **) p, id, root);
-    } else if (type == GRETL_TYPE_BUNDLE) {
-	return gretl_bundle_bcast((gretl_bundle **) p, id, root);
-    } else if (type == GRETL_TYPE_ARRAY) {
-	return gretl_array_bcast((gretl_array **) p, id, root);
+    } else if (type == GRETL_TYPE_BUNDLE || type == GRETL_TYPE_ARRAY) {
+	return gretl_packed_bcast((void **) p, type, id, root);
     } else if (type == GRETL_TYPE_STRING) {
 	return gretl_string_bcast((char **) p, id, root);
     } else if (type == GRETL_TYPE_LIST) {
@@ -1338,43 +1520,6 @@ static int gretl_int_send (int *pi, int dest)
     return err;
 }
 
-static int gretl_array_send (gretl_array *a, int dest)
-{
-    GretlType type = 0;
-    int nelem = 0;
-    int st[2];
-    int i, err = 0;
-
-    st[0] = nelem = gretl_array_get_length(a);
-    st[1] = type = gretl_array_get_type(a);
-
-    /* send the array size and type */
-    err = mpi_send(st, 2, mpi_int, dest, TAG_ARRAY_INFO,
-		   mpi_comm_world);
-
-    for (i=0; i<nelem && !err; i++) {
-	void *data = gretl_array_get_data(a, i);
-
-	if (type == GRETL_TYPE_MATRICES) {
-	    err = gretl_matrix_mpi_send(data, dest);
-	} else if (type == GRETL_TYPE_STRINGS) {
-	    err = gretl_string_send(data, dest);
-	} else if (type == GRETL_TYPE_BUNDLES) {
-	    err = gretl_bundle_send(data, dest);
-	} else if (type == GRETL_TYPE_LISTS) {
-	    err = gretl_list_send(data, dest);
-	} else if (type == GRETL_TYPE_ARRAYS) {
-	    err = gretl_array_send(data, dest);
-	}
-    }
-
-    if (err) {
-	gretl_mpi_error(&err);
-    }
-
-    return err;
-}
-
 /**
  * gretl_mpi_send:
  * @p: pointer to the object to be sent.
@@ -1402,10 +1547,8 @@ int gretl_mpi_send (void *p, GretlType type, int dest)
 	return gretl_int_send((int *) p, dest);
     } else if (type == GRETL_TYPE_MATRIX) {
 	return gretl_matrix_mpi_send((gretl_matrix *) p, dest);
-    } else if (type == GRETL_TYPE_BUNDLE) {
-	return gretl_bundle_send((gretl_bundle *) p, dest);
-    } else if (type == GRETL_TYPE_ARRAY) {
-	return gretl_array_send((gretl_array *) p, dest);
+    } else if (type == GRETL_TYPE_BUNDLE || type == GRETL_TYPE_ARRAY) {
+	return gretl_packed_send(p, type, dest);
     } else if (type == GRETL_TYPE_STRING) {
 	return gretl_string_send((char *) p, dest);
     } else if (type == GRETL_TYPE_LIST) {
@@ -1580,46 +1723,6 @@ static double gretl_int_receive (int source, int *err)
     return i;
 }
 
-static gretl_array *gretl_array_receive (int source, int *err)
-{
-    gretl_array *a = NULL;
-    GretlType type = 0;
-    int nelem = 0;
-    int st[2];
-    int i;
-
-    /* get the array size and type */
-    *err = mpi_recv(st, 2, mpi_int, source, TAG_ARRAY_INFO,
-		    mpi_comm_world, MPI_STATUS_IGNORE);
-
-    if (!*err) {
-	nelem = st[0];
-	type = st[1];
-	a = gretl_array_new(type, nelem, err);
-    }
-
-    for (i=0; i<nelem && !*err; i++) {
-	void *data = NULL;
-
-	if (type == GRETL_TYPE_MATRICES) {
-	    data = gretl_matrix_mpi_receive(source, err);
-	} else if (type == GRETL_TYPE_STRINGS) {
-	    data = gretl_string_receive(source, err);
-	} else if (type == GRETL_TYPE_BUNDLES) {
-	    data = gretl_bundle_receive(source, err);
-	} else if (type == GRETL_TYPE_LISTS) {
-	    data = gretl_list_receive(source, err);
-	} else if (type == GRETL_TYPE_ARRAYS) {
-	    data = gretl_array_receive(source, err);
-	}
-	if (data != NULL) {
-	    gretl_array_set_data(a, i, data);
-	}
-    }
-
-    return a;
-}
-
 static GretlType type_from_status (MPI_Status *status)
 {
     if (status->MPI_TAG == TAG_MATRIX_INFO) {
@@ -1667,10 +1770,8 @@ void *gretl_mpi_receive (int source, GretlType *ptype, int *err)
 	ret = &k;
     } else if (*ptype == GRETL_TYPE_MATRIX) {
 	ret = gretl_matrix_mpi_receive(source, err);
-    } else if (*ptype == GRETL_TYPE_BUNDLE) {
-	ret = gretl_bundle_receive(source, err);
-    } else if (*ptype == GRETL_TYPE_ARRAY) {
-	ret = gretl_array_receive(source, err);
+    } else if (*ptype == GRETL_TYPE_BUNDLE || *ptype == GRETL_TYPE_ARRAY) {
+	ret = gretl_packed_receive(source, *ptype, err);
     } else if (*ptype == GRETL_TYPE_STRING) {
 	ret = gretl_string_receive(source, err);
     } else if (*ptype == GRETL_TYPE_LIST) {
@@ -1696,10 +1797,8 @@ static void *mpi_receive_element (int source, GretlType etype,
 	*err = E_TYPES;
     } else if (etype == GRETL_TYPE_MATRIX) {
 	ret = gretl_matrix_mpi_receive(source, err);
-    } else if (etype == GRETL_TYPE_BUNDLE) {
-	ret = gretl_bundle_receive(source, err);
-    } else if (etype == GRETL_TYPE_ARRAY) {
-	ret = gretl_array_receive(source, err);
+    } else if (etype == GRETL_TYPE_BUNDLE || etype == GRETL_TYPE_ARRAY) {
+	ret = gretl_packed_receive(source, etype, err);
     } else if (etype == GRETL_TYPE_STRING) {
 	ret = gretl_string_receive(source, err);
     } else if (etype == GRETL_TYPE_LIST) {
@@ -1709,117 +1808,319 @@ static void *mpi_receive_element (int source, GretlType etype,
     return ret;
 }
 
-/* "new"-style send/receive for bundles: we do everything
-   in memory */
+/* Nonblocking point-to-point transfers. The object to be sent
+   is packed (see gretl_gbin.c) when gretl_mpi_isend() is called,
+   so the caller is free to modify or destroy it while the
+   transfer is in progress. The sender posts at once a fixed-size
+   header, carrying the size of the packed object and the tag for
+   its content, followed by the content itself, and the send is
+   complete when these requests are. Once the header has arrived
+   the receiver allocates storage and posts the receives for the
+   data. If it can't get the storage it takes delivery of the data
+   anyway, by way of a scratch buffer, so the sender is never left
+   blocked, and reports the failure on its own side.
+
+   A data send may not complete until the receiver has posted the
+   matching receive, which requires that it has seen the header.
+   So while waiting on any transfer we keep checking the headers
+   of all pending receives, and post the data receives for those
+   that have arrived: otherwise two processes that each wait on a
+   send to the other before waiting on their receives would block
+   for ever.
+
+   Each transfer gets its own data tag, so transfers between the
+   same pair of processes cannot get crossed when they're
+   completed out of order. Pending transfers are identified to
+   the caller by a positive integer "handle", an index into the
+   table below. The transfers themselves are allocated one by
+   one, since MPI holds pointers into them (to the header) while
+   their requests are pending.
+*/
+
+/* keeps data tags under the guaranteed MPI_TAG_UB */
+#define NB_TAG_MAX 8192
+
+/* max bytes per data message: this is also the size of the
+   scratch buffer used when the receiver is short of memory */
+#define NB_CHUNK (1 << 22)
+
+enum {
+    NB_SEND = 1,
+    NB_RECV
+};
+
+typedef struct nb_transfer_ nb_transfer;
+
+struct nb_transfer_ {
+    int kind;          /* NB_SEND or NB_RECV */
+    int posted;        /* data receives posted? */
+    int err;           /* failure on the receiving side */
+    guint64 hdr[2];    /* packed size and data tag */
+    char *buf;         /* packed object */
+    MPI_Request *reqs; /* pending requests */
+    int nreq;          /* number of pending requests */
+    int peer;          /* rank of the other process */
+};
+
+static nb_transfer **nb_table;
+static int nb_n;
+static int nb_seq;
+
+static int nb_n_chunks (guint64 size)
+{
+    return (int) ((size + NB_CHUNK - 1) / NB_CHUNK);
+}
+
+static int nb_new_transfer (int kind, int peer, int nreq, int *err)
+{
+    nb_transfer *t;
+    int i;
+
+    for (i=0; i<nb_n; i++) {
+	if (nb_table[i] == NULL) {
+	    break;
+	}
+    }
+
+    if (i == nb_n) {
+	nb_transfer **tt = realloc(nb_table, (nb_n + 8) * sizeof *tt);
+
+	if (tt == NULL) {
+	    *err = E_ALLOC;
+	    return -1;
+	}
+	nb_table = tt;
+	memset(nb_table + nb_n, 0, 8 * sizeof *tt);
+	nb_n += 8;
+    }
+
+    t = calloc(1, sizeof *t);
+    if (t != NULL) {
+	t->reqs = malloc(nreq * sizeof *t->reqs);
+    }
+    if (t == NULL || t->reqs == NULL) {
+	free(t);
+	*err = E_ALLOC;
+	return -1;
+    }
+
+    t->kind = kind;
+    t->peer = peer;
+    nb_table[i] = t;
 
-static int gretl_series_send (double *x, int n, int dest)
+    return i;
+}
+
+/* cancel any pending requests of @t, and wait for them to be
+   either cancelled or completed, so that @t can be freed */
+
+static void nb_cancel_requests (nb_transfer *t)
 {
-    int err;
+    int i;
 
-    err = mpi_send(&n, 1, mpi_int, dest, TAG_SERIES_LEN,
-		   mpi_comm_world);
+    for (i=0; i<t->nreq; i++) {
+	mpi_cancel(&t->reqs[i]);
+    }
+    mpi_waitall(t->nreq, t->reqs, MPI_STATUSES_IGNORE);
+    t->nreq = 0;
+}
 
-    if (!err) {
-	err = mpi_send(x, n, mpi_double, dest, TAG_SERIES_VAL,
-		       mpi_comm_world);
+static void nb_clear_transfer (int k)
+{
+    nb_transfer *t = nb_table[k];
+
+    if (t->nreq > 0) {
+	nb_cancel_requests(t);
     }
+    free(t->buf);
+    free(t->reqs);
+    free(t);
+    nb_table[k] = NULL;
+}
 
-    if (err) {
-	gretl_mpi_error(&err);
+static nb_transfer *nb_get_transfer (int handle, int *err)
+{
+    if (handle < 1 || handle > nb_n || nb_table[handle-1] == NULL) {
+	gretl_errmsg_sprintf(_("Invalid MPI request handle %d"), handle);
+	*err = E_DATA;
+	return NULL;
     }
 
-    return err;
+    return nb_table[handle-1];
 }
 
-static double *gretl_series_receive (int source, int *err)
+/**
+ * gretl_mpi_isend:
+ * @p: pointer to the object to be sent.
+ * @type: the type of the object.
+ * @dest: the MPI rank of the destination.
+ * @err: location to receive error code.
+ *
+ * Starts a nonblocking send of the value referenced by @p, of
+ * gretl type @type, to the MPI process with rank @dest, which
+ * should call gretl_mpi_irecv() to receive it. The transfer
+ * must be completed via gretl_mpi_wait().
+ *
+ * Returns: a positive handle for the transfer, or 0 on failure.
+ **/
+
+int gretl_mpi_isend (void *p, GretlType type, int dest, int *err)
 {
-    double *x = NULL;
-    int n;
+    nb_transfer *t;
+    guint64 offset, n, size;
+    size_t psize = 0;
+    char *buf;
+    int i, k, nc, np;
 
-    *err = mpi_recv(&n, 1, mpi_int, source, TAG_SERIES_LEN,
-		    mpi_comm_world, MPI_STATUS_IGNORE);
+    mpi_comm_size(mpi_comm_world, &np);
+    if (dest < 0 || dest >= np) {
+	*err = invalid_rank_error(dest);
+	return 0;
+    }
 
+    buf = gretl_gbin_pack(p, type, &psize, err);
+    if (*err) {
+	return 0;
+    }
+
+    /* room for the header request, then the data */
+    size = psize;
+    nc = nb_n_chunks(size);
+    k = nb_new_transfer(NB_SEND, dest, nc + 1, err);
+    if (*err) {
+	free(buf);
+	return 0;
+    }
+
+    t = nb_table[k];
+    t->buf = buf;
+    t->hdr[0] = size;
+    t->hdr[1] = TAG_NB_DATA + nb_seq;
+    nb_seq = (nb_seq + 1) % NB_TAG_MAX;
+
+    *err = mpi_isend(t->hdr, sizeof t->hdr, mpi_byte, dest,
+		     TAG_NB_HEADER, mpi_comm_world, &t->reqs[0]);
     if (!*err) {
-	x = malloc(n * sizeof *x);
-	if (x == NULL) {
-	    *err = E_ALLOC;
-	    return NULL;
-	} else {
-	    *err = mpi_recv(x, n, mpi_double, source,
-			    TAG_SERIES_VAL, mpi_comm_world,
-			    MPI_STATUS_IGNORE);
+	t->nreq = 1;
+    }
+
+    for (i=0, offset=0; i<nc && !*err; i++, offset+=n) {
+	n = MIN(size - offset, NB_CHUNK);
+	*err = mpi_isend(buf + offset, (int) n, mpi_byte, dest,
+			 (int) t->hdr[1], mpi_comm_world,
+			 &t->reqs[t->nreq]);
+	if (!*err) {
+	    t->nreq += 1;
 	}
     }
 
     if (*err) {
 	gretl_mpi_error(err);
+	nb_clear_transfer(k);
+	return 0;
     }
 
-    return x;
+    return k + 1;
 }
 
-static int gretl_bundle_send (gretl_bundle *b, int dest)
+/**
+ * gretl_mpi_irecv:
+ * @source: the MPI rank of the sending process.
+ * @err: location to receive error code.
+ *
+ * Starts a nonblocking receive of an object sent via
+ * gretl_mpi_isend() by the process with rank @source. The
+ * object can be retrieved via gretl_mpi_wait().
+ *
+ * Returns: a positive handle for the transfer, or 0 on failure.
+ **/
+
+int gretl_mpi_irecv (int source, int *err)
 {
-    gretl_array *keys = NULL;
-    GretlType type;
-    void *data;
-    char msgbuf[64];
-    int msglen = sizeof msgbuf;
-    int size;
-    int i, nk;
-    int err = 0;
+    nb_transfer *t;
+    int k, np;
 
-    nk = gretl_bundle_get_n_keys(b);
-    if (nk > 0) {
-	keys = gretl_bundle_get_keys(b, &err);
-	if (err) {
-	    return err;
-	}
+    mpi_comm_size(mpi_comm_world, &np);
+    if (source < 0 || source >= np) {
+	*err = invalid_rank_error(source);
+	return 0;
     }
 
-    /* send the number of keys first */
-    err = mpi_send(&nk, 1, mpi_int, dest, TAG_BUNDLE_SIZE,
-		   mpi_comm_world);
+    k = nb_new_transfer(NB_RECV, source, 1, err);
+    if (*err) {
+	return 0;
+    }
+
+    t = nb_table[k];
+    *err = mpi_irecv(t->hdr, sizeof t->hdr, mpi_byte, source,
+		     TAG_NB_HEADER, mpi_comm_world, &t->reqs[0]);
 
-    if (nk == 0) {
-	/* the bundle is empty */
+    if (*err) {
+	gretl_mpi_error(err);
+	nb_clear_transfer(k);
 	return 0;
     }
 
-    for (i=0; i<nk && !err; i++) {
-	/* loop across bundle keys */
-	const char *key = gretl_array_get_data(keys, i);
+    t->nreq = 1;
 
-	data = gretl_bundle_get_data(b, key, &type, &size, &err);
-	if (!err) {
-	    /* send info on the bundle member */
-	    compose_msgbuf(msgbuf, type, key, &size, data);
-	    err = mpi_send(msgbuf, msglen, mpi_byte, dest,
-			   TAG_BMEMB_INFO, mpi_comm_world);
-	}
-	if (err) {
-	    break;
-	}
-	if (type == GRETL_TYPE_MATRIX) {
-	    err = gretl_matrix_mpi_send(data, dest);
-	} else if (type == GRETL_TYPE_ARRAY) {
-	    err = gretl_array_send(data, dest);
-	} else if (type == GRETL_TYPE_BUNDLE) {
-	    err = gretl_bundle_send(data, dest);
-	} else if (type == GRETL_TYPE_SERIES) {
-	    err = gretl_series_send(data, size, dest);
-	} else if (type == GRETL_TYPE_STRING) {
-	    err = gretl_string_send(data, dest);
-	} else if (type == GRETL_TYPE_LIST) {
-	    err = gretl_list_send(data, dest);
-	} else if (type == GRETL_TYPE_DOUBLE) {
-	    err = gretl_scalar_send(data, dest);
-	} else if (type == GRETL_TYPE_INT) {
-	    err = gretl_int_send(data, dest);
-	}
+    return k + 1;
+}
+
+/* take delivery of the data for @t without storing them: the
+   sender has already posted all the sends, so this can't block
+   for long */
+
+static int nb_drain (nb_transfer *t, int nc)
+{
+    static char scratch[NB_CHUNK];
+    guint64 offset, n, size = t->hdr[0];
+    int i, err = 0;
+
+    for (i=0, offset=0; i<nc && !err; i++, offset+=n) {
+	n = MIN(size - offset, NB_CHUNK);
+	err = mpi_recv(scratch, (int) n, mpi_byte, t->peer,
+		       (int) t->hdr[1], mpi_comm_world,
+		       MPI_STATUS_IGNORE);
     }
 
-    gretl_array_destroy(keys);
+    return err;
+}
+
+/* the header for a receive has arrived: allocate storage and
+   post the receives for the data; a failure to get the storage
+   is recorded against @t, to be reported when @t is completed */
+
+static int nb_post_recvs (nb_transfer *t)
+{
+    guint64 offset, n, size = t->hdr[0];
+    int tag = (int) t->hdr[1];
+    int nc = nb_n_chunks(size);
+    MPI_Request *reqs;
+    int i, err = 0;
+
+    t->posted = 1;
+
+    t->buf = malloc(size);
+    reqs = realloc(t->reqs, MAX(nc, 1) * sizeof *reqs);
+    if (reqs != NULL) {
+	t->reqs = reqs;
+    }
+
+    if (t->buf == NULL || reqs == NULL) {
+	free(t->buf);
+	t->buf = NULL;
+	t->err = E_ALLOC;
+	err = nb_drain(t, nc);
+    } else {
+	for (i=0, offset=0; i<nc && !err; i++, offset+=n) {
+	    n = MIN(size - offset, NB_CHUNK);
+	    err = mpi_irecv(t->buf + offset, (int) n, mpi_byte, t->peer,
+			    tag, mpi_comm_world, &t->reqs[t->nreq]);
+	    if (!err) {
+		t->nreq += 1;
+	    }
+	}
+    }
 
     if (err) {
 	gretl_mpi_error(&err);
@@ -1828,79 +2129,148 @@ static int gretl_bundle_send (gretl_bundle *b, int dest)
     return err;
 }
 
-gretl_bundle *gretl_bundle_receive (int source, int *err)
+/* for a receive whose data receives are not yet posted, check
+   without blocking for the header, and if it has arrived post
+   the data receives; return 1 if they're posted, else 0 */
+
+static int nb_check_header (nb_transfer *t, int *err)
 {
-    gretl_bundle *b = NULL;
-    char key[32];
-    char msgbuf[64];
-    int msglen = sizeof msgbuf;
-    int size;
-    int i, nk;
+    int got = 0;
 
-    /* get the number of keys first */
-    *err = mpi_recv(&nk, 1, mpi_int, source, TAG_BUNDLE_SIZE,
-		    mpi_comm_world, MPI_STATUS_IGNORE);
+    *err = mpi_testall(1, t->reqs, &got, MPI_STATUSES_IGNORE);
 
-    if (!*err) {
-	b = gretl_bundle_new();
-	if (b == NULL) {
-	    *err = E_ALLOC;
-	    return NULL;
-	}
+    if (*err) {
+	gretl_mpi_error(err);
+    } else if (got) {
+	t->nreq = 0;
+	*err = nb_post_recvs(t);
     }
 
-    if (nk == 0) {
-	/* the bundle is empty */
-	return b;
+    return got && !*err;
+}
+
+/* post the data receives for any pending receives, other than
+   @t, whose headers have arrived; an error is recorded against
+   the receive in question */
+
+static void nb_check_headers (nb_transfer *t)
+{
+    nb_transfer *u;
+    int i, err;
+
+    for (i=0; i<nb_n; i++) {
+	u = nb_table[i];
+	if (u != NULL && u != t && u->kind == NB_RECV &&
+	    !u->posted && !u->err) {
+	    err = 0;
+	    nb_check_header(u, &err);
+	    if (err) {
+		u->err = err;
+	    }
+	}
     }
+}
 
-    for (i=0; i<nk && !*err; i++) {
-	/* loop across bundle keys */
-	GretlType type = 0;
-	void *data = NULL;
-	double x;
+/* test for completion of @t, or wait for it if @wait is
+   non-zero; return 1 if complete, else 0 */
 
-	memset(msgbuf, 0, msglen);
-	size = 0;
+static int nb_progress (nb_transfer *t, int wait, int *err)
+{
+    int done = 0;
 
-	/* get info on bundle member @i */
-	*err = mpi_recv(msgbuf, msglen, mpi_byte, source, TAG_BMEMB_INFO,
-			mpi_comm_world, MPI_STATUS_IGNORE);
-	if (!*err) {
-	    *err = parse_msgbuf(msgbuf, key, &type, &size);
+    while (!*err && !t->err) {
+	if (t->kind == NB_RECV && !t->posted) {
+	    /* we need the header before anything else */
+	    nb_check_header(t, err);
 	}
-	if (*err) {
-	    break;
+	if (!*err && (t->posted || t->kind == NB_SEND)) {
+	    *err = mpi_testall(t->nreq, t->reqs, &done,
+			       MPI_STATUSES_IGNORE);
+	    if (*err) {
+		gretl_mpi_error(err);
+	    }
 	}
-	if (type == GRETL_TYPE_DOUBLE) {
-	    x = gretl_scalar_receive(source, err);
-	    data = &x;
-	} else if (type == GRETL_TYPE_INT) {
-	    x = gretl_int_receive(source, err);
-	    data = &x;
-	} else if (type == GRETL_TYPE_MATRIX) {
-	    data = gretl_matrix_mpi_receive(source, err);
-	} else if (type == GRETL_TYPE_ARRAY) {
-	    data = gretl_array_receive(source, err);
-	} else if (type == GRETL_TYPE_BUNDLE) {
-	    data = gretl_bundle_receive(source, err);
-	} else if (type == GRETL_TYPE_SERIES) {
-	    data = gretl_series_receive(source, err);
-	} else if (type == GRETL_TYPE_LIST) {
-	    data = gretl_list_receive(source, err);
-	} else if (type == GRETL_TYPE_STRING) {
-	    data = gretl_string_receive(source, err);
+	if (done || !wait || *err) {
+	    break;
 	}
-	if (!*err) {
-	    *err = gretl_bundle_donate_data(b, key, data, type, size);
+	/* our peer may be waiting on us */
+	nb_check_headers(t);
+    }
+
+    if (!*err && t->err) {
+	*err = t->err;
+    }
+
+    if (done && !*err) {
+	t->nreq = 0;
+    } else {
+	done = 0;
+    }
+
+    return done;
+}
+
+/**
+ * gretl_mpi_test:
+ * @handle: handle returned by gretl_mpi_isend() or
+ * gretl_mpi_irecv().
+ * @err: location to receive error code.
+ *
+ * Checks, without blocking, whether the transfer identified
+ * by @handle is complete. The transfer still has to be
+ * finalized via gretl_mpi_wait().
+ *
+ * Returns: 1 if the transfer is complete, otherwise 0.
+ **/
+
+int gretl_mpi_test (int handle, int *err)
+{
+    nb_transfer *t = nb_get_transfer(handle, err);
+    int done = 0;
+
+    if (t != NULL) {
+	done = nb_progress(t, 0, err);
+	if (*err) {
+	    nb_clear_transfer(handle - 1);
 	}
     }
 
-    if (*err) {
-	gretl_mpi_error(err);
+    return done;
+}
+
+/**
+ * gretl_mpi_wait:
+ * @handle: handle returned by gretl_mpi_isend() or
+ * gretl_mpi_irecv().
+ * @type: location to receive the type of the object.
+ * @err: location to receive error code.
+ *
+ * Waits for completion of the transfer identified by @handle,
+ * after which the handle is no longer valid.
+ *
+ * Returns: in the case of a receive, the object received, with
+ * its type written to @type; if the object is a scalar the
+ * return value points to newly allocated storage which should
+ * be freed by the caller. In the case of a send, NULL, with
+ * @type set to GRETL_TYPE_NONE.
+ **/
+
+void *gretl_mpi_wait (int handle, GretlType *type, int *err)
+{
+    nb_transfer *t = nb_get_transfer(handle, err);
+    void *ret = NULL;
+
+    *type = GRETL_TYPE_NONE;
+
+    if (t != NULL) {
+	nb_progress(t, 1, err);
+	if (!*err && t->kind == NB_RECV) {
+	    ret = gretl_gbin_unpack(t->buf, t->hdr[0], type, err);
+	}
+	nb_clear_transfer(handle - 1);
     }
 
-    return b;
+    return ret;
 }
 
 static void fill_tmp (double * restrict tmp,
@@ -74,9 +74,21 @@ int gretl_array_mpi_reduce (gretl_array *sa,
 			    Gretl_MPI_Op op,
 			    int root);
 
+int gretl_scalar_mpi_allgather (double x, gretl_matrix **pm);
+
+int gretl_array_mpi_allgather (gretl_array *sa, gretl_array **pa);
+
 void *gretl_mpi_receive (int source, GretlType *type,
 			 int *err);
 
+int gretl_mpi_isend (void *p, GretlType type, int dest, int *err);
+
+int gretl_mpi_irecv (int source, int *err);
+
+int gretl_mpi_test (int handle, int *err);
+
+void *gretl_mpi_wait (int handle, GretlType *type, int *err);
+
 void gretl_mpi_stopwatch_init (void);
 
 double gretl_mpi_stopwatch (void);
@@ -5574,7 +5574,7 @@ static int pad_panel_dataset (const double *uid, int uv, int nunits,
 
 	/* swap the padded arrays into Z */
 	for (i=0; i<dset->v; i++) {
-	    free(dset->Z[i]);
+	    series_data_free(dset->Z[i]);
 	    dset->Z[i] = bigZ[i];
 	}
 
@@ -29,6 +29,8 @@
 #include "gretl_xml.h"
 #include "forecast.h"
 #include "gretl_typemap.h"
+#include "gretl_cmatrix.h"
+#include "dbread.h"
 
 #ifdef USE_CURL
 # include "gretl_www.h"
@@ -2387,6 +2389,7 @@ static void blas_init (void)
 void libgretl_init (void)
 {
     libset_init();
+    gretl_simd_init();
     gretl_rand_init();
     gretl_xml_init();
     gretl_stopwatch_init();
@@ -2417,6 +2420,7 @@ int libgretl_mpi_init (int self, int np, int dcmt)
     int err;
 
     libset_init();
+    gretl_simd_init();
 
     /* let geneval know */
     set_mpi_rank_and_size(self, np);
@@ -2562,6 +2566,7 @@ void libgretl_cleanup (void)
     gretl_command_hash_cleanup();
     gretl_function_hash_cleanup();
     lapack_mem_free();
+    gretl_matrix_pool_cleanup();
     forecast_matrix_cleanup();
     stored_options_cleanup();
     option_printing_cleanup();
@@ -2575,12 +2580,16 @@ void libgretl_cleanup (void)
 #endif
     builtin_strings_cleanup();
     last_result_cleanup();
+    series_index_cleanup();
+    db_index_cleanup();
 
 #ifdef HAVE_MPI
+    gretl_fft_cleanup(!gretl_mpi_initialized() || gretl_mpi_rank() == 0);
     if (!gretl_mpi_initialized()) {
 	dotdir_cleanup();
     }
 #else
+    gretl_fft_cleanup(1);
     dotdir_cleanup();
 #endif
 
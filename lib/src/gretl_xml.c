@@ -28,6 +28,10 @@
 #include "dbread.h"
 #include "swap_bytes.h"
 #include "gretl_zip.h"
+#include "usermat.h"
+#include "uservar.h"
+
+#include <libxml/xmlreader.h>
 
 #ifdef HAVE_MPI
 # include "gretl_mpi.h"
@@ -47,6 +51,7 @@
 
 #define GRETLDATA_VERSION "1.4"
 #define GRETLDATA_COMPAT  "1.3" /* status quo as of gretl 2018b */
+#define GRETLDATA_CHUNKED "1.5" /* gdtb with chunked binary data */
 
 #define GDT_DEBUG 0
 
@@ -1950,15 +1955,166 @@ static PRN *open_gdt_write_stream (const char *fname,
 
 #define BIN_HDRLEN 24
 
-static int write_binary_header (FILE *fp)
+/* The binary data file in a gdtb zipfile comes in one of two
+   layouts. In the original one the header is followed by each
+   series in turn, as a plain array of doubles.
+
+   In the chunked layout, written on "store" with the --chunked
+   option (gdt version 1.5), each series is divided into chunks
+   of BIN_CHUNK_ROWS observations (the last one possibly shorter).
+   Each chunk is compressed with zlib at the "store" compression
+   level, or kept as raw doubles if the level is zero or this
+   doesn't save space, and is padded to a multiple of 8 bytes.
+   The chunks of the first series come first, then those of the
+   second, and so on. They are followed by an index with an entry
+   for each chunk, giving its position and size plus the minimum,
+   maximum and number of missing values of its data, and finally
+   by a fixed-size trailer saying where the index starts. So a
+   reader can go straight to the series and observations it wants,
+   and can pass over chunks whose statistics show that they hold
+   no observations satisfying a restriction. Since the chunks are
+   compressed individually, the zipfile is not compressed in this
+   case.
+*/
+
+#define BIN_CHUNK_ROWS 65536
+#define BIN_CHUNK_MAX (1 << 24) /* max rows per chunk on reading */
+
+/* Offsets within the binary data file are absolute, and the file
+   may well exceed 2GB, so we need 64-bit seek and tell */
+
+#if defined(_WIN64)
+# define ftell64(a)     _ftelli64(a)
+# define fseek64(a,b,c) _fseeki64(a,b,c)
+#elif !defined(WIN32)
+# define ftell64(a)     ftello(a)
+# define fseek64(a,b,c) fseeko(a,b,c)
+#else
+/* 32-bit Windows: _ftelli64 missing in msvcrt.dll */
+
+static gint64 ftell64 (FILE *fp)
+{
+    return (gint64) ftell(fp);
+}
+
+static int fseek64 (FILE *fp, gint64 offset, int whence)
+{
+    if (offset > (gint64) LONG_MAX) {
+	return -1;
+    } else {
+	return fseek(fp, (long) offset, whence);
+    }
+}
+#endif
+
+/* flags for chunks */
+#define BIN_CHUNK_ZLIB    1 /* compressed with zlib */
+#define BIN_CHUNK_NOSTATS 2 /* no statistics (original layout) */
+
+typedef struct bin_chunk_ bin_chunk;
+typedef struct bin_trailer_ bin_trailer;
+typedef struct bin_writer_ bin_writer;
+typedef struct bin_reader_ bin_reader;
+typedef struct bin_cond_ bin_cond;
+typedef struct gdt_rowspec_ gdt_rowspec;
+typedef struct gdt_rowsel_ gdt_rowsel;
+
+struct bin_chunk_ {
+    guint64 offset;    /* position of the chunk in the file */
+    guint32 size;      /* number of bytes stored */
+    guint32 flags;     /* see BIN_CHUNK_ZLIB above */
+    double min;        /* minimum of the non-missing values */
+    double max;        /* maximum of the non-missing values */
+    guint32 n_na;      /* number of missing values */
+    guint32 reserved;
+};
+
+struct bin_trailer_ {
+    guint64 index_offset; /* position of the chunk index */
+    guint32 nvars;        /* number of series */
+    guint32 nobs;         /* number of observations per series */
+    guint32 chunk_rows;   /* number of observations per chunk */
+    guint32 reserved;
+};
+
+/* state for writing series in chunked form */
+
+struct bin_writer_ {
+    bin_chunk *chunks; /* index, for all chunks of all series */
+    int nchunks;       /* number of chunks per series */
+    int k;             /* number of series written so far */
+    guint64 pos;       /* current position in the file */
+    int level;         /* zlib compression level (0 for none) */
+    Bytef *zbuf;       /* workspace for compression */
+    uLong zlen;        /* size of @zbuf */
+};
+
+/* state for reading series from a binary data file of
+   either layout: for the original one we construct an
+   index with one chunk per series
+*/
+
+struct bin_reader_ {
+    FILE *fp;          /* the binary data file */
+    guint64 fsize;     /* its size in bytes */
+    bin_chunk *chunks; /* index, @nchunks entries per series */
+    int nvars;         /* number of series in the file */
+    int nobs;          /* number of observations per series */
+    int chunk_rows;    /* number of observations per chunk */
+    int nchunks;       /* number of chunks per series */
+    int swap;          /* data are in the "wrong" byte order */
+    int old_na;        /* data use old-style NAs (DBL_MAX) */
+    Bytef *zbuf;       /* workspace for decompression */
+    double *xbuf;      /* workspace for the values of a chunk */
+};
+
+/* comparison operators in restrictions */
+enum {
+    COND_LT,
+    COND_LE,
+    COND_GT,
+    COND_GE,
+    COND_EQ,
+    COND_NE
+};
+
+/* a term in a restriction on the rows to be read */
+
+struct bin_cond_ {
+    int v;      /* ID number of series in the file */
+    int op;     /* comparison operator */
+    double val; /* value to compare with */
+};
+
+/* rows to be read, as given by the --rowmask and --restrict
+   options to "open" and "append" */
+
+struct gdt_rowspec_ {
+    const gretl_matrix *mask; /* row mask, or NULL */
+    const char *restr;        /* restriction, or NULL */
+};
+
+/* the outcome of applying a gdt_rowspec */
+
+struct gdt_rowsel_ {
+    char *sel;   /* 1 for rows to be read, else 0 */
+    int *nsel;   /* number of rows selected per chunk */
+    int nsrc;    /* number of rows in the file */
+    int n;       /* number of rows selected */
+    int t0;      /* index of the first row selected */
+    int contig;  /* 1 if the selected rows are contiguous */
+};
+
+static int write_binary_header (FILE *fp, int chunked)
 {
     char header[BIN_HDRLEN] = {0};
     int err = 0;
 
+    strcpy(header, chunked ? "gretl-chk:" : "gretl-bin:");
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
-    strcpy(header, "gretl-bin:little-endian");
+    strcat(header, "little-endian");
 #else
-    strcpy(header, "gretl-bin:big-endian");
+    strcat(header, "big-endian");
 #endif
 
     if (fwrite(header, 1, BIN_HDRLEN, fp) != BIN_HDRLEN) {
@@ -1968,14 +2124,134 @@ static int write_binary_header (FILE *fp)
     return err;
 }
 
+static void bin_chunk_stats (bin_chunk *bc, const double *x, int n)
+{
+    int t;
+
+    bc->min = bc->max = NADBL;
+    bc->n_na = 0;
+
+    for (t=0; t<n; t++) {
+	if (na(x[t])) {
+	    bc->n_na += 1;
+	} else if (na(bc->min)) {
+	    bc->min = bc->max = x[t];
+	} else if (x[t] < bc->min) {
+	    bc->min = x[t];
+	} else if (x[t] > bc->max) {
+	    bc->max = x[t];
+	}
+    }
+}
+
+/* Write the @n values in @x: as a plain array if @bw is NULL,
+   otherwise in chunked form.
+*/
+
+static int write_binary_series (FILE *fp, const double *x, int n,
+				bin_writer *bw)
+{
+    const char zero[8] = {0};
+    bin_chunk *bc;
+    int t, err = 0;
+
+    if (bw == NULL) {
+	if (fwrite(x, sizeof(double), n, fp) != n) {
+	    err = E_DATA;
+	}
+	return err;
+    }
+
+    bc = bw->chunks + bw->k * bw->nchunks;
+
+    for (t=0; t<n && !err; t+=BIN_CHUNK_ROWS) {
+	int m = MIN(BIN_CHUNK_ROWS, n - t);
+	const void *src = x + t;
+	uLongf zlen = bw->zlen;
+	size_t pad;
+
+	bin_chunk_stats(bc, x + t, m);
+	bc->offset = bw->pos;
+	bc->size = m * sizeof(double);
+	bc->flags = 0;
+	bc->reserved = 0;
+
+	if (bw->level > 0 &&
+	    compress2(bw->zbuf, &zlen, (const Bytef *) (x + t),
+		      bc->size, bw->level) == Z_OK &&
+	    zlen < bc->size) {
+	    bc->size = zlen;
+	    bc->flags = BIN_CHUNK_ZLIB;
+	    src = bw->zbuf;
+	}
+
+	pad = (8 - bc->size % 8) % 8;
+	if (fwrite(src, 1, bc->size, fp) != bc->size) {
+	    err = E_DATA;
+	} else if (pad > 0 && fwrite(zero, 1, pad, fp) != pad) {
+	    err = E_DATA;
+	}
+	bw->pos += bc->size + pad;
+	bc++;
+    }
+
+    bw->k += 1;
+
+    return err;
+}
+
+static int write_binary_index (FILE *fp, bin_writer *bw, int nobs)
+{
+    bin_trailer bt = {0};
+    size_t n = bw->k * bw->nchunks;
+
+    bt.index_offset = bw->pos;
+    bt.nvars = bw->k;
+    bt.nobs = nobs;
+    bt.chunk_rows = BIN_CHUNK_ROWS;
+
+    if (fwrite(bw->chunks, sizeof *bw->chunks, n, fp) != n ||
+	fwrite(&bt, sizeof bt, 1, fp) != 1) {
+	return E_DATA;
+    }
+
+    return 0;
+}
+
+static int bin_writer_init (bin_writer *bw, int nseries, int nrows)
+{
+    bw->nchunks = (nrows + BIN_CHUNK_ROWS - 1) / BIN_CHUNK_ROWS;
+    bw->k = 0;
+    bw->pos = BIN_HDRLEN;
+    bw->level = get_compression_option(STORE);
+    bw->zbuf = NULL;
+    bw->zlen = 0;
+
+    bw->chunks = calloc(nseries * bw->nchunks + 1, sizeof *bw->chunks);
+    if (bw->chunks == NULL) {
+	return E_ALLOC;
+    }
+
+    if (bw->level > 0) {
+	bw->zlen = compressBound(BIN_CHUNK_ROWS * sizeof(double));
+	bw->zbuf = malloc(bw->zlen);
+	if (bw->zbuf == NULL) {
+	    /* not fatal: just don't compress */
+	    bw->level = 0;
+	}
+    }
+
+    return 0;
+}
+
 static int write_binary_data (const char *fname, const DATASET *dset,
 			      const int *list, int nvars, int nrows,
 			      gretlopt opt)
 {
+    bin_writer bwriter, *bw = NULL;
     char *bname;
     FILE *fp;
     int T = dset->t2 - dset->t1 + 1;
-    size_t wrote;
     int i, v, err = 0;
 
     bname = switch_ext_new(fname, "bin");
@@ -1986,7 +2262,17 @@ static int write_binary_data (const char *fname, const DATASET *dset,
 	return E_FOPEN;
     }
 
-    write_binary_header(fp);
+    if (opt & OPT_K) {
+	/* --chunked */
+	bw = &bwriter;
+	err = bin_writer_init(bw, nrows < T ? nvars + 2 : nvars, nrows);
+	if (err) {
+	    fclose(fp);
+	    return err;
+	}
+    }
+
+    write_binary_header(fp, bw != NULL);
 
     if (nrows < T) {
 	/* panel data with skip-padding in force */
@@ -2029,10 +2315,7 @@ static int write_binary_data (const char *fname, const DATASET *dset,
 		    tmp[s++] = dset->Z[v][t];
 		}
 	    }
-	    wrote = fwrite(tmp, sizeof(double), nrows, fp);
-	    if (wrote != nrows) {
-		err = E_DATA;
-	    }
+	    err = write_binary_series(fp, tmp, nrows, bw);
 	}
 
 	free(tmp);
@@ -2042,31 +2325,57 @@ static int write_binary_data (const char *fname, const DATASET *dset,
     } else {
 	for (i=1; i<=nvars && !err; i++) {
 	    v = savenum(list, i);
-	    wrote = fwrite(dset->Z[v] + dset->t1, sizeof(double),
-			   T, fp);
-	    if (wrote != T) {
-		err = E_DATA;
-	    }
+	    err = write_binary_series(fp, dset->Z[v] + dset->t1, T, bw);
 	}
     }
 
+    if (bw != NULL) {
+	if (!err) {
+	    err = write_binary_index(fp, bw, nrows);
+	}
+	free(bw->chunks);
+	free(bw->zbuf);
+    }
+
     fclose(fp);
 
     return err;
 }
 
-static void gdt_swap_endianness (DATASET *dset)
+/* Check the binary data header @hdr against the byte order
+   given in the XML, @order, and determine whether the data
+   are in chunked form.
+*/
+
+static int check_binary_header (const char *hdr, int order,
+				int *chunked)
 {
-    int i, t;
+    int bin_order = 0;
+    int err = 0;
 
-    for (i=1; i<dset->v; i++) {
-	for (t=0; t<dset->n; t++) {
-	    reverse_double(dset->Z[i][t]);
-	}
+    if (!strncmp(hdr, "gretl-bin:", 10)) {
+	*chunked = 0;
+    } else if (!strncmp(hdr, "gretl-chk:", 10)) {
+	*chunked = 1;
+    } else {
+	return E_DATA;
+    }
+
+    if (!strcmp(hdr + 10, "little-endian")) {
+	bin_order = G_LITTLE_ENDIAN;
+    } else if (!strcmp(hdr + 10, "big-endian")) {
+	bin_order = G_BIG_ENDIAN;
+    } else {
+	err = E_DATA;
     }
+    if (!err && bin_order != order) {
+	err = E_DATA;
+    }
+
+    return err;
 }
 
-static int read_binary_header (FILE *fp, int order)
+static int read_binary_header (FILE *fp, int order, int *chunked)
 {
     char hdr[BIN_HDRLEN] = {0};
     unsigned chk;
@@ -2074,27 +2383,10 @@ static int read_binary_header (FILE *fp, int order)
 
     chk = fread(hdr, 1, BIN_HDRLEN, fp);
 
-    if (chk != BIN_HDRLEN) {
+    if (chk != BIN_HDRLEN || hdr[BIN_HDRLEN-1] != '\0') {
 	err = E_DATA;
     } else {
-	int bin_order = 0;
-
-	if (strncmp(hdr, "gretl-bin:", 10)) {
-	    err = E_DATA;
-	} else if (!strcmp(hdr + 10, "little-endian")) {
-	    bin_order = G_LITTLE_ENDIAN;
-	} else if (!strcmp(hdr + 10, "big-endian")) {
-	    bin_order = G_BIG_ENDIAN;
-	} else {
-	    err = E_DATA;
-	}
-	if (!err && bin_order != order) {
-	    err = E_DATA;
-	}
-    }
-
-    if (err) {
-	gretl_errmsg_set("Error reading binary data file");
+	err = check_binary_header(hdr, order, chunked);
     }
 
     return err;
@@ -2111,146 +2403,923 @@ static void na_convert (double *x, int n)
     }
 }
 
-static int read_binary_data (const char *fname,
-			     DATASET *dset,
-			     int order,
-			     double gdtversion,
-			     int fullv,
-			     const int *vlist)
+/* number of observations in chunk @j */
+
+static int bin_chunk_length (const bin_reader *br, int j)
 {
-    char *bname;
-    FILE *fp;
-    int err = 0;
+    return MIN(br->chunk_rows, br->nobs - j * br->chunk_rows);
+}
 
-    bname = switch_ext_new(fname, "bin");
-    fp = gretl_fopen(bname, "rb");
+/* the index entry for chunk @j of series @v (1-based) */
 
-    if (fp == NULL) {
-	err = E_FOPEN;
-    } else {
-	int T = dset->n;
-	long offset = T * sizeof(double);
-	size_t got;
-	int i, k = 1;
+static bin_chunk *bin_get_chunk (const bin_reader *br, int v, int j)
+{
+    return br->chunks + (v - 1) * br->nchunks + j;
+}
 
-	err = read_binary_header(fp, order);
+/* Read the trailer and chunk index of a file in chunked layout,
+   converting them to native byte order if need be, and check
+   that they agree with the file size and the dimensions given
+   in the XML.
+*/
 
-	for (i=1; i<fullv && !err; i++) {
-	    if (vlist == NULL || in_gretl_list(vlist, i)) {
-		got = fread(dset->Z[k], sizeof(double), T, fp);
-		if (got != T) {
-		    err = E_DATA;
-		}
-		if (!err && gdtversion < 1.4) {
-		    /* we need to convert old-style NAs */
-		    na_convert(dset->Z[k], dset->n);
-		}
-		k++;
-	    } else {
-		fseek(fp, offset, SEEK_CUR);
-	    }
-	}
-	fclose(fp);
+static int read_binary_index (bin_reader *br)
+{
+    bin_trailer bt;
+    bin_chunk *bc;
+    size_t n;
+    int i, j, m;
+
+    if (br->fsize < BIN_HDRLEN + sizeof bt ||
+	fseek64(br->fp, br->fsize - sizeof bt, SEEK_SET) ||
+	fread(&bt, sizeof bt, 1, br->fp) != 1) {
+	return E_DATA;
     }
 
-    free(bname);
+    if (br->swap) {
+	bt.index_offset = GUINT64_SWAP_LE_BE(bt.index_offset);
+	bt.nvars = GUINT32_SWAP_LE_BE(bt.nvars);
+	bt.nobs = GUINT32_SWAP_LE_BE(bt.nobs);
+	bt.chunk_rows = GUINT32_SWAP_LE_BE(bt.chunk_rows);
+    }
 
-    if (!err && order != G_BYTE_ORDER) {
-	gdt_swap_endianness(dset);
+    if (bt.nobs != br->nobs || bt.nvars != br->nvars ||
+	bt.chunk_rows == 0 || bt.chunk_rows > BIN_CHUNK_MAX) {
+	return E_DATA;
     }
 
-    return err;
-}
+    br->chunk_rows = bt.chunk_rows;
+    br->nchunks = (br->nobs + br->chunk_rows - 1) / br->chunk_rows;
+    n = (size_t) br->nvars * br->nchunks;
 
-static void write_binary_order (PRN *prn)
-{
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-    pputs(prn, " binary=\"little-endian\" ");
-#else
-    pputs(prn, " binary=\"big-endian\" ");
-#endif
-}
+    if (bt.index_offset < BIN_HDRLEN ||
+	bt.index_offset + n * sizeof *bc + sizeof bt != br->fsize) {
+	return E_DATA;
+    }
 
-/* Here we're testing a series to see if it can be represented in full
-   precision (discarding any artifacts) using the format "%.15g". The
-   criterion is that each value must have a least one trailing zero
-   when printed using "% .14e". We don't necessarily check every
-   element in the series; assuming a reasonable degree of homogeneity
-   in the data it ought to be enough if 100 members pass the test.
-*/
+    br->chunks = malloc((n + 1) * sizeof *bc);
+    if (br->chunks == NULL) {
+	return E_ALLOC;
+    }
 
-static int p15_OK (const DATASET *dset, int v)
-{
-    const double *x = dset->Z[v];
-    char s[32];
-    int t, i, n_ok = 0;
-    int ret = 1;
+    if (fseek64(br->fp, bt.index_offset, SEEK_SET) ||
+	fread(br->chunks, sizeof *bc, n, br->fp) != n) {
+	return E_DATA;
+    }
 
-    for (t=dset->t1; t<=dset->t2; t++) {
-	if (!na(x[t])) {
-	    sprintf(s, "% .14e", x[t]);
-	    for (i=16; i>13; i--) {
-		if (s[i] != '0') {
-		    break;
-		}
+    bc = br->chunks;
+    for (i=0; i<br->nvars; i++) {
+	for (j=0; j<br->nchunks; j++, bc++) {
+	    if (br->swap) {
+		bc->offset = GUINT64_SWAP_LE_BE(bc->offset);
+		bc->size = GUINT32_SWAP_LE_BE(bc->size);
+		bc->flags = GUINT32_SWAP_LE_BE(bc->flags);
+		bc->n_na = GUINT32_SWAP_LE_BE(bc->n_na);
+		reverse_double(bc->min);
+		reverse_double(bc->max);
 	    }
-	    if (i == 16) {
-		ret = 0;
-		break;
+	    m = bin_chunk_length(br, j);
+	    if (bc->offset < BIN_HDRLEN ||
+		bc->offset + bc->size > bt.index_offset ||
+		(bc->flags & ~BIN_CHUNK_ZLIB) || bc->n_na > m) {
+		return E_DATA;
+	    } else if (bc->flags & BIN_CHUNK_ZLIB) {
+		if (bc->size == 0 ||
+		    bc->size > compressBound(br->chunk_rows * sizeof(double))) {
+		    return E_DATA;
+		}
+	    } else if (bc->size != m * sizeof(double)) {
+		return E_DATA;
 	    }
-	    n_ok++;
-	}
-	if (n_ok > 100) {
-	    break;
 	}
     }
 
-    return ret;
+    return 0;
 }
 
-/* apparatus from trimming string-values on gdt save,
-   and restoration afterwards
+/* Construct the index for a file in the original layout:
+   one chunk per series, without statistics.
 */
 
-struct strval_saver_ {
-    int *list;
-    gretl_matrix *X;
-    series_table **st;
-    size_t sz;
-};
+static int make_binary_index (bin_reader *br)
+{
+    guint64 len = (guint64) br->nobs * sizeof(double);
+    int i;
 
-typedef struct strval_saver_ strval_saver;
+    if (br->fsize < BIN_HDRLEN + br->nvars * len) {
+	return E_DATA;
+    }
 
-static void strval_saver_destroy (strval_saver *ss)
+    br->chunk_rows = br->nobs;
+    br->nchunks = br->nobs > 0;
+
+    br->chunks = calloc(br->nvars + 1, sizeof *br->chunks);
+    if (br->chunks == NULL) {
+	return E_ALLOC;
+    }
+
+    for (i=0; i<br->nvars; i++) {
+	br->chunks[i].offset = BIN_HDRLEN + i * len;
+	br->chunks[i].flags = BIN_CHUNK_NOSTATS;
+    }
+
+    return 0;
+}
+
+static void bin_reader_destroy (bin_reader *br)
 {
-    if (ss != NULL) {
-	free(ss->list);
-	gretl_matrix_free(ss->X);
-	free(ss->st);
-	free(ss);
+    if (br != NULL) {
+	if (br->fp != NULL) {
+	    fclose(br->fp);
+	}
+	free(br->chunks);
+	free(br->zbuf);
+	free(br->xbuf);
+	free(br);
     }
 }
 
-static strval_saver *strval_saver_setup (DATASET *dset,
-					 int nvars, int nsv,
-					 int *list, int *err)
+/* Open the binary data file @bname, which should hold @nvars
+   series of length @nobs, check its header and get hold of its
+   index (real or constructed) ready for reading.
+*/
+
+static bin_reader *bin_reader_open (const char *bname, int order,
+				    double gdtversion, int nvars,
+				    int nobs, int *err)
 {
-    strval_saver *ss;
-    int n_changed = 0;
-    int i, n;
+    bin_reader *br = calloc(1, sizeof *br);
+    int chunked = 0;
 
-    ss = calloc(1, sizeof *ss);
-    if (ss == NULL) {
+    if (br == NULL) {
 	*err = E_ALLOC;
 	return NULL;
     }
 
-    n = sample_size(dset);
-    ss->list = gretl_list_new(nsv);
-    ss->X = gretl_matrix_alloc(n, nsv);
-    ss->st = calloc(nsv, sizeof *ss->st);
-    if (ss->list == NULL || ss->X == NULL || ss->st == NULL) {
-	*err = E_ALLOC;
+    br->fp = gretl_fopen(bname, "rb");
+    if (br->fp == NULL) {
+	*err = E_FOPEN;
+	free(br);
+	return NULL;
+    }
+
+    br->nvars = nvars;
+    br->nobs = nobs;
+    br->swap = (order != G_BYTE_ORDER);
+    br->old_na = (gdtversion < 1.4);
+
+    *err = read_binary_header(br->fp, order, &chunked);
+
+    if (!*err) {
+	gint64 fsize = -1;
+
+	if (fseek64(br->fp, 0, SEEK_END) == 0) {
+	    fsize = ftell64(br->fp);
+	}
+	if (fsize < 0) {
+	    *err = E_DATA;
+	} else {
+	    br->fsize = fsize;
+	}
+    }
+
+    if (!*err) {
+	if (chunked) {
+	    *err = read_binary_index(br);
+	} else {
+	    *err = make_binary_index(br);
+	}
+    }
+
+    if (!*err && br->chunk_rows > 0) {
+	br->xbuf = malloc(br->chunk_rows * sizeof *br->xbuf);
+	if (br->xbuf == NULL) {
+	    *err = E_ALLOC;
+	}
+    }
+
+    if (*err) {
+	if (*err == E_DATA) {
+	    gretl_errmsg_set("Error reading binary data file");
+	}
+	bin_reader_destroy(br);
+	br = NULL;
+    }
+
+    return br;
+}
+
+/* Read chunk @j of series @v (1-based) into @x */
+
+static int bin_read_chunk (bin_reader *br, int v, int j, double *x)
+{
+    bin_chunk *bc = bin_get_chunk(br, v, j);
+    int m = bin_chunk_length(br, j);
+    int t, err = 0;
+
+    if (fseek64(br->fp, bc->offset, SEEK_SET)) {
+	err = E_DATA;
+    } else if (bc->flags & BIN_CHUNK_ZLIB) {
+	uLongf len = m * sizeof *x;
+
+	if (br->zbuf == NULL) {
+	    br->zbuf = malloc(compressBound(br->chunk_rows * sizeof *x));
+	    if (br->zbuf == NULL) {
+		return E_ALLOC;
+	    }
+	}
+	if (fread(br->zbuf, 1, bc->size, br->fp) != bc->size ||
+	    uncompress((Bytef *) x, &len, br->zbuf, bc->size) != Z_OK ||
+	    len != m * sizeof *x) {
+	    err = E_DATA;
+	}
+    } else if (fread(x, sizeof *x, m, br->fp) != m) {
+	err = E_DATA;
+    }
+
+    if (!err && br->swap) {
+	for (t=0; t<m; t++) {
+	    reverse_double(x[t]);
+	}
+    }
+
+    if (!err && br->old_na) {
+	/* we need to convert old-style NAs */
+	na_convert(x, m);
+    }
+
+    return err;
+}
+
+/* Read series @v (1-based) into @x, either in full or just the
+   rows selected in @rs, skipping the chunks that hold none of
+   them.
+*/
+
+static int bin_read_series (bin_reader *br, int v, double *x,
+			    const gdt_rowsel *rs)
+{
+    int j, t, t0, m, s = 0;
+    int err = 0;
+
+    for (j=0; j<br->nchunks && !err; j++) {
+	t0 = j * br->chunk_rows;
+	m = bin_chunk_length(br, j);
+	if (rs == NULL) {
+	    err = bin_read_chunk(br, v, j, x + t0);
+	} else if (rs->nsel[j] == m) {
+	    err = bin_read_chunk(br, v, j, x + s);
+	    s += m;
+	} else if (rs->nsel[j] > 0) {
+	    err = bin_read_chunk(br, v, j, br->xbuf);
+	    for (t=0; t<m; t++) {
+		if (rs->sel[t0 + t]) {
+		    x[s++] = br->xbuf[t];
+		}
+	    }
+	}
+    }
+
+    return err;
+}
+
+/* Can the statistics for chunk @bc, of length @m, tell us
+   that (a) no observation in the chunk satisfies @c (return
+   0), or (b) all of them do (return 1)? If not, return -1.
+*/
+
+static int bin_chunk_verdict (const bin_chunk *bc, int m,
+			      const bin_cond *c)
+{
+    double x = c->val;
+
+    if (bc->flags & BIN_CHUNK_NOSTATS) {
+	return -1;
+    } else if (bc->n_na == m) {
+	return 0;
+    }
+
+    switch (c->op) {
+    case COND_LT:
+	if (bc->min >= x) return 0;
+	if (bc->max < x) return bc->n_na == 0 ? 1 : -1;
+	break;
+    case COND_LE:
+	if (bc->min > x) return 0;
+	if (bc->max <= x) return bc->n_na == 0 ? 1 : -1;
+	break;
+    case COND_GT:
+	if (bc->max <= x) return 0;
+	if (bc->min > x) return bc->n_na == 0 ? 1 : -1;
+	break;
+    case COND_GE:
+	if (bc->max < x) return 0;
+	if (bc->min >= x) return bc->n_na == 0 ? 1 : -1;
+	break;
+    case COND_EQ:
+	if (x < bc->min || x > bc->max) return 0;
+	if (bc->min == x && bc->max == x) return bc->n_na == 0 ? 1 : -1;
+	break;
+    case COND_NE:
+	if (bc->min == x && bc->max == x) return 0;
+	if (x < bc->min || x > bc->max) return bc->n_na == 0 ? 1 : -1;
+	break;
+    }
+
+    return -1;
+}
+
+static int bin_cond_holds (double x, const bin_cond *c)
+{
+    if (na(x)) {
+	return 0;
+    }
+
+    switch (c->op) {
+    case COND_LT: return x < c->val;
+    case COND_LE: return x <= c->val;
+    case COND_GT: return x > c->val;
+    case COND_GE: return x >= c->val;
+    case COND_EQ: return x == c->val;
+    case COND_NE: return x != c->val;
+    }
+
+    return 0;
+}
+
+/* Narrow the row selection in @rs down to the rows that satisfy
+   all of the @nc conditions in @c. A chunk is read only if its
+   statistics can't settle the matter.
+*/
+
+static int bin_apply_restriction (bin_reader *br, const bin_cond *c,
+				  int nc, gdt_rowsel *rs)
+{
+    int i, j, t, t0, m, verdict;
+    int err = 0;
+
+    for (j=0; j<br->nchunks && !err; j++) {
+	if (rs->nsel[j] == 0) {
+	    continue;
+	}
+	t0 = j * br->chunk_rows;
+	m = bin_chunk_length(br, j);
+	for (i=0; i<nc && rs->nsel[j] > 0 && !err; i++) {
+	    verdict = bin_chunk_verdict(bin_get_chunk(br, c[i].v, j), m, &c[i]);
+	    if (verdict == 0) {
+		memset(rs->sel + t0, 0, m);
+		rs->nsel[j] = 0;
+	    } else if (verdict < 0) {
+		err = bin_read_chunk(br, c[i].v, j, br->xbuf);
+		for (t=0; t<m && !err; t++) {
+		    if (rs->sel[t0 + t] && !bin_cond_holds(br->xbuf[t], &c[i])) {
+			rs->sel[t0 + t] = 0;
+			rs->nsel[j] -= 1;
+		    }
+		}
+	    }
+	}
+    }
+
+    return err;
+}
+
+static int parse_cond_op (const char **ps)
+{
+    const char *s = *ps;
+    int op = -1;
+
+    if (!strncmp(s, "<=", 2)) {
+	op = COND_LE;
+    } else if (!strncmp(s, ">=", 2)) {
+	op = COND_GE;
+    } else if (!strncmp(s, "==", 2)) {
+	op = COND_EQ;
+    } else if (!strncmp(s, "!=", 2)) {
+	op = COND_NE;
+    } else if (*s == '<') {
+	op = COND_LT;
+    } else if (*s == '>') {
+	op = COND_GT;
+    } else if (*s == '=') {
+	op = COND_EQ;
+    }
+
+    if (op == COND_LT || op == COND_GT || (op == COND_EQ && s[1] != '=')) {
+	*ps += 1;
+    } else if (op >= 0) {
+	*ps += 2;
+    }
+
+    return op;
+}
+
+/* Parse the restriction @s, which should take the form of one
+   or more comparisons of a series with a numerical value or
+   named scalar, joined by "&&", as in "x > 0 && y != 3". The
+   series are looked up in @dset, which holds the names of the
+   series in the data file.
+*/
+
+static bin_cond *parse_gdt_restriction (const char *s,
+					const DATASET *dset,
+					int *nc, int *err)
+{
+    char word[VNAMELEN];
+    bin_cond *c = NULL;
+    const char *p = s;
+    char *test;
+    int n, k = 0;
+
+    /* count the terms */
+    for (n=1; (p = strstr(p, "&&")) != NULL; n++) {
+	p += 2;
+    }
+
+    c = malloc(n * sizeof *c);
+    if (c == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    p = s;
+    while (k < n && !*err) {
+	p += strspn(p, " ");
+	if (sscanf(p, "%31[A-Za-z0-9_]", word) != 1) {
+	    *err = E_PARSE;
+	    break;
+	}
+	p += strlen(word);
+	for (c[k].v=1; c[k].v<dset->v; c[k].v++) {
+	    if (!strcmp(word, dset->varname[c[k].v])) {
+		break;
+	    }
+	}
+	if (c[k].v >= dset->v) {
+	    gretl_errmsg_sprintf(_("Unknown variable '%s'"), word);
+	    *err = E_UNKVAR;
+	    break;
+	}
+	p += strspn(p, " ");
+	c[k].op = parse_cond_op(&p);
+	if (c[k].op < 0) {
+	    *err = E_PARSE;
+	    break;
+	}
+	p += strspn(p, " ");
+	c[k].val = strtod(p, &test);
+	if (test == p) {
+	    if (sscanf(p, "%31[A-Za-z0-9_]", word) != 1) {
+		*err = E_PARSE;
+		break;
+	    }
+	    c[k].val = gretl_scalar_get_value(word, err);
+	    p += strlen(word);
+	} else {
+	    p = test;
+	}
+	p += strspn(p, " ");
+	k++;
+	if (k < n) {
+	    if (strncmp(p, "&&", 2)) {
+		*err = E_PARSE;
+	    } else {
+		p += 2;
+	    }
+	} else if (*p != '\0') {
+	    *err = E_PARSE;
+	}
+    }
+
+    if (*err) {
+	if (*err == E_PARSE) {
+	    gretl_errmsg_sprintf(_("%s: invalid restriction"), s);
+	}
+	free(c);
+	c = NULL;
+    } else {
+	*nc = n;
+    }
+
+    return c;
+}
+
+static void gdt_rowsel_destroy (gdt_rowsel *rs)
+{
+    if (rs != NULL) {
+	free(rs->sel);
+	free(rs->nsel);
+	free(rs);
+    }
+}
+
+/* Fill out @spec from the --rowmask and --restrict options to
+   command @ci. These are supported only for binary data.
+*/
+
+static int gdt_rowspec_init (gdt_rowspec *spec, int ci,
+			     gretlopt opt, int binary)
+{
+    if (!binary) {
+	gretl_errmsg_set(_("The --rowmask and --restrict options require "
+			   "a binary (gdtb) data file"));
+	return E_BADOPT;
+    }
+
+    if (opt & OPT_M) {
+	const char *s = get_optval_string(ci, OPT_M);
+
+	if (s == NULL) {
+	    return E_BADOPT;
+	}
+	spec->mask = get_matrix_by_name(s);
+	if (spec->mask == NULL) {
+	    gretl_errmsg_sprintf(_("'%s': no such matrix"), s);
+	    return E_DATA;
+	} else if (gretl_vector_get_length(spec->mask) == 0) {
+	    return E_NONCONF;
+	}
+    }
+
+    if (opt & OPT_E) {
+	spec->restr = get_optval_string(ci, OPT_E);
+	if (spec->restr == NULL || *spec->restr == '\0') {
+	    return E_BADOPT;
+	}
+    }
+
+    return 0;
+}
+
+/* Work out which rows of the data file are to be read, given
+   a row mask and/or a restriction in @spec.
+*/
+
+static gdt_rowsel *gdt_rowsel_new (const gdt_rowspec *spec,
+				   bin_reader *br,
+				   const DATASET *dset,
+				   int *err)
+{
+    gdt_rowsel *rs;
+    int j, t, t1 = -1;
+
+    if (dset->structure == STACKED_TIME_SERIES ||
+	dset->structure == STACKED_CROSS_SECTION) {
+	gretl_errmsg_set(_("Selection of rows is not supported "
+			   "for panel data"));
+	*err = E_BADOPT;
+	return NULL;
+    }
+
+    rs = calloc(1, sizeof *rs);
+    if (rs == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    rs->nsrc = br->nobs;
+    rs->sel = malloc(br->nobs + 1);
+    rs->nsel = calloc(br->nchunks + 1, sizeof *rs->nsel);
+    if (rs->sel == NULL || rs->nsel == NULL) {
+	*err = E_ALLOC;
+	gdt_rowsel_destroy(rs);
+	return NULL;
+    }
+
+    for (t=0; t<br->nobs; t++) {
+	if (spec->mask == NULL) {
+	    rs->sel[t] = 1;
+	} else {
+	    rs->sel[t] = t < gretl_vector_get_length(spec->mask) &&
+		gretl_vector_get(spec->mask, t) != 0;
+	}
+	rs->nsel[t / br->chunk_rows] += rs->sel[t];
+    }
+
+    if (spec->restr != NULL) {
+	bin_cond *c;
+	int nc = 0;
+
+	c = parse_gdt_restriction(spec->restr, dset, &nc, err);
+	if (!*err) {
+	    *err = bin_apply_restriction(br, c, nc, rs);
+	    if (*err == E_DATA) {
+		gretl_errmsg_set("Error reading binary data file");
+	    }
+	}
+	free(c);
+    }
+
+    if (!*err) {
+	for (j=0; j<br->nchunks; j++) {
+	    rs->n += rs->nsel[j];
+	}
+	if (rs->n == 0) {
+	    gretl_errmsg_set(_("No observations were selected"));
+	    *err = E_DATA;
+	}
+    }
+
+    if (*err) {
+	gdt_rowsel_destroy(rs);
+	return NULL;
+    }
+
+    rs->t0 = -1;
+    for (t=0; t<br->nobs; t++) {
+	if (rs->sel[t]) {
+	    if (rs->t0 < 0) {
+		rs->t0 = t;
+	    }
+	    t1 = t;
+	}
+    }
+    rs->contig = (t1 - rs->t0 + 1 == rs->n);
+
+    return rs;
+}
+
+/* Once the selected rows have been read into @dset, adjust its
+   starting and ending observations. If the rows are contiguous
+   the structure is unchanged; otherwise the dataset becomes an
+   undated cross section, and if it was dated the dates of the
+   selected observations are recorded as observation markers.
+*/
+
+static int gdt_rowsel_finish (DATASET *dset, const gdt_rowsel *rs)
+{
+    if (rs->contig) {
+	if (dset->structure == CROSS_SECTION) {
+	    strcpy(dset->stobs, "1");
+	} else {
+	    if (calendar_data(dset) && dset->S != NULL) {
+		strcpy(dset->stobs, dset->S[0]);
+	    } else {
+		ntolabel(dset->stobs, rs->t0, dset);
+	    }
+	    dset->sd0 = get_date_x(dset->pd, dset->stobs);
+	}
+    } else {
+	if (dset->structure != CROSS_SECTION && dset->S == NULL) {
+	    char **S = strings_array_new_with_length(dset->n, OBSLEN);
+	    int s = 0, t;
+
+	    if (S == NULL) {
+		return E_ALLOC;
+	    }
+	    for (t=0; t<rs->nsrc; t++) {
+		if (rs->sel[t]) {
+		    ntolabel(S[s++], t, dset);
+		}
+	    }
+	    dset->S = S;
+	    dset->markers = REGULAR_MARKERS;
+	}
+	dset->structure = CROSS_SECTION;
+	dset->pd = 1;
+	dset->sd0 = 1.0;
+	strcpy(dset->stobs, "1");
+    }
+
+    ntolabel(dset->endobs, dset->n - 1, dset);
+
+    return 0;
+}
+
+#ifndef WIN32
+
+/* binary data files at least this big are candidates for mapping */
+#define BIN_MMAP_MIN (1 << 24)
+
+/* Try mapping the binary data file @bname into memory and pointing
+   the wanted series of @dset into the mapping, as described in
+   dataset.c (see series_data_map_register()). This requires that
+   each of these series is stored uncompressed, in consecutive
+   chunks. We don't do this on MS Windows, where the file could
+   not then be deleted after unzipping. Returns 1 on success;
+   otherwise 0, in which case the data should be read in the
+   regular way.
+*/
+
+static int map_binary_data (const char *bname, bin_reader *br,
+			    DATASET *dset, int fullv,
+			    const int *vlist)
+{
+    GMappedFile *mf;
+    const char *buf;
+    gsize csize = br->chunk_rows * sizeof(double);
+    bin_chunk *bc;
+    int i, j, k = 1;
+
+    if (dset->v < 2 || br->fsize < BIN_MMAP_MIN) {
+	return 0;
+    }
+
+    for (i=1; i<fullv; i++) {
+	if (vlist == NULL || in_gretl_list(vlist, i)) {
+	    bc = bin_get_chunk(br, i, 0);
+	    for (j=0; j<br->nchunks; j++) {
+		if ((bc[j].flags & BIN_CHUNK_ZLIB) ||
+		    bc[j].offset != bc[0].offset + j * csize) {
+		    return 0;
+		}
+	    }
+	}
+    }
+
+    mf = g_mapped_file_new(bname, TRUE, NULL);
+    if (mf == NULL) {
+	return 0;
+    }
+
+    buf = g_mapped_file_get_contents(mf);
+    if (buf == NULL || g_mapped_file_get_length(mf) != br->fsize) {
+	g_mapped_file_unref(mf);
+	return 0;
+    }
+
+    if (series_data_map_register(mf, dset->v - 1, dset->n)) {
+	g_mapped_file_unref(mf);
+	return 0;
+    }
+
+    for (i=1; i<fullv; i++) {
+	if (vlist == NULL || in_gretl_list(vlist, i)) {
+	    bc = bin_get_chunk(br, i, 0);
+	    dset->Z[k++] = (double *) (buf + bc->offset);
+	}
+    }
+
+    return 1;
+}
+
+#endif
+
+/* Read the binary data for all series (or those in @vlist) into
+   @dset, whose Z array has been allocated but whose series (other
+   than the constant) have not. Only the chunks holding data for
+   these series are visited. If @spec is non-NULL just the rows it
+   specifies are read, in which case the resulting selection is
+   returned in @prs, and dset->n is reset. Otherwise, in the case
+   of a big file written in native byte order we may "map" rather
+   than read the data.
+*/
+
+static int read_binary_data (const char *fname,
+			     DATASET *dset,
+			     int order,
+			     double gdtversion,
+			     int fullv,
+			     const int *vlist,
+			     const gdt_rowspec *spec,
+			     gdt_rowsel **prs)
+{
+    gdt_rowsel *rs = NULL;
+    bin_reader *br;
+    char *bname;
+    int err = 0;
+
+    bname = switch_ext_new(fname, "bin");
+
+    br = bin_reader_open(bname, order, gdtversion, fullv - 1,
+			 dset->n, &err);
+
+    if (!err && spec != NULL) {
+	rs = gdt_rowsel_new(spec, br, dset, &err);
+	if (!err) {
+	    dset->n = rs->n;
+	}
+    }
+
+#ifndef WIN32
+    if (!err && rs == NULL && !br->swap && !br->old_na &&
+	map_binary_data(bname, br, dset, fullv, vlist)) {
+	bin_reader_destroy(br);
+	free(bname);
+	return 0;
+    }
+#endif
+
+    if (!err) {
+	int i, k = 1;
+
+	for (i=1; i<fullv && !err; i++) {
+	    if (vlist == NULL || in_gretl_list(vlist, i)) {
+		dset->Z[k] = malloc(dset->n * sizeof(double));
+		if (dset->Z[k] == NULL) {
+		    err = E_ALLOC;
+		} else {
+		    err = bin_read_series(br, i, dset->Z[k], rs);
+		}
+		k++;
+	    }
+	}
+	if (err == E_DATA) {
+	    gretl_errmsg_set("Error reading binary data file");
+	}
+    }
+
+    bin_reader_destroy(br);
+    free(bname);
+
+    if (!err && rs != NULL) {
+	*prs = rs;
+    } else {
+	gdt_rowsel_destroy(rs);
+    }
+
+    return err;
+}
+
+static void write_binary_order (PRN *prn)
+{
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    pputs(prn, " binary=\"little-endian\" ");
+#else
+    pputs(prn, " binary=\"big-endian\" ");
+#endif
+}
+
+/* Here we're testing a series to see if it can be represented in full
+   precision (discarding any artifacts) using the format "%.15g". The
+   criterion is that each value must have a least one trailing zero
+   when printed using "% .14e". We don't necessarily check every
+   element in the series; assuming a reasonable degree of homogeneity
+   in the data it ought to be enough if 100 members pass the test.
+*/
+
+static int p15_OK (const DATASET *dset, int v)
+{
+    const double *x = dset->Z[v];
+    char s[32];
+    int t, i, n_ok = 0;
+    int ret = 1;
+
+    for (t=dset->t1; t<=dset->t2; t++) {
+	if (!na(x[t])) {
+	    sprintf(s, "% .14e", x[t]);
+	    for (i=16; i>13; i--) {
+		if (s[i] != '0') {
+		    break;
+		}
+	    }
+	    if (i == 16) {
+		ret = 0;
+		break;
+	    }
+	    n_ok++;
+	}
+	if (n_ok > 100) {
+	    break;
+	}
+    }
+
+    return ret;
+}
+
+/* apparatus from trimming string-values on gdt save,
+   and restoration afterwards
+*/
+
+struct strval_saver_ {
+    int *list;
+    gretl_matrix *X;
+    series_table **st;
+    size_t sz;
+};
+
+typedef struct strval_saver_ strval_saver;
+
+static void strval_saver_destroy (strval_saver *ss)
+{
+    if (ss != NULL) {
+	free(ss->list);
+	gretl_matrix_free(ss->X);
+	free(ss->st);
+	free(ss);
+    }
+}
+
+static strval_saver *strval_saver_setup (DATASET *dset,
+					 int nvars, int nsv,
+					 int *list, int *err)
+{
+    strval_saver *ss;
+    int n_changed = 0;
+    int i, n;
+
+    ss = calloc(1, sizeof *ss);
+    if (ss == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    n = sample_size(dset);
+    ss->list = gretl_list_new(nsv);
+    ss->X = gretl_matrix_alloc(n, nsv);
+    ss->st = calloc(nsv, sizeof *ss->st);
+    if (ss->list == NULL || ss->X == NULL || ss->st == NULL) {
+	*err = E_ALLOC;
     }
 
     if (!*err) {
@@ -2420,6 +3489,9 @@ static int real_write_gdt (const char *fname, const int *inlist,
     /* support --oldbinary option */
     if (binary && (opt & OPT_O)) {
 	gdtver = GRETLDATA_COMPAT;
+    } else if (binary && (opt & OPT_K)) {
+	/* --chunked */
+	gdtver = GRETLDATA_CHUNKED;
     }
 
     pprintf(prn, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
@@ -2730,6 +3802,10 @@ int gretl_write_gdt (const char *fname, const int *list,
 	    if (!err) {
 		int level = get_compression_option(STORE);
 
+		if (opt & OPT_K) {
+		    /* the binary data are compressed by chunk */
+		    level = 0;
+		}
 		err = gretl_zip_datafile(fname, zdir, level);
 		if (err) {
 		    gretl_errmsg_ensure("Problem writing data file");
@@ -3071,88 +4147,283 @@ static int process_varlist_subset (xmlNodePtr node, DATASET *dset,
 	cur = cur->next;
     }
 
-    return err;
+    return err;
+}
+
+static void set_underflow_warning (int n)
+{
+    gchar *msg;
+
+    msg = g_strdup_printf(_("Data file contains %d subnormal values"), n);
+    gretl_warnmsg_set(msg);
+    g_free(msg);
+}
+
+/* Read the values for all (or selected) variables at
+   observation @t */
+
+static int process_values (DATASET *dset,
+			   int t, char *s,
+			   int fullv,
+			   const int *vlist,
+			   int *n_uflow)
+{
+    char *test;
+    double x;
+    int i, k = 1;
+    int err = 0;
+
+    gretl_error_clear();
+
+    for (i=1; i<fullv && !err; i++) {
+	while (isspace(*s)) s++;
+	if (vlist != NULL && !in_gretl_list(vlist, i)) {
+	    s += strcspn(s, " \t\r\n");
+	} else {
+	    x = strtod(s, &test);
+	    if (errno == ERANGE && SMALLVAL(x)) {
+		errno = 0; /* underflow, treat as OK? */
+		fprintf(stderr, "warning, underflow: %g for series %d (%s) at obs %d\n",
+			x, i, dset->varname[i], t + 1);
+		*n_uflow += 1;
+		s = test;
+	    } else if (errno) {
+		fprintf(stderr, "%s: %d: bad data\n", __FILE__, __LINE__);
+		perror(NULL);
+		err = E_DATA;
+	    } else if (!strncmp(test, "NA", 2)) {
+		x = NADBL;
+		s = test + 2;
+	    } else if (*test != '\0' && !isspace(*test)) {
+		err = 1;
+	    } else {
+		s = test;
+	    }
+	    if (!err && t < dset->n) {
+		dset->Z[k++][t] = x;
+	    }
+	}
+    }
+
+    /* check for trailing junk in <obs> line */
+    s += strspn(s, " \t");
+    if (*s) {
+	fprintf(stderr, "Warning: found trailing junk at obs %d:\n'%s'\n",
+		t + 1, s);
+    }
+
+    if (err && !gretl_errmsg_is_set()) {
+	gretl_errmsg_sprintf(_("Failed to parse data values at obs %d"), t+1);
+    }
+
+    return err;
+}
+
+/* Callbacks allowing libxml2's xmlTextReader to pull data from
+   a (possibly gzipped) gdt file via zlib */
+
+static int gdt_gz_read (void *context, char *buffer, int len)
+{
+    return gzread((gzFile) context, buffer, len);
+}
+
+static int gdt_gz_close (void *context)
+{
+    return gzclose((gzFile) context) == Z_OK ? 0 : -1;
+}
+
+/* Open a streaming reader on the gdt file @fname and advance it
+   to the root element, which is written into @pnode. We open
+   the file via gretl_gzopen(), which takes care of any issues
+   with the encoding of @fname on MS Windows.
+*/
+
+static xmlTextReaderPtr gdt_reader_open (const char *fname,
+					 xmlNodePtr *pnode,
+					 int *err)
+{
+    xmlTextReaderPtr reader;
+    gzFile fz;
+    int ret;
+
+    LIBXML_TEST_VERSION;
+
+    fz = gretl_gzopen(fname, "rb");
+    if (fz == NULL) {
+	gretl_errmsg_sprintf(_("Couldn't open %s"), fname);
+	*err = E_FOPEN;
+	return NULL;
+    }
+
+    /* note: on failure @fz is closed via gdt_gz_close */
+    reader = xmlReaderForIO(gdt_gz_read, gdt_gz_close, fz,
+			    fname, NULL, XML_PARSE_NOBLANKS);
+    if (reader == NULL) {
+	gretl_errmsg_sprintf(_("xmlParseFile failed on %s"), fname);
+	*err = 1;
+	return NULL;
+    }
+
+    while ((ret = xmlTextReaderRead(reader)) == 1) {
+	if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT) {
+	    break;
+	}
+    }
+
+    if (ret < 0) {
+	gretl_errmsg_sprintf(_("xmlParseFile failed on %s"), fname);
+	*err = 1;
+    } else if (ret == 0) {
+	gretl_errmsg_sprintf(_("%s: empty document"), fname);
+	*err = 1;
+    } else if (xmlStrcmp(xmlTextReaderConstName(reader), (XUC) "gretldata")) {
+	gretl_errmsg_sprintf(_("File of the wrong type, root node not %s"),
+			     "gretldata");
+	*err = 1;
+    } else {
+	*pnode = xmlTextReaderCurrentNode(reader);
+    }
+
+    if (*err) {
+	xmlFreeTextReader(reader);
+	reader = NULL;
+    }
+
+    return reader;
+}
+
+/* Advance @reader to the next child element of the root node: if
+   @skip is non-zero we first skip the subtree of the current node.
+   Returns 1 if an element is found, 0 at the end of the document,
+   or -1 on a parse error.
+*/
+
+static int gdt_reader_next_child (xmlTextReaderPtr reader, int skip)
+{
+    int ret;
+
+    ret = skip ? xmlTextReaderNext(reader) : xmlTextReaderRead(reader);
+
+    while (ret == 1) {
+	if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT &&
+	    xmlTextReaderDepth(reader) == 1) {
+	    break;
+	}
+	ret = xmlTextReaderRead(reader);
+    }
+
+    return ret;
 }
 
-static void set_underflow_warning (int n)
+/* Iterate across the <obs> elements inside the <observations>
+   element on which @reader is positioned, picking up observation
+   markers if wanted and, unless @binary is non-zero, reading the
+   data values straight into @dset. The reader discards each <obs>
+   element once we've moved past it, so the full XML tree is never
+   held in memory. If @rs is non-NULL only the rows it selects are
+   transcribed. The number of <obs> elements found is written into
+   @pt.
+*/
+
+static int stream_observations (xmlTextReaderPtr reader,
+				DATASET *dset, int binary,
+				int fullv, const int *vlist,
+				const gdt_rowsel *rs,
+				int (*show_progress) (double, double, int),
+				int *n_uflow, int *pt)
 {
-    gchar *msg;
+    xmlChar *tmp;
+    int nsrc = rs != NULL ? rs->nsrc : dset->n;
+    int depth, ret;
+    int t = 0, s = 0;
+    int err = 0;
 
-    msg = g_strdup_printf(_("Data file contains %d subnormal values"), n);
-    gretl_warnmsg_set(msg);
-    g_free(msg);
-}
+    if (xmlTextReaderIsEmptyElement(reader)) {
+	gretl_errmsg_set(_("Got no observations\n"));
+	return E_DATA;
+    }
 
-/* Read the values for all (or selected) variables at
-   observation @t */
+    depth = xmlTextReaderDepth(reader);
 
-static int process_values (DATASET *dset,
-			   int t, char *s,
-			   int fullv,
-			   const int *vlist,
-			   int *n_uflow)
-{
-    char *test;
-    double x;
-    int i, k = 1;
-    int err = 0;
+    while (!err && (ret = xmlTextReaderRead(reader)) == 1) {
+	int type = xmlTextReaderNodeType(reader);
 
-    gretl_error_clear();
+	if (type == XML_READER_TYPE_END_ELEMENT &&
+	    xmlTextReaderDepth(reader) == depth) {
+	    break;
+	} else if (type != XML_READER_TYPE_ELEMENT ||
+		   xmlStrcmp(xmlTextReaderConstName(reader), (XUC) "obs")) {
+	    continue;
+	}
 
-    for (i=1; i<fullv && !err; i++) {
-	while (isspace(*s)) s++;
-	if (vlist != NULL && !in_gretl_list(vlist, i)) {
-	    s += strcspn(s, " \t\r\n");
-	} else {
-	    x = strtod(s, &test);
-	    if (errno == ERANGE && SMALLVAL(x)) {
-		errno = 0; /* underflow, treat as OK? */
-		fprintf(stderr, "warning, underflow: %g for series %d (%s) at obs %d\n",
-			x, i, dset->varname[i], t + 1);
-		*n_uflow += 1;
-		s = test;
-	    } else if (errno) {
-		fprintf(stderr, "%s: %d: bad data\n", __FILE__, __LINE__);
-		perror(NULL);
-		err = E_DATA;
-	    } else if (!strncmp(test, "NA", 2)) {
-		x = NADBL;
-		s = test + 2;
-	    } else if (*test != '\0' && !isspace(*test)) {
-		err = 1;
+	if (t == nsrc) {
+	    /* got too many observations */
+	    t = nsrc + 1;
+	    break;
+	}
+
+	if (rs != NULL && !rs->sel[t]) {
+	    /* not a selected row */
+	    t++;
+	    continue;
+	}
+
+	if (dset->markers) {
+	    tmp = xmlTextReaderGetAttribute(reader, (XUC) "label");
+	    if (tmp) {
+		transcribe_string(dset->S[s], (char *) tmp, OBSLEN);
+		free(tmp);
 	    } else {
-		s = test;
+		gretl_errmsg_sprintf(_("Case marker missing at obs %d"), t+1);
+		return E_DATA;
 	    }
-	    if (!err && t < dset->n) {
-		dset->Z[k++][t] = x;
+	}
+
+	if (!binary) {
+	    tmp = xmlTextReaderReadString(reader);
+	    if (tmp) {
+		err = process_values(dset, s, (char *) tmp, fullv, vlist, n_uflow);
+		free(tmp);
+	    } else if (dset->v > 1) {
+		gretl_errmsg_sprintf(_("Values missing at observation %d"), t+1);
+		err = E_DATA;
 	    }
 	}
-    }
 
-    /* check for trailing junk in <obs> line */
-    s += strspn(s, " \t");
-    if (*s) {
-	fprintf(stderr, "Warning: found trailing junk at obs %d:\n'%s'\n",
-		t + 1, s);
+	t++;
+	s++;
+
+	if (show_progress != NULL && t % 50 == 0) {
+	    (*show_progress) (50, dset->n, SP_NONE);
+	}
     }
 
-    if (err && !gretl_errmsg_is_set()) {
-	gretl_errmsg_sprintf(_("Failed to parse data values at obs %d"), t+1);
+    if (!err && ret < 0) {
+	err = E_DATA;
     }
 
+    *pt = t;
+
     return err;
 }
 
-static int read_observations (xmlDocPtr doc, xmlNodePtr node,
+/* Read the <observations> element. If @spec is non-NULL (which
+   requires binary data) only the rows it specifies are read, and
+   the number of observations in @dset is reduced accordingly.
+*/
+
+static int read_observations (xmlTextReaderPtr reader, xmlNodePtr node,
 			      DATASET *dset, double dsize,
 			      int binary, double gdtversion,
-			      const char *fname)
+			      const char *fname,
+			      const gdt_rowspec *spec)
 {
-    xmlNodePtr cur;
     xmlChar *tmp;
+    gdt_rowsel *rs = NULL;
     int n, i, t;
     int (*show_progress) (double, double, int) = NULL;
     int progbar = 0;
+    int markers = 0;
     int n_uflow = 0;
     int err = 0;
 
@@ -3179,16 +4450,30 @@ static int read_observations (xmlDocPtr doc, xmlNodePtr node,
 
     tmp = xmlGetProp(node, (XUC) "labels");
     if (tmp) {
-	if (!strcmp((char *) tmp, "true")) {
-	    if (dataset_allocate_obs_markers(dset)) {
-		return E_ALLOC;
-	    }
-	}
+	markers = !strcmp((char *) tmp, "true");
 	free(tmp);
     } else {
 	return E_DATA;
     }
 
+    for (i=0; i<dset->v; i++) {
+	dset->Z[i] = NULL;
+    }
+
+    if (binary) {
+	/* this may reduce dset->n, given @spec */
+	err = read_binary_data(fname, dset, binary, gdtversion,
+			       dset->v, NULL, spec, &rs);
+	if (err) {
+	    return err;
+	}
+    }
+
+    if (markers && dataset_allocate_obs_markers(dset)) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
     if (dset->endobs[0] == '\0') {
 	sprintf(dset->endobs, "%d", dset->n);
     }
@@ -3196,9 +4481,14 @@ static int read_observations (xmlDocPtr doc, xmlNodePtr node,
     dset->t2 = dset->n - 1;
 
     for (i=0; i<dset->v; i++) {
+	if (binary && i > 0) {
+	    /* handled by read_binary_data() */
+	    continue;
+	}
 	dset->Z[i] = malloc(dset->n * sizeof **dset->Z);
 	if (dset->Z[i] == NULL) {
-	    return E_ALLOC;
+	    err = E_ALLOC;
+	    goto bailout;
 	}
     }
 
@@ -3206,23 +4496,9 @@ static int read_observations (xmlDocPtr doc, xmlNodePtr node,
 	dset->Z[0][t] = 1.0;
     }
 
-    if (binary) {
-	err = read_binary_data(fname, dset, binary, gdtversion,
-			       dset->v, NULL);
-	if (!dset->markers) {
-	    goto bailout;
-	}
-    }
-
-    /* now get individual obs info: labels and values */
-    cur = node->xmlChildrenNode;
-    while (cur && xmlIsBlankNode(cur)) {
-	cur = cur->next;
-    }
-
-    if (cur == NULL) {
-	gretl_errmsg_set(_("Got no observations\n"));
-	return E_DATA;
+    if (binary && !dset->markers) {
+	t = n;
+	goto bailout;
     }
 
     if (progbar) {
@@ -3233,48 +4509,9 @@ static int read_observations (xmlDocPtr doc, xmlNodePtr node,
 #endif
     }
 
-    t = 0;
-    while (cur != NULL) {
-        if (!xmlStrcmp(cur->name, (XUC) "obs")) {
-	    if (dset->markers) {
-		tmp = xmlGetProp(cur, (XUC) "label");
-		if (tmp) {
-		    transcribe_string(dset->S[t], (char *) tmp, OBSLEN);
-		    free(tmp);
-		} else {
-		    gretl_errmsg_sprintf(_("Case marker missing at obs %d"), t+1);
-		    return E_DATA;
-		}
-	    }
-	    if (!binary) {
-		tmp = xmlNodeListGetRawString(doc, cur->xmlChildrenNode, 1);
-		if (tmp) {
-		    err = process_values(dset, t, (char *) tmp, dset->v, NULL, &n_uflow);
-		    free(tmp);
-		} else if (dset->v > 1) {
-		    gretl_errmsg_sprintf(_("Values missing at observation %d"), t+1);
-		    err = E_DATA;
-		}
-	    }
-	    t++;
-	}
-
-	if (err) {
-	    break;
-	}
-
-	cur = cur->next;
-
-	if (cur != NULL && t == dset->n) {
-	    /* got too many observations */
-	    t = dset->n + 1;
-	    break;
-	}
-
-	if (progbar && t > 0 && t % 50 == 0) {
-	    (*show_progress) (50, dset->n, SP_NONE);
-	}
-    }
+    /* now get individual obs info: labels and values */
+    err = stream_observations(reader, dset, binary, dset->v, rs,
+			      show_progress, &n_uflow, &t);
 
  bailout:
 
@@ -3285,19 +4522,25 @@ static int read_observations (xmlDocPtr doc, xmlNodePtr node,
 	(*show_progress)(0, dset->n, SP_FINISH);
     }
 
-    if (!err && t != dset->n) {
+    if (!err && t != n) {
 	gretl_errmsg_set(_("Number of observations does not match declaration"));
 	err = E_DATA;
     }
 
+    if (!err && rs != NULL) {
+	err = gdt_rowsel_finish(dset, rs);
+    }
+
     if (!err && n_uflow > 0) {
 	set_underflow_warning(n_uflow);
     }
 
+    gdt_rowsel_destroy(rs);
+
     return err;
 }
 
-static int read_observations_subset (xmlDocPtr doc,
+static int read_observations_subset (xmlTextReaderPtr reader,
 				     xmlNodePtr node,
 				     DATASET *dset,
 				     int binary,
@@ -3307,7 +4550,6 @@ static int read_observations_subset (xmlDocPtr doc,
 				     const int *vlist,
 				     gretlopt opt)
 {
-    xmlNodePtr cur;
     xmlChar *tmp;
     int n, i, t;
     int n_uflow = 0;
@@ -3348,6 +4590,11 @@ static int read_observations_subset (xmlDocPtr doc,
     dset->t2 = dset->n - 1;
 
     for (i=0; i<dset->v; i++) {
+	if (binary && i > 0) {
+	    /* deferred to read_binary_data() */
+	    dset->Z[i] = NULL;
+	    continue;
+	}
 	dset->Z[i] = malloc(dset->n * sizeof **dset->Z);
 	if (dset->Z[i] == NULL) {
 	    return E_ALLOC;
@@ -3360,61 +4607,15 @@ static int read_observations_subset (xmlDocPtr doc,
 
     if (binary) {
 	err = read_binary_data(fname, dset, binary, gdtversion,
-			       fullv, vlist);
-	if (!dset->markers) {
+			       fullv, vlist, NULL, NULL);
+	if (err || !dset->markers) {
 	    goto bailout;
 	}
     }
 
     /* now get individual obs info: labels and values */
-    cur = node->xmlChildrenNode;
-    while (cur && xmlIsBlankNode(cur)) {
-	cur = cur->next;
-    }
-
-    if (cur == NULL) {
-	gretl_errmsg_set(_("Got no observations\n"));
-	return E_DATA;
-    }
-
-    t = 0;
-    while (cur != NULL) {
-        if (!xmlStrcmp(cur->name, (XUC) "obs")) {
-	    if (dset->markers) {
-		tmp = xmlGetProp(cur, (XUC) "label");
-		if (tmp) {
-		    transcribe_string(dset->S[t], (char *) tmp, OBSLEN);
-		    free(tmp);
-		} else {
-		    gretl_errmsg_sprintf(_("Case marker missing at obs %d"), t+1);
-		    return E_DATA;
-		}
-	    }
-	    if (!binary) {
-		tmp = xmlNodeListGetRawString(doc, cur->xmlChildrenNode, 1);
-		if (tmp) {
-		    err = process_values(dset, t, (char *) tmp, fullv, vlist, &n_uflow);
-		    free(tmp);
-		} else if (dset->v > 1) {
-		    gretl_errmsg_sprintf(_("Values missing at observation %d"), t+1);
-		    err = E_DATA;
-		}
-	    }
-	    t++;
-	}
-
-	if (err) {
-	    break;
-	}
-
-	cur = cur->next;
-
-	if (cur != NULL && t == dset->n) {
-	    /* got too many observations */
-	    t = dset->n + 1;
-	    goto bailout;
-	}
-    }
+    err = stream_observations(reader, dset, binary, fullv, vlist,
+			      NULL, NULL, &n_uflow, &t);
 
  bailout:
 
@@ -3907,10 +5108,13 @@ static int real_read_gdt (const char *fname, const char *srcname,
 			  DATASET *dset, gretlopt opt, PRN *prn)
 {
     DATASET *tmpset;
-    xmlDocPtr doc = NULL;
-    xmlNodePtr cur;
+    xmlTextReaderPtr reader = NULL;
+    xmlNodePtr cur = NULL;
+    gdt_rowspec rowspec = {NULL, NULL};
+    gdt_rowspec *rspec = NULL;
     int gotvars = 0, gotobs = 0, err = 0;
     int caldata = 0, repad = 0;
+    int ret;
     double gdtversion = 1.0;
     double myversion;
     int in_c_locale = 0;
@@ -3937,14 +5141,13 @@ static int real_read_gdt (const char *fname, const char *srcname,
 	goto bailout;
     }
 
-    err = gretl_xml_open_doc_root(fname, "gretldata",
-				  &doc, &cur);
+    reader = gdt_reader_open(fname, &cur, &err);
     if (err) {
 	goto bailout;
     }
 
     gdtversion = get_gdt_version(cur);
-    myversion = dot_atof(GRETLDATA_VERSION);
+    myversion = dot_atof(GRETLDATA_CHUNKED);
     if (gdtversion > myversion) {
 	future_datafile_warning(gdtversion, myversion);
     }
@@ -3988,44 +5191,62 @@ static int real_read_gdt (const char *fname, const char *srcname,
 
     binary = gdt_binary_order(cur);
 
+    if (opt & (OPT_M | OPT_E)) {
+	/* --rowmask and/or --restrict, with "open" or "append" */
+	int ci = (dset != NULL && dset->v > 0)? APPEND : OPEN;
+
+	rspec = &rowspec;
+	err = gdt_rowspec_init(rspec, ci, opt, binary);
+	if (err) {
+	    goto bailout;
+	}
+    }
+
 #if GDT_DEBUG
-    fprintf(stderr, "starting to walk XML tree...\n");
+    fprintf(stderr, "starting to read XML stream...\n");
 #endif
 
-    /* Now walk the tree */
-    cur = cur->xmlChildrenNode;
-    while (cur != NULL && !err) {
-        if (!xmlStrcmp(cur->name, (XUC) "description")) {
-	    tmpset->descrip = (char *)
-		xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
-        } else if (!xmlStrcmp(cur->name, (XUC) "variables")) {
-	    err = process_varlist(cur, tmpset, 0);
-	    if (err) {
-		fprintf(stderr, "error processing varlist\n");
-	    } else {
-		gotvars = 1;
-	    }
-	} else if (!xmlStrcmp(cur->name, (XUC) "observations")) {
+    /* Now read the child elements of the root: with the exception
+       of <observations> these are small, and we expand each of
+       them into a subtree to be processed in the usual way
+    */
+    ret = gdt_reader_next_child(reader, 0);
+    while (ret == 1 && !err) {
+	if (!xmlStrcmp(xmlTextReaderConstName(reader), (XUC) "observations")) {
 	    if (!gotvars) {
 		gretl_errmsg_set(_("Variables information is missing"));
 		err = 1;
 	    } else {
 		double dsize = (opt & OPT_B)? (double) fsz : 0;
 
-		err = read_observations(doc, cur, tmpset, dsize,
-					binary, gdtversion, fname);
+		cur = xmlTextReaderCurrentNode(reader);
+		err = read_observations(reader, cur, tmpset, dsize,
+					binary, gdtversion, fname,
+					rspec);
 		if (err) {
 		    fprintf(stderr, "error %d in read_observations\n", err);
 		} else {
 		    gotobs = 1;
 		}
 	    }
+	} else if ((cur = xmlTextReaderExpand(reader)) == NULL) {
+	    err = E_DATA;
+	} else if (!xmlStrcmp(cur->name, (XUC) "description")) {
+	    tmpset->descrip = (char *)
+		xmlNodeListGetString(cur->doc, cur->xmlChildrenNode, 1);
+        } else if (!xmlStrcmp(cur->name, (XUC) "variables")) {
+	    err = process_varlist(cur, tmpset, 0);
+	    if (err) {
+		fprintf(stderr, "error processing varlist\n");
+	    } else {
+		gotvars = 1;
+	    }
 	} else if (!xmlStrcmp(cur->name, (XUC) "string-tables")) {
 	    if (!gotvars) {
 		gretl_errmsg_set(_("Variables information is missing"));
 		err = E_DATA;
 	    } else {
-		err = process_string_tables(doc, cur, tmpset, 0);
+		err = process_string_tables(cur->doc, cur, tmpset, 0);
 		if (err) {
 		    fprintf(stderr, "error %d processing string tables\n", err);
 		}
@@ -4042,12 +5263,16 @@ static int real_read_gdt (const char *fname, const char *srcname,
 	    }
 	}
 	if (!err) {
-	    cur = cur->next;
+	    ret = gdt_reader_next_child(reader, 1);
 	}
     }
 
+    if (!err && ret < 0) {
+	err = E_DATA;
+    }
+
 #if GDT_DEBUG
-    fprintf(stderr, "done walking XML tree, err = %d\n", err);
+    fprintf(stderr, "done reading XML stream, err = %d\n", err);
 #endif
 
     if (!err && !gotvars) {
@@ -4060,7 +5285,7 @@ static int real_read_gdt (const char *fname, const char *srcname,
 	err = 1;
     }
 
-    if (!err && caldata && tmpset->S != NULL) {
+    if (!err && caldata && calendar_data(tmpset) && tmpset->S != NULL) {
 	check_for_daily_date_strings(tmpset);
     }
 
@@ -4083,8 +5308,8 @@ static int real_read_gdt (const char *fname, const char *srcname,
 	gretl_pop_c_numeric_locale();
     }
 
-    if (doc != NULL) {
-	xmlFreeDoc(doc);
+    if (reader != NULL) {
+	xmlFreeTextReader(reader);
     }
 
     /* pre-process stacked cross-sectional panels: put into canonical
@@ -4133,15 +5358,15 @@ static int real_read_gdt_subset (const char *fname,
 				 gretlopt opt)
 {
     DATASET *tmpset;
-    xmlDocPtr doc = NULL;
-    xmlNodePtr cur;
+    xmlTextReaderPtr reader = NULL;
+    xmlNodePtr cur = NULL;
     double gdtversion = 1.0;
     int gotvars = 0, gotobs = 0;
     int caldata = 0;
     int in_c_locale = 0;
     int binary = 0;
     int fullv = 0;
-    int err = 0;
+    int ret, err = 0;
 
     gretl_error_clear();
 
@@ -4151,7 +5376,7 @@ static int real_read_gdt_subset (const char *fname,
 	goto bailout;
     }
 
-    err = gretl_xml_open_doc_root(fname, "gretldata", &doc, &cur);
+    reader = gdt_reader_open(fname, &cur, &err);
     if (err) {
 	goto bailout;
     }
@@ -4192,23 +5417,21 @@ static int real_read_gdt_subset (const char *fname,
     binary = gdt_binary_order(cur);
 
 #if GDT_DEBUG
-    fprintf(stderr, "%s: starting to walk XML tree...\n", fname);
+    fprintf(stderr, "%s: starting to read XML stream...\n", fname);
 #endif
 
-    /* Now walk the tree */
-    cur = cur->xmlChildrenNode;
-    while (cur != NULL && !err) {
-        if (!xmlStrcmp(cur->name, (XUC) "variables")) {
-	    err = process_varlist_subset(cur, tmpset, &fullv, vlist);
-	    if (!err) {
-		gotvars = 1;
-	    }
-	} else if (!xmlStrcmp(cur->name, (XUC) "observations")) {
+    /* Now read the child elements of the root: the values of
+       unwanted series are skipped as we go, and never stored
+    */
+    ret = gdt_reader_next_child(reader, 0);
+    while (ret == 1 && !err) {
+	if (!xmlStrcmp(xmlTextReaderConstName(reader), (XUC) "observations")) {
 	    if (!gotvars) {
 		gretl_errmsg_set(_("Variables information is missing"));
 		err = E_DATA;
 	    } else {
-		err = read_observations_subset(doc, cur, tmpset,
+		cur = xmlTextReaderCurrentNode(reader);
+		err = read_observations_subset(reader, cur, tmpset,
 					       binary, gdtversion,
 					       fname, fullv, vlist,
 					       opt);
@@ -4216,21 +5439,32 @@ static int real_read_gdt_subset (const char *fname,
 	    if (!err) {
 		gotobs = 1;
 	    }
+	} else if ((cur = xmlTextReaderExpand(reader)) == NULL) {
+	    err = E_DATA;
+        } else if (!xmlStrcmp(cur->name, (XUC) "variables")) {
+	    err = process_varlist_subset(cur, tmpset, &fullv, vlist);
+	    if (!err) {
+		gotvars = 1;
+	    }
 	} else if (!xmlStrcmp(cur->name, (XUC) "string-tables")) {
 	    if (!gotvars) {
 		gretl_errmsg_set(_("Variables information is missing"));
 		err = 1;
 	    } else {
-		err = process_string_tables(doc, cur, tmpset, 1);
+		err = process_string_tables(cur->doc, cur, tmpset, 1);
 	    }
 	}
 	if (!err) {
-	    cur = cur->next;
+	    ret = gdt_reader_next_child(reader, 1);
 	}
     }
 
+    if (!err && ret < 0) {
+	err = E_DATA;
+    }
+
 #if GDT_DEBUG
-    fprintf(stderr, "done walking XML tree...\n");
+    fprintf(stderr, "done reading XML stream...\n");
 #endif
 
     if (!err && !gotvars) {
@@ -4253,8 +5487,8 @@ static int real_read_gdt_subset (const char *fname,
 	gretl_pop_c_numeric_locale();
     }
 
-    if (doc != NULL) {
-	xmlFreeDoc(doc);
+    if (reader != NULL) {
+	xmlFreeTextReader(reader);
     }
 
     if (!err) {
@@ -4276,12 +5510,12 @@ static int real_read_gdt_varnames (const char *fname,
 				   int *nvars)
 {
     DATASET *tmpset;
-    xmlDocPtr doc = NULL;
-    xmlNodePtr cur;
+    xmlTextReaderPtr reader = NULL;
+    xmlNodePtr cur = NULL;
     int gotvars = 0;
     int caldata = 0;
     int in_c_locale = 0;
-    int err = 0;
+    int ret, err = 0;
 
     gretl_error_clear();
 
@@ -4291,7 +5525,7 @@ static int real_read_gdt_varnames (const char *fname,
 	goto bailout;
     }
 
-    err = gretl_xml_open_doc_root(fname, "gretldata", &doc, &cur);
+    reader = gdt_reader_open(fname, &cur, &err);
     if (err) {
 	goto bailout;
     }
@@ -4327,17 +5561,24 @@ static int real_read_gdt_varnames (const char *fname,
 	goto bailout;
     }
 
-    /* Now walk the tree */
-    cur = cur->xmlChildrenNode;
-    while (cur != NULL && !err) {
-        if (!xmlStrcmp(cur->name, (XUC) "variables")) {
-	    err = process_varlist(cur, tmpset, 1);
+    /* Now find the variables info: there's no need to read
+       any further than that
+    */
+    ret = gdt_reader_next_child(reader, 0);
+    while (ret == 1 && !err) {
+	if (!xmlStrcmp(xmlTextReaderConstName(reader), (XUC) "variables")) {
+	    cur = xmlTextReaderExpand(reader);
+	    if (cur == NULL) {
+		err = E_DATA;
+	    } else {
+		err = process_varlist(cur, tmpset, 1);
+	    }
 	    if (!err) {
 		gotvars = 1;
 	    }
 	    break;
 	}
-	cur = cur->next;
+	ret = gdt_reader_next_child(reader, 1);
     }
 
     if (!err && !gotvars) {
@@ -4351,8 +5592,8 @@ static int real_read_gdt_varnames (const char *fname,
 	gretl_pop_c_numeric_locale();
     }
 
-    if (doc != NULL) {
-	xmlFreeDoc(doc);
+    if (reader != NULL) {
+	xmlFreeTextReader(reader);
     }
 
     if (!err) {
@@ -182,6 +182,23 @@ static int filter_comments (char *s, CMD *cmd)
     return filt;
 }
 
+/**
+ * filter_command_line:
+ * @line: command line, modified in place.
+ * @cmd: command struct.
+ *
+ * Normalizes the spaces in @line and strips any comments, as
+ * is done before a command is tokenized.
+ *
+ * Returns: non-zero if the whole line is a comment.
+ */
+
+int filter_command_line (char *line, CMD *cmd)
+{
+    compress_spaces(line);
+    return filter_comments(line, cmd);
+}
+
 #define MODIFIES_LIST(c) (c == DIFF ||		\
 			  c == DUMMIFY ||	\
 			  c == LDIFF ||		\
@@ -300,11 +317,9 @@ int parse_command_line (ExecState *s, DATASET *dset, void *ptr)
     }
 
     if ((cmd->flags & CMD_SUBST) || !gretl_looping_currently()) {
-	/* normalize line spaces */
-	compress_spaces(line);
-
-	/* trap lines that are nothing but comments */
-	if (filter_comments(line, cmd)) {
+	/* normalize line spaces, trap lines that are nothing
+	   but comments */
+	if (filter_command_line(line, cmd)) {
 	    return 0;
 	}
 
@@ -3012,6 +3027,40 @@ static int panel_smpl_special (gretlopt opt)
     return opt & OPT_U;
 }
 
+/* Called from within a user function, on the first execution of
+   a "genr" line: compile the expression so that it can be run
+   without re-parsing on subsequent calls. Declarations and
+   non-equation specials such as "genr time" can't be compiled;
+   in that case we just execute the line in the regular way.
+   Compiling also executes the line, after which we do the
+   same post-processing as generate() and check whether the
+   compiled form is suitable for re-use.
+*/
+
+static int compile_function_genr (ExecState *s, DATASET *dset)
+{
+    CMD *cmd = s->cmd;
+    int oldv = dset != NULL ? dset->v : 0;
+    int err = 0;
+
+    *s->pgenr = genr_compile(cmd->vstart, dset, cmd->gtype,
+			     cmd->opt, s->prn, &err);
+
+    if (err == E_EQN || err == E_PARSE) {
+	gretl_error_clear();
+	err = generate(cmd->vstart, dset, cmd->gtype,
+		       cmd->opt, s->prn);
+    } else if (*s->pgenr != NULL) {
+	genr_finish_command(*s->pgenr, NULL, oldv, cmd->opt, s->prn);
+	if (!genr_command_cacheable(*s->pgenr)) {
+	    destroy_genr(*s->pgenr);
+	    *s->pgenr = NULL;
+	}
+    }
+
+    return err;
+}
+
 static void maybe_print_error_message (CMD *cmd, int err, PRN *prn)
 {
     if (gretl_function_depth() > 0) {
@@ -3040,6 +3089,11 @@ int gretl_cmd_exec (ExecState *s, DATASET *dset)
     exec_state_prep(s);
     plot_ok = 0;
 
+    if (s->pgenr != NULL && cmd->ci != GENR) {
+	/* a compiled genr is wanted for this command only */
+	s->pgenr = NULL;
+    }
+
     if (gretl_in_gui_mode() && check_for_stop()) {
 	/* the GUI user clicked the "Stop" button */
 	abort_execution(s);
@@ -3220,6 +3274,9 @@ int gretl_cmd_exec (ExecState *s, DATASET *dset)
 	    if (err == E_BADCATCH) {
 		cmd->flags ^= CMD_CATCH;
 	    }
+	} else if (s->pgenr != NULL && cmd->ci == GENR &&
+		   !cmd_subst(cmd) && !(cmd->opt & ~OPT_O)) {
+	    err = compile_function_genr(s, dset);
 	} else {
 	    err = generate(cmd->vstart, dset, cmd->gtype,
 			   cmd->opt, prn);
@@ -4145,6 +4202,7 @@ void gretl_exec_state_init (ExecState *s,
     s->var = NULL;
     s->in_comment = 0;
     s->padded = 0;
+    s->pgenr = NULL;
 
     if (flags == FUNCTION_EXEC) {
 	/* On entry to function execution we check if there's
@@ -82,6 +82,8 @@ void gretl_cmd_set_opt (CMD *cmd, gretlopt opt);
 
 int parse_command_line (ExecState *s, DATASET *dset, void *ptr);
 
+int filter_command_line (char *line, CMD *cmd);
+
 int parse_gui_command (char *line, CMD *cmd, DATASET *dset);
 
 const char *get_parser_errline (void);
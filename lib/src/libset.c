@@ -25,6 +25,7 @@
 #include "uservar.h"
 #include "matrix_extra.h"
 #include "gretl_func.h"
+#include "gretl_cmatrix.h"
 
 #ifdef _OPENMP
 # include <omp.h>
@@ -166,6 +167,8 @@ struct set_vars_ {
 			   !strcmp(s, MWRITE_G) || \
 			   !strcmp(s, GEOJSON_FAST) || \
 			   !strcmp(s, MPI_USE_SMT) || \
+			   !strcmp(s, FFT_MEASURE) || \
+			   !strcmp(s, MATRIX_POOL) || \
 			   !strcmp(s, USE_OPENMP))
 
 #define libset_double(s) (!strcmp(s, CONV_HUGE) || \
@@ -1663,6 +1666,7 @@ static int print_settings (PRN *prn, gretlopt opt)
     libset_print_int(OMP_N_THREADS, prn, opt);
     libset_print_int(SIMD_K_MAX, prn, opt);
     libset_print_int(SIMD_MN_MIN, prn, opt);
+    libset_print_bool(MATRIX_POOL, prn, opt);
 
     if (opt & OPT_D) {
 	/* display only */
@@ -1699,6 +1703,7 @@ static int print_settings (PRN *prn, gretlopt opt)
     libset_print_double(NADARWAT_TRIM, prn, opt);
     libset_print_int(FDJAC_QUAL, prn, opt);
     libset_print_double(FDJAC_EPS, prn, opt);
+    libset_print_bool(FFT_MEASURE, prn, opt);
 
     libset_header(N_("Random number generation"), prn, opt);
 
@@ -2413,6 +2418,10 @@ int libset_get_bool (const char *key)
         return gretl_rand_get_dcmt();
     } else if (!strcmp(key, GEOJSON_FAST)) {
 	return geojson_fast;
+    } else if (!strcmp(key, FFT_MEASURE)) {
+	return gretl_fft_get_measure();
+    } else if (!strcmp(key, MATRIX_POOL)) {
+	return gretl_matrix_pool_get();
     }
 
     if (check_for_state()) {
@@ -2517,6 +2526,10 @@ int libset_set_bool (const char *key, int val)
     } else if (!strcmp(key, GEOJSON_FAST)) {
 	geojson_fast = val;
 	return 0;
+    } else if (!strcmp(key, FFT_MEASURE)) {
+	return gretl_fft_set_measure(val);
+    } else if (!strcmp(key, MATRIX_POOL)) {
+	return gretl_matrix_pool_set(val);
     }
 
     flag = boolvar_get_flag(key);
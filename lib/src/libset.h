@@ -93,6 +93,8 @@ typedef enum {
 #define MWRITE_G         "mwrite_g"
 #define MPI_USE_SMT      "mpi_use_smt"
 #define GEOJSON_FAST     "geojson_fast"
+#define FFT_MEASURE      "fft_measure"
+#define MATRIX_POOL      "matrix_pool"
 #define GRETL_ASSERT     "assert"
 
 typedef void (*SHOW_ACTIVITY_FUNC) (void);
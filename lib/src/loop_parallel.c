@@ -0,0 +1,970 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Included by monte_carlo.c: support for "loop --parallel".
+
+   The iterations of an outermost count or index loop are split
+   into contiguous blocks, one per worker. Since the interpreter
+   keeps much of its state in static variables we use worker
+   processes created via fork() rather than threads: each child
+   gets its own copy-on-write image of the dataset and the user
+   variables. The parent runs the last block itself, so that on
+   exit from the loop the index and any variables assigned within
+   the loop have the values they would have after sequential
+   execution.
+
+   Before forking, the parent draws one seed per block from its
+   own random number generator, so the results are reproducible
+   given the seed and the number of workers. On completion each
+   child sends back over a pipe its printed output, its
+   "progressive" results (sums for "print" and models, rows for
+   "store") and the final values of any matrices named via the
+   --accumulate option. These are merged in block order. Other
+   side effects of the children are discarded, and "break" ends
+   only the block in which it occurs.
+*/
+
+#define PLOOP_DEBUG 0
+
+/* growable byte buffer, for communication between processes */
+
+typedef struct pbuf_ pbuf;
+
+struct pbuf_ {
+    char *buf;     /* the bytes */
+    size_t len;    /* number of bytes written */
+    size_t alloc;  /* allocated size of @buf */
+    size_t pos;    /* read position */
+    int err;       /* sticky error code */
+};
+
+typedef struct ploop_ ploop;
+
+struct ploop_ {
+    int nw;              /* number of workers, including the parent */
+    int id;              /* block run by this process (nw-1 for parent) */
+    int *start;          /* first iteration of each block, plus end */
+    pid_t *pid;          /* process IDs of children (parent only) */
+    int *fd;             /* read ends of pipes (parent only) */
+    int nchild;          /* number of children started */
+    int wfd;             /* write end of pipe (child only) */
+    PRN *prn0;           /* original printer */
+    PRN *bprn;           /* buffer for output of this process */
+    char **anames;       /* names of accumulator matrices */
+    int na;              /* number of accumulators */
+    gretl_matrix **a0;   /* values of accumulators at start */
+};
+
+/* set in child processes, to prevent nested forking */
+static int ploop_child;
+
+static void pbuf_put (pbuf *pb, const void *src, size_t n)
+{
+    if (pb->err || n == 0) {
+	return;
+    }
+
+    if (pb->len + n > pb->alloc) {
+	size_t alloc = pb->alloc == 0 ? 4096 : pb->alloc;
+	char *tmp;
+
+	while (alloc < pb->len + n) {
+	    alloc *= 2;
+	}
+	tmp = realloc(pb->buf, alloc);
+	if (tmp == NULL) {
+	    pb->err = E_ALLOC;
+	    return;
+	}
+	pb->buf = tmp;
+	pb->alloc = alloc;
+    }
+
+    memcpy(pb->buf + pb->len, src, n);
+    pb->len += n;
+}
+
+static void pbuf_get (pbuf *pb, void *dest, size_t n)
+{
+    if (!pb->err && pb->pos + n > pb->len) {
+	pb->err = E_DATA;
+    }
+    if (pb->err) {
+	memset(dest, 0, n);
+    } else {
+	memcpy(dest, pb->buf + pb->pos, n);
+	pb->pos += n;
+    }
+}
+
+static void pbuf_put_int (pbuf *pb, int k)
+{
+    pbuf_put(pb, &k, sizeof k);
+}
+
+static int pbuf_get_int (pbuf *pb)
+{
+    int k;
+
+    pbuf_get(pb, &k, sizeof k);
+    return k;
+}
+
+static void pbuf_put_string (pbuf *pb, const char *s)
+{
+    int n = (s == NULL)? 0 : strlen(s);
+
+    pbuf_put_int(pb, n);
+    pbuf_put(pb, s, n);
+}
+
+static char *pbuf_get_string (pbuf *pb)
+{
+    int n = pbuf_get_int(pb);
+    char *s = NULL;
+
+    if (!pb->err && (n < 0 || pb->pos + n > pb->len)) {
+	pb->err = E_DATA;
+    }
+    if (!pb->err) {
+	s = malloc(n + 1);
+	if (s == NULL) {
+	    pb->err = E_ALLOC;
+	} else {
+	    pbuf_get(pb, s, n);
+	    s[n] = '\0';
+	}
+    }
+
+    return s;
+}
+
+#if HAVE_GMP
+
+/* We pass a multiple-precision value as a short sequence of
+   doubles whose sum reproduces it: each term is the double value
+   of what remains after subtracting the previous terms, and the
+   remainders are computed exactly.
+*/
+
+#define BIGVAL_MAXPARTS 16
+
+static void pbuf_put_bigval (pbuf *pb, bigval x)
+{
+    double part[BIGVAL_MAXPARTS];
+    mpf_t r, m;
+    int n = 0;
+
+    mpf_init_set(r, x);
+    mpf_init(m);
+
+    while (n < BIGVAL_MAXPARTS && mpf_sgn(r) != 0) {
+	part[n] = mpf_get_d(r);
+	mpf_set_d(m, part[n]);
+	mpf_sub(r, r, m);
+	n++;
+    }
+
+    mpf_clear(r);
+    mpf_clear(m);
+
+    pbuf_put_int(pb, n);
+    pbuf_put(pb, part, n * sizeof *part);
+}
+
+static void pbuf_get_bigval (pbuf *pb, bigval x)
+{
+    double part[BIGVAL_MAXPARTS];
+    int i, n = pbuf_get_int(pb);
+    mpf_t m;
+
+    if (!pb->err && (n < 0 || n > BIGVAL_MAXPARTS)) {
+	pb->err = E_DATA;
+    }
+
+    mpf_set_d(x, 0.0);
+    if (pb->err) {
+	return;
+    }
+
+    pbuf_get(pb, part, n * sizeof *part);
+    mpf_init(m);
+    for (i=0; i<n; i++) {
+	mpf_set_d(m, part[i]);
+	mpf_add(x, x, m);
+    }
+    mpf_clear(m);
+}
+
+#endif /* HAVE_GMP */
+
+static void pbuf_read_fd (pbuf *pb, int fd)
+{
+    char chunk[4096];
+    ssize_t got;
+
+    while (!pb->err) {
+	got = read(fd, chunk, sizeof chunk);
+	if (got > 0) {
+	    pbuf_put(pb, chunk, got);
+	} else if (got == 0) {
+	    break;
+	} else if (errno != EINTR) {
+	    pb->err = E_DATA;
+	}
+    }
+}
+
+static int write_all (int fd, const char *buf, size_t n)
+{
+    ssize_t w;
+
+    while (n > 0) {
+	w = write(fd, buf, n);
+	if (w < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    return E_DATA;
+	}
+	buf += w;
+	n -= w;
+    }
+
+    return 0;
+}
+
+static void ploop_destroy (ploop *pl)
+{
+    int i;
+
+    if (pl == NULL) {
+	return;
+    }
+
+    if (pl->a0 != NULL) {
+	for (i=0; i<pl->na; i++) {
+	    gretl_matrix_free(pl->a0[i]);
+	}
+	free(pl->a0);
+    }
+    strings_array_free(pl->anames, pl->na);
+    gretl_print_destroy(pl->bprn);
+    free(pl->start);
+    free(pl->pid);
+    free(pl->fd);
+    free(pl);
+}
+
+static ploop *ploop_new (int nw, int n)
+{
+    ploop *pl = calloc(1, sizeof *pl);
+    int k;
+
+    if (pl == NULL) {
+	return NULL;
+    }
+
+    pl->nw = nw;
+    pl->wfd = -1;
+    pl->start = malloc((nw + 1) * sizeof *pl->start);
+    pl->pid = malloc(nw * sizeof *pl->pid);
+    pl->fd = malloc(nw * sizeof *pl->fd);
+
+    if (pl->start == NULL || pl->pid == NULL || pl->fd == NULL) {
+	ploop_destroy(pl);
+	return NULL;
+    }
+
+    /* contiguous blocks of as nearly equal size as possible */
+    for (k=0; k<=nw; k++) {
+	pl->start[k] = (int) (((double) k * n) / nw);
+    }
+    pl->start[nw] = n;
+
+    return pl;
+}
+
+/* record the names and initial values of the matrices whose
+   increments are to be summed across workers */
+
+static int ploop_save_accumulators (ploop *pl, const char *s)
+{
+    gretl_matrix *m;
+    int i, err = 0;
+
+    pl->anames = gretl_string_split(s, &pl->na, " ,");
+    if (pl->anames == NULL) {
+	return E_ALLOC;
+    }
+
+    pl->a0 = calloc(pl->na, sizeof *pl->a0);
+    if (pl->a0 == NULL) {
+	return E_ALLOC;
+    }
+
+    for (i=0; i<pl->na && !err; i++) {
+	m = get_matrix_by_name(pl->anames[i]);
+	if (m == NULL) {
+	    gretl_errmsg_sprintf(_("'%s': no such matrix"), pl->anames[i]);
+	    err = E_UNKVAR;
+	} else if (m->is_complex) {
+	    err = E_CMPLX;
+	} else {
+	    pl->a0[i] = gretl_matrix_copy(m);
+	    if (pl->a0[i] == NULL) {
+		err = E_ALLOC;
+	    }
+	}
+    }
+
+    return err;
+}
+
+static void ploop_put_accumulators (pbuf *pb, ploop *pl)
+{
+    gretl_matrix *m;
+    int i, n;
+
+    for (i=0; i<pl->na; i++) {
+	m = get_matrix_by_name(pl->anames[i]);
+	if (m == NULL || m->is_complex) {
+	    pbuf_put_int(pb, -1);
+	    pbuf_put_int(pb, -1);
+	} else {
+	    n = m->rows * m->cols;
+	    pbuf_put_int(pb, m->rows);
+	    pbuf_put_int(pb, m->cols);
+	    pbuf_put(pb, m->val, n * sizeof *m->val);
+	}
+    }
+}
+
+/* add to each accumulator the increment recorded by a child */
+
+static int ploop_merge_accumulators (pbuf *pb, ploop *pl)
+{
+    gretl_matrix *m, *a0;
+    double x;
+    int i, k, r, c;
+    int err = 0;
+
+    for (i=0; i<pl->na && !err && !pb->err; i++) {
+	r = pbuf_get_int(pb);
+	c = pbuf_get_int(pb);
+	m = get_matrix_by_name(pl->anames[i]);
+	a0 = pl->a0[i];
+	if (m == NULL || m->is_complex || r != a0->rows || c != a0->cols ||
+	    m->rows != r || m->cols != c) {
+	    gretl_errmsg_sprintf(_("loop --parallel: the dimensions of "
+				   "accumulator '%s' have changed"),
+				 pl->anames[i]);
+	    err = E_NONCONF;
+	} else {
+	    for (k=0; k<r*c && !pb->err; k++) {
+		pbuf_get(pb, &x, sizeof x);
+		m->val[k] += x - a0->val[k];
+	    }
+	}
+    }
+
+    return err ? err : pb->err;
+}
+
+#if HAVE_GMP
+
+static void ploop_put_progressive (pbuf *pb, LOOPSET *loop)
+{
+    LOOP_STORE *lstore = &loop->store;
+    int i, j;
+
+    pbuf_put_int(pb, loop->n_loop_models);
+    for (i=0; i<loop->n_loop_models; i++) {
+	LOOP_MODEL *lmod = &loop->lmodels[i];
+
+	pbuf_put_int(pb, lmod->lineno);
+	pbuf_put_int(pb, lmod->n);
+	pbuf_put_int(pb, lmod->nc);
+	for (j=0; j<4*lmod->nc; j++) {
+	    pbuf_put_bigval(pb, lmod->bigarray[j]);
+	}
+	/* cbak and sbak, cdiff and sdiff are contiguous */
+	pbuf_put(pb, lmod->cbak, 2 * lmod->nc * sizeof *lmod->cbak);
+	pbuf_put(pb, lmod->cdiff, 2 * lmod->nc * sizeof *lmod->cdiff);
+    }
+
+    pbuf_put_int(pb, loop->n_prints);
+    for (i=0; i<loop->n_prints; i++) {
+	LOOP_PRINT *lprn = &loop->prns[i];
+
+	pbuf_put_int(pb, lprn->lineno);
+	pbuf_put_int(pb, lprn->n);
+	pbuf_put_int(pb, lprn->nvars);
+	for (j=0; j<lprn->nvars; j++) {
+	    pbuf_put_bigval(pb, lprn->sum[j]);
+	    pbuf_put_bigval(pb, lprn->ssq[j]);
+	}
+	pbuf_put(pb, lprn->xbak, lprn->nvars * sizeof *lprn->xbak);
+	pbuf_put(pb, lprn->diff, lprn->nvars * sizeof *lprn->diff);
+	pbuf_put(pb, lprn->na, lprn->nvars);
+    }
+
+    if (lstore->dset == NULL) {
+	pbuf_put_int(pb, -1);
+    } else {
+	pbuf_put_int(pb, lstore->n);
+	pbuf_put_int(pb, lstore->nvars);
+	for (i=0; i<lstore->nvars; i++) {
+	    pbuf_put(pb, lstore->dset->Z[i+1], lstore->n * sizeof(double));
+	}
+    }
+}
+
+/* append @n rows of stored values, held by variable in @x */
+
+static int loop_store_append (LOOP_STORE *lstore, int n, const double *x)
+{
+    int i;
+
+    while (lstore->n + n > lstore->dset->n) {
+	if (extend_loop_dataset(lstore)) {
+	    return E_ALLOC;
+	}
+    }
+
+    for (i=0; i<lstore->nvars; i++) {
+	memcpy(lstore->dset->Z[i+1] + lstore->n, x + i * n,
+	       n * sizeof *x);
+    }
+
+    lstore->n += n;
+
+    return 0;
+}
+
+static int ploop_nonconf (void)
+{
+    gretl_errmsg_set(_("loop --parallel: the progressive results of the "
+		       "workers do not conform"));
+    return E_DATA;
+}
+
+static int ploop_merge_models (pbuf *pb, LOOPSET *loop)
+{
+    LOOP_MODEL *lmod;
+    double *bak = NULL;
+    int *diff = NULL;
+    int i, j, k, nm, lno, n, nc;
+    mpf_t m;
+    int err = 0;
+
+    mpf_init(m);
+
+    nm = pbuf_get_int(pb);
+
+    for (i=0; i<nm && !err && !pb->err; i++) {
+	lno = pbuf_get_int(pb);
+	n = pbuf_get_int(pb);
+	nc = pbuf_get_int(pb);
+	if (nc == 0 || pb->err) {
+	    continue;
+	}
+	lmod = NULL;
+	for (k=0; k<loop->n_loop_models; k++) {
+	    if (loop->lmodels[k].lineno == lno) {
+		lmod = &loop->lmodels[k];
+		break;
+	    }
+	}
+	if (lmod == NULL || lmod->nc != nc) {
+	    err = ploop_nonconf();
+	    break;
+	}
+	for (j=0; j<4*nc; j++) {
+	    pbuf_get_bigval(pb, m);
+	    mpf_add(lmod->bigarray[j], lmod->bigarray[j], m);
+	}
+	bak = realloc(bak, 2 * nc * sizeof *bak);
+	diff = realloc(diff, 2 * nc * sizeof *diff);
+	if (bak == NULL || diff == NULL) {
+	    err = E_ALLOC;
+	    break;
+	}
+	pbuf_get(pb, bak, 2 * nc * sizeof *bak);
+	pbuf_get(pb, diff, 2 * nc * sizeof *diff);
+	/* a value is not constant if it varies within a block or
+	   differs between blocks */
+	for (j=0; j<2*nc; j++) {
+	    if (diff[j] || (!na(bak[j]) && !na(lmod->cbak[j]) &&
+			    realdiff(bak[j], lmod->cbak[j]))) {
+		lmod->cdiff[j] = 1;
+	    }
+	}
+	lmod->n += n;
+    }
+
+    mpf_clear(m);
+    free(bak);
+    free(diff);
+
+    return err ? err : pb->err;
+}
+
+static int ploop_merge_prints (pbuf *pb, LOOPSET *loop)
+{
+    LOOP_PRINT *lprn;
+    double *xbak = NULL;
+    int *diff = NULL;
+    char *nas = NULL;
+    int i, j, k, np, lno, n, nv;
+    mpf_t m;
+    int err = 0;
+
+    mpf_init(m);
+
+    np = pbuf_get_int(pb);
+
+    for (i=0; i<np && !err && !pb->err; i++) {
+	lno = pbuf_get_int(pb);
+	n = pbuf_get_int(pb);
+	nv = pbuf_get_int(pb);
+	if (nv == 0 || pb->err) {
+	    continue;
+	}
+	lprn = NULL;
+	for (k=0; k<loop->n_prints; k++) {
+	    if (loop->prns[k].lineno == lno) {
+		lprn = &loop->prns[k];
+		break;
+	    }
+	}
+	if (lprn == NULL || lprn->nvars != nv) {
+	    err = ploop_nonconf();
+	    break;
+	}
+	for (j=0; j<nv; j++) {
+	    pbuf_get_bigval(pb, m);
+	    mpf_add(lprn->sum[j], lprn->sum[j], m);
+	    pbuf_get_bigval(pb, m);
+	    mpf_add(lprn->ssq[j], lprn->ssq[j], m);
+	}
+	xbak = realloc(xbak, nv * sizeof *xbak);
+	diff = realloc(diff, nv * sizeof *diff);
+	nas = realloc(nas, nv);
+	if (xbak == NULL || diff == NULL || nas == NULL) {
+	    err = E_ALLOC;
+	    break;
+	}
+	pbuf_get(pb, xbak, nv * sizeof *xbak);
+	pbuf_get(pb, diff, nv * sizeof *diff);
+	pbuf_get(pb, nas, nv);
+	for (j=0; j<nv; j++) {
+	    if (nas[j]) {
+		lprn->na[j] = 1;
+	    }
+	    if (diff[j] || (!na(xbak[j]) && !na(lprn->xbak[j]) &&
+			    realdiff(xbak[j], lprn->xbak[j]))) {
+		lprn->diff[j] = 1;
+	    }
+	}
+	lprn->n += n;
+    }
+
+    mpf_clear(m);
+    free(xbak);
+    free(diff);
+    free(nas);
+
+    return err ? err : pb->err;
+}
+
+static int ploop_merge_store (pbuf *pb, LOOPSET *loop)
+{
+    LOOP_STORE *lstore = &loop->store;
+    double *x;
+    int n, nv, err = 0;
+
+    n = pbuf_get_int(pb);
+    if (n < 0 || pb->err) {
+	return pb->err;
+    }
+
+    nv = pbuf_get_int(pb);
+    if (lstore->dset == NULL || nv != lstore->nvars) {
+	return ploop_nonconf();
+    }
+
+    x = malloc(n * nv * sizeof *x);
+    if (x == NULL) {
+	return E_ALLOC;
+    }
+
+    pbuf_get(pb, x, n * nv * sizeof *x);
+    err = pb->err;
+    if (!err) {
+	err = loop_store_append(lstore, n, x);
+    }
+
+    free(x);
+
+    return err;
+}
+
+/* Take the parent's own rows out of the "store" dataset, so that
+   those from the children can be placed first. */
+
+static double *ploop_take_store (LOOPSET *loop, int *pn, int *err)
+{
+    LOOP_STORE *lstore = &loop->store;
+    double *x = NULL;
+    int i, n = lstore->n;
+
+    *pn = 0;
+
+    if (lstore->dset == NULL || n == 0) {
+	return NULL;
+    }
+
+    x = malloc(n * lstore->nvars * sizeof *x);
+    if (x == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    for (i=0; i<lstore->nvars; i++) {
+	memcpy(x + i * n, lstore->dset->Z[i+1], n * sizeof *x);
+    }
+
+    lstore->n = 0;
+    *pn = n;
+
+    return x;
+}
+
+#endif /* HAVE_GMP */
+
+/* We don't fork within a worker, for a nested loop, in the GUI
+   program, or under MPI (forking an MPI process is not safe);
+   and only count and index loops are split up. In all these
+   cases the loop runs sequentially.
+*/
+
+static int parallel_loop_ok (LOOPSET *loop)
+{
+    return !ploop_child && loop->parent == NULL &&
+	!gretl_in_gui_mode() && !gretl_mpi_initialized() &&
+	(loop->type == COUNT_LOOP || loop->type == INDEX_LOOP);
+}
+
+/* Clean up after failure to launch all the workers */
+
+static void parallel_loop_abort (ploop *pl)
+{
+    int k, status;
+
+    for (k=0; k<pl->nchild; k++) {
+	close(pl->fd[k]);
+	kill(pl->pid[k], SIGKILL);
+	waitpid(pl->pid[k], &status, 0);
+    }
+
+    ploop_destroy(pl);
+}
+
+/* Start the workers for @loop, or return NULL (with @err = 0) if
+   the loop should be run sequentially. On successful return,
+   in both the parent and the children, @loop is set up to run just
+   the block of iterations assigned to the current process, and
+   printed output goes to a buffer.
+*/
+
+static ploop *parallel_loop_start (LOOPSET *loop, ExecState *s,
+				   int *err)
+{
+    unsigned int *seeds;
+    ploop *pl;
+    int nw = loop->nproc;
+    int k, i;
+
+    if (!parallel_loop_ok(loop)) {
+	return NULL;
+    }
+
+    if (nw == 0) {
+	nw = gretl_n_processors();
+    }
+    if (nw > loop->itermax) {
+	nw = loop->itermax;
+    }
+    if (nw < 2) {
+	return NULL;
+    }
+
+    pl = ploop_new(nw, loop->itermax);
+    seeds = malloc(nw * sizeof *seeds);
+    if (pl == NULL || seeds == NULL) {
+	*err = E_ALLOC;
+	goto bailout;
+    }
+
+    if (loop->accum != NULL) {
+	*err = ploop_save_accumulators(pl, loop->accum);
+	if (*err) {
+	    goto bailout;
+	}
+    }
+
+    pl->bprn = gretl_print_new(GRETL_PRINT_BUFFER, err);
+    if (*err) {
+	goto bailout;
+    }
+
+    for (k=0; k<nw; k++) {
+	seeds[k] = gretl_rand_int();
+	if (seeds[k] == 0) {
+	    seeds[k] = 1;
+	}
+    }
+
+    pl->prn0 = s->prn;
+    pl->id = nw - 1;
+
+    /* don't let buffered output be duplicated in the children */
+    fflush(NULL);
+
+    for (k=0; k<nw-1; k++) {
+	int fds[2];
+	pid_t pid;
+
+	if (pipe(fds) != 0) {
+	    *err = E_EXTERNAL;
+	    break;
+	}
+	pid = fork();
+	if (pid < 0) {
+	    close(fds[0]);
+	    close(fds[1]);
+	    *err = E_EXTERNAL;
+	    break;
+	} else if (pid == 0) {
+	    /* child process */
+	    close(fds[0]);
+	    for (i=0; i<pl->nchild; i++) {
+		close(pl->fd[i]);
+	    }
+	    pl->nchild = 0;
+	    pl->wfd = fds[1];
+	    pl->id = k;
+	    ploop_child = 1;
+#if defined(_OPENMP)
+	    /* avoid oversubscription (and libgomp trouble after fork) */
+	    libset_set_int("omp_num_threads", 1);
+#endif
+	    break;
+	}
+	close(fds[1]);
+	pl->pid[k] = pid;
+	pl->fd[k] = fds[0];
+	pl->nchild += 1;
+    }
+
+    if (*err) {
+	gretl_errmsg_set(_("loop --parallel: couldn't start worker process"));
+	parallel_loop_abort(pl);
+	free(seeds);
+	return NULL;
+    }
+
+#if PLOOP_DEBUG
+    fprintf(stderr, "ploop %d: iterations %d to %d\n", pl->id,
+	    pl->start[pl->id], pl->start[pl->id + 1] - 1);
+#endif
+
+    gretl_rand_set_seed(seeds[pl->id]);
+    free(seeds);
+
+    /* set up to run the assigned block only */
+    loop->iter = pl->start[pl->id];
+    loop->itermax = pl->start[pl->id + 1];
+    if (loop->type == INDEX_LOOP && loop->iter > 0) {
+	/* loop_condition() will increment the index */
+	loop->idxval = loop->init.val + loop->iter - 1;
+	uvar_set_scalar_fast(loop->idxvar, loop->idxval);
+    }
+
+    s->prn = pl->bprn;
+
+    return pl;
+
+ bailout:
+
+    ploop_destroy(pl);
+    free(seeds);
+
+    return NULL;
+}
+
+/* Called by a child on completion of its block: send the results
+   to the parent and exit.
+*/
+
+static void parallel_worker_exit (LOOPSET *loop, ploop *pl, int err,
+				  const char *errline)
+{
+    pbuf pb = {0};
+    int j, lno = -1;
+
+    if (err && errline != NULL) {
+	for (j=0; j<loop->n_cmds; j++) {
+	    if (loop->cmds[j].line == errline) {
+		lno = j;
+		break;
+	    }
+	}
+    }
+
+    pbuf_put_int(&pb, err);
+    pbuf_put_int(&pb, lno);
+    pbuf_put_string(&pb, err ? gretl_errmsg_get() : NULL);
+    pbuf_put_string(&pb, gretl_print_get_buffer(pl->bprn));
+
+    if (!err) {
+#if HAVE_GMP
+	if (loop_is_progressive(loop)) {
+	    ploop_put_progressive(&pb, loop);
+	}
+#endif
+	ploop_put_accumulators(&pb, pl);
+    }
+
+    if (!pb.err) {
+	pb.err = write_all(pl->wfd, pb.buf, pb.len);
+    }
+    close(pl->wfd);
+
+    /* don't run the parent's exit handlers */
+    _exit(pb.err ? 1 : 0);
+}
+
+/* Called by the parent on completion of its own block: collect
+   and merge the results from the children, in block order, and
+   restore the original printer. If a child hit an error, *errline
+   is pointed at the offending loop line.
+*/
+
+static int parallel_loop_finish (LOOPSET *loop, ploop *pl,
+				 ExecState *s, int err,
+				 char **errline)
+{
+    pbuf *pb;
+#if HAVE_GMP
+    double *x0 = NULL;
+    int n0 = 0;
+#endif
+    int k, status;
+
+    pb = calloc(pl->nchild, sizeof *pb);
+
+    for (k=0; k<pl->nchild; k++) {
+	if (pb != NULL) {
+	    pbuf_read_fd(&pb[k], pl->fd[k]);
+	}
+	close(pl->fd[k]);
+	if (waitpid(pl->pid[k], &status, 0) < 0 ||
+	    !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+	    if (pb != NULL && !pb[k].err) {
+		pb[k].err = E_EXTERNAL;
+	    }
+	}
+    }
+
+    s->prn = pl->prn0;
+    loop->itermax = pl->start[pl->nw];
+
+    if (pb == NULL) {
+	ploop_destroy(pl);
+	return E_ALLOC;
+    }
+
+#if HAVE_GMP
+    if (!err && loop_is_progressive(loop)) {
+	x0 = ploop_take_store(loop, &n0, &err);
+    }
+#endif
+
+    for (k=0; k<pl->nchild; k++) {
+	pbuf *b = &pb[k];
+	int cerr = pbuf_get_int(b);
+	int lno = pbuf_get_int(b);
+	char *msg = pbuf_get_string(b);
+	char *out = pbuf_get_string(b);
+
+	if (out != NULL) {
+	    pputs(s->prn, out);
+	}
+	if (b->err) {
+	    if (!err) {
+		gretl_errmsg_set(_("loop --parallel: worker process failed"));
+		err = b->err;
+	    }
+	} else if (cerr) {
+	    if (!err) {
+		err = cerr;
+		if (msg != NULL && *msg != '\0') {
+		    gretl_errmsg_set(msg);
+		}
+		if (lno >= 0 && lno < loop->n_cmds) {
+		    *errline = loop->cmds[lno].line;
+		}
+	    }
+	} else if (!err) {
+#if HAVE_GMP
+	    if (loop_is_progressive(loop)) {
+		err = ploop_merge_models(b, loop);
+		if (!err) {
+		    err = ploop_merge_prints(b, loop);
+		}
+		if (!err) {
+		    err = ploop_merge_store(b, loop);
+		}
+	    }
+#endif
+	    if (!err) {
+		err = ploop_merge_accumulators(b, pl);
+	    }
+	}
+	free(msg);
+	free(out);
+	free(b->buf);
+    }
+
+#if HAVE_GMP
+    if (!err && x0 != NULL) {
+	err = loop_store_append(&loop->store, n0, x0);
+    }
+    free(x0);
+#endif
+
+    pputs(s->prn, gretl_print_get_buffer(pl->bprn));
+
+    free(pb);
+    ploop_destroy(pl);
+
+    return err;
+}
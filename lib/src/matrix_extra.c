@@ -23,6 +23,7 @@
 #include "gretl_cmatrix.h"
 #include "matrix_extra.h"
 #include "swap_bytes.h"
+#include "gretl_gbin.h"
 
 #ifdef WIN32
 # include "gretl_win32.h"
@@ -1279,6 +1280,10 @@ gretl_matrix *gretl_matrix_read_from_file (const char *fname,
 	gretl_maybe_prepend_dir(fullname);
     }
 
+    if (has_suffix(fname, ".gbin")) {
+	return gretl_gbin_read_file(fullname, GRETL_TYPE_MATRIX, err);
+    }
+
     if (gz) {
 	char tmp[FILENAME_MAX];
 
@@ -1485,6 +1490,8 @@ int gretl_matrix_write_to_file (gretl_matrix *A, const char *fname,
 
     if (csv) {
 	return matrix_to_csv(A, targ);
+    } else if (has_suffix(fname, ".gbin")) {
+	return gretl_gbin_write_file(A, GRETL_TYPE_MATRIX, targ);
     }
 
     if (bin) {
@@ -0,0 +1,417 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Cache-blocked matrix multiplication, included by gretl_matrix.c.
+
+   The layout follows the scheme of Goto and van de Geijn: for
+   each slab of GEMM_KC columns of op(A) and rows of op(B), op(B)
+   is packed into slivers GEMM_NR columns wide and op(A) into
+   panels GEMM_MR rows high, with the elements of each sliver or
+   panel stored contiguously in the order in which the "micro
+   kernel" will read them. The kernel then computes a GEMM_MR x
+   GEMM_NR block of C, which is held in registers. A block of
+   GEMM_MC rows of packed A is sized to stay in L2 cache while
+   the slivers of B, which are reused across it, sit in L1.
+
+   Transposition of A and/or B is handled in the packing, so
+   the kernel only ever sees one case, and the same goes for
+   alpha = -1 (GRETL_MOD_DECREMENT), which is applied when A is
+   packed. As in gretl_dgemm() we support beta = 0 or 1 only.
+*/
+
+#define GEMM_MR 8     /* rows in micro-tile of C */
+#define GEMM_NR 4     /* columns in micro-tile of C */
+#define GEMM_KC 256   /* depth of packed slab */
+#define GEMM_MC 96    /* rows of packed A per block (L2) */
+#define GEMM_NC 4096  /* columns of packed B per block (L3) */
+
+/* below this size the packing isn't worth the bother */
+#define GEMM_MNK_MIN 32768
+
+static int gemm_use_blocked (int m, int n, int k)
+{
+    return m >= 16 && n >= GEMM_NR && k >= 16 &&
+	(guint64) m * n * k >= GEMM_MNK_MIN;
+}
+
+/* portable micro kernel: the tile is done in two halves of
+   4 x 4, with the accumulators in local variables so that the
+   compiler can keep them in registers */
+
+static void gemm_kernel_c (int kc,
+			   const double * restrict a,
+			   const double * restrict b,
+			   double * restrict c,
+			   int ldc, int beta)
+{
+    double c00, c10, c20, c30, c01, c11, c21, c31;
+    double c02, c12, c22, c32, c03, c13, c23, c33;
+    double a0, a1, a2, a3, bj;
+    const double *ap, *bp;
+    double *cj;
+    int h, l;
+
+    for (h=0; h<GEMM_MR; h+=4) {
+	c00 = c10 = c20 = c30 = c01 = c11 = c21 = c31 = 0.0;
+	c02 = c12 = c22 = c32 = c03 = c13 = c23 = c33 = 0.0;
+	ap = a + h;
+	bp = b;
+	for (l=0; l<kc; l++) {
+	    a0 = ap[0];
+	    a1 = ap[1];
+	    a2 = ap[2];
+	    a3 = ap[3];
+	    bj = bp[0];
+	    c00 += a0 * bj;
+	    c10 += a1 * bj;
+	    c20 += a2 * bj;
+	    c30 += a3 * bj;
+	    bj = bp[1];
+	    c01 += a0 * bj;
+	    c11 += a1 * bj;
+	    c21 += a2 * bj;
+	    c31 += a3 * bj;
+	    bj = bp[2];
+	    c02 += a0 * bj;
+	    c12 += a1 * bj;
+	    c22 += a2 * bj;
+	    c32 += a3 * bj;
+	    bj = bp[3];
+	    c03 += a0 * bj;
+	    c13 += a1 * bj;
+	    c23 += a2 * bj;
+	    c33 += a3 * bj;
+	    ap += GEMM_MR;
+	    bp += GEMM_NR;
+	}
+	if (!beta) {
+	    for (l=0; l<GEMM_NR; l++) {
+		cj = c + l*ldc + h;
+		cj[0] = cj[1] = cj[2] = cj[3] = 0.0;
+	    }
+	}
+	cj = c + h;
+	cj[0] += c00; cj[1] += c10; cj[2] += c20; cj[3] += c30;
+	cj += ldc;
+	cj[0] += c01; cj[1] += c11; cj[2] += c21; cj[3] += c31;
+	cj += ldc;
+	cj[0] += c02; cj[1] += c12; cj[2] += c22; cj[3] += c32;
+	cj += ldc;
+	cj[0] += c03; cj[1] += c13; cj[2] += c23; cj[3] += c33;
+    }
+}
+
+#if defined(HAVE_AVX_KERNELS)
+
+/* AVX micro kernels: the 8 x 4 tile of C occupies eight ymm
+   registers, each holding half a column. The kernel is written
+   out as a macro so that we can generate both an AVX variant
+   and one which uses fused multiply-add, and pick between them
+   at run time.
+*/
+
+#define GEMM_AVX_KERNEL(name, isa, madd)				\
+static SIMD_TARGET(isa)							\
+void name (int kc, const double * restrict a,				\
+	   const double * restrict b, double * restrict c,		\
+	   int ldc, int beta)						\
+{									\
+    __m256d c0l = _mm256_setzero_pd();					\
+    __m256d c0h = _mm256_setzero_pd();					\
+    __m256d c1l = _mm256_setzero_pd();					\
+    __m256d c1h = _mm256_setzero_pd();					\
+    __m256d c2l = _mm256_setzero_pd();					\
+    __m256d c2h = _mm256_setzero_pd();					\
+    __m256d c3l = _mm256_setzero_pd();					\
+    __m256d c3h = _mm256_setzero_pd();					\
+    __m256d al, ah, bj;							\
+    int l;								\
+									\
+    for (l=0; l<kc; l++) {						\
+	al = _mm256_loadu_pd(a);					\
+	ah = _mm256_loadu_pd(a + 4);					\
+	bj = _mm256_broadcast_sd(b);					\
+	c0l = madd(al, bj, c0l);					\
+	c0h = madd(ah, bj, c0h);					\
+	bj = _mm256_broadcast_sd(b + 1);				\
+	c1l = madd(al, bj, c1l);					\
+	c1h = madd(ah, bj, c1h);					\
+	bj = _mm256_broadcast_sd(b + 2);				\
+	c2l = madd(al, bj, c2l);					\
+	c2h = madd(ah, bj, c2h);					\
+	bj = _mm256_broadcast_sd(b + 3);				\
+	c3l = madd(al, bj, c3l);					\
+	c3h = madd(ah, bj, c3h);					\
+	a += GEMM_MR;							\
+	b += GEMM_NR;							\
+    }									\
+									\
+    if (beta) {								\
+	c0l = _mm256_add_pd(c0l, _mm256_loadu_pd(c));			\
+	c0h = _mm256_add_pd(c0h, _mm256_loadu_pd(c + 4));		\
+	c1l = _mm256_add_pd(c1l, _mm256_loadu_pd(c + ldc));		\
+	c1h = _mm256_add_pd(c1h, _mm256_loadu_pd(c + ldc + 4));	\
+	c2l = _mm256_add_pd(c2l, _mm256_loadu_pd(c + 2*ldc));		\
+	c2h = _mm256_add_pd(c2h, _mm256_loadu_pd(c + 2*ldc + 4));	\
+	c3l = _mm256_add_pd(c3l, _mm256_loadu_pd(c + 3*ldc));		\
+	c3h = _mm256_add_pd(c3h, _mm256_loadu_pd(c + 3*ldc + 4));	\
+    }									\
+									\
+    _mm256_storeu_pd(c, c0l);						\
+    _mm256_storeu_pd(c + 4, c0h);					\
+    _mm256_storeu_pd(c + ldc, c1l);					\
+    _mm256_storeu_pd(c + ldc + 4, c1h);				\
+    _mm256_storeu_pd(c + 2*ldc, c2l);					\
+    _mm256_storeu_pd(c + 2*ldc + 4, c2h);				\
+    _mm256_storeu_pd(c + 3*ldc, c3l);					\
+    _mm256_storeu_pd(c + 3*ldc + 4, c3h);				\
+}
+
+#define gemm_mul_add(a,b,c) _mm256_add_pd(_mm256_mul_pd(a,b),c)
+
+GEMM_AVX_KERNEL(gemm_kernel_avx, "avx", gemm_mul_add)
+
+#if defined(SIMD_DISPATCH) || defined(__FMA__)
+# define HAVE_GEMM_FMA 1
+GEMM_AVX_KERNEL(gemm_kernel_fma, "avx2,fma", _mm256_fmadd_pd)
+#endif
+
+#endif /* HAVE_AVX_KERNELS */
+
+typedef void (*gemm_kernel_func) (int, const double *, const double *,
+				  double *, int, int);
+
+/* the best micro kernel for the host CPU */
+
+static gemm_kernel_func gemm_get_kernel (void)
+{
+#if defined(HAVE_AVX_KERNELS)
+    int level = gretl_simd_level();
+#endif
+
+#if defined(HAVE_GEMM_FMA)
+    if (level >= GRETL_SIMD_AVX2) {
+	return gemm_kernel_fma;
+    }
+#endif
+#if defined(HAVE_AVX_KERNELS)
+    if (level >= GRETL_SIMD_AVX) {
+	return gemm_kernel_avx;
+    }
+#endif
+
+    return gemm_kernel_c;
+}
+
+/* compute an @mr x @nr tile of C: tiles at the bottom or right
+   edge of C may be smaller than the kernel's, in which case
+   we go via a temporary */
+
+static void gemm_tile (gemm_kernel_func kernel, int kc,
+		       const double *pa, const double *pb,
+		       double *c, int ldc, int mr, int nr, int beta)
+{
+    if (mr == GEMM_MR && nr == GEMM_NR) {
+	kernel(kc, pa, pb, c, ldc, beta);
+    } else {
+	double tmp[GEMM_MR * GEMM_NR];
+	int i, j;
+
+	kernel(kc, pa, pb, tmp, GEMM_MR, 0);
+	for (j=0; j<nr; j++) {
+	    for (i=0; i<mr; i++) {
+		if (beta) {
+		    c[j*ldc+i] += tmp[j*GEMM_MR+i];
+		} else {
+		    c[j*ldc+i] = tmp[j*GEMM_MR+i];
+		}
+	    }
+	}
+    }
+}
+
+/* pack @mr rows of op(A), starting at @src, into a panel of
+   GEMM_MR rows, padding with zeros as needed; op(A)[i,l] is
+   found at src[i*rs + l*cs] */
+
+static void gemm_pack_A (int kc, int mr, const double *src,
+			 int rs, int cs, double alpha,
+			 double * restrict pa)
+{
+    int i, l;
+
+    for (l=0; l<kc; l++) {
+	for (i=0; i<mr; i++) {
+	    pa[i] = alpha * src[i*rs + l*cs];
+	}
+	for (; i<GEMM_MR; i++) {
+	    pa[i] = 0.0;
+	}
+	pa += GEMM_MR;
+    }
+}
+
+/* pack @nr columns of op(B), starting at @src, into a sliver
+   of GEMM_NR columns, padding with zeros as needed */
+
+static void gemm_pack_B (int kc, int nr, const double *src,
+			 int rs, int cs, double * restrict pb)
+{
+    int j, l;
+
+    for (l=0; l<kc; l++) {
+	for (j=0; j<nr; j++) {
+	    pb[j] = src[l*rs + j*cs];
+	}
+	for (; j<GEMM_NR; j++) {
+	    pb[j] = 0.0;
+	}
+	pb += GEMM_NR;
+    }
+}
+
+/* 32-byte alignment for the packing buffers */
+
+static double *gemm_align (double *p)
+{
+    return (double *) (((guintptr) p + 31) & ~((guintptr) 31));
+}
+
+/* C := alpha*op(A)*op(B) + beta*C, with @threaded governing
+   whether we may use OpenMP. Returns non-zero only if we
+   couldn't allocate the workspace, in which case the caller
+   should use plain gretl_dgemm().
+*/
+
+static int gretl_dgemm_blocked (const gretl_matrix *a, int atr,
+				const gretl_matrix *b, int btr,
+				gretl_matrix *c, GretlMatrixMod cmod,
+				int m, int n, int k, int threaded)
+{
+    const double *A = a->val;
+    const double *B = b->val;
+    double *C = c->val;
+    int rsa = atr ? a->rows : 1;
+    int csa = atr ? 1 : a->rows;
+    int rsb = btr ? b->rows : 1;
+    int csb = btr ? 1 : b->rows;
+    int ldc = c->rows;
+    double alpha = 1.0;
+    int beta = 0;
+    int npa = (m + GEMM_MR - 1) / GEMM_MR;
+    int nsb = (MIN(n, GEMM_NC) + GEMM_NR - 1) / GEMM_NR;
+    int nmb = (m + GEMM_MC - 1) / GEMM_MC;
+    int kcmax = MIN(k, GEMM_KC);
+    gemm_kernel_func kernel = gemm_get_kernel();
+    double *abuf, *bbuf;
+    double *pa, *pb;
+#if defined(_OPENMP)
+    int use_omp;
+#endif
+    int jc, pc;
+
+    if (cmod == GRETL_MOD_CUMULATE) {
+	beta = 1;
+    } else if (cmod == GRETL_MOD_DECREMENT) {
+	alpha = -1.0;
+	beta = 1;
+    }
+
+    abuf = malloc((size_t) npa * GEMM_MR * kcmax * sizeof *abuf + 32);
+    bbuf = malloc((size_t) nsb * GEMM_NR * kcmax * sizeof *bbuf + 32);
+
+    if (abuf == NULL || bbuf == NULL) {
+	free(abuf);
+	free(bbuf);
+	return E_ALLOC;
+    }
+
+    pa = gemm_align(abuf);
+    pb = gemm_align(bbuf);
+
+#if defined(_OPENMP)
+    use_omp = threaded && libset_use_openmp((guint64) m * n * k);
+#endif
+
+    for (jc=0; jc<n; jc+=GEMM_NC) {
+	int nc = MIN(GEMM_NC, n - jc);
+	int ns = (nc + GEMM_NR - 1) / GEMM_NR;
+	int ntasks = nmb * ns;
+
+	for (pc=0; pc<k; pc+=GEMM_KC) {
+	    const double *Ap = A + pc * csa;
+	    const double *Bp = B + pc * rsb + jc * csb;
+	    int kc = MIN(GEMM_KC, k - pc);
+	    int bt = (pc == 0)? beta : 1;
+
+	    /* Pack this slab of op(A) and op(B), then share out
+	       the (row-block, sliver) pairs of C: with a static
+	       schedule each thread gets a run of slivers for a
+	       given block of rows, so the packed block of A is
+	       reused from cache.
+	    */
+#if defined(_OPENMP)
+#pragma omp parallel if (use_omp)
+#endif
+	    {
+		int i, p, s, t;
+
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+		for (s=0; s<ns; s++) {
+		    gemm_pack_B(kc, MIN(GEMM_NR, nc - s*GEMM_NR),
+				Bp + s * GEMM_NR * csb, rsb, csb,
+				pb + s * GEMM_NR * kc);
+		}
+
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+		for (p=0; p<npa; p++) {
+		    gemm_pack_A(kc, MIN(GEMM_MR, m - p*GEMM_MR),
+				Ap + p * GEMM_MR * rsa, rsa, csa, alpha,
+				pa + p * GEMM_MR * kc);
+		}
+
+#if defined(_OPENMP)
+#pragma omp for schedule(static)
+#endif
+		for (t=0; t<ntasks; t++) {
+		    int i0 = (t / ns) * GEMM_MC;
+		    int i1 = MIN(m, i0 + GEMM_MC);
+		    int j0 = (t % ns) * GEMM_NR;
+		    int nr = MIN(GEMM_NR, nc - j0);
+		    const double *pbs = pb + j0 * kc;
+		    double *cj = C + (size_t) (jc + j0) * ldc;
+
+		    for (i=i0; i<i1; i+=GEMM_MR) {
+			gemm_tile(kernel, kc, pa + i * kc, pbs, cj + i, ldc,
+				  MIN(GEMM_MR, i1 - i), nr, bt);
+		    }
+		}
+	    }
+	}
+    }
+
+    free(abuf);
+    free(bbuf);
+
+    return 0;
+}
@@ -17,140 +17,530 @@
  *
  */
 
-/* All code here is conditional on AVX (128-bit SSE is not really
-   worth the bother when working with doubles)
+/* SIMD code for gretl_matrix.c, which includes this file.
+
+   The element-wise kernels (addition, subtraction, scaling and
+   the dot product) are compiled in SSE2, AVX and AVX-512
+   variants, using the "target" attribute of GCC and clang, and
+   the first call to gretl_simd_init() picks the best variant the
+   CPU and operating system support. So a build for baseline
+   x86-64 still gets full use of newer hardware, and a build with
+   AVX enabled doesn't leave AVX-512 unused. Other compilers get
+   the AVX variants only if gretl is configured with AVX, and on
+   other architectures the plain C versions are used throughout.
+
+   The small matrix-multiplication routines at the foot of the
+   file, on the other hand, are compiled only if libgretl as a
+   whole is built with AVX (128-bit SSE is not really worth the
+   bother when multiplying doubles).
 */
 
 #define SHOW_SIMD 0
 
-static int gretl_matrix_simd_add_to (gretl_matrix *a,
-				     const gretl_matrix *b,
-				     int n)
-{
-    double *ax = a->val;
-    const double *bx = b->val;
-    int i, imax = n / 4;
-    int rem = n % 4;
+#if defined(SIMD_DISPATCH)
+# define SIMD_TARGET(s) __attribute__((target(s)))
+#else
+# define SIMD_TARGET(s)
+#endif
 
-#if SHOW_SIMD
-    fprintf(stderr, "AVX: gretl_matrix_simd_add_to (%d x %d)\n",
-	    a->rows, a->cols);
+#if defined(SIMD_DISPATCH) || defined(USE_SIMD)
+# define HAVE_AVX_KERNELS 1
 #endif
 
-    for (i=0; i<imax; i++) {
-	/* add 4 doubles in parallel */
-	__m256d Ymm_A = _mm256_loadu_pd(ax);
-	__m256d Ymm_B = _mm256_loadu_pd(bx);
-	__m256d Ymm_C = _mm256_add_pd(Ymm_A, Ymm_B);
+enum {
+    SIMD_ADD,
+    SIMD_SUB
+};
+
+/* the plain C versions, for use on non-x86 systems and as
+   fallback */
 
-	_mm256_storeu_pd(ax, Ymm_C);
-	ax += 4;
-	bx += 4;
+static void simd_binop_c (int op, const double *a, const double *b,
+			  double *c, int n)
+{
+    int i;
+
+    if (op == SIMD_ADD) {
+	for (i=0; i<n; i++) {
+	    c[i] = a[i] + b[i];
+	}
+    } else {
+	for (i=0; i<n; i++) {
+	    c[i] = a[i] - b[i];
+	}
     }
+}
+
+static void simd_scale_c (double *a, double x, int n)
+{
+    int i;
 
-    for (i=0; i<rem; i++) {
-	ax[i] += bx[i];
+    for (i=0; i<n; i++) {
+	a[i] *= x;
     }
+}
 
-    return 0;
+static double simd_dot_c (const double *a, const double *b, int n)
+{
+    double ret = 0.0;
+    int i;
+
+    for (i=0; i<n; i++) {
+	ret += a[i] * b[i];
+    }
+
+    return ret;
 }
 
-static int gretl_matrix_simd_subt_from (gretl_matrix *a,
-					const gretl_matrix *b,
-					int n)
+#if defined(SIMD_DISPATCH)
+
+/* SSE2: two doubles at a time */
+
+static SIMD_TARGET("sse2")
+void simd_binop_sse2 (int op, const double *a, const double *b,
+		      double *c, int n)
 {
-    double *ax = a->val;
-    const double *bx = b->val;
-    int i, imax = n / 4;
-    int rem = n % 4;
+    int i, imax = n - n % 2;
 
-#if SHOW_SIMD
-    fprintf(stderr, "AVX: gretl_matrix_simd_subt_from (%d x %d, rem=%d)\n",
-	    a->rows, a->cols, rem);
-#endif
+    if (op == SIMD_ADD) {
+	for (i=0; i<imax; i+=2) {
+	    _mm_storeu_pd(c + i, _mm_add_pd(_mm_loadu_pd(a + i),
+					    _mm_loadu_pd(b + i)));
+	}
+    } else {
+	for (i=0; i<imax; i+=2) {
+	    _mm_storeu_pd(c + i, _mm_sub_pd(_mm_loadu_pd(a + i),
+					    _mm_loadu_pd(b + i)));
+	}
+    }
 
-    for (i=0; i<imax; i++) {
-	/* subtract 4 doubles in parallel */
-	__m256d Ymm_A = _mm256_loadu_pd(ax);
-	__m256d Ymm_B = _mm256_loadu_pd(bx);
-	__m256d Ymm_C = _mm256_sub_pd(Ymm_A, Ymm_B);
+    if (i < n) {
+	c[i] = (op == SIMD_ADD)? a[i] + b[i] : a[i] - b[i];
+    }
+}
+
+static SIMD_TARGET("sse2")
+void simd_scale_sse2 (double *a, double x, int n)
+{
+    __m128d mul = _mm_set1_pd(x);
+    int i, imax = n - n % 2;
 
-	_mm256_storeu_pd(ax, Ymm_C);
-	ax += 4;
-	bx += 4;
+    for (i=0; i<imax; i+=2) {
+	_mm_storeu_pd(a + i, _mm_mul_pd(mul, _mm_loadu_pd(a + i)));
     }
 
-    for (i=0; i<rem; i++) {
-	ax[i] -= bx[i];
+    if (i < n) {
+	a[i] *= x;
     }
+}
 
-    return 0;
+static SIMD_TARGET("sse2")
+double simd_dot_sse2 (const double *a, const double *b, int n)
+{
+    __m128d sum = _mm_setzero_pd();
+    int i, imax = n - n % 2;
+    double ret;
+
+    for (i=0; i<imax; i+=2) {
+	sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(a + i),
+					 _mm_loadu_pd(b + i)));
+    }
+
+    ret = _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+    if (i < n) {
+	ret += a[i] * b[i];
+    }
+
+    return ret;
+}
+
+#endif /* SIMD_DISPATCH */
+
+#if defined(HAVE_AVX_KERNELS)
+
+/* See https://stackoverflow.com/questions/49941645,
+   Peter Cordes's answer on how efficiently to sum the
+   contents of an __m256d into a single double.
+*/
+
+static inline SIMD_TARGET("avx")
+double hsum_double_avx (__m256d v)
+{
+    __m128d vlow  = _mm256_castpd256_pd128(v);
+    __m128d vhigh = _mm256_extractf128_pd(v, 1);
+    __m128d high64;
+
+    vlow   = _mm_add_pd(vlow, vhigh);
+    high64 = _mm_unpackhi_pd(vlow, vlow);
+    return  _mm_cvtsd_f64(_mm_add_sd(vlow, high64));
 }
 
-static int gretl_matrix_simd_add (const double *ax,
-				  const double *bx,
-				  double *cx,
-				  int n)
+/* AVX: four doubles at a time (AVX2 adds nothing here) */
+
+static SIMD_TARGET("avx")
+void simd_binop_avx (int op, const double *a, const double *b,
+		     double *c, int n)
 {
-    int i, imax = n / 4;
-    int rem = n % 4;
+    int i, imax = n - n % 4;
 
 #if SHOW_SIMD
-    fprintf(stderr, "AVX: gretl_matrix_simd_add (%d x %d)\n",
-	    a->rows, a->cols);
+    fprintf(stderr, "AVX: simd_binop (op = %d, n = %d)\n", op, n);
 #endif
 
-    for (i=0; i<imax; i++) {
-	/* process 4 doubles in parallel */
-	__m256d Ymm_A = _mm256_loadu_pd(ax);
-	__m256d Ymm_B = _mm256_loadu_pd(bx);
-	__m256d Ymm_C = _mm256_add_pd(Ymm_A, Ymm_B);
+    if (op == SIMD_ADD) {
+	for (i=0; i<imax; i+=4) {
+	    /* add 4 doubles in parallel */
+	    __m256d Ymm_A = _mm256_loadu_pd(a + i);
+	    __m256d Ymm_B = _mm256_loadu_pd(b + i);
+
+	    _mm256_storeu_pd(c + i, _mm256_add_pd(Ymm_A, Ymm_B));
+	}
+	for (; i<n; i++) {
+	    c[i] = a[i] + b[i];
+	}
+    } else {
+	for (i=0; i<imax; i+=4) {
+	    /* subtract 4 doubles in parallel */
+	    __m256d Ymm_A = _mm256_loadu_pd(a + i);
+	    __m256d Ymm_B = _mm256_loadu_pd(b + i);
 
-	_mm256_storeu_pd(cx, Ymm_C);
-	ax += 4;
-	bx += 4;
-	cx += 4;
+	    _mm256_storeu_pd(c + i, _mm256_sub_pd(Ymm_A, Ymm_B));
+	}
+	for (; i<n; i++) {
+	    c[i] = a[i] - b[i];
+	}
     }
+}
 
-    for (i=0; i<rem; i++) {
-	cx[i] = ax[i] + bx[i];
+static SIMD_TARGET("avx")
+void simd_scale_avx (double *a, double x, int n)
+{
+    __m256d mul = _mm256_broadcast_sd(&x);
+    int i, imax = n - n % 4;
+
+    for (i=0; i<imax; i+=4) {
+	_mm256_storeu_pd(a + i, _mm256_mul_pd(mul, _mm256_loadu_pd(a + i)));
+    }
+    for (; i<n; i++) {
+	a[i] *= x;
     }
+}
 
-    return 0;
+static SIMD_TARGET("avx")
+double simd_dot_avx (const double *a, const double *b, int n)
+{
+    __m256d sum = _mm256_setzero_pd();
+    int i, imax = n - n % 4;
+    double ret;
+
+    for (i=0; i<imax; i+=4) {
+	/* multiply 4 doubles in parallel, and cumulate */
+	sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_loadu_pd(a + i),
+					       _mm256_loadu_pd(b + i)));
+    }
+
+    ret = hsum_double_avx(sum);
+    for (; i<n; i++) {
+	ret += a[i] * b[i];
+    }
+
+    return ret;
 }
 
-static int gretl_matrix_simd_subtract (const double *ax,
-				       const double *bx,
-				       double *cx,
-				       int n)
+#endif /* HAVE_AVX_KERNELS */
+
+#if defined(SIMD_DISPATCH)
+
+/* AVX-512: eight doubles at a time */
+
+static SIMD_TARGET("avx512f")
+void simd_binop_avx512 (int op, const double *a, const double *b,
+			double *c, int n)
 {
-    int i, imax = n / 4;
-    int rem = n % 4;
+    int i, imax = n - n % 8;
 
-#if SHOW_SIMD
-    fprintf(stderr, "AVX: gretl_matrix_simd_subtract (n = %d, rem = %d)\n",
-	    n, rem);
+    if (op == SIMD_ADD) {
+	for (i=0; i<imax; i+=8) {
+	    _mm512_storeu_pd(c + i, _mm512_add_pd(_mm512_loadu_pd(a + i),
+						  _mm512_loadu_pd(b + i)));
+	}
+	for (; i<n; i++) {
+	    c[i] = a[i] + b[i];
+	}
+    } else {
+	for (i=0; i<imax; i+=8) {
+	    _mm512_storeu_pd(c + i, _mm512_sub_pd(_mm512_loadu_pd(a + i),
+						  _mm512_loadu_pd(b + i)));
+	}
+	for (; i<n; i++) {
+	    c[i] = a[i] - b[i];
+	}
+    }
+}
+
+static SIMD_TARGET("avx512f")
+void simd_scale_avx512 (double *a, double x, int n)
+{
+    __m512d mul = _mm512_set1_pd(x);
+    int i, imax = n - n % 8;
+
+    for (i=0; i<imax; i+=8) {
+	_mm512_storeu_pd(a + i, _mm512_mul_pd(mul, _mm512_loadu_pd(a + i)));
+    }
+    for (; i<n; i++) {
+	a[i] *= x;
+    }
+}
+
+static SIMD_TARGET("avx512f")
+double simd_dot_avx512 (const double *a, const double *b, int n)
+{
+    __m512d sum = _mm512_setzero_pd();
+    int i, imax = n - n % 8;
+    double ret;
+
+    for (i=0; i<imax; i+=8) {
+	sum = _mm512_fmadd_pd(_mm512_loadu_pd(a + i),
+			      _mm512_loadu_pd(b + i), sum);
+    }
+
+    ret = hsum_double_avx(_mm256_add_pd(_mm512_castpd512_pd256(sum),
+					_mm512_extractf64x4_pd(sum, 1)));
+    for (; i<n; i++) {
+	ret += a[i] * b[i];
+    }
+
+    return ret;
+}
+
+/* Find out, via cpuid, which instruction sets the CPU supports;
+   for AVX and AVX-512 we also need confirmation (via xgetbv)
+   that the operating system saves the wider registers.
+*/
+
+static unsigned int simd_xgetbv (void)
+{
+    unsigned int eax, edx;
+
+    __asm__ volatile ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return eax;
+}
+
+static int simd_cpu_probe (void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int ecx1, xcr0 = 0;
+    int level = GRETL_SIMD_NONE;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx1, &edx) || !(edx & bit_SSE2)) {
+	return level;
+    }
+
+    level = GRETL_SIMD_SSE2;
+
+    if ((ecx1 & bit_OSXSAVE) && (ecx1 & bit_AVX)) {
+	xcr0 = simd_xgetbv();
+	if ((xcr0 & 0x06) == 0x06) {
+	    /* XMM and YMM state enabled */
+	    level = GRETL_SIMD_AVX;
+	}
+    }
+
+    if (level == GRETL_SIMD_AVX && __get_cpuid_max(0, NULL) >= 7) {
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	if ((ebx & bit_AVX2) && (ecx1 & bit_FMA)) {
+	    level = GRETL_SIMD_AVX2;
+#ifdef bit_AVX512F
+	    if ((ebx & bit_AVX512F) && (xcr0 & 0xe0) == 0xe0) {
+		/* opmask and ZMM state enabled too */
+		level = GRETL_SIMD_AVX512;
+	    }
 #endif
+	}
+    }
+
+    return level;
+}
+
+#endif /* SIMD_DISPATCH */
 
-    for (i=0; i<imax; i++) {
-	/* process 4 doubles in parallel */
-	__m256d Ymm_A = _mm256_loadu_pd(ax);
-	__m256d Ymm_B = _mm256_loadu_pd(bx);
-	__m256d Ymm_C = _mm256_sub_pd(Ymm_A, Ymm_B);
+static const char *simd_level_names[] = {
+    "none", "sse2", "avx", "avx2", "avx512"
+};
 
-	_mm256_storeu_pd(cx, Ymm_C);
-	cx += 4;
-	ax += 4;
-	bx += 4;
+static int simd_level = -1;
+
+static void (*simd_binop) (int, const double *, const double *,
+			   double *, int) = simd_binop_c;
+static void (*simd_scale) (double *, double, int) = simd_scale_c;
+static double (*simd_dot) (const double *, const double *, int) = simd_dot_c;
+
+/* The environment variable GRETL_SIMD can be used to cap the
+   level of SIMD support, e.g. for testing, or to get identical
+   results across the nodes of a heterogeneous cluster. */
+
+static int simd_level_cap (int level)
+{
+    char *s = getenv("GRETL_SIMD");
+    int i;
+
+    if (s != NULL) {
+	for (i=GRETL_SIMD_NONE; i<=GRETL_SIMD_AVX512; i++) {
+	    if (!strcmp(s, simd_level_names[i])) {
+		return MIN(level, i);
+	    }
+	}
     }
 
-    for (i=0; i<rem; i++) {
-	cx[i] = ax[i] - bx[i];
+    return level;
+}
+
+/**
+ * gretl_simd_init:
+ *
+ * Determines the level of SIMD support offered by the host
+ * CPU and selects the variants of the SIMD kernels to be used
+ * accordingly. Called by libgretl_init(); there's no harm in
+ * calling it more than once.
+ */
+
+void gretl_simd_init (void)
+{
+    int level = GRETL_SIMD_NONE;
+
+    if (simd_level >= 0) {
+	return;
     }
 
-    return 0;
+#if defined(SIMD_DISPATCH)
+    level = simd_cpu_probe();
+#elif defined(USE_SIMD)
+    /* we're built for AVX, so had better have it */
+# if defined(__AVX2__) && defined(__FMA__)
+    level = GRETL_SIMD_AVX2;
+# else
+    level = GRETL_SIMD_AVX;
+# endif
+#endif
+    level = simd_level_cap(level);
+
+#if defined(SIMD_DISPATCH)
+    if (level == GRETL_SIMD_AVX512) {
+	simd_binop = simd_binop_avx512;
+	simd_scale = simd_scale_avx512;
+	simd_dot = simd_dot_avx512;
+    } else if (level >= GRETL_SIMD_AVX) {
+	simd_binop = simd_binop_avx;
+	simd_scale = simd_scale_avx;
+	simd_dot = simd_dot_avx;
+    } else if (level == GRETL_SIMD_SSE2) {
+	simd_binop = simd_binop_sse2;
+	simd_scale = simd_scale_sse2;
+	simd_dot = simd_dot_sse2;
+    }
+#elif defined(USE_SIMD)
+    if (level >= GRETL_SIMD_AVX) {
+	simd_binop = simd_binop_avx;
+	simd_scale = simd_scale_avx;
+	simd_dot = simd_dot_avx;
+    }
+#endif
+
+    simd_level = level;
+}
+
+/**
+ * gretl_simd_level:
+ *
+ * Returns: the level of SIMD support in use, a member of
+ * the #GretlSIMDLevel enumeration.
+ */
+
+int gretl_simd_level (void)
+{
+    if (simd_level < 0) {
+	gretl_simd_init();
+    }
+
+    return simd_level;
 }
 
+/**
+ * gretl_simd_level_string:
+ *
+ * Returns: a string identifying the level of SIMD support
+ * in use ("none", "sse2", "avx", "avx2" or "avx512").
+ */
+
+const char *gretl_simd_level_string (void)
+{
+    return simd_level_names[gretl_simd_level()];
+}
+
+/**
+ * gretl_simd_add:
+ * @a: array of @n doubles.
+ * @b: array of @n doubles.
+ * @c: array of @n doubles, which may coincide with @a or @b.
+ * @n: number of elements.
+ *
+ * Sets @c = @a + @b, using SIMD instructions if available.
+ */
+
+void gretl_simd_add (const double *a, const double *b,
+		     double *c, int n)
+{
+    simd_binop(SIMD_ADD, a, b, c, n);
+}
+
+/**
+ * gretl_simd_subtract:
+ * @a: array of @n doubles.
+ * @b: array of @n doubles.
+ * @c: array of @n doubles, which may coincide with @a or @b.
+ * @n: number of elements.
+ *
+ * Sets @c = @a - @b, using SIMD instructions if available.
+ */
+
+void gretl_simd_subtract (const double *a, const double *b,
+			  double *c, int n)
+{
+    simd_binop(SIMD_SUB, a, b, c, n);
+}
+
+/**
+ * gretl_simd_scale:
+ * @a: array of @n doubles.
+ * @x: scalar multiplier.
+ * @n: number of elements.
+ *
+ * Multiplies the elements of @a by @x, using SIMD instructions
+ * if available.
+ */
+
+void gretl_simd_scale (double *a, double x, int n)
+{
+    simd_scale(a, x, n);
+}
+
+/**
+ * gretl_simd_dot:
+ * @a: array of @n doubles.
+ * @b: array of @n doubles.
+ * @n: number of elements.
+ *
+ * Returns: the dot product of @a and @b, computed using SIMD
+ * instructions if available.
+ */
+
+double gretl_simd_dot (const double *a, const double *b, int n)
+{
+    return simd_dot(a, b, n);
+}
+
+#if defined(USE_SIMD)
+
 /* very fast but restrictive: both A and B must be 4 x 4 */
 
 static int gretl_matrix_avx_mul4 (const double *aval,
@@ -355,67 +745,4 @@ static int gretl_matrix_simd_mul (const gretl_matrix *A,
     return 0;
 }
 
-/* See https://stackoverflow.com/questions/49941645,
-   Peter Cordes's answer on how efficiently to sum the
-   contents of an __m256d into a single double.
-*/
-
-static inline double hsum_double_avx (__m256d v)
-{
-    __m128d vlow  = _mm256_castpd256_pd128(v);
-    __m128d vhigh = _mm256_extractf128_pd(v, 1);
-    __m128d high64;
-
-    vlow   = _mm_add_pd(vlow, vhigh);
-    high64 = _mm_unpackhi_pd(vlow, vlow);
-    return  _mm_cvtsd_f64(_mm_add_sd(vlow, high64));
-}
-
-double gretl_vector_simd_dot_product (const gretl_vector *a,
-				      const gretl_vector *b)
-{
-    __m256d Ymm_A, Ymm_B, Ymm_C;
-    const double *ax = a->val;
-    const double *bx = b->val;
-    int n = gretl_vector_get_length(a);
-    int i, imax = n / 4;
-    int rem = n % 4;
-    double ret = 0.0;
-
-    for (i=0; i<imax; i++) {
-	/* multiply 4 doubles in parallel */
-	Ymm_A = _mm256_loadu_pd(ax);
-	Ymm_B = _mm256_loadu_pd(bx);
-	Ymm_C = _mm256_mul_pd(Ymm_A, Ymm_B);
-	ret += hsum_double_avx(Ymm_C);
-	ax += 4;
-	bx += 4;
-    }
-
-    for (i=0; i<rem; i++) {
-	ret += ax[i] * bx[i];
-    }
-
-    return ret;
-}
-
-void gretl_matrix_simd_scalar_mul (double *mx, double x, int n)
-{
-    __m256d mxi, mul, res;
-    int i, imax = n / 4;
-    int rem = n % 4;
-
-    mul = _mm256_broadcast_sd(&x);
-
-    for (i=0; i<imax; i++) {
-	/* multiply 4 doubles in parallel */
-	mxi = _mm256_loadu_pd(mx);
-	res = _mm256_mul_pd(mul, mxi);
-	_mm256_storeu_pd(mx, res);
-	mx += 4;
-    }
-
-    for (i=0; i<rem; i++) {
-	mx[i] *= x;
-    }
-}
+#endif /* USE_SIMD */
@@ -1427,9 +1427,27 @@ static void panel_vcv_line (const VCVInfo *vi, PRN *prn)
 static void cluster_vcv_line (const MODEL *pmod, const VCVInfo *vi,
 			      const DATASET *dset, PRN *prn)
 {
+    const int *clist = gretl_model_get_list(pmod, "cluster_list");
     gchar *cstr;
 
-    if (vi->vmin >= 1 && vi->vmin < dset->v) {
+    if (clist != NULL) {
+	/* multi-way clustering */
+	GString *names = g_string_new(NULL);
+	int i;
+
+	for (i=1; i<=clist[0]; i++) {
+	    if (clist[i] >= dset->v) {
+		break;
+	    }
+	    if (i > 1) {
+		g_string_append(names, ", ");
+	    }
+	    g_string_append(names, dset->varname[clist[i]]);
+	}
+	cstr = g_strdup_printf(A_("Standard errors clustered by %s"),
+			       names->str);
+	g_string_free(names, TRUE);
+    } else if (vi->vmin >= 1 && vi->vmin < dset->v) {
 	int n_c = gretl_model_get_int(pmod, "n_clusters");
 
 	cstr = g_strdup_printf(A_("Standard errors clustered by %d values of %s"),
@@ -38,6 +38,22 @@
 #include <time.h>
 #include <unistd.h>
 
+#ifdef WIN32
+# define LOOP_FORK 0
+#else
+# define LOOP_FORK 1
+#endif
+
+#if LOOP_FORK
+# include "usermat.h"
+# include <errno.h>
+# include <signal.h>
+# include <sys/wait.h>
+# ifdef HAVE_MPI
+#  include "gretl_mpi.h"
+# endif
+#endif
+
 #define LOOP_DEBUG 0
 #define SUBST_DEBUG 0
 
@@ -116,7 +132,8 @@ typedef enum {
     LOOP_ATTACHED    = 1 << 3,
     LOOP_RENAMING    = 1 << 4,
     LOOP_ERR_CAUGHT  = 1 << 5,
-    LOOP_CONDITIONAL = 1 << 6
+    LOOP_CONDITIONAL = 1 << 6,
+    LOOP_PARALLEL    = 1 << 7
 } LoopFlags;
 
 struct controller_ {
@@ -174,6 +191,10 @@ struct LOOPSET_ {
     /* break signal */
     char brk;
 
+    /* "parallel" option: number of processes, accumulators */
+    int nproc;
+    char *accum;
+
     /* control structures */
     controller init;
     controller test;
@@ -215,6 +236,8 @@ struct LOOPSET_ {
 #define loop_err_caught(l)      (l->flags |= LOOP_ERR_CAUGHT)
 #define loop_has_cond(l)        (l->flags & LOOP_CONDITIONAL)
 #define loop_set_has_cond(l)    (l->flags |= LOOP_CONDITIONAL)
+#define loop_is_parallel(l)     (l->flags & LOOP_PARALLEL)
+#define loop_set_parallel(l)    (l->flags |= LOOP_PARALLEL)
 
 #define model_print_deferred(o) (o & OPT_F)
 
@@ -483,14 +506,41 @@ loop_delta (LOOPSET *loop, DATASET *dset, int *err)
     }
 }
 
-static void set_loop_opts (LOOPSET *loop, gretlopt opt)
+static int set_loop_opts (LOOPSET *loop, gretlopt opt)
 {
+    int err = 0;
+
     if (opt & OPT_P) {
 	loop_set_progressive(loop);
     }
     if (opt & OPT_V) {
 	loop_set_verbose(loop);
     }
+    if (opt & OPT_L) {
+	loop_set_parallel(loop);
+	loop->nproc = get_optval_int(LOOP, OPT_L, &err);
+	if (!err && loop->nproc < 0) {
+	    gretl_errmsg_set(_("loop --parallel: invalid number of processes"));
+	    err = E_INVARG;
+	}
+    }
+    if (!err && (opt & OPT_A)) {
+	const char *s = get_optval_string(LOOP, OPT_A);
+
+	if (!(opt & OPT_L)) {
+	    gretl_errmsg_set(_("loop --accumulate requires --parallel"));
+	    err = E_BADOPT;
+	} else if (s == NULL || *s == '\0') {
+	    err = E_ARGS;
+	} else {
+	    loop->accum = gretl_strdup(s);
+	    if (loop->accum == NULL) {
+		err = E_ALLOC;
+	    }
+	}
+    }
+
+    return err;
 }
 
 #define plain_model_ci(c) (MODEL_COMMAND(c) && \
@@ -567,6 +617,8 @@ static void gretl_loop_init (LOOPSET *loop)
     loop->idxvar = NULL;
     loop->idxval = 0;
     loop->brk = 0;
+    loop->nproc = 0;
+    loop->accum = NULL;
     *loop->eachname = '\0';
     loop->eachtype = 0;
     loop->eachstrs = NULL;
@@ -657,6 +709,7 @@ void gretl_loop_destroy (LOOPSET *loop)
 
     free(loop->model_lines);
     free(loop->models);
+    free(loop->accum);
 
     if (loop->eachstrs != NULL && loop->eachtype != GRETL_TYPE_STRINGS) {
 	strings_array_free(loop->eachstrs, loop->itermax);
@@ -2503,8 +2556,12 @@ int gretl_loop_append_line (ExecState *s, DATASET *dset)
 #endif
 	    if (newloop == NULL) {
 		return err;
+	    }
+	    err = set_loop_opts(newloop, opt);
+	    if (err) {
+		destroy_loop_stack(newloop);
+		return err;
 	    } else {
-		set_loop_opts(newloop, opt);
 		compile_level++;
 		if (!nested) {
 		    currloop = newloop;
@@ -3604,6 +3661,10 @@ static int handle_prog_command (LOOPSET *loop, int j,
 
 #endif /* HAVE_GMP */
 
+#if LOOP_FORK
+# include "loop_parallel.c"
+#endif
+
 #define LTRACE 0
 
 int gretl_loop_exec (ExecState *s, DATASET *dset, LOOPSET *loop)
@@ -3619,6 +3680,9 @@ int gretl_loop_exec (ExecState *s, DATASET *dset, LOOPSET *loop)
     int prev_messages;
 #if HAVE_GMP
     int progressive;
+#endif
+#if LOOP_FORK
+    ploop *pl = NULL;
 #endif
     int err = 0;
 
@@ -3656,6 +3720,15 @@ int gretl_loop_exec (ExecState *s, DATASET *dset, LOOPSET *loop)
 
     err = top_of_loop(loop, dset);
 
+#if LOOP_FORK
+    if (!err && loop_is_parallel(loop)) {
+	pl = parallel_loop_start(loop, s, &err);
+	if (pl != NULL) {
+	    prn = s->prn;
+	}
+    }
+#endif
+
     if (!err) {
 	if (loop_is_renaming(loop)) {
 	    loop_renaming = 1;
@@ -3953,6 +4026,17 @@ int gretl_loop_exec (ExecState *s, DATASET *dset, LOOPSET *loop)
 	}
     } /* end iterations of loop */
 
+#if LOOP_FORK
+    if (pl != NULL) {
+	if (pl->id < pl->nw - 1) {
+	    /* child process: report back and exit */
+	    parallel_worker_exit(loop, pl, err, currline);
+	}
+	err = parallel_loop_finish(loop, pl, s, err, &currline);
+	prn = s->prn;
+    }
+#endif
+
     cmd->flags &= ~CMD_NOSUB;
 
     if (loop->brk) {
@@ -412,26 +412,95 @@ static int compare_pairs_x (const void *a, const void *b)
     return ret;
 }
 
-static int compare_pairs_y (const void *a, const void *b)
+/* add the contribution of a run of @t tied values to the
+   tie-correction terms for Kendall's tau */
+
+static void kendall_tie_run (gint64 t, gint64 *T, gint64 *T2,
+			     gint64 *T25)
 {
-    const struct xy_pair *pa = a;
-    const struct xy_pair *pb = b;
+    gint64 tt1 = t * (t - 1);
 
-    return (pa->y > pb->y) - (pa->y < pb->y);
+    *T += tt1;
+    *T2 += tt1 * (t - 2);
+    *T25 += tt1 * (2 * t + 5);
 }
 
+/* Sort @y into ascending order by merging (bottom-up, so no
+   recursion), using @tmp as workspace, and return the number of
+   "swaps", i.e. the number of pairs i < j with y[i] > y[j] in
+   the original ordering.
+*/
+
+static gint64 kendall_merge_count (double *y, double *tmp, int n)
+{
+    double *src = y, *dst = tmp, *swap;
+    gint64 nswaps = 0;
+    int w, lo, mid, hi;
+    int i, j, k;
+
+    for (w=1; w<n; w*=2) {
+	for (lo=0; lo<n; lo+=2*w) {
+	    mid = lo + w < n ? lo + w : n;
+	    hi = lo + 2*w < n ? lo + 2*w : n;
+	    i = lo;
+	    j = mid;
+	    k = lo;
+	    while (i < mid && j < hi) {
+		if (src[j] < src[i]) {
+		    /* src[j] jumps all the remaining left values */
+		    nswaps += mid - i;
+		    dst[k++] = src[j++];
+		} else {
+		    dst[k++] = src[i++];
+		}
+	    }
+	    while (i < mid) {
+		dst[k++] = src[i++];
+	    }
+	    while (j < hi) {
+		dst[k++] = src[j++];
+	    }
+	}
+	swap = src;
+	src = dst;
+	dst = swap;
+    }
+
+    if (src != y) {
+	memcpy(y, src, n * sizeof *y);
+    }
+
+    return nswaps;
+}
+
+/* Kendall's tau, computed in O(n log n) time following Knight,
+   "A Computer Method for Calculating Kendall's Tau with Ungrouped
+   Data", JASA 61, 1966: once the pairs are sorted by x (and by y
+   within x), the number of discordant pairs equals the number of
+   swaps required to sort the y values, and the number of concordant
+   pairs follows from the total number of pairs and the numbers of
+   pairs tied in x, in y and in both.
+*/
+
 static int real_kendall_tau (const double *x, const double *y,
 			     int n, struct xy_pair *xy, int nn,
 			     double *ptau, double *pz)
 {
+    double *ys, *tmp;
     double tau, nn1, s2, z;
-    int tt1, tx = 0, ty = 0;
-    int Tx = 0, Ty = 0;
-    int Tx2 = 0, Ty2 = 0;
-    int Tx25 = 0, Ty25 = 0;
-    int tie, N0, N1, S;
+    gint64 tx, ty, txy;
+    gint64 Tx = 0, Ty = 0, Txy = 0;
+    gint64 Tx2 = 0, Ty2 = 0;
+    gint64 Tx25 = 0, Ty25 = 0;
+    gint64 N0, N1, S;
     int i, j;
 
+    ys = malloc(2 * nn * sizeof *ys);
+    if (ys == NULL) {
+	return E_ALLOC;
+    }
+    tmp = ys + nn;
+
     /* populate sorter */
     j = 0;
     for (i=0; i<n; i++) {
@@ -442,65 +511,60 @@ static int real_kendall_tau (const double *x, const double *y,
 	}
     }
 
-    /* sort pairs by x */
+    /* sort pairs by x, then y */
     qsort(xy, nn, sizeof *xy, compare_pairs_x);
 
-    /* make order counts */
-    N0 = N1 = 0;
-    for (i=0; i<nn; i++) {
-	for (j=i+1; j<nn; j++) {
-	    if (xy[j].y == xy[i].y) {
-		Ty++;
-	    } else if (xy[j].x != xy[i].x) {
-		if (xy[j].y > xy[i].y) {
-		    N0++;
-		} else if (xy[j].y < xy[i].y) {
-		    N1++;
-		}
-	    }
-	}
-	if (i > 0) {
-	    /* account for ties in x */
-	    tie = (xy[i].x == xy[i-1].x);
-	    if (tie) {
-		tx++;
+    /* account for ties in x, and joint ties in x and y */
+    tx = txy = 1;
+    for (i=1; i<=nn; i++) {
+	if (i < nn && xy[i].x == xy[i-1].x) {
+	    tx++;
+	    if (xy[i].y == xy[i-1].y) {
+		txy++;
+	    } else {
+		Txy += txy * (txy - 1);
+		txy = 1;
 	    }
-	    if (tx > 0 && (!tie || i == nn - 1)) {
-		tx++;
-		tt1 = tx * (tx - 1);
-		Tx += tt1;
-		Tx2 += tt1 * (tx - 2);
-		Tx25 += tt1 * (2 * tx + 5);
-		tx = 0;
+	} else {
+	    if (tx > 1) {
+		kendall_tie_run(tx, &Tx, &Tx2, &Tx25);
 	    }
+	    Txy += txy * (txy - 1);
+	    tx = txy = 1;
 	}
     }
 
-    if (Ty > 0) {
-	/* account for ties in y */
-	Ty = 0;
-	qsort(xy, nn, sizeof *xy, compare_pairs_y);
-	for (i=1; i<nn; i++) {
-	    tie = (xy[i].y == xy[i-1].y);
-	    if (tie) {
-		ty++;
-	    }
-	    if (ty > 0 && (!tie || i == nn - 1)) {
-		ty++;
-		tt1 = ty * (ty - 1);
-		Ty += tt1;
-		Ty2 += tt1 * (ty - 2);
-		Ty25 += tt1 * (2 * ty + 5);
-		ty = 0;
+    /* count discordant pairs while sorting by y */
+    for (i=0; i<nn; i++) {
+	ys[i] = xy[i].y;
+    }
+    N1 = kendall_merge_count(ys, tmp, nn);
+
+    /* account for ties in y */
+    ty = 1;
+    for (i=1; i<=nn; i++) {
+	if (i < nn && ys[i] == ys[i-1]) {
+	    ty++;
+	} else {
+	    if (ty > 1) {
+		kendall_tie_run(ty, &Ty, &Ty2, &Ty25);
 	    }
+	    ty = 1;
 	}
     }
 
+    free(ys);
+
+    /* concordant pairs: the remainder, after netting out the
+       ties (note that Tx, Ty and Txy count each pair twice) */
+    N0 = (gint64) nn * (nn - 1) / 2 - (Tx + Ty - Txy) / 2 - N1;
     S = N0 - N1;
 
 #if 0
-    fprintf(stderr, "N0 = %d, N1 = %d, S = %d\n", N0, N1, S);
-    fprintf(stderr, "Tx = %d, Ty = %d\n", Tx, Ty);
+    fprintf(stderr, "N0 = %" G_GINT64_FORMAT ", N1 = %" G_GINT64_FORMAT
+	    ", S = %" G_GINT64_FORMAT "\n", N0, N1, S);
+    fprintf(stderr, "Tx = %" G_GINT64_FORMAT ", Ty = %" G_GINT64_FORMAT
+	    "\n", Tx, Ty);
 #endif
 
     nn1 = nn * (nn - 1.0);
@@ -777,7 +841,11 @@ double lockes_test (const double *x, int t1, int t2)
 	    }
 	    t += 2;
 	}
-	real_kendall_tau(u, v, m, uv, m, NULL, &zj);
+	err = real_kendall_tau(u, v, m, uv, m, NULL, &zj);
+	if (err) {
+	    z = NADBL;
+	    goto bailout;
+	}
 	z += zj;
 #if LOCKE_DEBUG
 	fprintf(stderr, "z[%d] = %g\n", j, zj);
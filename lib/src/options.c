@@ -130,6 +130,7 @@ struct gretl_option gretl_opts[] = {
     { APPEND,   OPT_V, "verbose", 0 },
     { APPEND,   OPT_U, "update-overlap", 0 },
     { APPEND,   OPT_X, "fixed-sample", 0 },
+    { APPEND,   OPT_E, "restrict", 2 },
     { ARBOND,   OPT_A, "asymptotic", 0 },
     { ARBOND,   OPT_D, "time-dummies", 1 },
     { ARBOND,   OPT_H, "orthdev", 0 },
@@ -395,6 +396,8 @@ struct gretl_option gretl_opts[] = {
     { LOGIT,    OPT_R, "robust", 0 },
     { LOGIT,    OPT_C, "cluster", 2 },
     { LOGIT,    OPT_V, "verbose", 0 },
+    { LOOP,     OPT_A, "accumulate", 2 },
+    { LOOP,     OPT_L, "parallel", 1 },
     { LOOP,     OPT_P, "progressive", 0 },
     { LOOP,     OPT_V, "verbose", 0 },
     { MAHAL,    OPT_S, "save", 0 },
@@ -470,6 +473,7 @@ struct gretl_option gretl_opts[] = {
     { OPEN,     OPT_K, "frompkg", 2 },
     { OPEN,     OPT_H, "no-header", 0 },
     { OPEN,     OPT_I, "ignore-quotes", 0 },
+    { OPEN,     OPT_E, "restrict", 2 },
     { OUTFILE,  OPT_A, "append", 0 },
     { OUTFILE,  OPT_C, "close", 0 },
     { OUTFILE,  OPT_W, "write", 0 },
@@ -610,6 +614,7 @@ struct gretl_option gretl_opts[] = {
     { STORE,    OPT_G, "dat", 0 },
     { STORE,    OPT_I, "decimal-comma", 0 },
     { STORE,    OPT_J, "jmulti", 0 },
+    { STORE,    OPT_K, "chunked", 0 },
     { STORE,    OPT_L, "lcnames", 0 },
     { STORE,    OPT_M, "gnu-octave", 0 },
     { STORE,    OPT_N, "no-header", 0 },
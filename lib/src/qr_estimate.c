@@ -1762,173 +1762,165 @@ int qr_tsls_vcv (MODEL *pmod, const DATASET *dset, gretlopt opt)
     return err;
 }
 
-static int cval_count (MODEL *pmod, double cvi, const double *cZ)
+#define CDEBUG 0
+
+/* Sum the scores, e_t * X_t (with weighting if applicable), by
+   cluster in a single pass over the observations; the columns
+   are independent so they can be handled in parallel. On return
+   @nused holds the number of observations used.
+*/
+
+static gretl_matrix *cluster_scores (MODEL *pmod,
+				     const DATASET *dset,
+				     const int *cid, int n_c,
+				     int *nused, int *err)
 {
-    int t, cc = 0;
+    gretl_matrix *S;
+    const double *wgt = NULL;
+    int T = pmod->t2 - pmod->t1 + 1;
+    int k = pmod->ncoeff;
+    int j, s, t, n = 0;
 
-    for (t=pmod->t1; t<=pmod->t2; t++) {
-	if (!na(pmod->uhat[t]) && cZ[t] == cvi) {
-	    cc++;
-	}
+    S = gretl_zero_matrix_new(n_c, k);
+    if (S == NULL) {
+	*err = E_ALLOC;
+	return NULL;
     }
 
-    return cc;
-}
+    if (pmod->nwt) {
+	wgt = dset->Z[pmod->nwt];
+    }
 
-static int cval_count_max (MODEL *pmod, const gretl_matrix *cvals,
-			   const double *cZ)
-{
-    int n = gretl_vector_get_length(cvals);
-    int i, cc, cmax = 0;
+    for (s=0, t=pmod->t1; s<T; s++, t++) {
+	if (cid[s] >= 0 && !na(pmod->uhat[t])) {
+	    n++;
+	}
+    }
 
-    for (i=0; i<n; i++) {
-	cc = cval_count(pmod, cvals->val[i], cZ);
-	if (cc > cmax) {
-	    cmax = cc;
+#if defined(_OPENMP)
+#pragma omp parallel for private(j, s, t) if (libset_use_openmp((guint64) T * k))
+#endif
+    for (j=0; j<k; j++) {
+	const double *xj = dset->Z[pmod->list[j+2]];
+	double *sj = S->val + j * n_c;
+
+	for (s=0, t=pmod->t1; s<T; s++, t++) {
+	    if (cid[s] >= 0 && !na(pmod->uhat[t])) {
+		if (wgt != NULL) {
+		    sj[cid[s]] += pmod->uhat[t] * xj[t] * sqrt(wgt[t]);
+		} else {
+		    sj[cid[s]] += pmod->uhat[t] * xj[t];
+		}
+	    }
 	}
     }
 
-    return cmax;
+    *nused = n;
+
+    return S;
 }
 
-#define CDEBUG 0
+/* With a single clustering series in @clist we compute the
+   regular one-way clustered variance matrix; otherwise we sum
+   the matrices clustered by each subset of the series, with
+   signs given by inclusion and exclusion. On output @nmin holds
+   the smallest number of clusters for a single series.
+*/
 
 static gretl_matrix *cluster_vcv_calc (MODEL *pmod,
-				       int cvar,
-				       gretl_matrix *cvals,
+				       const int *clist,
 				       gretl_matrix *XX,
 				       const DATASET *dset,
+				       int *nmin,
 				       int *err)
 
 {
     gretl_matrix *V = NULL;
+    gretl_matrix *Vs = NULL;
     gretl_matrix *W = NULL;
     gretl_matrix *XXW = NULL;
-    gretl_vector *ei = NULL;
-    gretl_matrix *Xi = NULL;
-    gretl_vector *eXi = NULL;
-    const double *cZ;
-    const double *wgt = NULL;
-    int n_c, M, N, k = pmod->ncoeff;
-    int total_obs = 0;
-    int i, j, v, t;
-
-    cZ = dset->Z[cvar];
-    N = cval_count_max(pmod, cvals, cZ);
-#if CDEBUG
-    fprintf(stderr, "max cval count = %d\n", N);
-#endif
+    gretl_matrix *S = NULL;
+    int k = pmod->ncoeff;
+    int mask, nmask, nbits;
+    int M, N, nused;
+    int *cid;
 
-    V   = gretl_matrix_alloc(k, k);
-    W   = gretl_zero_matrix_new(k, k);
-    XXW = gretl_zero_matrix_new(k, k);
-    ei  = gretl_column_vector_alloc(N);
-    Xi  = gretl_matrix_alloc(N, k);
-    eXi = gretl_vector_alloc(k);
+    V   = gretl_zero_matrix_new(k, k);
+    Vs  = gretl_matrix_alloc(k, k);
+    W   = gretl_matrix_alloc(k, k);
+    XXW = gretl_matrix_alloc(k, k);
 
-    if (V == NULL || W == NULL || XXW == NULL ||
-	ei == NULL || Xi == NULL || eXi == NULL) {
+    if (V == NULL || Vs == NULL || W == NULL || XXW == NULL) {
 	*err = E_ALLOC;
 	goto bailout;
     }
 
-    if (pmod->nwt) {
-	wgt = dset->Z[pmod->nwt];
-    }
-
-    M = gretl_vector_get_length(cvals);
-    n_c = 0;
+    *nmin = 0;
+    nmask = 1 << clist[0];
 
-    for (i=0; i<M; i++) {
-	double cvi = cvals->val[i];
-	int Ni = cval_count(pmod, cvi, cZ);
-	int s = 0;
+    for (mask=1; mask<nmask && !*err; mask++) {
+	cid = gretl_model_cluster_ids(pmod, clist, mask, dset, &M, err);
+	if (!*err) {
+	    S = cluster_scores(pmod, dset, cid, M, &nused, err);
+	}
+	free(cid);
+	if (*err) {
+	    break;
+	}
 
-	if (Ni == 0) {
-	    continue;
+	if (M < 2) {
+	    gretl_errmsg_set("Invalid clustering variable");
+	    *err = E_DATA;
+	} else if (nused < pmod->nobs) {
+	    *err = E_MISSDATA;
 	}
 
+	if (!*err) {
+	    /* W = sum over clusters of the outer products of the
+	       score sums; form V(W) = (X'X)^{-1} W (X'X)^{-1} */
+	    gretl_matrix_multiply_mod(S, GRETL_MOD_TRANSPOSE,
+				      S, GRETL_MOD_NONE,
+				      W, GRETL_MOD_NONE);
+	    gretl_matrix_multiply(XX, W, XXW);
+	    gretl_matrix_multiply(XXW, XX, Vs);
+	    gretl_matrix_xtr_symmetric(Vs);
 #if CDEBUG
-	fprintf(stderr, "i=%d, cvi=%g, Ni=%d\n", i, cvi, Ni);
+	    fprintf(stderr, "mask %d: %d clusters\n", mask, M);
+	    gretl_matrix_print(W, "W");
+	    gretl_matrix_print(Vs, "Vs");
 #endif
-	ei = gretl_matrix_reuse(ei, Ni, -1);
-	Xi = gretl_matrix_reuse(Xi, Ni, -1);
-
-	for (t=pmod->t1; t<=pmod->t2; t++) {
-	    if (!na(pmod->uhat[t]) && cZ[t] == cvi) {
-		gretl_vector_set(ei, s, pmod->uhat[t]);
-		for (j=0; j<k; j++) {
-		    v = pmod->list[j+2];
-		    if (wgt != NULL) {
-			gretl_matrix_set(Xi, s, j, dset->Z[v][t] * sqrt(wgt[t]));
-		    } else {
-			gretl_matrix_set(Xi, s, j, dset->Z[v][t]);
-		    }
-		}
-		s++;
+	    if (!(pmod->opt & OPT_N)) {
+		/* apply df adjustment a la Stata */
+		/* FIXME IVREG case? */
+		double dfadj;
+
+		N = pmod->nobs;
+		dfadj = (M/(M-1.0)) * (N-1.0)/(N-k);
+		gretl_matrix_multiply_by_scalar(Vs, dfadj);
 	    }
-	    if (s == Ni) {
-		/* we've filled this matrix */
-		break;
+	    nbits = gretl_cluster_mask_size(mask);
+	    if (nbits % 2 == 0) {
+		gretl_matrix_multiply_by_scalar(Vs, -1.0);
+	    }
+	    gretl_matrix_add_to(V, Vs);
+	    if (nbits == 1 && (*nmin == 0 || M < *nmin)) {
+		*nmin = M;
 	    }
 	}
 
-	gretl_matrix_multiply_mod(ei, GRETL_MOD_TRANSPOSE,
-				  Xi, GRETL_MOD_NONE,
-				  eXi, GRETL_MOD_NONE);
-	gretl_matrix_multiply_mod(eXi, GRETL_MOD_TRANSPOSE,
-				  eXi, GRETL_MOD_NONE,
-				  W, GRETL_MOD_CUMULATE);
-#if CDEBUG > 1
-	gretl_matrix_print(ei, "e(i)");
-	gretl_matrix_print(Xi, "X(i)");
-	gretl_matrix_print(W, "W");
-#endif
-	n_c++;
-	total_obs += s;
+	gretl_matrix_free(S);
+	S = NULL;
     }
 
-    if (n_c < 2) {
-	gretl_errmsg_set("Invalid clustering variable");
-	*err = E_DATA;
-	goto bailout;
-    } else if (total_obs < pmod->nobs) {
-	*err = E_MISSDATA;
-	goto bailout;
-    }
-
-    /* form V(W) = (X'X)^{-1} W (X'X)^{-1} */
-    gretl_matrix_multiply(XX, W, XXW);
-    gretl_matrix_multiply(XXW, XX, V);
-    gretl_matrix_xtr_symmetric(V);
-
-#if CDEBUG
-    gretl_matrix_print(XX, "X'X^{-1}");
-    gretl_matrix_print(W, "W");
-    gretl_matrix_print(V, "V");
-#endif
-
-    if (!(pmod->opt & OPT_N)) {
-	/* apply df adjustment a la Stata */
-	/* FIXME IVREG case? */
-	double dfadj;
-
-	N = pmod->nobs;
-	dfadj = (M/(M-1.0)) * (N-1.0)/(N-k);
-	gretl_matrix_multiply_by_scalar(V, dfadj);
-#if CDEBUG > 1
-	gretl_matrix_print(V, "V(adjusted)");
-#endif
-
+    if (!*err && clist[0] > 1) {
+	*err = gretl_model_cluster_vcv_fixup(V);
     }
 
  bailout:
 
+    gretl_matrix_free(Vs);
     gretl_matrix_free(W);
     gretl_matrix_free(XXW);
-    gretl_matrix_free(ei);
-    gretl_matrix_free(Xi);
-    gretl_matrix_free(eXi);
 
     if (*err) {
 	gretl_matrix_free(V);
@@ -1938,59 +1930,6 @@ static gretl_matrix *cluster_vcv_calc (MODEL *pmod,
     return V;
 }
 
-/* Get the sorted values of the clustering series, @cvar, checking
-   for missing values as we go. This is a little more complicated
-   if there are interior missing values for the regressand or
-   regressors: in that case we need to construct a temporary
-   array to hold the relevant values of the clustering series.
-*/
-
-static gretl_matrix *cluster_var_values (const double *cvar,
-					 MODEL *pmod,
-					 int *err)
-{
-    gretl_matrix *cvals = NULL;
-    int t;
-
-    if (pmod->missmask != NULL) {
-	double *ctmp = malloc(pmod->nobs * sizeof *ctmp);
-
-	if (ctmp == NULL) {
-	    *err = E_ALLOC;
-	} else {
-	    int i = 0;
-
-	    for (t=pmod->t1; t<=pmod->t2 && !*err; t++) {
-		if (pmod->missmask[t] != '1') {
-		    if (na(cvar[t])) {
-			*err = E_MISSDATA;
-		    } else {
-			ctmp[i++] = cvar[t];
-		    }
-		}
-	    }
-
-	    if (!*err) {
-		cvals = gretl_matrix_values(ctmp, pmod->nobs, OPT_S, err);
-	    }
-	    free(ctmp);
-	}
-    } else {
-	/* no interior missing values for y or X */
-	for (t=pmod->t1; t<=pmod->t2 && !*err; t++) {
-	    if (na(cvar[t])) {
-		*err = E_MISSDATA;
-	    }
-	}
-	if (!*err) {
-	    cvals = gretl_matrix_values(cvar + pmod->t1, pmod->nobs,
-					OPT_S, err);
-	}
-    }
-
-    return cvals;
-}
-
 static int cluster_vcv_ci;
 
 /**
@@ -2001,8 +1940,8 @@ static int cluster_vcv_ci;
  * @XX: X'X matrix.
  *
  * Compute and set on @pmod a variance matrix that is "clustered"
- * by the value of a selected variable via the --cluster=foo
- * command-line option.
+ * by the value(s) of one or more variables selected via the
+ * --cluster=foo command-line option.
  *
  * Returns: 0 on success, non-zero code on error.
  */
@@ -2012,10 +1951,9 @@ static int qr_make_cluster_vcv (MODEL *pmod, int ci,
 				gretl_matrix *XX,
 				gretlopt opt)
 {
-    gretl_matrix *cvals = NULL;
     gretl_matrix *V = NULL;
-    const char *cname;
-    int cvar, n_c = 0;
+    int *clist;
+    int n_c = 0;
     int err = 0;
 
     if (pmod->ci != OLS && pmod->ci != IVREG && pmod->ci != WLS) {
@@ -2028,35 +1966,15 @@ static int qr_make_cluster_vcv (MODEL *pmod, int ci,
 	cluster_vcv_ci = 0;
     }
 
-    cname = get_optval_string(ci, OPT_C);
-    if (cname == NULL) {
-	gretl_errmsg_set("Got --cluster option but couldn't find varname");
-	return E_PARSE;
-    }
-
-    cvar = current_series_index(dset, cname);
-    if (cvar < 1 || cvar >= dset->v) {
-	err = E_UNKVAR;
-    }
-
-    if (!err) {
-	cvals = cluster_var_values(dset->Z[cvar], pmod, &err);
-	if (!err) {
-	    n_c = gretl_vector_get_length(cvals);
-	    if (n_c < 2) {
-		err = E_DATA;
-	    }
-	}
-    }
+    clist = gretl_model_get_cluster_list(ci, dset, &err);
 
 #if CDEBUG
     fprintf(stderr, "qr_make_cluster_vcv: err = %d\n", err);
-    fprintf(stderr, "cluster var = %s (%d)\n", cname, cvar);
-    gretl_matrix_print(cvals, "cvals");
+    printlist(clist, "cluster list");
 #endif
 
     if (!err) {
-	V = cluster_vcv_calc(pmod, cvar, cvals, XX, dset, &err);
+	V = cluster_vcv_calc(pmod, clist, XX, dset, &n_c, &err);
     }
 
     if (!err) {
@@ -2064,12 +1982,12 @@ static int qr_make_cluster_vcv (MODEL *pmod, int ci,
     }
 
     if (!err) {
-	gretl_model_set_vcv_info(pmod, VCV_CLUSTER, cvar);
-	gretl_model_set_int(pmod, "n_clusters", n_c);
+	gretl_model_set_cluster_info(pmod, clist, n_c);
+    } else {
+	free(clist);
     }
 
     gretl_matrix_free(V);
-    gretl_matrix_free(cvals);
 
     return err;
 }
@@ -349,7 +349,7 @@ static void sync_datainfo_members (const DATASET *dset)
 		fullset->v - dset->v);
 #endif
 	for (i=dset->v; i<fullset->v; i++) {
-	    free(fullset->Z[i]);
+	    series_data_free(fullset->Z[i]);
 	    fullset->Z[i] = NULL;
 	}
 	fullset->v = dset->v;
@@ -1114,6 +1114,38 @@ double matrix_get_element (const gretl_matrix *M, int i, int *err)
     return x;
 }
 
+/* Get the offset and dimensions of the contiguous chunk of
+   data in @M that is selected by @spec.
+*/
+
+static int get_chunk_dims (const gretl_matrix *M,
+			   matrix_subspec *spec,
+			   int *offset, int *rows,
+			   int *cols)
+{
+    int nelem = spec->lsel.range[1];
+
+    *offset = spec->lsel.range[0];
+
+    if (*offset < 0) {
+	fprintf(stderr, "matrix_get_chunk: offset = %d\n", *offset);
+	return E_DATA;
+    }
+
+    if (M->cols > 1 && M->rows > 1) {
+	*cols = contig_cols(spec, M);
+	*rows = nelem / *cols;
+    } else if (M->rows == 1) {
+	*rows = 1;
+	*cols = nelem;
+    } else {
+	*rows = nelem;
+	*cols = 1;
+    }
+
+    return 0;
+}
+
 /* Copy a contiguous chunk of data out of @M, the offset and
    extent of which are given by @spec.
 */
@@ -1122,28 +1154,16 @@ gretl_matrix *matrix_get_chunk (const gretl_matrix *M,
 				matrix_subspec *spec,
 				int *err)
 {
-    int offset = spec->lsel.range[0];
-    int nelem = spec->lsel.range[1];
     gretl_matrix *ret;
+    int offset, nelem;
     int rows, cols;
 
-    if (offset < 0) {
-	fprintf(stderr, "matrix_get_chunk: offset = %d\n", offset);
-	*err = E_DATA;
+    *err = get_chunk_dims(M, spec, &offset, &rows, &cols);
+    if (*err) {
 	return NULL;
     }
 
-    if (M->cols > 1 && M->rows > 1) {
-	cols = contig_cols(spec, M);
-	rows = nelem / cols;
-    } else if (M->rows == 1) {
-	rows = 1;
-	cols = nelem;
-    } else {
-	rows = nelem;
-	cols = 1;
-    }
-
+    nelem = rows * cols;
     ret = gretl_matching_matrix_new(rows, cols, M);
 
     if (ret == NULL) {
@@ -1167,6 +1187,35 @@ gretl_matrix *matrix_get_chunk (const gretl_matrix *M,
     return ret;
 }
 
+/* Like matrix_get_chunk(), but without copying: the return
+   value is a view onto the data of @M (see gretl_matrix_view_new()),
+   which must be freed using gretl_matrix_view_free().
+*/
+
+gretl_matrix *matrix_get_chunk_view (const gretl_matrix *M,
+				     matrix_subspec *spec,
+				     int *err)
+{
+    gretl_matrix *ret;
+    int offset, rows, cols;
+
+    *err = get_chunk_dims(M, spec, &offset, &rows, &cols);
+    if (*err) {
+	return NULL;
+    }
+
+    ret = gretl_matrix_view_new(M, offset, rows, cols);
+
+    if (ret == NULL) {
+	*err = E_ALLOC;
+    } else if (M->rows > 1 && rows == M->rows && offset == 0 &&
+	       gretl_matrix_is_dated(M)) {
+	matrix_transcribe_dates(ret, M);
+    }
+
+    return ret;
+}
+
 /* Handle the case where we got a single string as argument
    to colnames() or rownames(), for a matrix with more than
    one column or row: construct specific names by appending
@@ -163,6 +163,10 @@ gretl_matrix *matrix_get_chunk (const gretl_matrix *M,
 				matrix_subspec *spec,
 				int *err);
 
+gretl_matrix *matrix_get_chunk_view (const gretl_matrix *M,
+				     matrix_subspec *spec,
+				     int *err);
+
 int *mspec_make_list (int type, union msel *sel, int n,
 		      int *err);
 
@@ -38,10 +38,6 @@
 #define UVDEBUG 0
 #define HDEBUG 0
 
-#if HDEBUG && defined(_OPENMP)
-# include <omp.h>
-#endif
-
 #define LEVEL_AUTO -1
 #define LEV_PRIVATE -1
 
@@ -98,6 +94,7 @@ static user_var *user_var_new (const char *name, int type,
 	*u->name = '\0';
 	strncat(u->name, name, VNAMELEN - 1);
 	u->ptr = NULL;
+	u->hnext = NULL;
 
 	if (type == GRETL_TYPE_MATRIX) {
 	    gretl_matrix *m = value;
@@ -178,65 +175,79 @@ static void uvar_free_value (user_var *u)
     }
 }
 
-static GHashTable *uvh0;       /* for use at "main" exec level */
-static GHashTable *uvh1;       /* for use within functions */
-static GHashTable *uvars_hash; /* pointer to one or other of the above */
-static int previous_d = -1;    /* record of previous "function depth" */
+/* Index of user variables by name. Variables at different levels
+   of function execution may share a name, so the hash table maps a
+   name to the first such variable (in order of addition to the
+   @uvars stack), and the rest are chained via their @hnext members.
+   The index is maintained as variables are added, destroyed and
+   renamed, so that it always agrees with the stack. (The level of
+   a variable may change without any effect on the index.)
+*/
+
+static GHashTable *uvars_hash;
 
-void set_previous_depth (int d)
+static void uvar_hash_add (user_var *u)
 {
-    previous_d = d;
-}
+    user_var *prev;
 
-static int get_previous_depth (void)
-{
-    return previous_d;
+    u->hnext = NULL;
+
+    if (uvars_hash == NULL) {
+	uvars_hash = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+
+    prev = g_hash_table_lookup(uvars_hash, u->name);
+
+    if (prev == NULL) {
+	g_hash_table_insert(uvars_hash, u->name, u);
+    } else {
+	while (prev->hnext != NULL) {
+	    prev = prev->hnext;
+	}
+	prev->hnext = u;
+    }
 }
 
-void switch_uservar_hash (int level)
+static void uvar_hash_remove (user_var *u)
 {
-#if HDEBUG && defined(_OPENMP)
-    fprintf(stderr, "switch_uservar_hash: level %d, nthreads %d\n",
-	    level, omp_get_num_threads());
-#endif
+    user_var *prev;
+
+    if (uvars_hash == NULL) {
+	return;
+    }
+
+    prev = g_hash_table_lookup(uvars_hash, u->name);
 
-    if (level == 0) {
-	uvars_hash = uvh0;
-	if (uvh1 != NULL) {
-	    g_hash_table_remove_all(uvh1);
+    if (prev == u) {
+	if (u->hnext != NULL) {
+	    /* note: the key must be updated too */
+	    g_hash_table_replace(uvars_hash, u->hnext->name, u->hnext);
+	} else {
+	    g_hash_table_remove(uvars_hash, u->name);
 	}
     } else {
-	uvars_hash = uvh1;
+	while (prev != NULL) {
+	    if (prev->hnext == u) {
+		prev->hnext = u->hnext;
+		break;
+	    }
+	    prev = prev->hnext;
+	}
     }
+
+    u->hnext = NULL;
 }
 
 static void uvar_hash_destroy (void)
 {
 #if HDEBUG
-    fprintf(stderr, "uvar_hash_destroy (uvh0=%p, uvh1=%p)\n",
-	    (void *) uvh0, (void *) uvh1);
+    fprintf(stderr, "uvar_hash_destroy (%p)\n", (void *) uvars_hash);
 #endif
 
-    if (uvh0 != NULL) {
-#if HDEBUG
-	fprintf(stderr, " destroying uvh0\n");
-#endif
-	g_hash_table_destroy(uvh0);
-	uvh0 = NULL;
-    }
-
-    if (uvh1 != NULL) {
-#if HDEBUG
-	fprintf(stderr, " destroying uvh1\n");
-#endif
-	g_hash_table_destroy(uvh1);
-	uvh1 = NULL;
+    if (uvars_hash != NULL) {
+	g_hash_table_destroy(uvars_hash);
+	uvars_hash = NULL;
     }
-
-    /* also NULL the convenience pointer */
-    uvars_hash = NULL;
-
-    set_previous_depth(-1);
 }
 
 static void user_var_destroy (user_var *u)
@@ -245,16 +256,7 @@ static void user_var_destroy (user_var *u)
     fprintf(stderr, "user_var_destroy: '%s' (level %d)\n", u->name, u->level);
 #endif
 
-    if (uvars_hash != NULL) {
-# if HDEBUG
-	if (g_hash_table_remove(uvars_hash, u->name)) {
-	    fprintf(stderr, "removed '%s' from hash table at %p\n",
-		    u->name, (void *) uvars_hash);
-	}
-# else
-	g_hash_table_remove(uvars_hash, u->name);
-# endif
-    }
+    uvar_hash_remove(u);
 
     if (!var_is_shell(u)) {
 	uvar_free_value(u);
@@ -341,6 +343,7 @@ static int real_user_var_add (const char *name,
 		u->flags |= UV_NODECL;
 	    }
 	    uvars[n_vars] = u;
+	    uvar_hash_add(u);
 	    set_nvars(n_vars + 1, "user_var_add");
 	}
     }
@@ -479,151 +482,48 @@ int user_var_delete (user_var *uvar)
     return err;
 }
 
-#if HDEBUG > 1
-
-static int uvar_index (user_var *u)
-{
-    int i;
-
-    for (i=0; i<n_vars; i++) {
-	if (u == uvars[i]) {
-	    return i;
-	}
-    }
-
-    return -1;
-}
-
-#endif
-
-/* Try to guess whether the currently-called function is big enough
-   (number of lines of code) to make it worthwhile to construct a hash
-   table for uservars at its level of execution, namely @uvh1, given
-   that we'll have to empty the table on exit from the function.
-
-   The number-of-lines threshold here is obviously kinda arbitrary;
-   some systematic experimentation might be useful.
-*/
-
-static inline int use_uvh1 (void)
-{
-    return current_function_size() > 40;
-}
-
 user_var *get_user_var_of_type_by_name (const char *name,
 					GretlType type)
 {
-    int prev_d = get_previous_depth();
     int d = gretl_function_depth();
-    int i, imin = 0;
+    int i;
     user_var *u = NULL;
 
     if (name == NULL || *name == '\0') {
 	return NULL;
     }
 
-    if (type == GRETL_TYPE_DOUBLE) {
-	/* support "auxiliary scalars" mechanism */
-	imin = scalar_imin;
-    }
-
 #if HDEBUG > 1
-    int hfound = 0;
-
     fprintf(stderr, "get user var: '%s', %s (n_vars=%d, level=%d, "
-	    "previous=%d, imin=%d)\n", name, gretl_type_get_name(type),
-	    n_vars, d, prev_d, imin);
-# if HDEBUG > 2
-    fputs("uvars list:\n", stderr);
-    for (i=0; i<n_vars; i++) {
-	fprintf(stderr, " %d: '%s', %s, level %d, ptr %p\n", i,
-		uvars[i]->name, gretl_type_get_name(uvars[i]->type),
-		uvars[i]->level, uvars[i]->ptr);
-    }
-# endif
+	    "imin=%d)\n", name, gretl_type_get_name(type),
+	    n_vars, d, scalar_imin);
 #endif
 
-    if (d != prev_d) {
-	if (d == 0) {
-	    /* we're now at "main" level */
-	    if (uvh0 == NULL) {
-		uvh0 = g_hash_table_new(g_str_hash, g_str_equal);
-#if HDEBUG
-		fprintf(stderr, "uvh0: d=0, allocated at %p\n", uvh0);
-#endif
-	    }
-	    if (uvh1 != NULL) {
-#if HDEBUG
-		fprintf(stderr, "d=0, prev=%d: clear uvh1 at %p\n",
-			prev_d, uvh1);
-#endif
-		g_hash_table_remove_all(uvh1);
-	    }
-	    uvars_hash = uvh0;
-	} else if (!use_uvh1()) {
-	    /* exec'ing a function, hash table not wanted */
-	    if (prev_d > 0 && uvh1 != NULL) {
-		g_hash_table_remove_all(uvh1);
-	    }
-	    uvars_hash = NULL;
-	} else {
-	    /* exec'ing a function, hash table wanted */
-	    if (uvh1 == NULL) {
-		uvh1 = g_hash_table_new(g_str_hash, g_str_equal);
-#if HDEBUG
-		fprintf(stderr, "uvh1: d=%d, prev=%d, allocated at %p\n",
-			d, prev_d, uvh1);
-#endif
-	    } else if (prev_d > 0 && uvh1 != NULL) {
-#if HDEBUG
-		fprintf(stderr, "d=%d, prev=%d: clear uvh1 at %p\n",
-			d, prev_d, uvh1);
-#endif
-		g_hash_table_remove_all(uvh1);
-	    }
-	    uvars_hash = uvh1;
-	}
-	set_previous_depth(d);
-    }
-
-    if (uvars_hash != NULL) {
-	/* first resort: try a hash look-up */
-	u = g_hash_table_lookup(uvars_hash, name);
-	/* but verify type, if specified */
-	if (u != NULL && type != GRETL_TYPE_ANY && u->type != type) {
-	    u = NULL;
-	}
-#if HDEBUG > 1
-	if (u != NULL) hfound = 1;
-#endif
-    }
-
-    if (u == NULL) {
-	/* "On demand" hashing: if we're successful in looking
-	   up a variable in the traditional manner, then
-	   insert it into the uservars hash table.
+    if (type == GRETL_TYPE_DOUBLE && scalar_imin > 0) {
+	/* "auxiliary scalars" mechanism: the search must be
+	   confined to the top of the stack
 	*/
-	for (i=imin; i<n_vars; i++) {
+	for (i=scalar_imin; i<n_vars; i++) {
 	    if (uvars[i]->level == d &&
-		(type == GRETL_TYPE_ANY || uvars[i]->type == type) &&
+		uvars[i]->type == type &&
 		!strcmp(uvars[i]->name, name)) {
 		u = uvars[i];
-		if (uvars_hash != NULL) {
-		    g_hash_table_insert(uvars_hash, u->name, u);
-		}
 		break;
 	    }
 	}
+    } else if (uvars_hash != NULL) {
+	u = g_hash_table_lookup(uvars_hash, name);
+	while (u != NULL) {
+	    if (u->level == d &&
+		(type == GRETL_TYPE_ANY || u->type == type)) {
+		break;
+	    }
+	    u = u->hnext;
+	}
     }
 
 #if HDEBUG > 1
-    if (hfound)
-	fprintf(stderr, "found at pos %d via hash (%s)\n\n", uvar_index(u),
-		uvars_hash == uvh1 ? "uvh1" : "uvh0");
-    else if (u != NULL)
-	fprintf(stderr, "found at pos %d via regular search\n\n", uvar_index(u));
-    else
-	fprintf(stderr, "not found\n\n");
+    fprintf(stderr, "%s\n\n", u != NULL ? "found" : "not found");
 #endif
 
     return u;
@@ -797,8 +697,10 @@ int user_var_set_name (user_var *uvar, const char *name)
     if (uvar == NULL) {
 	err = E_DATA;
     } else {
+	uvar_hash_remove(uvar);
 	*uvar->name = '\0';
 	strncat(uvar->name, name, VNAMELEN - 1);
+	uvar_hash_add(uvar);
     }
 
     return err;
@@ -1264,8 +1166,8 @@ void destroy_user_vars (void)
     int i, j;
 
 #if HDEBUG
-    fprintf(stderr, "destroy_user_vars, uvars_hash = %p (uvh0 %p, uvh1 %p)\n",
-	    (void *) uvars_hash, (void *) uvh0, (void *) uvh1);
+    fprintf(stderr, "destroy_user_vars, uvars_hash = %p\n",
+	    (void *) uvars_hash);
 #endif
 
     for (i=0; i<n_vars; i++) {
@@ -1280,9 +1182,7 @@ void destroy_user_vars (void)
 	i--;
     }
 
-    if (uvh0 != NULL || uvh1 != NULL) {
-	uvar_hash_destroy();
-    }
+    uvar_hash_destroy();
 
     set_nvars(0, "destroy_user_vars");
 
@@ -26,6 +26,7 @@ struct user_var_ {
     UVFlags flags;
     char name[VNAMELEN];
     void *ptr;
+    user_var *hnext; /* next variable with the same name, if any */
 };
 
 #define uvar_set_scalar_fast(u,x) (*(double *) u->ptr = x)
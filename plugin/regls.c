@@ -40,17 +40,6 @@
 # include "gretl_foreign.h"
 #endif
 
-#if defined(USE_AVX)
-# define USE_SIMD
-# if defined(HAVE_IMMINTRIN_H)
-#  include <immintrin.h>
-# else
-#  include <mmintrin.h>
-#  include <xmmintrin.h>
-#  include <emmintrin.h>
-# endif
-#endif
-
 #define ADMM_MAX_ITER 20000
 #define ADMM_RELTOL_DEFAULT 1.0e-4
 #define ADMM_ABSTOL_DEFAULT 1.0e-6
@@ -420,69 +409,23 @@ static inline double max (double x, double y)
     return x >= y ? x : y;
 }
 
-#if defined(USE_SIMD)
-
-static inline double hsum_double_avx (__m256d v)
-{
-    __m128d vlow  = _mm256_castpd256_pd128(v);
-    __m128d vhigh = _mm256_extractf128_pd(v, 1);
-    __m128d high64;
-
-    vlow   = _mm_add_pd(vlow, vhigh);
-    high64 = _mm_unpackhi_pd(vlow, vlow);
-    return  _mm_cvtsd_f64(_mm_add_sd(vlow, high64));
-}
+/* The basic vector operations go via libgretl's SIMD kernels,
+   which are selected at run time according to the capabilities
+   of the CPU.
+*/
 
 static void vector_add_into (const gretl_vector *a,
 			     const gretl_vector *b,
 			     gretl_vector *c, int n)
 {
-    const double *ax = a->val;
-    const double *bx = b->val;
-    double *cx = c->val;
-    int imax = n / 4;
-    int rem = n % 4;
-    int i;
-
-    __m256d a256, b256, c256;
-
-    for (i=0; i<imax; i++) {
-	a256 = _mm256_loadu_pd(ax);
-	b256 = _mm256_loadu_pd(bx);
-	c256 = _mm256_add_pd(a256, b256);
-	_mm256_storeu_pd(cx, c256);
-	ax += 4;
-	bx += 4;
-	cx += 4;
-    }
-    for (i=0; i<rem; i++) {
-	cx[i] = ax[i] + bx[i];
-    }
+    gretl_simd_add(a->val, b->val, c->val, n);
 }
 
 static void vector_add_to (gretl_vector *a,
 			   const gretl_vector *b,
 			   int n)
 {
-    double *ax = a->val;
-    const double *bx = b->val;
-    int imax = n / 4;
-    int rem = n % 4;
-    int i;
-
-    __m256d a256, b256, sum;
-
-    for (i=0; i<imax; i++) {
-	a256 = _mm256_loadu_pd(ax);
-	b256 = _mm256_loadu_pd(bx);
-	sum = _mm256_add_pd(a256, b256);
-	_mm256_storeu_pd(ax, sum);
-	ax += 4;
-	bx += 4;
-    }
-    for (i=0; i<rem; i++) {
-	ax[i] += bx[i];
-    }
+    gretl_simd_add(a->val, b->val, a->val, n);
 }
 
 /* a = a - b */
@@ -491,25 +434,7 @@ static void vector_subtract_from (gretl_vector *a,
 				  const gretl_vector *b,
 				  int n)
 {
-    double *ax = a->val;
-    const double *bx = b->val;
-    int imax = n / 4;
-    int rem = n % 4;
-    int i;
-
-    __m256d a256, b256, dif;
-
-    for (i=0; i<imax; i++) {
-	a256 = _mm256_loadu_pd(ax);
-	b256 = _mm256_loadu_pd(bx);
-	dif = _mm256_sub_pd(a256, b256);
-	_mm256_storeu_pd(ax, dif);
-	ax += 4;
-	bx += 4;
-    }
-    for (i=0; i<rem; i++) {
-	ax[i] -= bx[i];
-    }
+    gretl_simd_subtract(a->val, b->val, a->val, n);
 }
 
 /* c = a - b */
@@ -518,181 +443,26 @@ static void vector_subtract_into (const gretl_vector *a,
 				  const gretl_vector *b,
 				  gretl_vector *c, int n,
 				  int cumulate)
-{
-    const double *ax = a->val;
-    const double *bx = b->val;
-    double *cx = c->val;
-    int imax = n / 4;
-    int rem = n % 4;
-    int i;
-
-    __m256d a256, b256, c256;
-
-    for (i=0; i<imax; i++) {
-	a256 = _mm256_loadu_pd(ax);
-	b256 = _mm256_loadu_pd(bx);
-	if (cumulate) {
-	    __m256d d256 = _mm256_sub_pd(a256, b256);
-
-	    c256 = _mm256_loadu_pd(cx);
-	    d256 = _mm256_add_pd(c256, d256);
-	    _mm256_storeu_pd(cx, d256);
-	} else {
-	    c256 = _mm256_sub_pd(a256, b256);
-	    _mm256_storeu_pd(cx, c256);
-	}
-	ax += 4;
-	bx += 4;
-	cx += 4;
-    }
-    for (i=0; i<rem; i++) {
-	if (cumulate) {
-	    cx[i] += ax[i] - bx[i];
-	} else {
-	    cx[i] = ax[i] - bx[i];
-	}
-    }
-}
-
-/* compute q = rho * (b - u) + X'y */
-
-static inline void compute_q (gretl_vector *q,
-			      const gretl_vector *b,
-			      const gretl_vector *u,
-			      const gretl_vector *a, /* X'y */
-			      double rho, int n)
-{
-    __m256d b256, u256, a256;
-    __m256d r256, tmp;
-    const double *bx = b->val;
-    const double *ux = u->val;
-    const double *ax = a->val;
-    double *qx = q->val;
-    const int mul = rho != 1.0;
-    int imax = n / 4;
-    int rem = n % 4;
-    int i;
-
-    if (mul) {
-	/* broadcast rho */
-	r256 = _mm256_broadcast_sd(&rho);
-    }
-
-    for (i=0; i<imax; i++) {
-	b256 = _mm256_loadu_pd(bx);
-	u256 = _mm256_loadu_pd(ux);
-	a256 = _mm256_loadu_pd(ax);
-	/* subtract u from b */
-	tmp = _mm256_sub_pd(b256, u256);
-	if (mul) {
-	    /* multiply by rho */
-	    tmp = _mm256_mul_pd(tmp, r256);
-	}
-	/* add a */
-	tmp = _mm256_add_pd(tmp, a256);
-	/* write result into q */
-	_mm256_storeu_pd(qx, tmp);
-	bx += 4;
-	ux += 4;
-	ax += 4;
-	qx += 4;
-    }
-
-    for (i=0; i<rem; i++) {
-	if (mul) {
-	    qx[i] = rho * (bx[i] - ux[i]) + ax[i];
-	} else {
-	    qx[i] = bx[i] - ux[i] + ax[i];
-	}
-    }
-}
-
-static double dot_product (const double *x, const double *y, int n)
-{
-    double ret = 0.0;
-    int i, imax = n / 4;
-    int rem = n % 4;
-
-    __m256d x256, y256, tmp;
-
-    for (i=0; i<imax; i++) {
-	x256 = _mm256_loadu_pd(x);
-	y256 = _mm256_loadu_pd(y);
-	tmp = _mm256_mul_pd(x256, y256);
-	ret += hsum_double_avx(tmp);
-	x += 4;
-	y += 4;
-    }
-
-    for (i=0; i<rem; i++) {
-	ret += x[i] * y[i];
-    }
-
-    return ret;
-}
-
-#else
-
-static void vector_add_into (const gretl_vector *a,
-			     const gretl_vector *b,
-			     gretl_vector *c, int n)
-{
-    int i;
-
-    for (i=0; i<n; i++) {
-	c->val[i] = a->val[i] + b->val[i];
-    }
-}
-
-static void vector_add_to (gretl_vector *a,
-			   const gretl_vector *b,
-			   int n)
 {
     int i;
 
-    for (i=0; i<n; i++) {
-	a->val[i] += b->val[i];
-    }
-}
-
-static void vector_subtract_from (gretl_vector *a,
-				  const gretl_vector *b,
-				  int n)
-{
-    int i;
-
-    for (i=0; i<n; i++) {
-	a->val[i] -= b->val[i];
+    if (!cumulate) {
+	gretl_simd_subtract(a->val, b->val, c->val, n);
+	return;
     }
-}
-
-static void vector_subtract_into (const gretl_vector *a,
-				  const gretl_vector *b,
-				  gretl_vector *c, int n,
-				  int cumulate)
-{
-    int i;
 
     for (i=0; i<n; i++) {
-	if (cumulate) {
-	    c->val[i] += a->val[i] - b->val[i];
-	} else {
-	    c->val[i] = a->val[i] - b->val[i];
-	}
+	c->val[i] += a->val[i] - b->val[i];
     }
 }
 
 static double dot_product (const double *x, const double *y, int n)
 {
-    double ret = 0.0;
-    int i;
-
-    for (i=0; i<n; i++) {
-	ret += x[i] * y[i];
-    }
-    return ret;
+    return gretl_simd_dot(x, y, n);
 }
 
+/* compute q = rho * (b - u) + X'y */
+
 static inline void compute_q (gretl_vector *q,
 			      const gretl_vector *b,
 			      const gretl_vector *u,
@@ -711,8 +481,6 @@ static inline void compute_q (gretl_vector *q,
     }
 }
 
-#endif /* AVX or not */
-
 static double own_dot_product (const gretl_vector *x)
 {
     int n = gretl_vector_get_length(x);